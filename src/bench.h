@@ -0,0 +1,18 @@
+#pragma once
+
+#include "defines.h"
+
+#define BENCH_DEPTH 11
+#define BENCH_HASH_MB 16
+
+typedef struct {
+    uint64_t nodes;
+    int64_t time; // ms
+    int positions;
+} BenchResult;
+
+// Searches a fixed set of positions to 'depth' (BENCH_DEPTH if 0) with one thread and a
+// cleared hash of BENCH_HASH_MB each, the node count only changes with the search itself
+void runBench(int depth, bool verbose, BenchResult* result);
+// Time, node signature and speed in the format the usual testing tools parse
+void printBenchResult(const BenchResult* result);
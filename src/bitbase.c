@@ -0,0 +1,100 @@
+#include "bitbase.h"
+
+// [strongToMove][pawn index][strong king] -> weak king squares where the pawn wins
+static Bitboard KPK[2][24][SQUARES];
+
+// Files a-d, ranks 2-7
+static inline int pawnIndex(int pawn) {
+    return squareFile(pawn) * 6 + squareRank(pawn) - 1;
+}
+
+// Squares adjacent to any square of the set
+static inline Bitboard kingSpread(Bitboard b) {
+    Bitboard left = (b >> 1) & ~FILE_H_BB;
+    Bitboard right = (b << 1) & ~FILE_A_BB;
+    Bitboard row = b | left | right;
+    return left | right | (row << 8) | (row >> 8);
+}
+
+// Retrograde analysis for one pawn square, the weak king squares of every
+// (strong king, side to move) pair are handled 64 at a time as a bitboard.
+// Pawn pushes lead to squares that are already solved, so only king moves
+// have to be iterated until nothing changes.
+static void solvePawnSquare(int pawn) {
+    Bitboard* winStrong = KPK[1][pawnIndex(pawn)];
+    Bitboard* winWeak = KPK[0][pawnIndex(pawn)];
+    Bitboard validStrong[SQUARES], validWeak[SQUARES], illegal[SQUARES], pushWins[SQUARES];
+    int next = pawn + 8;
+
+    for(int king = 0; king < SQUARES; king++) {
+        if(king == pawn) {
+            validStrong[king] = validWeak[king] = illegal[king] = pushWins[king] = 0;
+            winStrong[king] = winWeak[king] = 0;
+            continue;
+        }
+
+        Bitboard near = KING_ATTACKS[king] | squareBB(king) | squareBB(pawn);
+        validWeak[king] = ~near;
+        // the weak king can't be in check with the strong side to move
+        validStrong[king] = ~(near | PAWN_ATTACKS[TEAM_WHITE][pawn]);
+        // where the weak king can't go, a defended pawn is covered by KING_ATTACKS
+        illegal[king] = KING_ATTACKS[king] | squareBB(king) | PAWN_ATTACKS[TEAM_WHITE][pawn];
+
+        Bitboard wins = 0;
+        if(king != next) {
+            if(squareRank(pawn) == 6) {
+                // promotion wins unless the new queen is lost right away
+                wins = ~squareBB(next);
+                if(!(KING_ATTACKS[king] & squareBB(next)))
+                    wins &= ~KING_ATTACKS[next];
+            } else {
+                wins = KPK[0][pawnIndex(next)][king];
+                if(squareRank(pawn) == 1 && king != next + 8)
+                    wins |= KPK[0][pawnIndex(next + 8)][king] & ~squareBB(next);
+            }
+        }
+        pushWins[king] = wins & validStrong[king];
+        winStrong[king] = pushWins[king];
+        winWeak[king] = 0;
+    }
+
+    bool changed = true;
+    while(changed) {
+        changed = false;
+
+        // Weak side to move loses when every legal king move lands on a lost
+        // position, stalemate and capturing an undefended pawn draw
+        for(int king = 0; king < SQUARES; king++) {
+            Bitboard good = winStrong[king] | illegal[king];
+            Bitboard lost = validWeak[king] & ~kingSpread(~good) & kingSpread(~illegal[king]);
+            if(lost != winWeak[king]) {
+                winWeak[king] = lost;
+                changed = true;
+            }
+        }
+
+        // Strong side to move wins with any move reaching a lost position
+        for(int king = 0; king < SQUARES; king++) {
+            Bitboard won = pushWins[king];
+            Bitboard moves = KING_ATTACKS[king] & ~squareBB(pawn);
+            while(moves)
+                won |= winWeak[popLsb(&moves)];
+            won &= validStrong[king];
+            if(won != winStrong[king]) {
+                winStrong[king] = won;
+                changed = true;
+            }
+        }
+    }
+}
+
+void initBitbase(void) {
+    for(int file = 0; file < 4; file++) {
+        for(int rank = 6; rank >= 1; rank--)
+            solvePawnSquare(makeSquare(file, rank));
+    }
+}
+
+bool bitbaseProbeKPK(int strongKing, int pawn, int weakKing, bool strongToMove) {
+    return (KPK[strongToMove][pawnIndex(pawn)][strongKing] >> weakKing) & 1;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "bitboard.h"
+
+// King and pawn against king win/draw bitbase, 24 pawn squares * 64 white king
+// squares * 64 black king squares * side to move bits = 24 KB
+// Call it after initBitboards, takes well under a millisecond
+void initBitbase(void);
+
+// Squares are from the pawn owner's point of view (pawn moving up the board)
+// with the pawn on the a-d files, stm is the side to move relative to it
+bool bitbaseProbeKPK(int strongKing, int pawn, int weakKing, bool strongToMove);
@@ -0,0 +1,118 @@
+#include "bitboard.h"
+
+Bitboard PAWN_ATTACKS[TEAMS][SQUARES];
+Bitboard KNIGHT_ATTACKS[SQUARES];
+Bitboard KING_ATTACKS[SQUARES];
+Bitboard BETWEEN[SQUARES][SQUARES];
+
+// Line masks through a square, the square itself excluded
+static Bitboard FILE_MASKS[SQUARES];
+static Bitboard DIAG_MASKS[SQUARES];
+static Bitboard ANTI_DIAG_MASKS[SQUARES];
+// Attacks along the first rank, indexed by file and the 6 inner occupancy bits
+static uint8_t FIRST_RANK_ATTACKS[FILES][64];
+
+static Bitboard stepMask(int sq, const int (*steps)[2], int count) {
+    Bitboard b = 0;
+    for(int i = 0; i < count; i++) {
+        int f = squareFile(sq) + steps[i][0];
+        int r = squareRank(sq) + steps[i][1];
+        if(f >= 0 && f < FILES && r >= 0 && r < RANKS)
+            b |= squareBB(makeSquare(f, r));
+    }
+    return b;
+}
+
+static Bitboard rayMask(int sq, int df, int dr) {
+    Bitboard b = 0;
+    int f = squareFile(sq) + df, r = squareRank(sq) + dr;
+    while(f >= 0 && f < FILES && r >= 0 && r < RANKS) {
+        b |= squareBB(makeSquare(f, r));
+        f += df;
+        r += dr;
+    }
+    return b;
+}
+
+// Hyperbola quintessence, valid for any line mask that has one square per rank
+static inline Bitboard lineAttacks(int sq, Bitboard occupied, Bitboard mask) {
+    Bitboard forward = occupied & mask;
+    Bitboard reverse = __builtin_bswap64(forward);
+    forward -= squareBB(sq);
+    reverse -= __builtin_bswap64(squareBB(sq));
+    forward ^= __builtin_bswap64(reverse);
+    return forward & mask;
+}
+
+static inline Bitboard rankAttacks(int sq, Bitboard occupied) {
+    int shift = sq & 56;
+    int inner = (int)(occupied >> (shift + 1)) & 63;
+    return (Bitboard)FIRST_RANK_ATTACKS[squareFile(sq)][inner] << shift;
+}
+
+Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    return lineAttacks(sq, occupied, DIAG_MASKS[sq]) | lineAttacks(sq, occupied, ANTI_DIAG_MASKS[sq]);
+}
+
+Bitboard rookAttacks(int sq, Bitboard occupied) {
+    return lineAttacks(sq, occupied, FILE_MASKS[sq]) | rankAttacks(sq, occupied);
+}
+
+void initBitboards(void) {
+    static const int knightSteps[8][2] = {
+        {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}
+    };
+    static const int kingSteps[8][2] = {
+        {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+    };
+    static const int whitePawnSteps[2][2] = { {-1, 1}, {1, 1} };
+    static const int blackPawnSteps[2][2] = { {-1, -1}, {1, -1} };
+
+    for(int sq = 0; sq < SQUARES; sq++) {
+        KNIGHT_ATTACKS[sq] = stepMask(sq, knightSteps, 8);
+        KING_ATTACKS[sq] = stepMask(sq, kingSteps, 8);
+        PAWN_ATTACKS[TEAM_WHITE][sq] = stepMask(sq, whitePawnSteps, 2);
+        PAWN_ATTACKS[TEAM_BLACK][sq] = stepMask(sq, blackPawnSteps, 2);
+
+        FILE_MASKS[sq] = rayMask(sq, 0, 1) | rayMask(sq, 0, -1);
+        DIAG_MASKS[sq] = rayMask(sq, 1, 1) | rayMask(sq, -1, -1);
+        ANTI_DIAG_MASKS[sq] = rayMask(sq, -1, 1) | rayMask(sq, 1, -1);
+    }
+
+    for(int file = 0; file < FILES; file++) {
+        for(int inner = 0; inner < 64; inner++) {
+            int occupied = inner << 1;
+            uint8_t attacks = 0;
+            for(int f = file + 1; f < FILES; f++) {
+                attacks |= 1 << f;
+                if(occupied & (1 << f))
+                    break;
+            }
+            for(int f = file - 1; f >= 0; f--) {
+                attacks |= 1 << f;
+                if(occupied & (1 << f))
+                    break;
+            }
+            FIRST_RANK_ATTACKS[file][inner] = attacks;
+        }
+    }
+
+    for(int a = 0; a < SQUARES; a++) {
+        for(int b = 0; b < SQUARES; b++) {
+            BETWEEN[a][b] = 0;
+            if(a == b)
+                continue;
+            int df = squareFile(b) - squareFile(a);
+            int dr = squareRank(b) - squareRank(a);
+            if(df != 0 && dr != 0 && abs(df) != abs(dr))
+                continue;
+            df = (df > 0) - (df < 0);
+            dr = (dr > 0) - (dr < 0);
+            int sq = makeSquare(squareFile(a) + df, squareRank(a) + dr);
+            while(sq != b) {
+                BETWEEN[a][b] |= squareBB(sq);
+                sq = makeSquare(squareFile(sq) + df, squareRank(sq) + dr);
+            }
+        }
+    }
+}
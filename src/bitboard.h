@@ -0,0 +1,108 @@
+#pragma once
+
+#include "defines.h"
+
+typedef uint64_t Bitboard;
+
+// Squares are numbered a1 = 0, b1 = 1, ..., h8 = 63
+#define SQUARE_NONE 64
+
+#define FILE_A_BB 0x0101010101010101ULL
+#define FILE_H_BB (FILE_A_BB << 7)
+#define RANK_1_BB 0xFFULL
+#define RANK_8_BB (RANK_1_BB << 56)
+#define DARK_SQUARES_BB 0xAA55AA55AA55AA55ULL
+
+static inline int makeSquare(int file, int rank) {
+    return rank * 8 + file;
+}
+
+static inline int squareFile(int sq) {
+    return sq & 7;
+}
+
+static inline int squareRank(int sq) {
+    return sq >> 3;
+}
+
+// Rank as seen from the given team, 0 being its back rank
+static inline int relativeRank(PieceTeam team, int sq) {
+    return team == TEAM_WHITE ? squareRank(sq) : 7 - squareRank(sq);
+}
+
+// Mirrors the square vertically, a1 <-> a8
+static inline int flipSquare(int sq) {
+    return sq ^ 56;
+}
+
+static inline Bitboard squareBB(int sq) {
+    return 1ULL << sq;
+}
+
+static inline int popCount(Bitboard b) {
+    return __builtin_popcountll(b);
+}
+
+// @note b must not be empty
+static inline int lsb(Bitboard b) {
+    return __builtin_ctzll(b);
+}
+
+// @note b must not be empty
+static inline int msb(Bitboard b) {
+    return 63 - __builtin_clzll(b);
+}
+
+static inline int popLsb(Bitboard* b) {
+    int sq = lsb(*b);
+    *b &= *b - 1;
+    return sq;
+}
+
+static inline bool moreThanOne(Bitboard b) {
+    return (b & (b - 1)) != 0;
+}
+
+static inline bool isDarkSquare(int sq) {
+    return (DARK_SQUARES_BB >> sq) & 1;
+}
+
+static inline int fileDistance(int a, int b) {
+    return abs(squareFile(a) - squareFile(b));
+}
+
+static inline int rankDistance(int a, int b) {
+    return abs(squareRank(a) - squareRank(b));
+}
+
+static inline int squareDistance(int a, int b) {
+    int f = fileDistance(a, b), r = rankDistance(a, b);
+    return f > r ? f : r;
+}
+
+static inline Bitboard fileBB(int sq) {
+    return FILE_A_BB << squareFile(sq);
+}
+
+static inline Bitboard rankBB(int sq) {
+    return RANK_1_BB << (squareRank(sq) * 8);
+}
+
+extern Bitboard PAWN_ATTACKS[TEAMS][SQUARES];
+extern Bitboard KNIGHT_ATTACKS[SQUARES];
+extern Bitboard KING_ATTACKS[SQUARES];
+// Squares strictly between two aligned squares, empty if they aren't aligned
+extern Bitboard BETWEEN[SQUARES][SQUARES];
+
+void initBitboards(void);
+
+Bitboard bishopAttacks(int sq, Bitboard occupied);
+Bitboard rookAttacks(int sq, Bitboard occupied);
+
+static inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+}
+
+static inline Bitboard pawnPushes(PieceTeam team, Bitboard pawns) {
+    return team == TEAM_WHITE ? pawns << 8 : pawns >> 8;
+}
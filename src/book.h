@@ -0,0 +1,38 @@
+#pragma once
+
+#include "position.h"
+#include "platform.h"
+
+// Polyglot layout: 16 byte big endian entries sorted by key,
+// key u64, move u16, weight u16, learn u32
+#define BOOK_ENTRY_SIZE 16
+#define BOOK_MAX_MOVES 64
+
+typedef struct {
+    Move move;
+    uint16_t weight;
+    uint32_t learn;
+} BookEntry;
+
+// Read-only and never copied, one Book can be shared by every thread
+typedef struct {
+    MappedFile map;
+    uint64_t count;
+} Book;
+
+bool bookOpen(Book* book, const char* path);
+void bookClose(Book* book);
+
+// Polyglot's key of the position, books written by other programs match
+uint64_t bookKey(const Position* pos);
+
+// Polyglot's encoding of the move, castling becomes the king taking its rook
+uint16_t bookEncodeMove(Move move);
+// Writes one entry in file layout
+void bookWriteEntry(uint8_t* out, uint64_t key, uint16_t move, uint16_t weight, uint32_t learn);
+
+// Entries for the position ordered as in the file, only legal moves are returned
+int bookProbe(const Book* book, const Position* pos, BookEntry* out, int max);
+// Weighted random choice, MOVE_NONE when the position isn't in the book
+// @note 'seed' is the caller's random state so threads don't share one
+Move bookPick(const Book* book, const Position* pos, uint64_t* seed);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define null 0
+
+#define FILES 8
+#define RANKS 8
+#define SQUARES (FILES * RANKS)
+
+#define TEAMS 2
+#define PIECE_TYPES 6
+
+#define INFO(msg, ...) fprintf(stdout, "INFO: "msg, ##__VA_ARGS__)
+#define ERROR(msg, ...) fprintf(stderr, "ERROR: "msg, ##__VA_ARGS__)
+#define ASSERT(expr, msg, ...) do { if(!(expr)) { fprintf(stderr, "ASSERT FAILED! "msg, \
+                       ##__VA_ARGS__); exit(1); } } while(0)
+
+typedef enum {
+    TEAM_WHITE,
+    TEAM_BLACK
+} PieceTeam;
+
+typedef enum {
+    PAWN,
+    ROOK,
+    KNIGHT,
+    BISHOP,
+    QUEEN,
+    KING
+} PieceType;
@@ -0,0 +1,286 @@
+#include "endgame.h"
+#include "bitbase.h"
+
+#include <string.h>
+
+#define MAX_ENDGAMES 64
+
+static Endgame ENDGAMES[MAX_ENDGAMES];
+static int endgameCount = 0;
+
+static inline int minInt(int a, int b) {
+    return a < b ? a : b;
+}
+
+// Bonus for a king close to the edge and corners, 0 in the centre, 60 in a corner
+static inline int pushToEdge(int sq) {
+    int f = minInt(squareFile(sq), 7 - squareFile(sq));
+    int r = minInt(squareRank(sq), 7 - squareRank(sq));
+    return 10 * (6 - f - r);
+}
+
+static inline int pushClose(int a, int b) {
+    return 140 - 20 * squareDistance(a, b);
+}
+
+static inline int pushAway(int a, int b) {
+    return 120 - pushClose(a, b);
+}
+
+// Mirrors the square so that the strong team plays up the board and the
+// pawn (if any) is on the a-d files
+static int normalizeSquare(const Position* pos, PieceTeam strong, int sq) {
+    Bitboard pawns = pos->pieces[TEAM_WHITE][PAWN] | pos->pieces[TEAM_BLACK][PAWN];
+
+    if(pawns && squareFile(lsb(pawns)) >= 4)
+        sq ^= 7;
+    return strong == TEAM_WHITE ? sq : flipSquare(sq);
+}
+
+int evaluateKXK(const Position* pos, PieceTeam strong) {
+    PieceTeam weak = !strong;
+    int strongKing = kingSquare(pos, strong);
+    int weakKing = kingSquare(pos, weak);
+
+    // Stalemate detection with a lone king
+    if(pos->side == weak) {
+        MoveList list;
+        generateLegalMoves(pos, &list);
+        if(list.count == 0 && !positionInCheck(pos))
+            return 0;
+    }
+
+    int result = nonPawnMaterial(pos, strong)
+               + pos->counts[strong][PAWN] * PIECE_VALUE_EG[PAWN]
+               + pushToEdge(weakKing)
+               + pushClose(strongKing, weakKing);
+
+    if(pos->counts[strong][QUEEN] || pos->counts[strong][ROOK]
+        || (pos->counts[strong][BISHOP] && pos->counts[strong][KNIGHT])
+        || ((pos->pieces[strong][BISHOP] & DARK_SQUARES_BB) && (pos->pieces[strong][BISHOP] & ~DARK_SQUARES_BB)))
+        result += VALUE_KNOWN_WIN;
+
+    return result;
+}
+
+// Mate with bishop and knight, the lone king is driven to a corner of the bishop's colour
+static int evaluateKBNK(const Position* pos, PieceTeam strong) {
+    int strongKing = kingSquare(pos, strong);
+    int weakKing = kingSquare(pos, !strong);
+    int corners[2];
+
+    if(pos->pieces[strong][BISHOP] & DARK_SQUARES_BB) {
+        corners[0] = makeSquare(0, 0);
+        corners[1] = makeSquare(7, 7);
+    } else {
+        corners[0] = makeSquare(7, 0);
+        corners[1] = makeSquare(0, 7);
+    }
+    int cornerDistance = minInt(squareDistance(weakKing, corners[0]), squareDistance(weakKing, corners[1]));
+
+    return VALUE_KNOWN_WIN + PIECE_VALUE_EG[BISHOP] + PIECE_VALUE_EG[KNIGHT]
+         + pushClose(strongKing, weakKing) + 30 * (7 - cornerDistance) + pushToEdge(weakKing);
+}
+
+// Exact result from the bitbase, the score only guides the pawn forward
+static int evaluateKPK(const Position* pos, PieceTeam strong) {
+    int strongKing = normalizeSquare(pos, strong, kingSquare(pos, strong));
+    int weakKing = normalizeSquare(pos, strong, kingSquare(pos, !strong));
+    int pawn = normalizeSquare(pos, strong, lsb(pos->pieces[strong][PAWN]));
+
+    if(!bitbaseProbeKPK(strongKing, pawn, weakKing, pos->side == strong))
+        return 0;
+
+    return VALUE_KNOWN_WIN + PIECE_VALUE_EG[PAWN] + 10 * squareRank(pawn);
+}
+
+static int evaluateKRKP(const Position* pos, PieceTeam strong) {
+    int strongKing = normalizeSquare(pos, strong, kingSquare(pos, strong));
+    int weakKing = normalizeSquare(pos, strong, kingSquare(pos, !strong));
+    int rook = normalizeSquare(pos, strong, lsb(pos->pieces[strong][ROOK]));
+    int pawn = normalizeSquare(pos, strong, lsb(pos->pieces[!strong][PAWN]));
+    int queening = makeSquare(squareFile(pawn), 0);
+    int next = pawn - 8;
+    bool weakToMove = pos->side != strong;
+
+    // The strong king is in front of the pawn, or the lone pawn is too far from its king
+    if((squareFile(strongKing) == squareFile(pawn) && strongKing < pawn)
+        || (squareDistance(weakKing, pawn) >= 3 + weakToMove && squareDistance(weakKing, rook) >= 3))
+        return PIECE_VALUE_EG[ROOK] - squareDistance(strongKing, pawn);
+
+    // Advanced pawn supported by its king, the strong king is too far away
+    if(squareRank(weakKing) <= 2 && squareDistance(weakKing, pawn) == 1
+        && squareRank(strongKing) >= 3 && squareDistance(strongKing, pawn) > 2 + !weakToMove)
+        return 80 - 8 * squareDistance(strongKing, pawn);
+
+    return 200 - 8 * (squareDistance(strongKing, next) - squareDistance(weakKing, next)
+                      - squareDistance(pawn, queening));
+}
+
+static int evaluateKRKB(const Position* pos, PieceTeam strong) {
+    return pushToEdge(kingSquare(pos, !strong));
+}
+
+static int evaluateKRKN(const Position* pos, PieceTeam strong) {
+    int weakKing = kingSquare(pos, !strong);
+    int knight = lsb(pos->pieces[!strong][KNIGHT]);
+    return pushToEdge(weakKing) + pushAway(weakKing, knight);
+}
+
+// A pawn on the 7th rook or bishop file supported by its king usually holds the draw
+static int evaluateKQKP(const Position* pos, PieceTeam strong) {
+    int strongKing = kingSquare(pos, strong);
+    int weakKing = kingSquare(pos, !strong);
+    int pawn = lsb(pos->pieces[!strong][PAWN]);
+    int result = pushClose(strongKing, weakKing);
+    int file = squareFile(pawn);
+
+    if(relativeRank(!strong, pawn) != 6 || squareDistance(weakKing, pawn) != 1
+        || (file != 0 && file != 2 && file != 5 && file != 7))
+        result += PIECE_VALUE_EG[QUEEN] - PIECE_VALUE_EG[PAWN];
+
+    return result;
+}
+
+static int evaluateKQKR(const Position* pos, PieceTeam strong) {
+    int strongKing = kingSquare(pos, strong);
+    int weakKing = kingSquare(pos, !strong);
+    return PIECE_VALUE_EG[QUEEN] - PIECE_VALUE_EG[ROOK] + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+}
+
+static int evaluateKNNK(const Position* pos, PieceTeam strong) {
+    (void)pos;
+    (void)strong;
+    return 0;
+}
+
+// Rook pawns with a bishop that doesn't control the queening square
+int scaleKBPsK(const Position* pos, PieceTeam strong) {
+    Bitboard pawns = pos->pieces[strong][PAWN];
+    int weakKing = kingSquare(pos, !strong);
+
+    if(!(pawns & ~FILE_A_BB) || !(pawns & ~FILE_H_BB)) {
+        int queening = makeSquare(squareFile(lsb(pawns)), strong == TEAM_WHITE ? 7 : 0);
+        bool bishopDark = (pos->pieces[strong][BISHOP] & DARK_SQUARES_BB) != 0;
+        if(bishopDark != isDarkSquare(queening) && squareDistance(weakKing, queening) <= 1)
+            return SCALE_DRAW;
+    }
+
+    return SCALE_NONE;
+}
+
+// Pawns on one rook file against a king sitting in front of them
+int scaleKPsK(const Position* pos, PieceTeam strong) {
+    Bitboard pawns = pos->pieces[strong][PAWN];
+    int weakKing = kingSquare(pos, !strong);
+
+    if((!(pawns & ~FILE_A_BB) || !(pawns & ~FILE_H_BB))
+        && fileDistance(weakKing, lsb(pawns)) <= 1) {
+        int front = strong == TEAM_WHITE ? msb(pawns) : lsb(pawns);
+        if(relativeRank(strong, weakKing) > relativeRank(strong, front))
+            return SCALE_DRAW;
+    }
+
+    return SCALE_NONE;
+}
+
+// Philidor position: the defending king stands in front of a not too advanced pawn
+static int scaleKRPKR(const Position* pos, PieceTeam strong) {
+    int weakKing = normalizeSquare(pos, strong, kingSquare(pos, !strong));
+    int pawn = normalizeSquare(pos, strong, lsb(pos->pieces[strong][PAWN]));
+
+    if(fileDistance(weakKing, pawn) <= 1 && squareRank(weakKing) > squareRank(pawn)) {
+        if(squareFile(pawn) == 0)
+            return 8;
+        if(squareRank(pawn) <= 4)
+            return 12;
+    }
+
+    return SCALE_NONE;
+}
+
+// Opposite coloured bishops with a single pawn are a book draw
+static int scaleKBPKB(const Position* pos, PieceTeam strong) {
+    bool strongDark = (pos->pieces[strong][BISHOP] & DARK_SQUARES_BB) != 0;
+    bool weakDark = (pos->pieces[!strong][BISHOP] & DARK_SQUARES_BB) != 0;
+    int weakKing = kingSquare(pos, !strong);
+    int pawn = lsb(pos->pieces[strong][PAWN]);
+
+    if(strongDark != weakDark)
+        return SCALE_DRAW;
+    if(squareFile(weakKing) == squareFile(pawn) && relativeRank(strong, weakKing) > relativeRank(strong, pawn))
+        return SCALE_DRAW;
+
+    return SCALE_NONE;
+}
+
+// The weak pawn rarely matters when the strong pawn isn't far advanced, so
+// it is dropped and the bitbase decides
+static int scaleKPKP(const Position* pos, PieceTeam strong) {
+    int pawn = lsb(pos->pieces[strong][PAWN]);
+    int mirror = (squareFile(pawn) >= 4 ? 7 : 0) ^ (strong == TEAM_WHITE ? 0 : 56);
+    int strongKing = kingSquare(pos, strong) ^ mirror;
+    int weakKing = kingSquare(pos, !strong) ^ mirror;
+
+    pawn ^= mirror;
+    if(squareRank(pawn) >= 4 || squareFile(pawn) == 0)
+        return SCALE_NONE;
+
+    return bitbaseProbeKPK(strongKing, pawn, weakKing, pos->side == strong) ? SCALE_NONE : SCALE_DRAW;
+}
+
+// Material key of an endgame code such as "KBNK", the first king starting the strong team
+static uint64_t endgameKey(const char* code, PieceTeam strong) {
+    static const char* letters = "PRNBQK";
+    uint8_t counts[TEAMS][PIECE_TYPES] = {0};
+    PieceTeam team = strong;
+    uint64_t key = 0;
+
+    for(int i = 0; code[i]; i++) {
+        if(i > 0 && code[i] == 'K')
+            team = !strong;
+        const char* letter = strchr(letters, code[i]);
+        ASSERT(letter != null, "Invalid endgame code: %s\n", code);
+        PieceType type = (PieceType)(letter - letters);
+        key ^= ZOBRIST_MATERIAL[team][type][counts[team][type]++];
+    }
+
+    return key;
+}
+
+static void addEndgame(const char* code, EndgameEvalFn evalFn, EndgameScaleFn scaleFn) {
+    for(int team = 0; team < TEAMS; team++) {
+        ASSERT(endgameCount < MAX_ENDGAMES, "Too many endgames registered!\n");
+        Endgame* e = &ENDGAMES[endgameCount++];
+        e->key = endgameKey(code, (PieceTeam)team);
+        e->strong = (PieceTeam)team;
+        e->evalFn = evalFn;
+        e->scaleFn = scaleFn;
+    }
+}
+
+void initEndgames(void) {
+    initBitbase();
+    endgameCount = 0;
+
+    addEndgame("KPK", evaluateKPK, null);
+    addEndgame("KNNK", evaluateKNNK, null);
+    addEndgame("KBNK", evaluateKBNK, null);
+    addEndgame("KRKP", evaluateKRKP, null);
+    addEndgame("KRKB", evaluateKRKB, null);
+    addEndgame("KRKN", evaluateKRKN, null);
+    addEndgame("KQKP", evaluateKQKP, null);
+    addEndgame("KQKR", evaluateKQKR, null);
+
+    addEndgame("KRPKR", null, scaleKRPKR);
+    addEndgame("KBPKB", null, scaleKBPKB);
+    addEndgame("KPKP", null, scaleKPKP);
+}
+
+const Endgame* findEndgame(uint64_t materialKey, PieceTeam strong) {
+    for(int i = 0; i < endgameCount; i++) {
+        if(ENDGAMES[i].key == materialKey && ENDGAMES[i].strong == strong)
+            return &ENDGAMES[i];
+    }
+    return null;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "material.h"
+
+#define VALUE_KNOWN_WIN 10000
+
+typedef struct {
+    uint64_t key;
+    PieceTeam strong;
+    EndgameEvalFn evalFn;
+    EndgameScaleFn scaleFn;
+} Endgame;
+
+// Builds the material key -> endgame lookup and the KPK bitbase, call it after initPosition
+void initEndgames(void);
+// Specialised endgame for the material key with the given strong team, null if there is none
+const Endgame* findEndgame(uint64_t materialKey, PieceTeam strong);
+
+int evaluateKXK(const Position* pos, PieceTeam strong);
+int scaleKBPsK(const Position* pos, PieceTeam strong);
+int scaleKPsK(const Position* pos, PieceTeam strong);
@@ -0,0 +1,287 @@
+#include "eval.h"
+#include "endgame.h"
+
+#define TEMPO 10
+
+// Piece-square tables drawn from white's side, rank 8 on top
+static const int PST_MG[PIECE_TYPES][SQUARES] = {
+    { // pawn
+         0,   0,   0,   0,   0,   0,   0,   0,
+        60,  70,  60,  65,  65,  60,  70,  60,
+        15,  20,  30,  35,  35,  30,  20,  15,
+         0,   5,  10,  25,  25,  10,   5,   0,
+        -5,   0,   5,  20,  20,   5,   0,  -5,
+        -5,  -2,   0,   5,   5,  -5,  -2,  -5,
+        -5,   2,   2, -15, -15,  10,  10,  -5,
+         0,   0,   0,   0,   0,   0,   0,   0
+    },
+    { // rook
+        10,  10,  15,  20,  20,  15,  10,  10,
+        20,  25,  30,  30,  30,  30,  25,  20,
+         0,   5,   5,  10,  10,   5,   5,   0,
+        -5,   0,   0,   5,   5,   0,   0,  -5,
+       -10,  -5,   0,   0,   0,   0,  -5, -10,
+       -15,  -5,   0,   0,   0,   0,  -5, -15,
+       -20, -10,  -5,   0,   0,  -5, -10, -20,
+        -5,  -5,   5,  10,  10,   5,  -5,  -5
+    },
+    { // knight
+       -60, -40, -30, -20, -20, -30, -40, -60,
+       -30, -15,  10,  10,  10,  10, -15, -30,
+       -20,  10,  25,  35,  35,  25,  10, -20,
+       -10,  10,  25,  35,  35,  25,  10, -10,
+       -15,   5,  15,  20,  20,  15,   5, -15,
+       -20,   0,  10,  10,  10,  10,   0, -20,
+       -30, -20,  -5,   0,   0,  -5, -20, -30,
+       -50, -25, -30, -20, -20, -30, -25, -50
+    },
+    { // bishop
+       -20, -10, -10, -10, -10, -10, -10, -20,
+       -10,   5,   0,   0,   0,   0,   5, -10,
+       -10,   5,  10,  10,  10,  10,   5, -10,
+        -5,  10,  10,  15,  15,  10,  10,  -5,
+        -5,   5,  15,  15,  15,  15,   5,  -5,
+         0,  10,  10,  10,  10,  10,  10,   0,
+         0,  15,   5,   5,   5,   5,  15,   0,
+       -20,  -5, -15,  -5,  -5, -15,  -5, -20
+    },
+    { // queen
+       -20, -10, -10,  -5,  -5, -10, -10, -20,
+       -10,  -5,   0,   5,   5,   0,  -5, -10,
+       -10,   0,   5,   5,   5,   5,   0, -10,
+        -5,   0,   5,   5,   5,   5,   0,  -5,
+        -5,   0,   5,   5,   5,   5,   0,  -5,
+       -10,   5,   5,   5,   5,   5,   0, -10,
+       -10,   0,   5,   5,   5,   0,   0, -10,
+       -20, -10, -10,   0,  -5, -10, -10, -20
+    },
+    { // king
+       -40, -50, -50, -60, -60, -50, -50, -40,
+       -40, -50, -50, -60, -60, -50, -50, -40,
+       -40, -50, -50, -60, -60, -50, -50, -40,
+       -40, -50, -50, -60, -60, -50, -50, -40,
+       -30, -40, -40, -50, -50, -40, -40, -30,
+       -20, -30, -30, -40, -40, -30, -30, -20,
+        10,  10, -10, -20, -20, -10,  10,  10,
+        20,  35,  10, -10,   0,  10,  40,  20
+    }
+};
+
+static const int PST_EG[PIECE_TYPES][SQUARES] = {
+    { // pawn
+         0,   0,   0,   0,   0,   0,   0,   0,
+        90,  85,  80,  75,  75,  80,  85,  90,
+        50,  50,  45,  40,  40,  45,  50,  50,
+        25,  20,  15,  10,  10,  15,  20,  25,
+        10,   5,   0,   0,   0,   0,   5,  10,
+         0,   0,  -5,  -5,  -5,  -5,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0
+    },
+    { // rook
+        10,  10,  10,  10,  10,  10,  10,  10,
+        10,  10,  10,  10,  10,  10,  10,  10,
+         5,   5,   5,   5,   5,   5,   5,   5,
+         0,   0,   5,   5,   5,   5,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+        -5,   0,   0,   0,   0,   0,   0,  -5,
+        -5,  -5,   0,   0,   0,   0,  -5,  -5,
+       -10,  -5,   0,   0,   0,   0,  -5, -10
+    },
+    { // knight
+       -50, -35, -20, -15, -15, -20, -35, -50,
+       -30, -10,   0,   5,   5,   0, -10, -30,
+       -20,   0,  10,  15,  15,  10,   0, -20,
+       -15,   5,  15,  20,  20,  15,   5, -15,
+       -15,   5,  15,  20,  20,  15,   5, -15,
+       -20,   0,  10,  15,  15,  10,   0, -20,
+       -30, -10,   0,   5,   5,   0, -10, -30,
+       -50, -35, -20, -15, -15, -20, -35, -50
+    },
+    { // bishop
+       -15, -10,  -5,  -5,  -5,  -5, -10, -15,
+       -10,   0,   0,   5,   5,   0,   0, -10,
+        -5,   0,   5,  10,  10,   5,   0,  -5,
+        -5,   5,  10,  15,  15,  10,   5,  -5,
+        -5,   5,  10,  15,  15,  10,   5,  -5,
+        -5,   0,   5,  10,  10,   5,   0,  -5,
+       -10,   0,   0,   5,   5,   0,   0, -10,
+       -15, -10,  -5,  -5,  -5,  -5, -10, -15
+    },
+    { // queen
+       -20, -10,  -5,   0,   0,  -5, -10, -20,
+       -10,   0,   5,  10,  10,   5,   0, -10,
+        -5,   5,  15,  20,  20,  15,   5,  -5,
+         0,  10,  20,  25,  25,  20,  10,   0,
+         0,  10,  20,  25,  25,  20,  10,   0,
+        -5,   5,  15,  20,  20,  15,   5,  -5,
+       -10,   0,   5,  10,  10,   5,   0, -10,
+       -20, -10,  -5,   0,   0,  -5, -10, -20
+    },
+    { // king
+       -50, -30, -20, -15, -15, -20, -30, -50,
+       -25,  -5,  10,  15,  15,  10,  -5, -25,
+       -15,  10,  25,  30,  30,  25,  10, -15,
+       -15,  10,  30,  40,  40,  30,  10, -15,
+       -20,   5,  25,  35,  35,  25,   5, -20,
+       -25,  -5,  10,  20,  20,  10,  -5, -25,
+       -35, -15,  -5,   5,   5,  -5, -15, -35,
+       -55, -40, -30, -25, -25, -30, -40, -55
+    }
+};
+
+// Passed pawn bonus by relative rank
+static const int PASSED_MG[RANKS] = { 0, 5, 10, 15, 30, 55, 90, 0 };
+static const int PASSED_EG[RANKS] = { 0, 10, 20, 35, 60, 100, 150, 0 };
+
+// Mobility bonus per reachable square
+static const int MOBILITY_MG[PIECE_TYPES] = { 0, 3, 5, 5, 2, 0 };
+static const int MOBILITY_EG[PIECE_TYPES] = { 0, 6, 4, 5, 4, 0 };
+
+// Squares in front of the pawn on its own and both adjacent files, and on its own file only
+static Bitboard PASSED_MASK[TEAMS][SQUARES];
+static Bitboard FORWARD_FILE[TEAMS][SQUARES];
+static Bitboard ADJACENT_FILES[FILES];
+
+void initEval(void) {
+    for(int f = 0; f < FILES; f++) {
+        ADJACENT_FILES[f] = (f > 0 ? FILE_A_BB << (f - 1) : 0) | (f < 7 ? FILE_A_BB << (f + 1) : 0);
+    }
+
+    for(int sq = 0; sq < SQUARES; sq++) {
+        Bitboard above = 0, below = 0;
+        for(int r = squareRank(sq) + 1; r < RANKS; r++)
+            above |= RANK_1_BB << (r * 8);
+        for(int r = squareRank(sq) - 1; r >= 0; r--)
+            below |= RANK_1_BB << (r * 8);
+
+        FORWARD_FILE[TEAM_WHITE][sq] = fileBB(sq) & above;
+        FORWARD_FILE[TEAM_BLACK][sq] = fileBB(sq) & below;
+        PASSED_MASK[TEAM_WHITE][sq] = (fileBB(sq) | ADJACENT_FILES[squareFile(sq)]) & above;
+        PASSED_MASK[TEAM_BLACK][sq] = (fileBB(sq) | ADJACENT_FILES[squareFile(sq)]) & below;
+    }
+
+    initEndgames();
+}
+
+static void evaluatePawns(const Position* pos, PieceTeam us, int* mg, int* eg) {
+    PieceTeam them = !us;
+    Bitboard own = pos->pieces[us][PAWN];
+    Bitboard their = pos->pieces[them][PAWN];
+    Bitboard b = own;
+
+    while(b) {
+        int sq = popLsb(&b);
+        int rank = relativeRank(us, sq);
+
+        if(!(PASSED_MASK[us][sq] & their)) {
+            *mg += PASSED_MG[rank];
+            *eg += PASSED_EG[rank];
+            // a passer gets stronger as the enemy king is further from it
+            int stop = us == TEAM_WHITE ? sq + 8 : sq - 8;
+            if(rank >= 3 && stop >= 0 && stop < SQUARES) {
+                *eg += 5 * squareDistance(kingSquare(pos, them), stop) * (rank - 2) / 2;
+                *eg -= 2 * squareDistance(kingSquare(pos, us), stop) * (rank - 2) / 2;
+            }
+        }
+        if(!(ADJACENT_FILES[squareFile(sq)] & own)) {
+            *mg -= 10;
+            *eg -= 15;
+        }
+        if(FORWARD_FILE[us][sq] & own) {
+            *mg -= 10;
+            *eg -= 20;
+        }
+    }
+}
+
+static void evaluatePieces(const Position* pos, PieceTeam us, int* mg, int* eg) {
+    PieceTeam them = !us;
+    Bitboard theirPawns = pos->pieces[them][PAWN];
+    Bitboard pawnAttacks = us == TEAM_WHITE
+        ? ((theirPawns >> 7) & ~FILE_A_BB) | ((theirPawns >> 9) & ~FILE_H_BB)
+        : ((theirPawns << 7) & ~FILE_H_BB) | ((theirPawns << 9) & ~FILE_A_BB);
+    Bitboard mobilityArea = ~(pos->teams[us] | pawnAttacks);
+
+    for(int type = PAWN; type <= KING; type++) {
+        Bitboard b = pos->pieces[us][type];
+        while(b) {
+            int sq = popLsb(&b);
+            int idx = us == TEAM_WHITE ? flipSquare(sq) : sq;
+            *mg += PST_MG[type][idx];
+            *eg += PST_EG[type][idx];
+
+            Bitboard attacks = 0;
+            switch(type) {
+                case KNIGHT: attacks = KNIGHT_ATTACKS[sq]; break;
+                case BISHOP: attacks = bishopAttacks(sq, pos->all); break;
+                case ROOK: attacks = rookAttacks(sq, pos->all); break;
+                case QUEEN: attacks = queenAttacks(sq, pos->all); break;
+                default: break;
+            }
+            int mobility = popCount(attacks & mobilityArea);
+            *mg += MOBILITY_MG[type] * mobility;
+            *eg += MOBILITY_EG[type] * mobility;
+
+            if(type == ROOK && !(fileBB(sq) & pos->pieces[us][PAWN])) {
+                bool open = !(fileBB(sq) & theirPawns);
+                *mg += open ? 25 : 10;
+                *eg += open ? 10 : 5;
+            }
+        }
+    }
+
+    // Pawn shelter in front of the king
+    int king = kingSquare(pos, us);
+    Bitboard shelter = (fileBB(king) | ADJACENT_FILES[squareFile(king)]) & PASSED_MASK[us][king]
+                     & pos->pieces[us][PAWN] & (us == TEAM_WHITE ? 0x00000000FFFFFF00ULL : 0x00FFFFFF00000000ULL);
+    *mg += 12 * popCount(shelter);
+}
+
+static int scaleFactor(const Position* pos, const MaterialEntry* e, PieceTeam strong) {
+    int scale = e->factor[strong];
+
+    if(e->scaleFn[strong]) {
+        int s = e->scaleFn[strong](pos, strong);
+        if(s != SCALE_NONE)
+            return s;
+    }
+
+    // Opposite coloured bishops
+    if(scale == SCALE_NORMAL && pos->counts[TEAM_WHITE][BISHOP] == 1 && pos->counts[TEAM_BLACK][BISHOP] == 1) {
+        bool whiteDark = (pos->pieces[TEAM_WHITE][BISHOP] & DARK_SQUARES_BB) != 0;
+        bool blackDark = (pos->pieces[TEAM_BLACK][BISHOP] & DARK_SQUARES_BB) != 0;
+        if(whiteDark != blackDark) {
+            if(nonPawnMaterial(pos, TEAM_WHITE) == PIECE_VALUE_MG[BISHOP]
+                && nonPawnMaterial(pos, TEAM_BLACK) == PIECE_VALUE_MG[BISHOP])
+                return 16 + 4 * abs(pos->counts[TEAM_WHITE][PAWN] - pos->counts[TEAM_BLACK][PAWN]);
+            return 46;
+        }
+    }
+
+    return scale;
+}
+
+int evaluate(const Position* pos, MaterialTable* material) {
+    MaterialEntry* e = materialProbe(material, pos);
+
+    if(e->evalFn) {
+        int v = e->evalFn(pos, e->evalStrong);
+        return pos->side == e->evalStrong ? v : -v;
+    }
+
+    int mg = e->mg, eg = e->eg;
+    int wMg = 0, wEg = 0, bMg = 0, bEg = 0;
+
+    evaluatePawns(pos, TEAM_WHITE, &wMg, &wEg);
+    evaluatePawns(pos, TEAM_BLACK, &bMg, &bEg);
+    evaluatePieces(pos, TEAM_WHITE, &wMg, &wEg);
+    evaluatePieces(pos, TEAM_BLACK, &bMg, &bEg);
+    mg += wMg - bMg;
+    eg += wEg - bEg;
+
+    int scale = scaleFactor(pos, e, eg > 0 ? TEAM_WHITE : TEAM_BLACK);
+    int v = (mg * e->phase + eg * (PHASE_MAX - e->phase) * scale / SCALE_NORMAL) / PHASE_MAX;
+
+    return (pos->side == TEAM_WHITE ? v : -v) + TEMPO;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "position.h"
+#include "material.h"
+
+#define VALUE_DRAW 0
+#define VALUE_MATE 32000
+#define VALUE_INFINITE 32001
+// Mate scores are VALUE_MATE - plies, anything beyond this is a mate
+#define VALUE_MATE_BOUND (VALUE_MATE - 1024)
+
+// Call it after initPosition
+void initEval(void);
+
+// Static evaluation in centipawns from the side to move's point of view
+int evaluate(const Position* pos, MaterialTable* material);
@@ -0,0 +1,102 @@
+#include "explorer.h"
+
+#include <string.h>
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t readU64(const uint8_t* p) {
+    return (uint64_t)readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+static inline void writeU32(uint8_t* p, uint32_t v) {
+    for(int i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void writeU64(uint8_t* p, uint64_t v) {
+    writeU32(p, (uint32_t)v);
+    writeU32(p + 4, (uint32_t)(v >> 32));
+}
+
+bool explorerOpen(Explorer* explorer, const char* path) {
+    ASSERT(explorer != null, "The explorer ptr provided shouldn't be null!\n");
+    memset(explorer, 0, sizeof(Explorer));
+
+    if(!mapFile(&explorer->map, path))
+        return false;
+
+    const uint8_t* data = explorer->map.data;
+    size_t size = explorer->map.size;
+    if(size < EXPLORER_HEADER_SIZE || memcmp(data, "CEX1", 4)
+        || readU64(data + 8) > (size - EXPLORER_HEADER_SIZE) / EXPLORER_ENTRY_SIZE) {
+        unmapFile(&explorer->map);
+        return false;
+    }
+
+    explorer->plies = (int)readU32(data + 4);
+    explorer->count = readU64(data + 8);
+    explorer->games = readU64(data + 16);
+    explorer->entries = data + EXPLORER_HEADER_SIZE;
+    return true;
+}
+
+void explorerClose(Explorer* explorer) {
+    if(explorer->map.data)
+        unmapFile(&explorer->map);
+    memset(explorer, 0, sizeof(Explorer));
+}
+
+int explorerLookup(const Explorer* explorer, uint64_t key, ExplorerEntry* out, int max) {
+    uint64_t lo = 0, hi = explorer->count;
+    while(lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if(readU64(explorer->entries + mid * EXPLORER_ENTRY_SIZE) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    int count = 0;
+    for(uint64_t i = lo; i < explorer->count; i++, count++) {
+        const uint8_t* entry = explorer->entries + i * EXPLORER_ENTRY_SIZE;
+        if(readU64(entry) != key)
+            break;
+        if(count < max)
+            explorerReadEntry(entry, &out[count]);
+    }
+    return count;
+}
+
+void explorerReadEntry(const uint8_t* in, ExplorerEntry* entry) {
+    entry->key = readU64(in);
+    entry->move = (Move)(in[8] | in[9] << 8);
+    entry->white = readU32(in + 12);
+    entry->draws = readU32(in + 16);
+    entry->black = readU32(in + 20);
+    entry->unknown = readU32(in + 24);
+    entry->rated = readU32(in + 28);
+    entry->ratingSum = readU64(in + 32);
+}
+
+void explorerWriteEntry(uint8_t* out, const ExplorerEntry* entry) {
+    writeU64(out, entry->key);
+    out[8] = (uint8_t)entry->move;
+    out[9] = (uint8_t)(entry->move >> 8);
+    out[10] = out[11] = 0;
+    writeU32(out + 12, entry->white);
+    writeU32(out + 16, entry->draws);
+    writeU32(out + 20, entry->black);
+    writeU32(out + 24, entry->unknown);
+    writeU32(out + 28, entry->rated);
+    writeU64(out + 32, entry->ratingSum);
+}
+
+void explorerWriteHeader(uint8_t* out, int plies, uint64_t count, uint64_t games) {
+    memset(out, 0, EXPLORER_HEADER_SIZE);
+    memcpy(out, "CEX1", 4);
+    writeU32(out + 4, (uint32_t)plies);
+    writeU64(out + 8, count);
+    writeU64(out + 16, games);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "position.h"
+#include "platform.h"
+
+/*
+ * Opening explorer statistics, little endian:
+ *   0  char[4]  magic "CEX1"
+ *   4  uint32   plies of every game counted
+ *   8  uint64   entry count
+ *   16 uint64   games of the database counted, an update adds the ones after them
+ * followed by the entries sorted by key, then move:
+ *   0  uint64   position key
+ *   8  uint16   move
+ *   10 uint16   reserved
+ *   12 uint32   white wins
+ *   16 uint32   draws
+ *   20 uint32   black wins
+ *   24 uint32   games without a result
+ *   28 uint32   games the player to move has a rating in
+ *   32 uint64   sum of those ratings
+ */
+#define EXPLORER_HEADER_SIZE 32
+#define EXPLORER_ENTRY_SIZE 40
+
+typedef struct {
+    uint64_t key;
+    Move move;
+    uint32_t white, draws, black, unknown;
+    uint32_t rated;
+    uint64_t ratingSum;
+} ExplorerEntry;
+
+typedef struct {
+    MappedFile map;
+    uint64_t count;
+    uint64_t games;
+    int plies;
+    const uint8_t* entries;
+} Explorer;
+
+bool explorerOpen(Explorer* explorer, const char* path);
+void explorerClose(Explorer* explorer);
+// Writes up to 'max' moves of the position, returns how many there are
+int explorerLookup(const Explorer* explorer, uint64_t key, ExplorerEntry* out, int max);
+
+void explorerReadEntry(const uint8_t* in, ExplorerEntry* entry);
+void explorerWriteEntry(uint8_t* out, const ExplorerEntry* entry);
+void explorerWriteHeader(uint8_t* out, int plies, uint64_t count, uint64_t games);
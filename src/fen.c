@@ -0,0 +1,287 @@
+#include "position.h"
+
+#include <string.h>
+
+static const char PIECE_CHARS[TEAMS][PIECE_TYPES] = {
+    { 'P', 'R', 'N', 'B', 'Q', 'K' },
+    { 'p', 'r', 'n', 'b', 'q', 'k' }
+};
+
+// makePiece code + 1 of every FEN letter, 0 for anything else
+static const uint8_t FEN_PIECES[256] = {
+    ['P'] = 1, ['R'] = 2, ['N'] = 3, ['B'] = 4, ['Q'] = 5, ['K'] = 6,
+    ['p'] = 9, ['r'] = 10, ['n'] = 11, ['b'] = 12, ['q'] = 13, ['k'] = 14
+};
+
+static inline const char* skipSpaces(const char* p, const char* end) {
+    while(p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+// Null as well past FEN_MAX_COUNTER, the counters are 16 bits
+static inline const char* parseNumber(const char* p, const char* end, int* out) {
+    int v = 0;
+    if(p >= end || *p < '0' || *p > '9')
+        return null;
+    while(p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+        if(v > FEN_MAX_COUNTER)
+            return null;
+    }
+    *out = v;
+    return p;
+}
+
+// sprintf is most of the cost of a FEN otherwise
+static inline char* writeNumber(char* p, unsigned v) {
+    char digits[8];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while(v);
+    while(n)
+        *p++ = digits[--n];
+    return p;
+}
+
+// At most 16 pieces, and no more officers than the missing pawns could have promoted to
+static bool isMaterialPossible(const Position* pos, PieceTeam team) {
+    static const int START_COUNT[PIECE_TYPES] = { 8, 2, 2, 2, 1, 1 };
+    int pawns = popCount(pos->pieces[team][PAWN]);
+    int promoted = 0;
+    for(PieceType type = ROOK; type <= QUEEN; type++) {
+        int count = popCount(pos->pieces[team][type]);
+        if(count > START_COUNT[type])
+            promoted += count - START_COUNT[type];
+    }
+    return pawns + promoted <= 8 && popCount(pos->teams[team]) <= 16;
+}
+
+// Parses one FEN up to 'end', returns where it stopped or null if it's invalid
+static const char* parseFen(Position* pos, const char* p, const char* end) {
+    positionClear(pos);
+
+    // placement, rank 8 first
+    int rank = 7, file = 0;
+    for(; p < end && *p != ' '; p++) {
+        char c = *p;
+        if(c == '/') {
+            if(file != 8 || rank == 0)
+                return null;
+            rank--;
+            file = 0;
+        } else if(c >= '1' && c <= '8') {
+            file += c - '0';
+            if(file > 8)
+                return null;
+        } else {
+            if(!FEN_PIECES[(uint8_t)c] || file > 7)
+                return null;
+            uint8_t piece = FEN_PIECES[(uint8_t)c] - 1;
+            positionPutPiece(pos, pieceTeam(piece), pieceType(piece), makeSquare(file, rank));
+            file++;
+        }
+    }
+    if(rank != 0 || file != 8)
+        return null;
+
+    // side to move
+    p = skipSpaces(p, end);
+    if(p >= end || (*p != 'w' && *p != 'b'))
+        return null;
+    pos->side = *p++ == 'w' ? TEAM_WHITE : TEAM_BLACK;
+
+    // castling
+    p = skipSpaces(p, end);
+    if(p < end && *p == '-') {
+        p++;
+    } else {
+        for(; p < end && *p != ' '; p++) {
+            switch(*p) {
+                case 'K': pos->castling |= CASTLE_WHITE_KING; break;
+                case 'Q': pos->castling |= CASTLE_WHITE_QUEEN; break;
+                case 'k': pos->castling |= CASTLE_BLACK_KING; break;
+                case 'q': pos->castling |= CASTLE_BLACK_QUEEN; break;
+                default: return null;
+            }
+        }
+    }
+
+    // en passant, kept only when a capture is possible
+    p = skipSpaces(p, end);
+    int epSquare = SQUARE_NONE;
+    if(p < end && *p == '-') {
+        p++;
+    } else if(p + 1 < end && p[0] >= 'a' && p[0] <= 'h' && (p[1] == '3' || p[1] == '6')) {
+        epSquare = makeSquare(p[0] - 'a', p[1] - '1');
+        p += 2;
+    } else if(p < end) {
+        return null;
+    }
+
+    // the move counters are optional
+    int halfmoves = 0, fullmoves = 1;
+    const char* q = skipSpaces(p, end);
+    if(q < end && *q >= '0' && *q <= '9') {
+        if(!(p = parseNumber(q, end, &halfmoves)))
+            return null;
+        q = skipSpaces(p, end);
+        if(q < end && *q >= '0' && *q <= '9' && !(p = parseNumber(q, end, &fullmoves)))
+            return null;
+    }
+    pos->halfmoves = (uint16_t)halfmoves;
+    pos->fullmoves = (uint16_t)(fullmoves > 0 ? fullmoves : 1);
+
+    // one king each, no pawns on the back ranks
+    if(popCount(pos->pieces[TEAM_WHITE][KING]) != 1 || popCount(pos->pieces[TEAM_BLACK][KING]) != 1)
+        return null;
+    if(!isMaterialPossible(pos, TEAM_WHITE) || !isMaterialPossible(pos, TEAM_BLACK))
+        return null;
+    if((pos->pieces[TEAM_WHITE][PAWN] | pos->pieces[TEAM_BLACK][PAWN]) & (RANK_1_BB | RANK_8_BB))
+        return null;
+    if(isSquareAttacked(pos, kingSquare(pos, !pos->side), pos->side))
+        return null;
+
+    // rights without the king and rook at home are dropped
+    static const int KING_HOME[TEAMS] = { 4, 60 };
+    static const int ROOK_HOME[4] = { 7, 0, 63, 56 };
+    for(int i = 0; i < 4; i++) {
+        PieceTeam team = i < 2 ? TEAM_WHITE : TEAM_BLACK;
+        if(pos->board[KING_HOME[team]] != makePiece(team, KING) || pos->board[ROOK_HOME[i]] != makePiece(team, ROOK))
+            pos->castling &= ~(1 << i);
+    }
+
+    if(epSquare != SQUARE_NONE) {
+        PieceTeam us = pos->side;
+        int pushed = epSquare + (us == TEAM_WHITE ? -8 : 8);
+        if(relativeRank(us, epSquare) == 5 && pos->board[pushed] == makePiece(!us, PAWN)
+            && !(pos->all & squareBB(epSquare)) && (PAWN_ATTACKS[!us][epSquare] & pos->pieces[us][PAWN]))
+            pos->epSquare = (uint8_t)epSquare;
+    }
+
+    pos->key ^= ZOBRIST_CASTLING[pos->castling];
+    if(pos->epSquare != SQUARE_NONE)
+        pos->key ^= ZOBRIST_EN_PASSANT[squareFile(pos->epSquare)];
+    if(pos->side == TEAM_BLACK)
+        pos->key ^= ZOBRIST_SIDE;
+
+    return p;
+}
+
+bool positionSetFen(Position* pos, const char* fen) {
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!\n");
+    ASSERT(fen != null, "The fen shouldn't be null!\n");
+
+    const char* end = fen + strlen(fen);
+    return parseFen(pos, skipSpaces(fen, end), end) != null;
+}
+
+size_t positionParseFen(Position* pos, const char* text, size_t length) {
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!\n");
+    ASSERT(text != null, "The text shouldn't be null!\n");
+
+    const char* end = parseFen(pos, skipSpaces(text, text + length), text + length);
+    return end ? (size_t)(end - text) : 0;
+}
+
+int positionGetFen(const Position* pos, char* out) {
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!\n");
+    ASSERT(out != null, "The out ptr provided shouldn't be null!\n");
+
+    char* p = out;
+    for(int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for(int file = 0; file < FILES; file++) {
+            uint8_t piece = pos->board[makeSquare(file, rank)];
+            if(piece == PIECE_NONE) {
+                empty++;
+                continue;
+            }
+            if(empty)
+                *p++ = (char)('0' + empty);
+            empty = 0;
+            *p++ = PIECE_CHARS[pieceTeam(piece)][pieceType(piece)];
+        }
+        if(empty)
+            *p++ = (char)('0' + empty);
+        if(rank)
+            *p++ = '/';
+    }
+
+    *p++ = ' ';
+    *p++ = pos->side == TEAM_WHITE ? 'w' : 'b';
+    *p++ = ' ';
+    if(!pos->castling)
+        *p++ = '-';
+    if(pos->castling & CASTLE_WHITE_KING)
+        *p++ = 'K';
+    if(pos->castling & CASTLE_WHITE_QUEEN)
+        *p++ = 'Q';
+    if(pos->castling & CASTLE_BLACK_KING)
+        *p++ = 'k';
+    if(pos->castling & CASTLE_BLACK_QUEEN)
+        *p++ = 'q';
+
+    *p++ = ' ';
+    if(pos->epSquare == SQUARE_NONE) {
+        *p++ = '-';
+    } else {
+        *p++ = (char)('a' + squareFile(pos->epSquare));
+        *p++ = (char)('1' + squareRank(pos->epSquare));
+    }
+
+    *p++ = ' ';
+    p = writeNumber(p, pos->halfmoves);
+    *p++ = ' ';
+    p = writeNumber(p, pos->fullmoves);
+    *p = '\0';
+    return (int)(p - out);
+}
+
+size_t positionsFromFen(const char* text, size_t length, Position* out, size_t max, size_t* consumed) {
+    ASSERT(text != null, "The text shouldn't be null!\n");
+    ASSERT(out != null, "The out ptr provided shouldn't be null!\n");
+
+    const char* p = text;
+    const char* end = text + length;
+    size_t count = 0;
+
+    while(count < max && p < end) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        // a partial last line is left for the next call
+        if(!eol && consumed)
+            break;
+        const char* lineEnd = eol ? eol : end;
+        const char* next = eol ? eol + 1 : end;
+
+        while(lineEnd > p && (lineEnd[-1] == '\r' || lineEnd[-1] == ' '))
+            lineEnd--;
+        if(lineEnd > p) {
+            if(!parseFen(&out[count], skipSpaces(p, lineEnd), lineEnd))
+                positionClear(&out[count]);
+            count++;
+        }
+        p = next;
+    }
+
+    if(consumed)
+        *consumed = (size_t)(p - text);
+    return count;
+}
+
+size_t positionsToFen(const Position* positions, size_t count, char* out, size_t capacity, size_t* written) {
+    ASSERT(positions != null, "The positions ptr provided shouldn't be null!\n");
+    ASSERT(out != null, "The out ptr provided shouldn't be null!\n");
+
+    size_t bytes = 0, i = 0;
+    for(; i < count && bytes + FEN_MAX_LENGTH + 1 <= capacity; i++) {
+        bytes += (size_t)positionGetFen(&positions[i], out + bytes);
+        out[bytes++] = '\n';
+    }
+
+    if(written)
+        *written = bytes;
+    return i;
+}
@@ -0,0 +1,397 @@
+#include "gamedb.h"
+
+#include <string.h>
+
+static const char* STRING_TAGS[GAMEDB_STRINGS] = { "Event", "Site", "Round", "White", "Black", "ECO", "FEN" };
+
+static const int COLUMN_SIZES[GAMEDB_COLUMNS] = {
+    [GAMEDB_COLUMN_MOVES] = 8,
+    [GAMEDB_COLUMN_PLY] = 2,
+    [GAMEDB_COLUMN_DATE] = 4,
+    [GAMEDB_COLUMN_RESULT] = 1,
+    [GAMEDB_COLUMN_WHITE_ELO] = 2,
+    [GAMEDB_COLUMN_BLACK_ELO] = 2,
+    [GAMEDB_COLUMN_STRINGS ... GAMEDB_COLUMNS - 1] = 4
+};
+
+static inline uint16_t readU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t readU64(const uint8_t* p) {
+    return (uint64_t)readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+static inline void writeU64(uint8_t* p, uint64_t v) {
+    for(int i = 0; i < 8; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static int parseInt(PgnString s, int digits) {
+    int v = 0;
+    for(int i = 0; i < digits; i++) {
+        if((uint32_t)i >= s.length || s.data[i] < '0' || s.data[i] > '9')
+            return 0;
+        v = v * 10 + (s.data[i] - '0');
+    }
+    return v;
+}
+
+void gameInfoFromPgn(const PgnGame* game, GameInfo* info) {
+    memset(info, 0, sizeof(GameInfo));
+    for(int i = 0; i < GAMEDB_STRINGS; i++)
+        pgnFindTag(game, STRING_TAGS[i], &info->strings[i]);
+
+    PgnString s;
+    // "yyyy.mm.dd" with '?' for the unknown parts
+    if(pgnFindTag(game, "Date", &s) && s.length >= 10) {
+        PgnString month = { s.data + 5, 2 }, day = { s.data + 8, 2 };
+        info->date = (uint32_t)(parseInt(s, 4) * 10000 + parseInt(month, 2) * 100 + parseInt(day, 2));
+    }
+    if(pgnFindTag(game, "WhiteElo", &s))
+        info->whiteElo = (uint16_t)parseInt(s, s.length < 5 ? (int)s.length : 5);
+    if(pgnFindTag(game, "BlackElo", &s))
+        info->blackElo = (uint16_t)parseInt(s, s.length < 5 ? (int)s.length : 5);
+    info->result = game->result;
+    info->ply = game->ply;
+}
+
+static inline bool isPromoting(const Position* pos, int from) {
+    return pieceType(pos->board[from]) == PAWN && relativeRank(pos->side, from) == 6;
+}
+
+bool gameDbEncodeMoves(const Position* start, const Move* moves, int ply, uint8_t* out, size_t* outSize) {
+    // no move adds a piece, the start has the most
+    if(popCount(start->teams[TEAM_WHITE]) > 16 || popCount(start->teams[TEAM_BLACK]) > 16)
+        return false;
+
+    Position pos = *start;
+    size_t size = 0;
+
+    for(int i = 0; i < ply; i++) {
+        int from = moveFrom(moves[i]), to = moveTo(moves[i]);
+        int piece = popCount(pos.teams[pos.side] & (squareBB(from) - 1));
+        int index = popCount(pieceMoveTargets(&pos, from) & (squareBB(to) - 1));
+        if(isPromoting(&pos, from))
+            index = 4 * index + ((moves[i] >> 12) & 3);
+
+        if(index < GAMEDB_MOVE_EXTENDED) {
+            out[size++] = (uint8_t)(piece << 4 | index);
+        } else {
+            out[size++] = (uint8_t)(piece << 4 | GAMEDB_MOVE_EXTENDED);
+            out[size++] = (uint8_t)(index - GAMEDB_MOVE_EXTENDED);
+        }
+        positionMakeMove(&pos, moves[i]);
+    }
+
+    *outSize = size;
+    return true;
+}
+
+// Decodes into 'out' if given and hands every position to 'fn' if given
+static int decodeMoves(const Position* start, const uint8_t* data, size_t size, Move* out, int max,
+                       GameDbPositionFn fn, void* user) {
+    static const PieceType PROMOTIONS[4] = { KNIGHT, BISHOP, ROOK, QUEEN };
+    Position pos = *start;
+    const uint8_t* end = data + size;
+    int ply = 0;
+
+    if(fn && !fn(&pos, 0, user))
+        return 0;
+    while(data < end && ply < max) {
+        int piece = *data >> 4, index = *data++ & 15;
+        if(index == GAMEDB_MOVE_EXTENDED) {
+            if(data == end)
+                break;
+            index += *data++;
+        }
+
+        Bitboard pieces = pos.teams[pos.side];
+        for(; piece > 0 && pieces; piece--)
+            pieces &= pieces - 1;
+        if(!pieces)
+            break;
+        int from = lsb(pieces);
+
+        bool promoting = isPromoting(&pos, from);
+        Bitboard targets = pieceMoveTargets(&pos, from);
+        for(int i = promoting ? index / 4 : index; i > 0 && targets; i--)
+            targets &= targets - 1;
+        if(!targets)
+            break;
+        int to = lsb(targets);
+
+        Move move;
+        if(promoting)
+            move = createPromotion(from, to, PROMOTIONS[index % 4]);
+        else if(pieceType(pos.board[from]) == KING && (to == from + 2 || to == from - 2))
+            move = createSpecialMove(from, to, MOVE_CASTLING);
+        else if(pieceType(pos.board[from]) == PAWN && to == pos.epSquare)
+            move = createSpecialMove(from, to, MOVE_EN_PASSANT);
+        else
+            move = createMove(from, to);
+
+        if(!positionMakeMove(&pos, move))
+            break;
+        if(out)
+            out[ply] = move;
+        ply++;
+        if(fn && !fn(&pos, ply, user))
+            break;
+    }
+
+    return ply;
+}
+
+int gameDbDecodeMoves(const Position* start, const uint8_t* data, size_t size, Move* out, int max) {
+    return decodeMoves(start, data, size, out, max, null, null);
+}
+
+int gameDbReplay(const Position* start, const uint8_t* data, size_t size, int max, GameDbPositionFn fn, void* user) {
+    return decodeMoves(start, data, size, null, max, fn, user);
+}
+
+bool gameDbOpen(GameDb* db, const char* path) {
+    ASSERT(db != null, "The db ptr provided shouldn't be null!\n");
+    memset(db, 0, sizeof(GameDb));
+
+    if(!mapFile(&db->map, path))
+        return false;
+
+    const uint8_t* data = db->map.data;
+    size_t size = db->map.size;
+    if(size < GAMEDB_HEADER_SIZE || memcmp(data, "CGD1", 4)) {
+        unmapFile(&db->map);
+        return false;
+    }
+
+    db->count = readU64(data + 8);
+    db->stringCount = readU64(data + 16);
+    uint64_t offsets[3 + GAMEDB_COLUMNS];
+    for(int i = 0; i < 3 + GAMEDB_COLUMNS; i++) {
+        offsets[i] = readU64(data + 24 + 8 * i);
+        // every section has to fit in the file
+        uint64_t length = i == 0 ? 8 * (db->stringCount + 1) : i < 3 ? 0 : COLUMN_SIZES[i - 3] * (db->count + (i == 3));
+        if(offsets[i] > size || length > size - offsets[i]) {
+            unmapFile(&db->map);
+            return false;
+        }
+    }
+
+    if(readU64(data + offsets[0] + 8 * db->stringCount) > size - offsets[1]) {
+        unmapFile(&db->map);
+        return false;
+    }
+
+    db->stringOffsets = data + offsets[0];
+    db->strings = (const char*)data + offsets[1];
+    db->moves = data + offsets[2];
+    for(int i = 0; i < GAMEDB_COLUMNS; i++)
+        db->columns[i] = data + offsets[3 + i];
+    return true;
+}
+
+void gameDbClose(GameDb* db) {
+    if(db->map.data)
+        unmapFile(&db->map);
+    memset(db, 0, sizeof(GameDb));
+}
+
+static PgnString getString(const GameDb* db, uint32_t id) {
+    if(id >= db->stringCount)
+        return (PgnString){ "", 0 };
+    uint64_t start = readU64(db->stringOffsets + 8 * (uint64_t)id);
+    uint64_t end = readU64(db->stringOffsets + 8 * ((uint64_t)id + 1));
+    return (PgnString){ db->strings + start, (uint32_t)(end - start - 1) };
+}
+
+void gameDbInfo(const GameDb* db, uint64_t id, GameInfo* info) {
+    ASSERT(id < db->count, "The game id is out of range!\n");
+
+    for(int i = 0; i < GAMEDB_STRINGS; i++)
+        info->strings[i] = getString(db, readU32(db->columns[GAMEDB_COLUMN_STRINGS + i] + 4 * id));
+    info->date = readU32(db->columns[GAMEDB_COLUMN_DATE] + 4 * id);
+    // the callers index tables by the result, a byte from a damaged file reads as unknown
+    uint8_t result = db->columns[GAMEDB_COLUMN_RESULT][id];
+    info->result = result <= RESULT_DRAW ? (GameResult)result : RESULT_NONE;
+    info->whiteElo = readU16(db->columns[GAMEDB_COLUMN_WHITE_ELO] + 2 * id);
+    info->blackElo = readU16(db->columns[GAMEDB_COLUMN_BLACK_ELO] + 2 * id);
+    info->ply = readU16(db->columns[GAMEDB_COLUMN_PLY] + 2 * id);
+}
+
+bool gameDbStart(const GameDb* db, uint64_t id, Position* start) {
+    ASSERT(id < db->count, "The game id is out of range!\n");
+
+    PgnString fen = getString(db, readU32(db->columns[GAMEDB_COLUMN_STRINGS + GAMEDB_FEN] + 4 * id));
+    if(!fen.length) {
+        positionSetStart(start);
+        return true;
+    }
+    return positionSetFen(start, fen.data);
+}
+
+const uint8_t* gameDbMoveData(const GameDb* db, uint64_t id, size_t* size) {
+    ASSERT(id < db->count, "The game id is out of range!\n");
+
+    uint64_t start = readU64(db->columns[GAMEDB_COLUMN_MOVES] + 8 * id);
+    uint64_t end = readU64(db->columns[GAMEDB_COLUMN_MOVES] + 8 * (id + 1));
+    uint64_t available = (uint64_t)(db->map.data + db->map.size - db->moves);
+    if(start > end || end > available)
+        start = end = 0;
+    *size = (size_t)(end - start);
+    return db->moves + start;
+}
+
+int gameDbMoves(const GameDb* db, uint64_t id, Position* start, Move* moves, int max) {
+    if(!gameDbStart(db, id, start))
+        return -1;
+
+    size_t size;
+    const uint8_t* data = gameDbMoveData(db, id, &size);
+    return gameDbDecodeMoves(start, data, size, moves, max);
+}
+
+static void bufferAppend(GameDbBuffer* buffer, const void* data, size_t size) {
+    if(buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while(capacity < buffer->size + size)
+            capacity *= 2;
+        buffer->data = realloc(buffer->data, capacity);
+        ASSERT(buffer->data != null, "Failed to grow a game database buffer!\n");
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static inline void appendValue(GameDbBuffer* buffer, uint64_t v, int size) {
+    uint8_t bytes[8];
+    writeU64(bytes, v);
+    bufferAppend(buffer, bytes, (size_t)size);
+}
+
+static inline uint64_t hashString(const char* s, size_t length) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for(size_t i = 0; i < length; i++)
+        h = (h ^ (uint8_t)s[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+static void growStringTable(GameDbWriter* w) {
+    free(w->stringTable);
+    w->stringTableSize = w->stringTableSize ? w->stringTableSize * 2 : 1 << 12;
+    w->stringTable = calloc(w->stringTableSize, sizeof(uint32_t));
+    ASSERT(w->stringTable != null, "Failed to grow the string table!\n");
+
+    for(uint64_t id = 0; id < w->stringCount; id++) {
+        uint64_t start = readU64(w->stringOffsets.data + 8 * id);
+        uint64_t end = readU64(w->stringOffsets.data + 8 * (id + 1));
+        size_t i = hashString((const char*)w->stringData.data + start, end - start - 1) & (w->stringTableSize - 1);
+        while(w->stringTable[i])
+            i = (i + 1) & (w->stringTableSize - 1);
+        w->stringTable[i] = (uint32_t)id + 1;
+    }
+}
+
+static uint32_t internString(GameDbWriter* w, PgnString s) {
+    if(w->stringCount * 2 >= w->stringTableSize)
+        growStringTable(w);
+
+    size_t i = hashString(s.data, s.length) & (w->stringTableSize - 1);
+    while(w->stringTable[i]) {
+        uint32_t id = w->stringTable[i] - 1;
+        uint64_t start = readU64(w->stringOffsets.data + 8 * (uint64_t)id);
+        uint64_t end = readU64(w->stringOffsets.data + 8 * ((uint64_t)id + 1));
+        if(end - start - 1 == s.length && !memcmp(w->stringData.data + start, s.data, s.length))
+            return id;
+        i = (i + 1) & (w->stringTableSize - 1);
+    }
+
+    uint32_t id = (uint32_t)w->stringCount++;
+    w->stringTable[i] = id + 1;
+    bufferAppend(&w->stringData, s.data, s.length);
+    bufferAppend(&w->stringData, "", 1);
+    appendValue(&w->stringOffsets, w->stringData.size, 8);
+    return id;
+}
+
+bool gameDbCreate(GameDbWriter* writer, const char* path) {
+    ASSERT(writer != null, "The writer ptr provided shouldn't be null!\n");
+    memset(writer, 0, sizeof(GameDbWriter));
+
+    writer->file = fopen(path, "wb");
+    if(!writer->file)
+        return false;
+    writer->path = strdup(path);
+
+    // the headers go after the moves, the space for the file header is kept
+    uint8_t header[GAMEDB_HEADER_SIZE] = {0};
+    writer->failed = fwrite(header, 1, GAMEDB_HEADER_SIZE, writer->file) != GAMEDB_HEADER_SIZE;
+
+    appendValue(&writer->stringOffsets, 0, 8);
+    internString(writer, (PgnString){ "", 0 });
+    appendValue(&writer->columns[GAMEDB_COLUMN_MOVES], 0, 8);
+    return !writer->failed;
+}
+
+bool gameDbAdd(GameDbWriter* writer, const GameInfo* info, const uint8_t* moves, size_t size) {
+    if(writer->failed)
+        return false;
+    if(size && fwrite(moves, 1, size, writer->file) != size) {
+        writer->failed = true;
+        return false;
+    }
+    writer->moveBytes += size;
+    writer->count++;
+
+    appendValue(&writer->columns[GAMEDB_COLUMN_MOVES], writer->moveBytes, 8);
+    appendValue(&writer->columns[GAMEDB_COLUMN_PLY], (uint64_t)info->ply, 2);
+    appendValue(&writer->columns[GAMEDB_COLUMN_DATE], info->date, 4);
+    appendValue(&writer->columns[GAMEDB_COLUMN_RESULT], (uint64_t)info->result, 1);
+    appendValue(&writer->columns[GAMEDB_COLUMN_WHITE_ELO], info->whiteElo, 2);
+    appendValue(&writer->columns[GAMEDB_COLUMN_BLACK_ELO], info->blackElo, 2);
+    for(int i = 0; i < GAMEDB_STRINGS; i++)
+        appendValue(&writer->columns[GAMEDB_COLUMN_STRINGS + i], internString(writer, info->strings[i]), 4);
+    return true;
+}
+
+bool gameDbFinish(GameDbWriter* w) {
+    uint8_t header[GAMEDB_HEADER_SIZE] = {0};
+    uint64_t position = GAMEDB_HEADER_SIZE + w->moveBytes;
+    const GameDbBuffer* sections[3 + GAMEDB_COLUMNS] = { &w->stringOffsets, &w->stringData, null };
+    for(int i = 0; i < GAMEDB_COLUMNS; i++)
+        sections[3 + i] = &w->columns[i];
+
+    memcpy(header, "CGD1", 4);
+    writeU64(header + 8, w->count);
+    writeU64(header + 16, w->stringCount);
+    writeU64(header + 40, GAMEDB_HEADER_SIZE);
+    for(int i = 0; i < 3 + GAMEDB_COLUMNS && !w->failed; i++) {
+        if(!sections[i])
+            continue;
+        writeU64(header + 24 + 8 * i, position);
+        w->failed = fwrite(sections[i]->data, 1, sections[i]->size, w->file) != sections[i]->size;
+        position += sections[i]->size;
+    }
+    if(!w->failed)
+        w->failed = fseek(w->file, 0, SEEK_SET) != 0 || fwrite(header, 1, GAMEDB_HEADER_SIZE, w->file) != GAMEDB_HEADER_SIZE;
+    if(fclose(w->file) != 0)
+        w->failed = true;
+
+    bool ok = !w->failed;
+    if(!ok)
+        remove(w->path);
+
+    for(int i = 0; i < GAMEDB_COLUMNS; i++)
+        free(w->columns[i].data);
+    free(w->stringData.data);
+    free(w->stringOffsets.data);
+    free(w->stringTable);
+    free(w->path);
+    memset(w, 0, sizeof(GameDbWriter));
+    return ok;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "position.h"
+#include "pgn.h"
+#include "platform.h"
+
+#include <stdio.h>
+
+/*
+ * Game database, little endian:
+ *   0  char[4]  magic "CGD1"
+ *   4  uint32   reserved
+ *   8  uint64   game count
+ *   16 uint64   string count
+ *   24 uint64   string offsets, stringCount + 1 uint64 offsets into the string data
+ *   32 uint64   string data, every string is null terminated
+ *   40 uint64   move data
+ *   48 uint64[GAMEDB_COLUMNS] column offsets, gameCount values each
+ * A move byte is 'piece << 4 | target': the moving piece's index among the side's pieces
+ * by square, and the destination's index among its pseudo-legal targets by square (times 4
+ * plus the promotion piece for a promoting pawn). A target index of GAMEDB_MOVE_EXTENDED
+ * or more is written as GAMEDB_MOVE_EXTENDED followed by one byte with the rest.
+ * The headers are stored by column, the strings once each.
+ */
+#define GAMEDB_HEADER_SIZE 256
+#define GAMEDB_MOVE_EXTENDED 15
+#define GAMEDB_MAX_MOVE_BYTES 2
+
+typedef enum {
+    GAMEDB_EVENT,
+    GAMEDB_SITE,
+    GAMEDB_ROUND,
+    GAMEDB_WHITE,
+    GAMEDB_BLACK,
+    GAMEDB_ECO,
+    GAMEDB_FEN, // empty for the standard start
+    GAMEDB_STRINGS
+} GameDbString;
+
+typedef enum {
+    GAMEDB_COLUMN_MOVES, // uint64 offset into the move data, gameCount + 1 values
+    GAMEDB_COLUMN_PLY,   // uint16
+    GAMEDB_COLUMN_DATE,  // uint32 yyyymmdd, unknown parts are 0
+    GAMEDB_COLUMN_RESULT,    // uint8 GameResult
+    GAMEDB_COLUMN_WHITE_ELO, // uint16
+    GAMEDB_COLUMN_BLACK_ELO, // uint16
+    GAMEDB_COLUMN_STRINGS,   // uint32 string id for each GameDbString
+    GAMEDB_COLUMNS = GAMEDB_COLUMN_STRINGS + GAMEDB_STRINGS
+} GameDbColumn;
+
+typedef struct {
+    PgnString strings[GAMEDB_STRINGS]; // null terminated when read from a database
+    uint32_t date;
+    GameResult result;
+    uint16_t whiteElo;
+    uint16_t blackElo;
+    int ply;
+} GameInfo;
+
+typedef struct {
+    MappedFile map;
+    uint64_t count;
+    uint64_t stringCount;
+    const uint8_t* stringOffsets;
+    const char* strings;
+    const uint8_t* moves;
+    const uint8_t* columns[GAMEDB_COLUMNS];
+} GameDb;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} GameDbBuffer;
+
+typedef struct {
+    FILE* file;
+    char* path;
+    uint64_t count;
+    uint64_t moveBytes;
+    bool failed;
+
+    GameDbBuffer columns[GAMEDB_COLUMNS];
+    GameDbBuffer stringData;
+    GameDbBuffer stringOffsets;
+    uint32_t* stringTable; // open addressing, string id + 1
+    size_t stringTableSize;
+    uint64_t stringCount;
+} GameDbWriter;
+
+// Fills the info from the game's tags, the slices point into the PGN
+void gameInfoFromPgn(const PgnGame* game, GameInfo* info);
+
+// Writes the byte count to 'size', 'out' needs GAMEDB_MAX_MOVE_BYTES per move. False for a start
+// with more than 16 pieces a side, which the 4 bits numbering the moving piece can't tell apart
+bool gameDbEncodeMoves(const Position* start, const Move* moves, int ply, uint8_t* out, size_t* size);
+// Returns the number of moves decoded, stops early at a move that isn't legal
+int gameDbDecodeMoves(const Position* start, const uint8_t* data, size_t size, Move* out, int max);
+// Called with every position of a replayed game, the start is ply 0. Returning false stops the replay
+typedef bool (*GameDbPositionFn)(const Position* pos, int ply, void* user);
+// Replays up to 'max' moves without keeping them, returns the number played
+int gameDbReplay(const Position* start, const uint8_t* data, size_t size, int max, GameDbPositionFn fn, void* user);
+
+bool gameDbOpen(GameDb* db, const char* path);
+void gameDbClose(GameDb* db);
+void gameDbInfo(const GameDb* db, uint64_t id, GameInfo* info);
+// The start of the game, false if its FEN is broken
+bool gameDbStart(const GameDb* db, uint64_t id, Position* start);
+const uint8_t* gameDbMoveData(const GameDb* db, uint64_t id, size_t* size);
+// Decodes the start and moves of a game, returns the number of moves or -1
+int gameDbMoves(const GameDb* db, uint64_t id, Position* start, Move* moves, int max);
+
+bool gameDbCreate(GameDbWriter* writer, const char* path);
+// 'moves' as written by gameDbEncodeMoves, info->ply has to match
+bool gameDbAdd(GameDbWriter* writer, const GameInfo* info, const uint8_t* moves, size_t size);
+// Writes the headers and closes the file, false if anything failed on the way
+bool gameDbFinish(GameDbWriter* writer);
@@ -0,0 +1,188 @@
+#include "ingest.h"
+#include "platform.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#define INGEST_CHUNK_SIZE (4 << 20)
+
+typedef struct {
+    IngestBuffer out;
+    uint64_t games, plies, broken;
+    size_t offset, length;
+    bool ready;
+} IngestSlot;
+
+typedef struct {
+    const char* text;
+    size_t length;
+    const IngestOptions* options;
+    size_t chunkSize;
+
+    IngestSlot* slots;
+    int depth;
+
+    pthread_mutex_t lock;
+    pthread_cond_t slotFree;
+    pthread_cond_t slotReady;
+    size_t nextOffset; // start of the next chunk to hand out
+    uint64_t nextChunk;
+    uint64_t merged;
+    bool failed;
+} Ingest;
+
+typedef struct {
+    Ingest* ingest;
+    IngestSlot* slot;
+    bool failed;
+} IngestWorker;
+
+void ingestWrite(IngestBuffer* buffer, const void* data, size_t size) {
+    if(buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while(capacity < buffer->size + size)
+            capacity *= 2;
+        buffer->data = realloc(buffer->data, capacity);
+        ASSERT(buffer->data != null, "Failed to grow an ingest buffer!\n");
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static bool onWorkerGame(const PgnGame* game, void* user) {
+    IngestWorker* w = (IngestWorker*)user;
+    IngestSlot* slot = w->slot;
+    const IngestOptions* options = w->ingest->options;
+
+    slot->games++;
+    slot->plies += (uint64_t)game->ply;
+    slot->broken += game->broken;
+    if(options->onGame && !options->onGame(game, &slot->out, options->user)) {
+        w->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static void* ingestWorkerMain(void* arg) {
+    Ingest* in = (Ingest*)arg;
+    IngestWorker w = { .ingest = in };
+
+    while(true) {
+        pthread_mutex_lock(&in->lock);
+        while(!in->failed && in->nextOffset < in->length && in->nextChunk >= in->merged + (uint64_t)in->depth)
+            pthread_cond_wait(&in->slotFree, &in->lock);
+        if(in->failed || in->nextOffset >= in->length) {
+            pthread_mutex_unlock(&in->lock);
+            break;
+        }
+
+        IngestSlot* slot = &in->slots[in->nextChunk++ % (uint64_t)in->depth];
+        size_t start = in->nextOffset;
+        size_t end = start + in->chunkSize < in->length ? pgnNextGame(in->text, in->length, start + in->chunkSize) : in->length;
+        in->nextOffset = end;
+        pthread_mutex_unlock(&in->lock);
+
+        slot->out.size = 0;
+        slot->games = slot->plies = slot->broken = 0;
+        slot->offset = start;
+        slot->length = end - start;
+        w.slot = slot;
+        pgnParse(in->text + start, end - start, in->options->maxPly, onWorkerGame, &w);
+
+        pthread_mutex_lock(&in->lock);
+        slot->ready = true;
+        if(w.failed)
+            in->failed = true;
+        pthread_cond_broadcast(&in->slotReady);
+        if(w.failed)
+            pthread_cond_broadcast(&in->slotFree);
+        pthread_mutex_unlock(&in->lock);
+    }
+
+    return null;
+}
+
+bool ingestPgn(const char* text, size_t length, const IngestOptions* options, IngestStats* stats) {
+    ASSERT(options != null, "The options shouldn't be null!\n");
+    ASSERT(stats != null, "The stats shouldn't be null!\n");
+
+    int threads = options->threads > 0 ? options->threads : getCpuCount();
+    Ingest in = {
+        .text = text,
+        .length = length,
+        .options = options,
+        .chunkSize = options->chunkSize ? options->chunkSize : INGEST_CHUNK_SIZE,
+        .depth = options->queueDepth > 0 ? options->queueDepth : 2 * threads
+    };
+    in.slots = calloc((size_t)in.depth, sizeof(IngestSlot));
+    ASSERT(in.slots != null, "Failed to allocate the ingest queue!\n");
+    pthread_mutex_init(&in.lock, null);
+    pthread_cond_init(&in.slotFree, null);
+    pthread_cond_init(&in.slotReady, null);
+
+    int64_t start = getTimeMs();
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(handles != null, "Failed to allocate the ingest threads!\n");
+    for(int i = 0; i < threads; i++)
+        pthread_create(&handles[i], null, ingestWorkerMain, &in);
+
+    // merges the chunks in order as they're done
+    while(true) {
+        pthread_mutex_lock(&in.lock);
+        IngestSlot* slot = &in.slots[in.merged % (uint64_t)in.depth];
+        while(!in.failed && !slot->ready && !(in.nextOffset >= in.length && in.merged == in.nextChunk))
+            pthread_cond_wait(&in.slotReady, &in.lock);
+        if(in.failed || !slot->ready) {
+            pthread_mutex_unlock(&in.lock);
+            break;
+        }
+        pthread_mutex_unlock(&in.lock);
+
+        IngestChunk chunk = {
+            .data = slot->out.data,
+            .size = slot->out.size,
+            .games = slot->games,
+            .offset = slot->offset,
+            .length = slot->length
+        };
+        stats->games += slot->games;
+        stats->plies += slot->plies;
+        stats->broken += slot->broken;
+        stats->bytes += slot->length;
+        bool ok = !options->onChunk || options->onChunk(&chunk, options->user);
+
+        pthread_mutex_lock(&in.lock);
+        slot->ready = false;
+        in.merged++;
+        if(!ok)
+            in.failed = true;
+        pthread_cond_broadcast(&in.slotFree);
+        pthread_mutex_unlock(&in.lock);
+    }
+
+    for(int i = 0; i < threads; i++)
+        pthread_join(handles[i], null);
+    stats->time += getTimeMs() - start;
+
+    for(int i = 0; i < in.depth; i++)
+        free(in.slots[i].out.data);
+    free(in.slots);
+    free(handles);
+    pthread_mutex_destroy(&in.lock);
+    pthread_cond_destroy(&in.slotFree);
+    pthread_cond_destroy(&in.slotReady);
+
+    return !in.failed;
+}
+
+bool ingestPgnFile(const char* path, const IngestOptions* options, IngestStats* stats) {
+    MappedFile file;
+    if(!mapFile(&file, path))
+        return false;
+
+    bool ok = ingestPgn((const char*)file.data, file.size, options, stats);
+    unmapFile(&file);
+    return ok;
+}
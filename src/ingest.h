@@ -0,0 +1,56 @@
+#pragma once
+
+#include "pgn.h"
+
+#include <stddef.h>
+
+// Parallel PGN ingestion
+//
+// The text is cut into chunks at game boundaries, the worker threads parse a chunk
+// each and let onGame append whatever it wants to keep to the chunk's buffer. The
+// buffers are handed to onChunk on the calling thread in file order, at most
+// 'queueDepth' chunks are in flight so memory stays bounded however large the file is.
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} IngestBuffer;
+
+typedef struct {
+    const uint8_t* data; // what onGame wrote for the chunk's games, in order
+    size_t size;
+    uint64_t games;
+    size_t offset;       // where the chunk is in the text
+    size_t length;
+} IngestChunk;
+
+// Called on a worker thread, return false to abort
+typedef bool (*IngestGameFn)(const PgnGame* game, IngestBuffer* out, void* user);
+// Called on the ingesting thread in file order, return false to abort
+typedef bool (*IngestChunkFn)(const IngestChunk* chunk, void* user);
+
+typedef struct {
+    int threads;      // 0 for every core
+    int maxPly;       // see pgnParse
+    size_t chunkSize; // 0 for the default
+    int queueDepth;   // 0 for twice the threads
+    IngestGameFn onGame;   // may be null
+    IngestChunkFn onChunk; // may be null
+    void* user;
+} IngestOptions;
+
+typedef struct {
+    uint64_t games;
+    uint64_t plies;
+    uint64_t broken;
+    uint64_t bytes;
+    int64_t time; // ms
+} IngestStats;
+
+void ingestWrite(IngestBuffer* buffer, const void* data, size_t size);
+
+// Adds to 'stats', false when a callback aborted
+bool ingestPgn(const char* text, size_t length, const IngestOptions* options, IngestStats* stats);
+// False when the file can't be read or a callback aborted
+bool ingestPgnFile(const char* path, const IngestOptions* options, IngestStats* stats);
@@ -0,0 +1,118 @@
+#include "linepipe.h"
+#include "platform.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// How long a read waits before the reader checks whether it should stop
+#define READ_TIMEOUT_MS 100
+
+void linePipeInit(LinePipe* pipe, void* queue, size_t messageSize, size_t queueSize, char* outgoing,
+                  size_t outgoingCapacity) {
+    ASSERT(pipe != null, "The pipe ptr provided shouldn't be null!\n");
+    ASSERT((queueSize & (queueSize - 1)) == 0, "The queue size must be a power of 2!\n");
+
+    memset(pipe, 0, sizeof(LinePipe));
+    pipe->queue = queue;
+    pipe->messageSize = messageSize;
+    pipe->queueSize = queueSize;
+    pipe->outgoing = outgoing;
+    pipe->outgoingCapacity = outgoingCapacity;
+}
+
+bool linePipePush(LinePipe* pipe, const void* message, bool droppable) {
+    size_t tail = atomic_load_explicit(&pipe->tail, memory_order_relaxed);
+    while(tail - atomic_load_explicit(&pipe->head, memory_order_acquire) == pipe->queueSize) {
+        if(droppable || !atomic_load(&pipe->running))
+            return false;
+        sleepMs(1);
+    }
+
+    memcpy(pipe->queue + (tail & (pipe->queueSize - 1)) * pipe->messageSize, message, pipe->messageSize);
+    atomic_store_explicit(&pipe->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static void* readerMain(void* arg) {
+    LinePipe* pipe = (LinePipe*)arg;
+    char line[LINE_PIPE_MAX_LINE];
+    size_t lineLength = 0;
+    char buffer[4096];
+
+    while(atomic_load(&pipe->running)) {
+        long n = pipe->read(pipe->handle, buffer, sizeof(buffer), READ_TIMEOUT_MS);
+        if(n < 0)
+            break;
+
+        for(long i = 0; i < n; i++) {
+            char c = buffer[i];
+            if(c == '\n') {
+                line[lineLength] = '\0';
+                pipe->parse(line, pipe->user);
+                lineLength = 0;
+            } else if(c != '\r' && lineLength < sizeof(line) - 1) {
+                line[lineLength++] = c;
+            }
+        }
+    }
+
+    atomic_store(&pipe->ended, true);
+    pipe->parse(null, pipe->user);
+    return null;
+}
+
+bool linePipeStart(LinePipe* pipe, void* handle, LineReadFn read, LineWriteFn write, LineParseFn parse, void* user) {
+    pipe->handle = handle;
+    pipe->read = read;
+    pipe->write = write;
+    pipe->parse = parse;
+    pipe->user = user;
+
+    atomic_store(&pipe->running, true);
+    if(pthread_create(&pipe->reader, null, readerMain, pipe) != 0) {
+        atomic_store(&pipe->running, false);
+        return false;
+    }
+    return true;
+}
+
+void linePipeStop(LinePipe* pipe) {
+    if(!atomic_load(&pipe->running))
+        return;
+
+    atomic_store(&pipe->running, false);
+    pthread_join(pipe->reader, null);
+}
+
+void linePipeFlush(LinePipe* pipe) {
+    if(!pipe->outgoingSize || atomic_load(&pipe->ended))
+        return;
+    long written = pipe->write(pipe->handle, pipe->outgoing, pipe->outgoingSize);
+    if(written <= 0)
+        return;
+    memmove(pipe->outgoing, pipe->outgoing + written, pipe->outgoingSize - (size_t)written);
+    pipe->outgoingSize -= (size_t)written;
+}
+
+bool linePipeSend(LinePipe* pipe, const char* fmt, va_list args) {
+    size_t space = pipe->outgoingCapacity - pipe->outgoingSize;
+    int n = vsnprintf(pipe->outgoing + pipe->outgoingSize, space, fmt, args);
+    if(n < 0 || (size_t)n + 1 >= space)
+        return false;
+
+    pipe->outgoing[pipe->outgoingSize + n] = '\n';
+    pipe->outgoingSize += (size_t)n + 1;
+    linePipeFlush(pipe);
+    return true;
+}
+
+bool linePipePoll(LinePipe* pipe, void* out) {
+    linePipeFlush(pipe);
+
+    size_t head = atomic_load_explicit(&pipe->head, memory_order_relaxed);
+    if(head == atomic_load_explicit(&pipe->tail, memory_order_acquire))
+        return false;
+    memcpy(out, pipe->queue + (head & (pipe->queueSize - 1)) * pipe->messageSize, pipe->messageSize);
+    atomic_store_explicit(&pipe->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "defines.h"
+
+#include <stdarg.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Longest line handed to the parser, the rest of a longer one is cut off
+#define LINE_PIPE_MAX_LINE 4096
+
+// Return the bytes moved, 0 on a read timeout and -1 once the other end is gone
+typedef long (*LineReadFn)(void* handle, void* data, size_t size, int timeoutMs);
+typedef long (*LineWriteFn)(void* handle, const void* data, size_t size);
+// Called on the reader thread with every line, without its line end. Called once more with
+// null when the stream ends
+typedef void (*LineParseFn)(char* line, void* user);
+
+// A line based text stream to a child process or a socket, shared by the engine and the
+// server clients
+//
+// A reader thread splits the input into lines and the parser pushes its messages into a
+// single producer, single consumer ring that the thread owning the pipe (the render loop)
+// polls. Commands are written without blocking, whatever the stream doesn't take goes out
+// on the next send or poll. The ring and the outgoing buffer belong to the owner.
+typedef struct {
+    void* handle;
+    LineReadFn read;
+    LineWriteFn write;
+    LineParseFn parse;
+    void* user;
+
+    pthread_t reader;
+    atomic_bool running;
+    atomic_bool ended; // the reader saw the end of the stream, nothing is written after it
+
+    uint8_t* queue;
+    size_t messageSize;
+    size_t queueSize;    // must be a power of 2
+    _Atomic size_t head; // next to read, owned by the consumer
+    _Atomic size_t tail; // next to write, owned by the reader thread
+
+    // consumer side only
+    char* outgoing;
+    size_t outgoingCapacity;
+    size_t outgoingSize;
+} LinePipe;
+
+// Sets up the pipe over the caller's ring of 'queueSize' messages and outgoing buffer
+void linePipeInit(LinePipe* pipe, void* queue, size_t messageSize, size_t queueSize, char* outgoing,
+                  size_t outgoingCapacity);
+// Starts the reader thread on an open stream, false if it can't be created
+bool linePipeStart(LinePipe* pipe, void* handle, LineReadFn read, LineWriteFn write, LineParseFn parse, void* user);
+// Joins the reader thread, closing the stream is up to the caller
+void linePipeStop(LinePipe* pipe);
+
+// Reader thread: queues a message, waits for room unless 'droppable'. False if it was dropped
+bool linePipePush(LinePipe* pipe, const void* message, bool droppable);
+
+// Queues a command line and sends what the stream takes, false if the buffer is full
+bool linePipeSend(LinePipe* pipe, const char* fmt, va_list args);
+void linePipeFlush(LinePipe* pipe);
+// Takes the next message off the ring, false if there is none. Flushes the outgoing buffer first
+bool linePipePoll(LinePipe* pipe, void* out);
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -10,30 +11,30 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#define null 0
-#define QUAD_VERTICES 6
-
-#define FILES 8
-#define RANKS 8
-
-#define INFO(msg, ...) fprintf(stdout, "INFO: "msg, ##__VA_ARGS__)
-#define ERROR(msg, ...) fprintf(stderr, "ERROR: "msg, ##__VA_ARGS__)
-#define ASSERT(expr, msg, ...) do { if(!(expr)) { fprintf(stderr, "ASSERT FAILED! "msg, \
-                       ##__VA_ARGS__); exit(1); } } while(0)
-
-typedef enum {
-    TEAM_WHITE,
-    TEAM_BLACK
-} PieceTeam;
+#include "defines.h"
+#include "position.h"
+#include "eval.h"
+#include "search.h"
+#include "tb.h"
+#include "book.h"
+#include "gamedb.h"
+#include "posindex.h"
+#include "explorer.h"
+#include "bench.h"
+#include "platform.h"
+#include "uciclient.h"
+#include "netclient.h"
 
-typedef enum {
-    PAWN,
-    ROOK,
-    KNIGHT,
-    BISHOP,
-    QUEEN,
-    KING
-} PieceType;
+#define QUAD_VERTICES 6
+#define COMPUTER_MOVE_TIME 2000
+#define DEFAULT_HASH_MB 64
+// how often a hash file gets the entries stored since the last time
+#define HASH_SNAPSHOT_MS 30000
+// set on the computer's move once its search is done, so MOVE_NONE can be told apart
+#define COMPUTER_MOVE_READY (1 << 16)
+#define MAX_POSITION_HITS 256
+#define PRINTED_POSITION_HITS 5
+#define MAX_EXTERNAL_ENGINES 4
 
 typedef struct {
     uint32_t id;
@@ -46,7 +47,7 @@ typedef struct {
 } Quad;
 
 typedef struct {
-    Texture tex;
+    Texture* tex;
     Quad quad;
     PieceTeam team;
     PieceType type;
@@ -57,6 +58,7 @@ typedef struct {
 typedef struct {
     bool board[FILES][RANKS]; // to know if any slot on the board is occupied or not
     Piece pieces[8 * 4];
+    Texture textures[TEAMS][PIECE_TYPES]; // shared by every piece, loaded once
 } PieceManager;
 
 typedef struct {
@@ -69,6 +71,59 @@ typedef struct {
     Texture boardTex;
 
     PieceManager manager;
+
+    // the game behind the pieces, 'keys' holds every position before the current one
+    Position position;
+    uint64_t keys[MAX_GAME_PLY];
+    int keyCount;
+    // the moves from 'gameStart', the ones after 'gamePly' are kept for stepping forward
+    Position gameStart;
+    Move gameMoves[MAX_GAME_PLY];
+    int gameLength;
+    int gamePly;
+
+    GameDb db;
+    const char* dbPath;
+    int64_t dbGame; // -1 before one was loaded
+
+    // games of the database that reached the position on the board
+    PositionIndex index;
+    PositionHit hits[MAX_POSITION_HITS];
+    int hitCount;
+    int hitCursor;
+
+    Explorer explorer;
+
+    Engine engine;
+    bool analysing;
+    int multiPv; // lines the analysis shows, + and - change it
+    _Atomic uint32_t analysisMove; // written by the search thread
+    bool analysisTbShown; // cleared before the search starts, then only the search thread uses it
+    Quad hint;
+    Texture hintTex;
+
+    Book book;
+    uint64_t bookSeed;
+    int computer; // team the computer plays, -1 when off
+    _Atomic uint32_t computerMove;
+    // after its move the computer searches the reply it expects on the player's time
+    bool ponder;
+    Move computerPonder; // written by the search, read once engineWait returned
+    Move expectedReply;  // set while the computer's move is played
+    bool pondering;
+    uint64_t ponderKey;  // the position after the expected reply
+
+    // UCI engines run as child processes, they analyse alongside the built in one
+    UciClient* externals[MAX_EXTERNAL_ENGINES];
+    int externalCount;
+    bool externalAnalysis;
+
+    // a game on a server, the board only takes moves for 'netTeam' then
+    NetClient* net;
+    int netTeam; // -1 when offline
+    int netGame;
+    int netEchoes; // our moves the server still has to confirm
+    bool netPlaying;
 } Ctx;
 
 
@@ -256,20 +311,7 @@ void getPieceVertices(float* out, int file, int rank) {
     memcpy(out, cpy, sizeof(cpy));
 }
 
-void createPiece(Piece* piece, PieceType type, PieceTeam team, int file, int rank) {
-    ASSERT(piece != null, "The piece ptr provided shouldn't be null!");
-
-    piece->valid = true;
-    piece->file = file;
-    piece->rank = rank;
-    piece->type = type;
-    piece->team = team;
-
-    float vertices[QUAD_VERTICES * 5];
-    getPieceVertices(vertices, file, rank);
-
-    piece->quad = createQuad((float*)vertices, sizeof(vertices));
-
+void loadPieceTextures(Texture textures[TEAMS][PIECE_TYPES]) {
     const char* white[] = {
         "assets/textures/white_pawn.png",
         "assets/textures/white_rook.png",
@@ -286,27 +328,40 @@ void createPiece(Piece* piece, PieceType type, PieceTeam team, int file, int ran
         "assets/textures/black_queen.png",
         "assets/textures/black_king.png"
     };
-    const char* path;
-    if(team == TEAM_WHITE)
-        path = white[(int)type];
-    else
-        path = black[(int)type];
 
-    // texture
-    {
-        stbi_set_flip_vertically_on_load(true);
-        int w, h, ch;
-        uint8_t* pixels = stbi_load(path, &w, &h, &ch, 4);
-        ASSERT(pixels != null, "Failed to load the texture! Path: %s", path);
-        createTexture(&piece->tex, w, h, pixels);
-        free(pixels);
+    stbi_set_flip_vertically_on_load(true);
+    for(int team = 0; team < TEAMS; team++) {
+        for(int type = 0; type < PIECE_TYPES; type++) {
+            const char* path = team == TEAM_WHITE ? white[type] : black[type];
+            int w, h, ch;
+            uint8_t* pixels = stbi_load(path, &w, &h, &ch, 4);
+            ASSERT(pixels != null, "Failed to load the texture! Path: %s", path);
+            createTexture(&textures[team][type], w, h, pixels);
+            free(pixels);
+        }
     }
 }
 
+void createPiece(Piece* piece, Texture* tex, PieceType type, PieceTeam team, int file, int rank) {
+    ASSERT(piece != null, "The piece ptr provided shouldn't be null!");
+    ASSERT(tex != null, "The texture ptr provided shouldn't be null!");
+
+    piece->valid = true;
+    piece->file = file;
+    piece->rank = rank;
+    piece->type = type;
+    piece->team = team;
+    piece->tex = tex;
+
+    float vertices[QUAD_VERTICES * 5];
+    getPieceVertices(vertices, file, rank);
+
+    piece->quad = createQuad((float*)vertices, sizeof(vertices));
+}
+
 void deletePiece(Piece* piece) {
     ASSERT(piece != null, "The piece ptr provided shouldn't be null!");
     
-    deleteTexture(&piece->tex);
     deleteQuad(&piece->quad);
     piece->valid = false;
 }
@@ -324,43 +379,7 @@ void updatePiecePosition(Piece* piece, int file, int rank) {
 void renderPiece(Piece* piece, uint32_t shader) {
     ASSERT(piece != null, "The piece ptr provided shouldn't be null!");
 
-    renderQuad(&piece->quad, &piece->tex, shader);
-}
-
-void initPieceManager(PieceManager* manager) {
-    ASSERT(manager != null, "The manager ptr provided shouldn't be null!");
-
-    int idx = 0;
-    for(int i = 0; i < FILES; i++) {
-        createPiece(&manager->pieces[idx++], PAWN, TEAM_WHITE, i+1, 2);
-    }
-    for(int i = 0; i < FILES; i++) {
-        createPiece(&manager->pieces[idx++], PAWN, TEAM_BLACK, i+1, 7);
-    }
-    createPiece(&manager->pieces[idx++], ROOK, TEAM_WHITE, 1, 1);
-    createPiece(&manager->pieces[idx++], ROOK, TEAM_WHITE, 8, 1);
-    createPiece(&manager->pieces[idx++], KNIGHT, TEAM_WHITE, 2, 1);
-    createPiece(&manager->pieces[idx++], KNIGHT, TEAM_WHITE, 7, 1);
-    createPiece(&manager->pieces[idx++], BISHOP, TEAM_WHITE, 3, 1);
-    createPiece(&manager->pieces[idx++], BISHOP, TEAM_WHITE, 6, 1);
-    createPiece(&manager->pieces[idx++], QUEEN, TEAM_WHITE, 4, 1);
-    createPiece(&manager->pieces[idx++], KING, TEAM_WHITE, 5, 1);
-
-    createPiece(&manager->pieces[idx++], ROOK, TEAM_BLACK, 1, 8);
-    createPiece(&manager->pieces[idx++], ROOK, TEAM_BLACK, 8, 8);
-    createPiece(&manager->pieces[idx++], KNIGHT, TEAM_BLACK, 2, 8);
-    createPiece(&manager->pieces[idx++], KNIGHT, TEAM_BLACK, 7, 8);
-    createPiece(&manager->pieces[idx++], BISHOP, TEAM_BLACK, 3, 8);
-    createPiece(&manager->pieces[idx++], BISHOP, TEAM_BLACK, 6, 8);
-    createPiece(&manager->pieces[idx++], QUEEN, TEAM_BLACK, 4, 8);
-    createPiece(&manager->pieces[idx++], KING, TEAM_BLACK, 5, 8);
-
-    for(int i = 0; i < FILES; i++) {
-        manager->board[i][0] = true;
-        manager->board[i][1] = true;
-        manager->board[i][6] = true;
-        manager->board[i][7] = true;
-    }
+    renderQuad(&piece->quad, piece->tex, shader);
 }
 
 void deinitPieceManager(PieceManager* manager) {
@@ -371,10 +390,59 @@ void deinitPieceManager(PieceManager* manager) {
             deletePiece(&manager->pieces[i]);
         }
     }
+    for(int team = 0; team < TEAMS; team++) {
+        for(int type = 0; type < PIECE_TYPES; type++)
+            deleteTexture(&manager->textures[team][type]);
+    }
 
     memset(manager, 0, sizeof(PieceManager));
 }
 
+// Moves, promotes and removes pieces so the manager shows 'pos', the quads are reused
+void syncPieceManager(PieceManager* manager, const Position* pos) {
+    ASSERT(manager != null, "The manager ptr provided shouldn't be null!");
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!");
+
+    memset(manager->board, 0, sizeof(manager->board));
+
+    int idx = 0;
+    for(int sq = 0; sq < SQUARES; sq++) {
+        uint8_t piece = pos->board[sq];
+        if(piece == PIECE_NONE)
+            continue;
+        ASSERT(idx < 8 * 4, "More pieces than the manager can hold!\n");
+
+        Piece* p = &manager->pieces[idx++];
+        PieceTeam team = pieceTeam(piece);
+        PieceType type = pieceType(piece);
+        int file = squareFile(sq) + 1, rank = squareRank(sq) + 1;
+
+        if(!p->valid) {
+            createPiece(p, &manager->textures[team][type], type, team, file, rank);
+        } else {
+            p->type = type;
+            p->team = team;
+            p->tex = &manager->textures[team][type];
+            if(p->file != file || p->rank != rank)
+                updatePiecePosition(p, file, rank);
+        }
+        manager->board[file-1][rank-1] = true;
+    }
+
+    for(; idx < 8 * 4; idx++) {
+        if(manager->pieces[idx].valid)
+            deletePiece(&manager->pieces[idx]);
+    }
+}
+
+// Loads the textures and creates a piece for everything on 'pos'
+void initPieceManager(PieceManager* manager, const Position* pos) {
+    ASSERT(manager != null, "The manager ptr provided shouldn't be null!");
+
+    loadPieceTextures(manager->textures);
+    syncPieceManager(manager, pos);
+}
+
 void renderPieces(PieceManager* manager, uint32_t shader) {
     ASSERT(manager != null, "The manager ptr provided shouldn't be null!");
 
@@ -399,8 +467,10 @@ void getBoardPos(GLFWwindow* window, int width, int height, double x, double y,
     *rank = 8 - floorl(y);
 }
 
-void updatePieces(PieceManager* manager, GLFWwindow* window, int width, int height) {
+// Returns true once the user picked a legal move, promotions are always to a queen
+bool updatePieces(PieceManager* manager, const Position* pos, GLFWwindow* window, int width, int height, Move* move) {
     ASSERT(manager != null, "The manager ptr provided shouldn't be null!");
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!");
     ASSERT(window != null, "The window ptr provided shouldn't be null!");
     static bool isClicked = false;
     static Piece* piece = null;
@@ -424,7 +494,7 @@ void updatePieces(PieceManager* manager, GLFWwindow* window, int width, int heig
                     break;
                 }
 
-                if(p->valid && (p->rank == rank) && (p->file == file))
+                if(p->valid && (p->rank == rank) && (p->file == file) && p->team == pos->side)
                     piece = p;
             }
             
@@ -433,33 +503,740 @@ void updatePieces(PieceManager* manager, GLFWwindow* window, int width, int heig
 
             if (file != 0 && rank != 0 && !piece) {
                 file = rank = oFile = oRank = 0;
-                return;
+                return false;
             }
 
             if(oFile != 0 && oRank != 0) {
-                if(manager->board[oFile-1][oRank-1])
-                    return;
-                manager->board[file-1][rank-1] = false;
-                manager->board[oFile-1][oRank-1] = true;
-                updatePiecePosition(piece, oFile, oRank);     
+                int from = makeSquare(file-1, rank-1), to = makeSquare(oFile-1, oRank-1);
+                MoveList list;
+                generateLegalMoves(pos, &list);
+
+                *move = MOVE_NONE;
+                for(int i = 0; i < list.count; i++) {
+                    Move m = list.moves[i];
+                    if(moveFrom(m) == from && moveTo(m) == to && (moveFlag(m) != MOVE_PROMOTION || movePromotion(m) == QUEEN)) {
+                        *move = m;
+                        break;
+                    }
+                }
 
                 oFile = oRank = rank = file = 0;
                 piece = null;
-            } else {
-                return;
+                return *move != MOVE_NONE;
             }
         }
     }
+
+    return false;
+}
+
+// More than one line shows a block per depth, the lines in SAN under a header
+void printAnalysisLine(Ctx* ctx, const SearchReport* report) {
+    if(report->multiPv == 1)
+        printf("depth %d seldepth %d nodes %llu nps %llu tbhits %llu time %lld\n", report->depth, report->selDepth,
+               (unsigned long long)report->nodes, (unsigned long long)report->nps,
+               (unsigned long long)report->tbHits, (long long)report->time);
+
+    printf("%2d. ", report->multiPv);
+    if(abs(report->score) >= VALUE_MATE_BOUND)
+        printf("mate %d", report->score > 0 ? (VALUE_MATE - report->score + 1) / 2 : -(VALUE_MATE + report->score) / 2);
+    else
+        printf("cp %d", report->score);
+
+    // the root stays put while the search runs, unlike the board
+    Position pos = ctx->engine.root;
+    for(int i = 0; i < report->pvLength; i++) {
+        char san[8];
+        moveToSan(&pos, report->pv[i], san);
+        printf(" %s", san);
+        positionMakeMove(&pos, report->pv[i]);
+    }
+    printf("\n");
 }
 
-int main(void) {
+// The search probed the root before its first report, the render thread never waits on the files
+void printAnalysisTablebase(Ctx* ctx) {
+    const Engine* e = &ctx->engine;
+    const char* names[] = { "draw", "win", "loss" };
+
+    printf("tablebase %s", names[e->tbRootValue]);
+    if(e->tbRootValue != TB_DRAW && e->tbRootDtm >= 0) {
+        printf(" in %d%s plies", e->tbRootDtm, e->tbRootDtm == TB_DTM_MAX ? "+" : "");
+        // the distances don't know the 50-move rule
+        if(e->root.halfmoves + e->tbRootDtm > 100)
+            printf(", the 50-move rule may draw it");
+    }
+    printf("\n");
+}
+
+void onAnalysisReport(const SearchReport* report, void* user) {
+    Ctx* ctx = (Ctx*)user;
+
+    if(!ctx->analysisTbShown) {
+        ctx->analysisTbShown = true;
+        if(ctx->engine.tbRoot)
+            printAnalysisTablebase(ctx);
+    }
+
+    if(ctx->engine.limits.multiPv > 1) {
+        printAnalysisLine(ctx, report);
+    } else {
+        char move[8];
+        printf("info depth %d seldepth %d score ", report->depth, report->selDepth);
+        if(abs(report->score) >= VALUE_MATE_BOUND)
+            printf("mate %d", report->score > 0 ? (VALUE_MATE - report->score + 1) / 2 : -(VALUE_MATE + report->score) / 2);
+        else
+            printf("cp %d", report->score);
+        printf(" nodes %llu nps %llu tbhits %llu time %lld pv", (unsigned long long)report->nodes,
+               (unsigned long long)report->nps, (unsigned long long)report->tbHits, (long long)report->time);
+        for(int i = 0; i < report->pvLength; i++) {
+            moveToString(report->pv[i], move);
+            printf(" %s", move);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+
+    // a pondering search is a move ahead of the board
+    if(report->pvLength && report->multiPv == 1 && !atomic_load(&ctx->engine.pondering))
+        atomic_store(&ctx->analysisMove, report->pv[0]);
+}
+
+void startAnalysis(Ctx* ctx) {
+    ASSERT(ctx != null, "The ctx ptr provided shouldn't be null!\n");
+
+    engineStop(&ctx->engine);
+    engineWait(&ctx->engine);
+    atomic_store(&ctx->analysisMove, MOVE_NONE);
+
+    ctx->analysisTbShown = false;
+
+    SearchLimits limits = { .infinite = true, .multiPv = ctx->multiPv };
+    engineStart(&ctx->engine, &ctx->position, ctx->keys, ctx->keyCount, &limits, onAnalysisReport, null, ctx);
+}
+
+void stopAnalysis(Ctx* ctx) {
+    ASSERT(ctx != null, "The ctx ptr provided shouldn't be null!\n");
+
+    engineStop(&ctx->engine);
+    engineWait(&ctx->engine);
+    atomic_store(&ctx->analysisMove, MOVE_NONE);
+}
+
+void onComputerDone(Move best, Move ponder, void* user) {
+    Ctx* ctx = (Ctx*)user;
+    ctx->computerPonder = ponder;
+    atomic_store(&ctx->computerMove, best | COMPUTER_MOVE_READY);
+}
+
+// Book moves of the current position with their share of the weight
+void printBookMoves(Ctx* ctx) {
+    BookEntry entries[BOOK_MAX_MOVES];
+    int count = bookProbe(&ctx->book, &ctx->position, entries, BOOK_MAX_MOVES);
+    if(!count)
+        return;
+
+    uint32_t total = 0;
+    for(int i = 0; i < count; i++)
+        total += entries[i].weight;
+
+    printf("book");
+    for(int i = 0; i < count; i++) {
+        char move[8];
+        moveToString(entries[i].move, move);
+        printf(" %s %.1f%%", move, total ? 100.0 * entries[i].weight / total : 0.0);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static int compareExplorerGames(const void* a, const void* b) {
+    const ExplorerEntry* x = a;
+    const ExplorerEntry* y = b;
+    uint64_t gx = (uint64_t)x->white + x->draws + x->black + x->unknown;
+    uint64_t gy = (uint64_t)y->white + y->draws + y->black + y->unknown;
+    return gx < gy ? 1 : gx > gy ? -1 : 0;
+}
+
+// Continuations of the current position by the number of games, scored for the side to move
+void printExplorerMoves(Ctx* ctx) {
+    if(!ctx->explorer.count)
+        return;
+
+    ExplorerEntry entries[MAX_MOVES];
+    int count = explorerLookup(&ctx->explorer, ctx->position.key, entries, MAX_MOVES);
+    if(count > MAX_MOVES)
+        count = MAX_MOVES;
+    if(!count)
+        return;
+    qsort(entries, count, sizeof(ExplorerEntry), compareExplorerGames);
+
+    printf("explorer\n");
+    for(int i = 0; i < count; i++) {
+        const ExplorerEntry* e = &entries[i];
+        uint32_t wins = ctx->position.side == TEAM_WHITE ? e->white : e->black;
+        uint32_t losses = ctx->position.side == TEAM_WHITE ? e->black : e->white;
+        uint64_t decided = (uint64_t)wins + e->draws + losses;
+
+        char san[8];
+        moveToSan(&ctx->position, e->move, san);
+        printf("  %-7s %8llu games", san, (unsigned long long)(decided + e->unknown));
+        if(decided)
+            printf("  %5.1f%%", 100.0 * (wins + 0.5 * e->draws) / decided);
+        else
+            printf("       -");
+        if(e->rated)
+            printf("  avg %llu", (unsigned long long)(e->ratingSum / e->rated));
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+void startComputer(Ctx* ctx) {
+    ASSERT(ctx != null, "The ctx ptr provided shouldn't be null!\n");
+
+    engineStop(&ctx->engine);
+    engineWait(&ctx->engine);
+    atomic_store(&ctx->analysisMove, MOVE_NONE);
+    ctx->computerPonder = MOVE_NONE;
+
+    Move move = bookPick(&ctx->book, &ctx->position, &ctx->bookSeed);
+    if(move != MOVE_NONE) {
+        atomic_store(&ctx->computerMove, move | COMPUTER_MOVE_READY);
+        return;
+    }
+
+    SearchLimits limits = { .moveTime = COMPUTER_MOVE_TIME };
+    engineStart(&ctx->engine, &ctx->position, ctx->keys, ctx->keyCount, &limits, onAnalysisReport, onComputerDone, ctx);
+}
+
+// Searches the position after the reply the computer expects, false if there is none
+bool startPondering(Ctx* ctx, Move reply) {
+    if(!ctx->ponder || ctx->computer < 0 || reply == MOVE_NONE)
+        return false;
+
+    MoveList list;
+    generateLegalMoves(&ctx->position, &list);
+    int i = 0;
+    while(i < list.count && list.moves[i] != reply)
+        i++;
+    if(i == list.count)
+        return false;
+
+    static uint64_t keys[MAX_GAME_PLY];
+    int keyCount = ctx->keyCount < MAX_GAME_PLY ? ctx->keyCount : MAX_GAME_PLY - 1;
+    memcpy(keys, ctx->keys + ctx->keyCount - keyCount, sizeof(uint64_t) * keyCount);
+    keys[keyCount++] = ctx->position.key;
+
+    Position next = ctx->position;
+    positionMakeMove(&next, reply);
+    ctx->ponderKey = next.key;
+    ctx->pondering = true;
+    atomic_store(&ctx->analysisMove, MOVE_NONE);
+
+    char san[8];
+    moveToSan(&ctx->position, reply, san);
+    INFO("Pondering on %s\n", san);
+
+    // the time counts from the ponder hit, what was searched before it comes on top
+    SearchLimits limits = { .moveTime = COMPUTER_MOVE_TIME, .ponder = true };
+    engineStart(&ctx->engine, &next, keys, keyCount, &limits, onAnalysisReport, onComputerDone, ctx);
+    return true;
+}
+
+void printGameLine(Ctx* ctx, uint64_t id) {
+    static const char* RESULTS[] = { "*", "1-0", "0-1", "1/2-1/2" };
+    GameInfo info;
+    gameDbInfo(&ctx->db, id, &info);
+    printf("%s - %s %s, %s %u", info.strings[GAMEDB_WHITE].data, info.strings[GAMEDB_BLACK].data,
+           RESULTS[info.result], info.strings[GAMEDB_EVENT].data, info.date / 10000);
+}
+
+// Looks the position up in the index and lists the first games reaching it
+void findPositionGames(Ctx* ctx) {
+    ctx->hitCount = ctx->hitCursor = 0;
+    if(!ctx->index.count)
+        return;
+
+    int64_t start = getTimeMs();
+    uint64_t count = posIndexLookup(&ctx->index, ctx->position.key, ctx->hits, MAX_POSITION_HITS);
+    int64_t time = getTimeMs() - start;
+
+    // the index can be older than the database
+    ctx->hitCount = 0;
+    for(uint64_t i = 0; i < count && i < MAX_POSITION_HITS; i++) {
+        if(ctx->hits[i].game < ctx->db.count)
+            ctx->hits[ctx->hitCount++] = ctx->hits[i];
+    }
+    printf("%llu games reach this position (%lld ms)\n", (unsigned long long)count, (long long)time);
+    for(int i = 0; i < ctx->hitCount && i < PRINTED_POSITION_HITS; i++) {
+        printf("  game %u ply %u: ", ctx->hits[i].game + 1, ctx->hits[i].ply);
+        printGameLine(ctx, ctx->hits[i].game);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+// Sends the game leading to the position so the engines see the repetitions too
+void startExternalAnalysis(Ctx* ctx) {
+    static char position[32 + FEN_MAX_LENGTH + MAX_GAME_PLY * 6];
+    char fen[FEN_MAX_LENGTH + 1];
+    int n;
+    if(ctx->gamePly < MAX_GAME_PLY) {
+        positionGetFen(&ctx->gameStart, fen);
+        n = snprintf(position, sizeof(position), "position fen %s moves", fen);
+        for(int i = 0; i < ctx->gamePly; i++) {
+            char move[8];
+            moveToString(ctx->gameMoves[i], move);
+            n += snprintf(position + n, sizeof(position) - n, " %s", move);
+        }
+    } else {
+        positionGetFen(&ctx->position, fen);
+        snprintf(position, sizeof(position), "position fen %s", fen);
+    }
+
+    for(int i = 0; i < ctx->externalCount; i++)
+        uciClientGo(ctx->externals[i], position, "go infinite");
+}
+
+void stopExternalAnalysis(Ctx* ctx) {
+    for(int i = 0; i < ctx->externalCount; i++)
+        uciClientStopSearch(ctx->externals[i]);
+}
+
+// Prints what the external engines sent since the last frame, never waits for them
+void pollExternalEngines(Ctx* ctx) {
+    UciMessage message;
+    for(int i = 0; i < ctx->externalCount; i++) {
+        UciClient* client = ctx->externals[i];
+        while(uciClientPoll(client, &message)) {
+            if(message.kind == UCI_MESSAGE_EXITED) {
+                ERROR("%s exited\n", client->name);
+                continue;
+            }
+            if(message.kind != UCI_MESSAGE_INFO || !message.text[0])
+                continue;
+
+            printf("[%s] depth %d", client->name, message.depth);
+            if(ctx->multiPv > 1)
+                printf(" multipv %d", message.multiPv);
+            printf(" score ");
+            if(message.mate)
+                printf("mate %d", message.score);
+            else
+                printf("cp %d", message.score);
+            printf("%s pv", message.lowerBound ? " lowerbound" : message.upperBound ? " upperbound" : "");
+
+            // the engine's moves are checked against the board, a bad one ends the line
+            Position pos = ctx->position;
+            for(char* text = strtok(message.text, " "); text; text = strtok(null, " ")) {
+                Move move = parseMove(&pos, text);
+                if(move == MOVE_NONE)
+                    break;
+                char san[8];
+                moveToSan(&pos, move, san);
+                printf(" %s", san);
+                positionMakeMove(&pos, move);
+            }
+            printf("\n");
+        }
+    }
+    fflush(stdout);
+}
+
+// Starts whatever has to think about the new position
+void updatePosition(Ctx* ctx) {
+    // the player made the move the computer pondered on, its search goes on
+    bool ponderHit = ctx->pondering && ctx->computer == (int)ctx->position.side && ctx->position.key == ctx->ponderKey;
+    ctx->pondering = false;
+    if(ponderHit) {
+        INFO("Ponder hit\n");
+        enginePonderHit(&ctx->engine);
+    } else {
+        // a move the computer found for the previous position is dropped, so is a ponder miss
+        engineStop(&ctx->engine);
+        engineWait(&ctx->engine);
+        atomic_store(&ctx->computerMove, 0);
+    }
+    Move reply = ctx->expectedReply;
+    ctx->expectedReply = MOVE_NONE;
+
+    printBookMoves(ctx);
+    printExplorerMoves(ctx);
+    findPositionGames(ctx);
+
+    if(ctx->computer == (int)ctx->position.side) {
+        if(!ponderHit)
+            startComputer(ctx);
+    } else if(ctx->analysing) {
+        startAnalysis(ctx);
+    } else if(!startPondering(ctx, reply)) {
+        stopAnalysis(ctx);
+    }
+
+    if(ctx->externalAnalysis)
+        startExternalAnalysis(ctx);
+    else
+        stopExternalAnalysis(ctx);
+}
+
+// Starts a new game from 'pos', the history before it is unknown
+void setPosition(Ctx* ctx, const Position* pos) {
+    ctx->position = *pos;
+    ctx->keyCount = 0;
+    ctx->gameStart = *pos;
+    ctx->gameLength = ctx->gamePly = 0;
+    syncPieceManager(&ctx->manager, &ctx->position);
+    updatePosition(ctx);
+}
+
+void playMove(Ctx* ctx, Move move) {
+    // a move off the recorded line replaces the rest of the game
+    if(ctx->gamePly < MAX_GAME_PLY) {
+        if(ctx->gamePly >= ctx->gameLength || ctx->gameMoves[ctx->gamePly] != move) {
+            ctx->gameMoves[ctx->gamePly] = move;
+            ctx->gameLength = ctx->gamePly + 1;
+        }
+        ctx->gamePly++;
+    }
+
+    if(ctx->keyCount == MAX_GAME_PLY) {
+        memmove(ctx->keys, ctx->keys + 1, sizeof(uint64_t) * (MAX_GAME_PLY - 1));
+        ctx->keyCount--;
+    }
+    ctx->keys[ctx->keyCount++] = ctx->position.key;
+    positionMakeMove(&ctx->position, move);
+    syncPieceManager(&ctx->manager, &ctx->position);
+    updatePosition(ctx);
+}
+
+// Replays the game up to 'ply'
+void showPly(Ctx* ctx, int ply) {
+    ctx->position = ctx->gameStart;
+    ctx->keyCount = 0;
+    for(ctx->gamePly = 0; ctx->gamePly < ply; ctx->gamePly++) {
+        ctx->keys[ctx->keyCount++] = ctx->position.key;
+        positionMakeMove(&ctx->position, ctx->gameMoves[ctx->gamePly]);
+    }
+    syncPieceManager(&ctx->manager, &ctx->position);
+    updatePosition(ctx);
+}
+
+// A move made on the board, the server gets it when the game is online
+void playLocalMove(Ctx* ctx, Move move) {
+    char text[8];
+    moveToString(move, text);
+    playMove(ctx, move);
+    if(ctx->netPlaying) {
+        netClientSend(ctx->net, "move %s", text);
+        ctx->netEchoes++;
+    }
+}
+
+// Applies what the server sent since the last frame, never waits for it
+void pollNetwork(Ctx* ctx) {
+    if(!ctx->net)
+        return;
+
+    NetMessage message;
+    while(netClientPoll(ctx->net, &message)) {
+        switch(message.kind) {
+            case NET_MESSAGE_GAME:
+                ctx->netGame = message.game;
+                printf("game %d created, waiting for an opponent\n", message.game);
+                break;
+            case NET_MESSAGE_START: {
+                Position pos;
+                if(!positionSetFen(&pos, message.text)) {
+                    ERROR("The server sent an invalid FEN: %s\n", message.text);
+                    break;
+                }
+                ctx->netGame = message.game;
+                ctx->netPlaying = true;
+                ctx->netEchoes = 0;
+                setPosition(ctx, &pos);
+                printf("game %d started, you play %s\n", message.game, ctx->netTeam == TEAM_WHITE ? "white" : "black");
+                break;
+            }
+            case NET_MESSAGE_MOVE: {
+                // ours is on the board already
+                if(ctx->netEchoes) {
+                    ctx->netEchoes--;
+                    break;
+                }
+                if(ctx->gamePly != ctx->gameLength)
+                    showPly(ctx, ctx->gameLength);
+                Move move = parseMove(&ctx->position, message.text);
+                if(move == MOVE_NONE)
+                    ERROR("The opponent's move %s doesn't fit the board\n", message.text);
+                else
+                    playMove(ctx, move);
+                break;
+            }
+            case NET_MESSAGE_ILLEGAL:
+                // the board is a move ahead of the server, take it back
+                ERROR("The server refused %s\n", message.text);
+                if(ctx->netEchoes)
+                    ctx->netEchoes--;
+                if(ctx->gamePly > 0) {
+                    showPly(ctx, ctx->gameLength - 1);
+                    ctx->gameLength = ctx->gamePly;
+                }
+                break;
+            case NET_MESSAGE_END:
+                printf("game over: %s\n", message.text);
+                ctx->netPlaying = false;
+                break;
+            case NET_MESSAGE_ERROR:
+                ERROR("Server: %s\n", message.text);
+                break;
+            case NET_MESSAGE_CLOSED:
+                ERROR("Lost the connection to the server\n");
+                ctx->netPlaying = false;
+                break;
+        }
+    }
+    fflush(stdout);
+}
+
+// Shows the game at 'ply'
+void loadDbGame(Ctx* ctx, int64_t id, int ply) {
+    if(id < 0 || (uint64_t)id >= ctx->db.count)
+        return;
+
+    int length = gameDbMoves(&ctx->db, id, &ctx->gameStart, ctx->gameMoves, MAX_GAME_PLY);
+    if(length < 0) {
+        ERROR("Game %llu has a broken FEN\n", (unsigned long long)id);
+        return;
+    }
+
+    ctx->dbGame = id;
+    ctx->gameLength = length;
+    printf("game %llu/%llu: ", (unsigned long long)id + 1, (unsigned long long)ctx->db.count);
+    printGameLine(ctx, (uint64_t)id);
+    printf("\n");
+    fflush(stdout);
+    showPly(ctx, ply < length ? ply : length);
+}
+
+// Rewrites the database with the game on the board added at the end
+bool saveGame(Ctx* ctx) {
+    uint8_t data[MAX_GAME_PLY * GAMEDB_MAX_MOVE_BYTES];
+    size_t size;
+    if(!gameDbEncodeMoves(&ctx->gameStart, ctx->gameMoves, ctx->gameLength, data, &size)) {
+        ERROR("The game can't be stored, its start has more than 16 pieces a side\n");
+        return false;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.tmp", ctx->dbPath);
+
+    GameDbWriter writer;
+    if(!gameDbCreate(&writer, path))
+        return false;
+    for(uint64_t id = 0; id < ctx->db.count; id++) {
+        GameInfo info;
+        size_t moveSize;
+        gameDbInfo(&ctx->db, id, &info);
+        const uint8_t* moves = gameDbMoveData(&ctx->db, id, &moveSize);
+        gameDbAdd(&writer, &info, moves, moveSize);
+    }
+
+    GameInfo info = { .ply = ctx->gameLength };
+    char fen[FEN_MAX_LENGTH + 1] = "";
+    Position start;
+    positionSetStart(&start);
+    if(ctx->gameStart.key != start.key)
+        positionGetFen(&ctx->gameStart, fen);
+    info.strings[GAMEDB_EVENT] = (PgnString){ "Chess", 5 };
+    info.strings[GAMEDB_FEN] = (PgnString){ fen, (uint32_t)strlen(fen) };
+
+    time_t now = time(null);
+    struct tm* date = localtime(&now);
+    info.date = (uint32_t)((date->tm_year + 1900) * 10000 + (date->tm_mon + 1) * 100 + date->tm_mday);
+
+    // only a finished game gets a result
+    Position end = ctx->gameStart;
+    for(int i = 0; i < ctx->gameLength; i++)
+        positionMakeMove(&end, ctx->gameMoves[i]);
+    MoveList moves;
+    generateLegalMoves(&end, &moves);
+    if(!moves.count)
+        info.result = !positionInCheck(&end) ? RESULT_DRAW : end.side == TEAM_WHITE ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+
+    gameDbAdd(&writer, &info, data, size);
+
+    uint64_t count = ctx->db.count;
+    if(!gameDbFinish(&writer))
+        return false;
+
+    gameDbClose(&ctx->db);
+    remove(ctx->dbPath);
+    if(rename(path, ctx->dbPath) != 0 || !gameDbOpen(&ctx->db, ctx->dbPath))
+        return false;
+    ctx->dbGame = (int64_t)count;
+    printf("game %llu saved to %s\n", (unsigned long long)count + 1, ctx->dbPath);
+    fflush(stdout);
+    return true;
+}
+
+// Shades the squares of the move the analysis currently prefers
+void renderAnalysis(Ctx* ctx) {
+    Move m = (Move)atomic_load(&ctx->analysisMove);
+    if((!ctx->analysing && ctx->computer != (int)ctx->position.side) || m == MOVE_NONE)
+        return;
+
+    int squares[] = { moveFrom(m), moveTo(m) };
+    for(int i = 0; i < 2; i++) {
+        float vertices[QUAD_VERTICES * 5];
+        getPieceVertices(vertices, squareFile(squares[i]) + 1, squareRank(squares[i]) + 1);
+        updateQuadVertices(&ctx->hint, sizeof(vertices), vertices);
+        renderQuad(&ctx->hint, &ctx->hintTex, ctx->shader);
+    }
+}
+
+int main(int argc, char** argv) {
     Ctx ctx = {
         .width = 800,
-        .height = 800
+        .height = 800,
+        .computer = -1,
+        .multiPv = 1,
+        .ponder = true,
+        .dbPath = "games.cgd",
+        .dbGame = -1,
+        .netTeam = -1,
+        .netGame = -1
     };
+    const char* tbPath = null;
+    const char* bookPath = null;
+    const char* fen = START_FEN;
+    const char* indexPath = "games.cpi";
+    const char* explorerPath = "games.cex";
+    const char* engineCommands[MAX_EXTERNAL_ENGINES];
+    int engineCount = 0;
+    const char* serverAddress = null;
+    int joinGame = -1;
+    const char* hashPath = null;
+    size_t hashMb = DEFAULT_HASH_MB;
+
+    // main bench [depth]: a fixed search for speed and node signature checks, no window
+    if(argc > 1 && !strcmp(argv[1], "bench")) {
+        initPosition();
+        initEval();
+        BenchResult result;
+        runBench(argc > 2 ? atoi(argv[2]) : 0, true, &result);
+        printBenchResult(&result);
+        return 0;
+    }
+
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "--tb") && i + 1 < argc)
+            tbPath = argv[++i];
+        else if(!strcmp(argv[i], "--book") && i + 1 < argc)
+            bookPath = argv[++i];
+        else if(!strcmp(argv[i], "--fen") && i + 1 < argc)
+            fen = argv[++i];
+        else if(!strcmp(argv[i], "--db") && i + 1 < argc)
+            ctx.dbPath = argv[++i];
+        else if(!strcmp(argv[i], "--index") && i + 1 < argc)
+            indexPath = argv[++i];
+        else if(!strcmp(argv[i], "--explorer") && i + 1 < argc)
+            explorerPath = argv[++i];
+        else if(!strcmp(argv[i], "--server") && i + 1 < argc)
+            serverAddress = argv[++i];
+        else if(!strcmp(argv[i], "--join") && i + 1 < argc)
+            joinGame = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--hash") && i + 1 < argc)
+            hashMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--hash-file") && i + 1 < argc)
+            hashPath = argv[++i];
+        else if(!strcmp(argv[i], "--no-ponder"))
+            ctx.ponder = false;
+        else if(!strcmp(argv[i], "--multipv") && i + 1 < argc)
+            ctx.multiPv = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--engine") && i + 1 < argc && engineCount < MAX_EXTERNAL_ENGINES)
+            engineCommands[engineCount++] = argv[++i];
+    }
+
+    if(ctx.multiPv < 1)
+        ctx.multiPv = 1;
+    if(ctx.multiPv > MAX_MULTI_PV)
+        ctx.multiPv = MAX_MULTI_PV;
 
     // Init 
     {
+        // Engine
+        {
+            initPosition();
+            initEval();
+            if(!positionSetFen(&ctx.position, fen)) {
+                ERROR("Invalid FEN: %s\n", fen);
+                positionSetStart(&ctx.position);
+            }
+            ctx.gameStart = ctx.position;
+
+            // a missing database is created on the first save
+            if(gameDbOpen(&ctx.db, ctx.dbPath))
+                INFO("%llu games in %s\n", (unsigned long long)ctx.db.count, ctx.dbPath);
+            if(posIndexOpen(&ctx.index, indexPath) && ctx.index.games != ctx.db.count)
+                INFO("%s indexes %llu of the games, build it again with posindex\n", indexPath, (unsigned long long)ctx.index.games);
+            if(explorerOpen(&ctx.explorer, explorerPath) && ctx.explorer.games != ctx.db.count)
+                INFO("%s counts %llu of the games, update it with explorer\n", explorerPath, (unsigned long long)ctx.explorer.games);
+
+            int threads = getCpuCount() - 1;
+            initEngine(&ctx.engine, hashMb, threads > 0 ? threads : 1);
+            // the analysis of an earlier session goes on where it stopped
+            if(hashPath && !engineSetHashFile(&ctx.engine, hashPath, hashMb))
+                ERROR("Can't map the hash file: %s\n", hashPath);
+
+            if(tbPath)
+                INFO("Found %d tablebases in %s\n", tbInit(tbPath), tbPath);
+
+            ctx.bookSeed = (uint64_t)getTimeMs() | 1;
+            if(bookPath && !bookOpen(&ctx.book, bookPath))
+                ERROR("Can't open the book: %s\n", bookPath);
+
+            for(int i = 0; i < engineCount; i++) {
+                UciClient* client = malloc(sizeof(UciClient));
+                ASSERT(client != null, "Failed to allocate the engine client!\n");
+                if(uciClientStart(client, engineCommands[i])) {
+                    ctx.externals[ctx.externalCount++] = client;
+                    if(ctx.multiPv > 1)
+                        uciClientSend(client, "setoption name MultiPV value %d", ctx.multiPv);
+                } else {
+                    ERROR("Can't start the engine: %s\n", engineCommands[i]);
+                    free(client);
+                }
+            }
+
+            // --server host:port creates a game with the position on the board, --join
+            // plays black in one that's waiting
+            if(serverAddress) {
+                char host[256];
+                snprintf(host, sizeof(host), "%s", serverAddress);
+                char* colon = strrchr(host, ':');
+                int port = colon ? atoi(colon + 1) : 7777;
+                if(colon)
+                    *colon = '\0';
+
+                ctx.net = malloc(sizeof(NetClient));
+                ASSERT(ctx.net != null, "Failed to allocate the network client!\n");
+                if(!netClientConnect(ctx.net, host, port)) {
+                    ERROR("Can't connect to %s\n", serverAddress);
+                    free(ctx.net);
+                    ctx.net = null;
+                } else if(joinGame >= 0) {
+                    ctx.netTeam = TEAM_BLACK;
+                    netClientSend(ctx.net, "join %d", joinGame);
+                } else {
+                    char fen[FEN_MAX_LENGTH + 1];
+                    positionGetFen(&ctx.position, fen);
+                    ctx.netTeam = TEAM_WHITE;
+                    netClientSend(ctx.net, "new %s", fen);
+                }
+            }
+        }
+
         // Window
         {
             ASSERT(glfwInit(), "Can't init glfw!\n");
@@ -494,7 +1271,16 @@ int main(void) {
             stbi_image_free(data);
         }
 
-        initPieceManager(&ctx.manager);
+        initPieceManager(&ctx.manager, &ctx.position);
+
+        // Analysis hint
+        {
+            uint8_t pixel[] = { 255, 215, 0, 110 };
+            float vertices[QUAD_VERTICES * 5];
+            getPieceVertices(vertices, 1, 1);
+            ctx.hint = createQuad(vertices, sizeof(vertices));
+            createTexture(&ctx.hintTex, 1, 1, pixel);
+        }
     }
 
     glEnable(GL_BLEND);
@@ -502,12 +1288,41 @@ int main(void) {
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glfwShowWindow(ctx.window);
     while(!glfwWindowShouldClose(ctx.window)) {
+        // a move that arrived shows in this frame
+        pollNetwork(&ctx);
         glClear(GL_COLOR_BUFFER_BIT);
         // render
         renderQuad(&ctx.board, &ctx.boardTex, ctx.shader);
+        renderAnalysis(&ctx);
         renderPieces(&ctx.manager, ctx.shader);
         // update
-        updatePieces(&ctx.manager, ctx.window, ctx.width, ctx.height);
+        Move move;
+        bool ourTurn = ctx.net ? ctx.netPlaying && ctx.netTeam == (int)ctx.position.side && ctx.gamePly == ctx.gameLength
+                               : ctx.computer != (int)ctx.position.side;
+        if(ourTurn) {
+            if(updatePieces(&ctx.manager, &ctx.position, ctx.window, ctx.width, ctx.height, &move))
+                playLocalMove(&ctx, move);
+        }
+        {
+            uint32_t computerMove = atomic_exchange(&ctx.computerMove, 0);
+            move = (Move)(computerMove & 0xFFFF);
+            // a search stopped because the computer was switched off is dropped
+            if(computerMove && ctx.computer == (int)ctx.position.side && move != MOVE_NONE) {
+                engineWait(&ctx.engine);
+                ctx.expectedReply = ctx.computerPonder;
+                playMove(&ctx, move);
+            }
+        }
+        pollExternalEngines(&ctx);
+        {
+            // the disk writes happen in the background, the searches never wait on them
+            static int64_t lastSnapshot = 0;
+            int64_t now = getTimeMs();
+            if(hashPath && now - lastSnapshot >= HASH_SNAPSHOT_MS) {
+                ttSnapshot(ctx.engine.tt);
+                lastSnapshot = now;
+            }
+        }
         // viewport update        
         glfwGetWindowSize(ctx.window, &ctx.width, &ctx.height);
         glViewport(0, 0, ctx.width, ctx.height);
@@ -515,6 +1330,122 @@ int main(void) {
         if(glfwGetKey(ctx.window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             break;
         }
+        {
+            static bool wasDown = false;
+            bool down = glfwGetKey(ctx.window, GLFW_KEY_A) == GLFW_PRESS;
+            if(down && !wasDown) {
+                ctx.analysing = !ctx.analysing;
+                if(ctx.computer != (int)ctx.position.side)
+                    updatePosition(&ctx);
+            }
+            wasDown = down;
+        }
+        {
+            static bool wasMore = false, wasFewer = false;
+            bool more = glfwGetKey(ctx.window, GLFW_KEY_EQUAL) == GLFW_PRESS || glfwGetKey(ctx.window, GLFW_KEY_KP_ADD) == GLFW_PRESS;
+            bool fewer = glfwGetKey(ctx.window, GLFW_KEY_MINUS) == GLFW_PRESS || glfwGetKey(ctx.window, GLFW_KEY_KP_SUBTRACT) == GLFW_PRESS;
+            if((more && !wasMore && ctx.multiPv < MAX_MULTI_PV) || (fewer && !wasFewer && ctx.multiPv > 1)) {
+                ctx.multiPv += more ? 1 : -1;
+                INFO("MultiPV %d\n", ctx.multiPv);
+                // engines take options only while they're idle
+                stopExternalAnalysis(&ctx);
+                for(int i = 0; i < ctx.externalCount; i++)
+                    uciClientSend(ctx.externals[i], "setoption name MultiPV value %d", ctx.multiPv);
+                if(ctx.analysing && ctx.computer != (int)ctx.position.side)
+                    startAnalysis(&ctx);
+                if(ctx.externalAnalysis)
+                    startExternalAnalysis(&ctx);
+            }
+            wasMore = more;
+            wasFewer = fewer;
+        }
+        {
+            static bool wasDown = false;
+            bool down = glfwGetKey(ctx.window, GLFW_KEY_X) == GLFW_PRESS;
+            if(down && !wasDown && ctx.externalCount) {
+                ctx.externalAnalysis = !ctx.externalAnalysis;
+                if(ctx.externalAnalysis)
+                    startExternalAnalysis(&ctx);
+                else
+                    stopExternalAnalysis(&ctx);
+            }
+            wasDown = down;
+        }
+        {
+            // the computer takes the side not to move
+            static bool wasDown = false;
+            bool down = glfwGetKey(ctx.window, GLFW_KEY_C) == GLFW_PRESS
+                && glfwGetKey(ctx.window, GLFW_KEY_LEFT_CONTROL) != GLFW_PRESS
+                && glfwGetKey(ctx.window, GLFW_KEY_RIGHT_CONTROL) != GLFW_PRESS;
+            // an online game has its opponent already
+            if(down && !wasDown && !ctx.net) {
+                ctx.computer = ctx.computer < 0 ? (int)!ctx.position.side : -1;
+                updatePosition(&ctx);
+            }
+            wasDown = down;
+        }
+        {
+            // ctrl+v loads a FEN from the clipboard, ctrl+c copies the current one
+            static bool wasPaste = false, wasCopy = false;
+            bool ctrl = glfwGetKey(ctx.window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS
+                || glfwGetKey(ctx.window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS;
+            bool paste = ctrl && glfwGetKey(ctx.window, GLFW_KEY_V) == GLFW_PRESS;
+            bool copy = ctrl && glfwGetKey(ctx.window, GLFW_KEY_C) == GLFW_PRESS;
+            if(paste && !wasPaste && !ctx.netPlaying) {
+                const char* text = glfwGetClipboardString(ctx.window);
+                Position pos;
+                if(text && positionSetFen(&pos, text))
+                    setPosition(&ctx, &pos);
+                else
+                    ERROR("The clipboard doesn't hold a valid FEN\n");
+            }
+            if(copy && !wasCopy) {
+                char text[FEN_MAX_LENGTH + 1];
+                positionGetFen(&ctx.position, text);
+                glfwSetClipboardString(ctx.window, text);
+                printf("fen %s\n", text);
+                fflush(stdout);
+            }
+            wasPaste = paste;
+            wasCopy = copy;
+        }
+        {
+            // the arrows step through the game, page up and down through the database,
+            // G through the games reaching the position, ctrl+s adds the game to the database
+            static bool wasBack = false, wasForward = false, wasPrevious = false, wasNext = false, wasSave = false;
+            static bool wasJump = false;
+            bool ctrl = glfwGetKey(ctx.window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS
+                || glfwGetKey(ctx.window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS;
+            bool back = glfwGetKey(ctx.window, GLFW_KEY_LEFT) == GLFW_PRESS;
+            bool forward = glfwGetKey(ctx.window, GLFW_KEY_RIGHT) == GLFW_PRESS;
+            bool previous = glfwGetKey(ctx.window, GLFW_KEY_PAGE_UP) == GLFW_PRESS;
+            bool next = glfwGetKey(ctx.window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS;
+            bool save = ctrl && glfwGetKey(ctx.window, GLFW_KEY_S) == GLFW_PRESS;
+            bool jump = glfwGetKey(ctx.window, GLFW_KEY_G) == GLFW_PRESS;
+            if(back && !wasBack && ctx.gamePly > 0)
+                showPly(&ctx, ctx.gamePly - 1);
+            if(forward && !wasForward && ctx.gamePly < ctx.gameLength)
+                playMove(&ctx, ctx.gameMoves[ctx.gamePly]);
+            if(previous && !wasPrevious && !ctx.netPlaying)
+                loadDbGame(&ctx, ctx.dbGame - 1, 0);
+            if(next && !wasNext && !ctx.netPlaying)
+                loadDbGame(&ctx, ctx.dbGame + 1, 0);
+            if(save && !wasSave && !saveGame(&ctx))
+                ERROR("Can't save the game to %s\n", ctx.dbPath);
+            if(jump && !wasJump && ctx.hitCount && !ctx.netPlaying) {
+                // the position stays the same so the hits do too
+                int cursor = ctx.hitCursor;
+                PositionHit hit = ctx.hits[cursor];
+                loadDbGame(&ctx, hit.game, hit.ply);
+                ctx.hitCursor = (cursor + 1) % (ctx.hitCount ? ctx.hitCount : 1);
+            }
+            wasBack = back;
+            wasForward = forward;
+            wasPrevious = previous;
+            wasNext = next;
+            wasSave = save;
+            wasJump = jump;
+        }
         // window event polling
         glfwPollEvents();
         glfwSwapBuffers(ctx.window);
@@ -522,6 +1453,23 @@ int main(void) {
 
     // Cleanup
     {
+        destroyEngine(&ctx.engine);
+        tbFree();
+        bookClose(&ctx.book);
+        gameDbClose(&ctx.db);
+        posIndexClose(&ctx.index);
+        explorerClose(&ctx.explorer);
+        for(int i = 0; i < ctx.externalCount; i++) {
+            uciClientStop(ctx.externals[i]);
+            free(ctx.externals[i]);
+        }
+        if(ctx.net) {
+            netClientClose(ctx.net);
+            free(ctx.net);
+        }
+
+        deleteQuad(&ctx.hint);
+        deleteTexture(&ctx.hintTex);
         deinitPieceManager(&ctx.manager);
 
         deleteQuad(&ctx.board);
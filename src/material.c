@@ -0,0 +1,131 @@
+#include "material.h"
+#include "endgame.h"
+
+#include <string.h>
+
+const int PIECE_VALUE_MG[PIECE_TYPES] = { 82, 477, 337, 365, 1025, 0 };
+const int PIECE_VALUE_EG[PIECE_TYPES] = { 94, 512, 281, 297, 936, 0 };
+
+static const int PHASE_WEIGHTS[PIECE_TYPES] = { 0, 2, 1, 1, 4, 0 };
+
+void initMaterialTable(MaterialTable* table) {
+    ASSERT(table != null, "The material table ptr provided shouldn't be null!\n");
+
+    memset(table, 0, sizeof(MaterialTable));
+    // key 0 would match an empty entry
+    table->entries[0].key = ~0ULL;
+}
+
+// Second order material terms for one team, Kaufman style
+static void imbalance(const Position* pos, PieceTeam us, int* mg, int* eg) {
+    const uint8_t* own = pos->counts[us];
+    const uint8_t* their = pos->counts[!us];
+    int pawns = own[PAWN];
+
+    // Knights gain and rooks lose value as pawns come off
+    *mg += own[KNIGHT] * (pawns - 5) * 6;
+    *eg += own[KNIGHT] * (pawns - 5) * 6;
+    *mg -= own[ROOK] * (pawns - 5) * 12;
+    *eg -= own[ROOK] * (pawns - 5) * 12;
+
+    if(own[BISHOP] >= 2) {
+        *mg += 30;
+        *eg += 55;
+        // the pair matters more when the opponent can't answer with minors
+        if(!their[KNIGHT] && !their[BISHOP]) {
+            *mg += 10;
+            *eg += 10;
+        }
+    }
+
+    // Redundant major pieces
+    if(own[ROOK] >= 2) {
+        *mg -= 16;
+        *eg -= 24;
+    }
+    if(own[QUEEN] && own[ROOK]) {
+        *mg -= 10 * own[ROOK];
+        *eg -= 10 * own[ROOK];
+    }
+
+    // Minor pieces against a rook
+    if(own[ROOK] < their[ROOK] && own[KNIGHT] + own[BISHOP] > their[KNIGHT] + their[BISHOP]) {
+        *mg += 25;
+        *eg += 10;
+    }
+}
+
+static void computeEntry(MaterialEntry* e, const Position* pos) {
+    int mg = 0, eg = 0, phase = 0;
+
+    for(int type = PAWN; type < KING; type++) {
+        int diff = pos->counts[TEAM_WHITE][type] - pos->counts[TEAM_BLACK][type];
+        mg += diff * PIECE_VALUE_MG[type];
+        eg += diff * PIECE_VALUE_EG[type];
+        phase += (pos->counts[TEAM_WHITE][type] + pos->counts[TEAM_BLACK][type]) * PHASE_WEIGHTS[type];
+    }
+
+    int wMg = 0, wEg = 0, bMg = 0, bEg = 0;
+    imbalance(pos, TEAM_WHITE, &wMg, &wEg);
+    imbalance(pos, TEAM_BLACK, &bMg, &bEg);
+
+    e->mg = (int16_t)(mg + wMg - bMg);
+    e->eg = (int16_t)(eg + wEg - bEg);
+    e->phase = (uint8_t)(phase > PHASE_MAX ? PHASE_MAX : phase);
+    e->factor[TEAM_WHITE] = e->factor[TEAM_BLACK] = SCALE_NORMAL;
+    e->evalFn = null;
+    e->scaleFn[TEAM_WHITE] = e->scaleFn[TEAM_BLACK] = null;
+
+    // Symmetric material such as KPKP matches for both teams
+    for(int team = 0; team < TEAMS; team++) {
+        const Endgame* endgame = findEndgame(pos->materialKey, (PieceTeam)team);
+        if(endgame && endgame->evalFn) {
+            e->evalFn = endgame->evalFn;
+            e->evalStrong = endgame->strong;
+            return;
+        }
+        if(endgame && endgame->scaleFn)
+            e->scaleFn[team] = endgame->scaleFn;
+    }
+
+    for(int team = 0; team < TEAMS; team++) {
+        PieceTeam us = (PieceTeam)team, them = !us;
+        int ourNpm = nonPawnMaterial(pos, us);
+        int theirNpm = nonPawnMaterial(pos, them);
+
+        // Any decisive material against a lone king
+        if(!(pos->teams[them] & ~pos->pieces[them][KING]) && ourNpm >= PIECE_VALUE_MG[ROOK]) {
+            e->evalFn = evaluateKXK;
+            e->evalStrong = us;
+            return;
+        }
+
+        if(!e->scaleFn[us]) {
+            if(ourNpm == PIECE_VALUE_MG[BISHOP] && pos->counts[us][BISHOP] == 1 && pos->counts[us][PAWN])
+                e->scaleFn[us] = scaleKBPsK;
+            else if(!ourNpm && pos->counts[us][PAWN] >= 2 && !(pos->teams[them] & ~pos->pieces[them][KING]))
+                e->scaleFn[us] = scaleKPsK;
+        }
+
+        // Without pawns a small material edge rarely wins
+        if(!pos->counts[us][PAWN] && ourNpm - theirNpm <= PIECE_VALUE_MG[BISHOP]) {
+            e->factor[us] = ourNpm < PIECE_VALUE_MG[ROOK] ? SCALE_DRAW
+                          : theirNpm <= PIECE_VALUE_MG[BISHOP] ? 4 : 14;
+        }
+
+        // Only one pawn and a minor piece edge at most
+        if(pos->counts[us][PAWN] == 1 && ourNpm - theirNpm <= PIECE_VALUE_MG[BISHOP])
+            e->factor[us] = e->factor[us] < 48 ? e->factor[us] : 48;
+    }
+}
+
+MaterialEntry* materialProbe(MaterialTable* table, const Position* pos) {
+    MaterialEntry* e = &table->entries[pos->materialKey & (MATERIAL_TABLE_SIZE - 1)];
+
+    if(e->key == pos->materialKey)
+        return e;
+
+    e->key = pos->materialKey;
+    computeEntry(e, pos);
+    return e;
+}
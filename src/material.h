@@ -0,0 +1,47 @@
+#pragma once
+
+#include "position.h"
+
+// Must be a power of 2
+#define MATERIAL_TABLE_SIZE 8192
+
+#define PHASE_MAX 24
+
+#define SCALE_DRAW 0
+#define SCALE_NORMAL 64
+#define SCALE_NONE 255
+
+extern const int PIECE_VALUE_MG[PIECE_TYPES];
+extern const int PIECE_VALUE_EG[PIECE_TYPES];
+
+// Score of a known endgame from the strong team's point of view
+typedef int (*EndgameEvalFn)(const Position* pos, PieceTeam strong);
+// Scale factor for the strong team's eg score, SCALE_NONE when it has nothing to say
+typedef int (*EndgameScaleFn)(const Position* pos, PieceTeam strong);
+
+// Everything about a position that depends on the piece counts only
+typedef struct {
+    uint64_t key;
+    // Piece values plus the imbalance terms, from white's point of view
+    int16_t mg, eg;
+    uint8_t phase;
+    uint8_t factor[TEAMS];
+    uint8_t evalStrong;
+    EndgameEvalFn evalFn;
+    EndgameScaleFn scaleFn[TEAMS];
+} MaterialEntry;
+
+// @note Not thread safe, every searching thread owns a table
+typedef struct {
+    MaterialEntry entries[MATERIAL_TABLE_SIZE];
+} MaterialTable;
+
+void initMaterialTable(MaterialTable* table);
+MaterialEntry* materialProbe(MaterialTable* table, const Position* pos);
+
+static inline int nonPawnMaterial(const Position* pos, PieceTeam team) {
+    return pos->counts[team][KNIGHT] * PIECE_VALUE_MG[KNIGHT]
+         + pos->counts[team][BISHOP] * PIECE_VALUE_MG[BISHOP]
+         + pos->counts[team][ROOK] * PIECE_VALUE_MG[ROOK]
+         + pos->counts[team][QUEEN] * PIECE_VALUE_MG[QUEEN];
+}
@@ -0,0 +1,360 @@
+#include "position.h"
+
+#include <string.h>
+
+static inline void addMove(MoveList* list, Move move) {
+    list->moves[list->count++] = move;
+}
+
+static void addPromotions(MoveList* list, int from, int to, bool capturesOnly) {
+    addMove(list, createPromotion(from, to, QUEEN));
+    if(capturesOnly)
+        return;
+    addMove(list, createPromotion(from, to, KNIGHT));
+    addMove(list, createPromotion(from, to, ROOK));
+    addMove(list, createPromotion(from, to, BISHOP));
+}
+
+static void generatePawnMoves(const Position* pos, MoveList* list, bool capturesOnly) {
+    PieceTeam us = pos->side;
+    PieceTeam them = !us;
+    Bitboard pawns = pos->pieces[us][PAWN];
+    Bitboard empty = ~pos->all;
+    Bitboard enemies = pos->teams[them];
+    Bitboard lastRank = us == TEAM_WHITE ? RANK_8_BB : RANK_1_BB;
+    Bitboard thirdRank = us == TEAM_WHITE ? (RANK_1_BB << 16) : (RANK_1_BB << 40);
+    int up = us == TEAM_WHITE ? 8 : -8;
+
+    Bitboard single = pawnPushes(us, pawns) & empty;
+    Bitboard promos = single & lastRank;
+    while(promos) {
+        int to = popLsb(&promos);
+        addPromotions(list, to - up, to, capturesOnly);
+    }
+    if(!capturesOnly) {
+        Bitboard pushes = single & ~lastRank;
+        Bitboard doubles = pawnPushes(us, single & thirdRank) & empty;
+        while(pushes) {
+            int to = popLsb(&pushes);
+            addMove(list, createMove(to - up, to));
+        }
+        while(doubles) {
+            int to = popLsb(&doubles);
+            addMove(list, createMove(to - 2 * up, to));
+        }
+    }
+
+    Bitboard b = pawns;
+    while(b) {
+        int from = popLsb(&b);
+        Bitboard attacks = PAWN_ATTACKS[us][from] & enemies;
+        while(attacks) {
+            int to = popLsb(&attacks);
+            if(squareBB(to) & lastRank)
+                addPromotions(list, from, to, false);
+            else
+                addMove(list, createMove(from, to));
+        }
+    }
+
+    if(pos->epSquare != SQUARE_NONE) {
+        Bitboard attackers = PAWN_ATTACKS[them][pos->epSquare] & pawns;
+        while(attackers)
+            addMove(list, createSpecialMove(popLsb(&attackers), pos->epSquare, MOVE_EN_PASSANT));
+    }
+}
+
+static void generateCastling(const Position* pos, MoveList* list) {
+    PieceTeam us = pos->side;
+    PieceTeam them = !us;
+    int rights = us == TEAM_WHITE ? pos->castling & 3 : (pos->castling >> 2) & 3;
+    int king = makeSquare(4, us == TEAM_WHITE ? 0 : 7);
+
+    if(!rights || isSquareAttacked(pos, king, them))
+        return;
+
+    if((rights & 1) && !(pos->all & (squareBB(king + 1) | squareBB(king + 2)))
+        && !isSquareAttacked(pos, king + 1, them))
+        addMove(list, createSpecialMove(king, king + 2, MOVE_CASTLING));
+    if((rights & 2) && !(pos->all & (squareBB(king - 1) | squareBB(king - 2) | squareBB(king - 3)))
+        && !isSquareAttacked(pos, king - 1, them))
+        addMove(list, createSpecialMove(king, king - 2, MOVE_CASTLING));
+}
+
+Bitboard pieceMoveTargets(const Position* pos, int from) {
+    uint8_t piece = pos->board[from];
+    PieceTeam us = pieceTeam(piece);
+    Bitboard own = pos->teams[us];
+
+    switch(pieceType(piece)) {
+        case PAWN: {
+            Bitboard targets = PAWN_ATTACKS[us][from] & pos->teams[!us];
+            if(pos->epSquare != SQUARE_NONE)
+                targets |= PAWN_ATTACKS[us][from] & squareBB(pos->epSquare);
+            Bitboard single = pawnPushes(us, squareBB(from)) & ~pos->all;
+            targets |= single;
+            if(relativeRank(us, from) == 1)
+                targets |= pawnPushes(us, single) & ~pos->all;
+            return targets;
+        }
+        case KNIGHT: return KNIGHT_ATTACKS[from] & ~own;
+        case BISHOP: return bishopAttacks(from, pos->all) & ~own;
+        case ROOK: return rookAttacks(from, pos->all) & ~own;
+        case QUEEN: return queenAttacks(from, pos->all) & ~own;
+        default: {
+            Bitboard targets = KING_ATTACKS[from] & ~own;
+            MoveList castling = { .count = 0 };
+            generateCastling(pos, &castling);
+            for(int i = 0; i < castling.count; i++)
+                targets |= squareBB(moveTo(castling.moves[i]));
+            return targets;
+        }
+    }
+}
+
+static void generateAll(const Position* pos, MoveList* list, bool capturesOnly) {
+    PieceTeam us = pos->side;
+    Bitboard targets = capturesOnly ? pos->teams[!us] : ~pos->teams[us];
+
+    list->count = 0;
+    generatePawnMoves(pos, list, capturesOnly);
+
+    for(int type = ROOK; type <= KING; type++) {
+        Bitboard b = pos->pieces[us][type];
+        while(b) {
+            int from = popLsb(&b);
+            Bitboard attacks;
+            switch(type) {
+                case KNIGHT: attacks = KNIGHT_ATTACKS[from]; break;
+                case BISHOP: attacks = bishopAttacks(from, pos->all); break;
+                case ROOK: attacks = rookAttacks(from, pos->all); break;
+                case QUEEN: attacks = queenAttacks(from, pos->all); break;
+                default: attacks = KING_ATTACKS[from]; break;
+            }
+            attacks &= targets;
+            while(attacks)
+                addMove(list, createMove(from, popLsb(&attacks)));
+        }
+    }
+
+    if(!capturesOnly)
+        generateCastling(pos, list);
+}
+
+void generateMoves(const Position* pos, MoveList* list) {
+    generateAll(pos, list, false);
+}
+
+void generateCaptures(const Position* pos, MoveList* list) {
+    generateAll(pos, list, true);
+}
+
+void generateLegalMoves(const Position* pos, MoveList* list) {
+    MoveList pseudo;
+    generateMoves(pos, &pseudo);
+
+    list->count = 0;
+    for(int i = 0; i < pseudo.count; i++) {
+        Position next = *pos;
+        if(positionMakeMove(&next, pseudo.moves[i]))
+            addMove(list, pseudo.moves[i]);
+    }
+}
+
+void moveToString(Move move, char* out) {
+    int from = moveFrom(move), to = moveTo(move);
+
+    if(move == MOVE_NONE || move == MOVE_NULL) {
+        strcpy(out, "0000");
+        return;
+    }
+
+    out[0] = 'a' + squareFile(from);
+    out[1] = '1' + squareRank(from);
+    out[2] = 'a' + squareFile(to);
+    out[3] = '1' + squareRank(to);
+    out[4] = '\0';
+    if(moveFlag(move) == MOVE_PROMOTION) {
+        out[4] = "nbrq"[(move >> 12) & 3];
+        out[5] = '\0';
+    }
+}
+
+int moveToSan(const Position* pos, Move move, char* out) {
+    int from = moveFrom(move), to = moveTo(move);
+    PieceType type = pieceType(pos->board[from]);
+    int n = 0;
+
+    if(moveFlag(move) == MOVE_CASTLING) {
+        strcpy(out, to > from ? "O-O" : "O-O-O");
+        n = (int)strlen(out);
+    } else {
+        if(type != PAWN) {
+            out[n++] = "PRNBQK"[type];
+
+            // the file if it's enough to tell the pieces apart, else the rank, else both
+            MoveList list;
+            generateLegalMoves(pos, &list);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for(int i = 0; i < list.count; i++) {
+                int other = moveFrom(list.moves[i]);
+                if(other == from || moveTo(list.moves[i]) != to || pos->board[other] != pos->board[from])
+                    continue;
+                ambiguous = true;
+                sameFile |= squareFile(other) == squareFile(from);
+                sameRank |= squareRank(other) == squareRank(from);
+            }
+            if(ambiguous && (!sameFile || sameRank))
+                out[n++] = (char)('a' + squareFile(from));
+            if(ambiguous && sameFile)
+                out[n++] = (char)('1' + squareRank(from));
+        }
+        if(isCapture(pos, move)) {
+            if(type == PAWN)
+                out[n++] = (char)('a' + squareFile(from));
+            out[n++] = 'x';
+        }
+        out[n++] = (char)('a' + squareFile(to));
+        out[n++] = (char)('1' + squareRank(to));
+        if(moveFlag(move) == MOVE_PROMOTION) {
+            out[n++] = '=';
+            out[n++] = "PRNBQK"[movePromotion(move)];
+        }
+    }
+
+    Position next = *pos;
+    positionMakeMove(&next, move);
+    if(positionInCheck(&next)) {
+        MoveList replies;
+        generateLegalMoves(&next, &replies);
+        out[n++] = replies.count ? '+' : '#';
+    }
+    out[n] = '\0';
+    return n;
+}
+
+Move parseMove(const Position* pos, const char* str) {
+    MoveList list;
+    generateLegalMoves(pos, &list);
+
+    for(int i = 0; i < list.count; i++) {
+        char buf[6];
+        moveToString(list.moves[i], buf);
+        size_t len = strlen(buf);
+        if(strncmp(buf, str, len) == 0 && (str[len] == '\0' || str[len] == ' ' || str[len] == '\n' || str[len] == '\r'))
+            return list.moves[i];
+    }
+
+    return MOVE_NONE;
+}
+
+static inline bool isLegal(const Position* pos, Move move) {
+    Position next = *pos;
+    return positionMakeMove(&next, move);
+}
+
+Move parseSan(const Position* pos, const char* str, int length) {
+    // annotations and check marks carry no information
+    while(length > 0 && strchr("+#!?", str[length - 1]))
+        length--;
+    if(length < 2)
+        return MOVE_NONE;
+
+    if(str[0] == 'O' || str[0] == '0') {
+        bool queenSide = length >= 5;
+        MoveList list = { .count = 0 };
+        generateCastling(pos, &list);
+        for(int i = 0; i < list.count; i++) {
+            Move m = list.moves[i];
+            if((moveTo(m) < moveFrom(m)) == queenSide)
+                return isLegal(pos, m) ? m : MOVE_NONE;
+        }
+        return MOVE_NONE;
+    }
+
+    PieceType type = PAWN;
+    const char* piece = strchr("PRNBQK", str[0]);
+    if(piece && str[0]) {
+        type = (PieceType)(piece - "PRNBQK");
+        str++;
+        length--;
+    }
+
+    PieceType promotion = PAWN;
+    if(length >= 2 && strchr("RNBQ", str[length - 1]) && str[length - 1]) {
+        promotion = (PieceType)(strchr("PRNBQK", str[length - 1]) - "PRNBQK");
+        length--;
+        if(str[length - 1] == '=')
+            length--;
+    }
+
+    if(length < 2 || str[length - 2] < 'a' || str[length - 2] > 'h' || str[length - 1] < '1' || str[length - 1] > '8')
+        return MOVE_NONE;
+    int to = makeSquare(str[length - 2] - 'a', str[length - 1] - '1');
+
+    // whatever is left before the square disambiguates
+    int fromFile = -1, fromRank = -1;
+    for(int i = 0; i < length - 2; i++) {
+        if(str[i] >= 'a' && str[i] <= 'h')
+            fromFile = str[i] - 'a';
+        else if(str[i] >= '1' && str[i] <= '8')
+            fromRank = str[i] - '1';
+        else if(str[i] != 'x' && str[i] != '-' && str[i] != ':')
+            return MOVE_NONE;
+    }
+
+    // the pieces that can reach the square are found backwards from it instead of
+    // generating every move, only those are checked for legality
+    PieceTeam us = pos->side;
+    if(pos->teams[us] & squareBB(to))
+        return MOVE_NONE;
+
+    Bitboard candidates;
+    bool enPassant = false;
+    switch(type) {
+        case PAWN: {
+            int up = us == TEAM_WHITE ? 8 : -8;
+            if(fromFile >= 0 && fromFile != squareFile(to)) {
+                enPassant = to == pos->epSquare;
+                if(!enPassant && !(pos->teams[!us] & squareBB(to)))
+                    return MOVE_NONE;
+                candidates = PAWN_ATTACKS[!us][to];
+            } else {
+                if((pos->all & squareBB(to)) || relativeRank(us, to) == 0)
+                    return MOVE_NONE;
+                candidates = squareBB(to - up);
+                if(relativeRank(us, to) == 3 && !(pos->all & squareBB(to - up)))
+                    candidates = squareBB(to - 2 * up);
+            }
+            break;
+        }
+        case KNIGHT: candidates = KNIGHT_ATTACKS[to]; break;
+        case BISHOP: candidates = bishopAttacks(to, pos->all); break;
+        case ROOK: candidates = rookAttacks(to, pos->all); break;
+        case QUEEN: candidates = queenAttacks(to, pos->all); break;
+        default: candidates = KING_ATTACKS[to]; break;
+    }
+    candidates &= pos->pieces[us][type];
+    if(fromFile >= 0)
+        candidates &= FILE_A_BB << fromFile;
+    if(fromRank >= 0)
+        candidates &= RANK_1_BB << (8 * fromRank);
+
+    bool promoting = type == PAWN && (squareBB(to) & (RANK_1_BB | RANK_8_BB));
+    if(promoting != (promotion != PAWN))
+        return MOVE_NONE;
+
+    Move found = MOVE_NONE;
+    while(candidates) {
+        int from = popLsb(&candidates);
+        Move m = promoting ? createPromotion(from, to, promotion)
+            : enPassant ? createSpecialMove(from, to, MOVE_EN_PASSANT) : createMove(from, to);
+        if(!isLegal(pos, m))
+            continue;
+        if(found != MOVE_NONE)
+            return MOVE_NONE;
+        found = m;
+    }
+
+    return found;
+}
@@ -0,0 +1,86 @@
+#include "netclient.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+// Runs on the pipe's reader thread, moves can't be dropped so a full queue waits for the
+// render loop to catch up
+static void parseLine(char* line, void* user) {
+    NetClient* client = (NetClient*)user;
+    NetMessage m = { .game = -1 };
+    if(!line) {
+        m.kind = NET_MESSAGE_CLOSED;
+        linePipePush(&client->pipe, &m, false);
+        return;
+    }
+
+    char* args = line;
+    while(*args && *args != ' ')
+        args++;
+    if(*args)
+        *args++ = '\0';
+
+    if(!strcmp(line, "move")) {
+        m.kind = NET_MESSAGE_MOVE;
+    } else if(!strcmp(line, "illegal")) {
+        m.kind = NET_MESSAGE_ILLEGAL;
+    } else if(!strcmp(line, "game") || !strcmp(line, "start")) {
+        m.kind = line[0] == 'g' ? NET_MESSAGE_GAME : NET_MESSAGE_START;
+        m.game = (int)strtol(args, &args, 10);
+        while(*args == ' ')
+            args++;
+    } else if(!strcmp(line, "end")) {
+        m.kind = NET_MESSAGE_END;
+    } else if(!strcmp(line, "error")) {
+        m.kind = NET_MESSAGE_ERROR;
+    } else {
+        return;
+    }
+    snprintf(m.text, NET_TEXT, "%s", args);
+    linePipePush(&client->pipe, &m, false);
+}
+
+static long readSocket(void* socket, void* data, size_t size, int timeoutMs) {
+    return socketReceive((NetSocket*)socket, data, size, timeoutMs);
+}
+
+static long writeSocket(void* socket, const void* data, size_t size) {
+    return socketSend((NetSocket*)socket, data, size);
+}
+
+bool netClientConnect(NetClient* client, const char* host, int port) {
+    ASSERT(client != null, "The client ptr provided shouldn't be null!\n");
+
+    memset(client, 0, sizeof(NetClient));
+    if(!socketConnect(&client->socket, host, port))
+        return false;
+
+    linePipeInit(&client->pipe, client->queue, sizeof(NetMessage), NET_QUEUE_SIZE, client->outgoing, NET_OUTGOING);
+    if(!linePipeStart(&client->pipe, &client->socket, readSocket, writeSocket, parseLine, client)) {
+        socketClose(&client->socket);
+        return false;
+    }
+    return true;
+}
+
+void netClientClose(NetClient* client) {
+    if(!atomic_load(&client->pipe.running))
+        return;
+
+    linePipeStop(&client->pipe);
+    socketClose(&client->socket);
+}
+
+void netClientSend(NetClient* client, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bool queued = linePipeSend(&client->pipe, fmt, args);
+    va_end(args);
+
+    if(!queued)
+        ERROR("Command dropped, the server doesn't read its input\n");
+}
+
+bool netClientPoll(NetClient* client, NetMessage* out) {
+    return linePipePoll(&client->pipe, out);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "defines.h"
+#include "platform.h"
+#include "linepipe.h"
+
+// Must be a power of 2
+#define NET_QUEUE_SIZE 256
+#define NET_TEXT 128
+#define NET_OUTGOING 4096
+
+typedef enum {
+    NET_MESSAGE_GAME,    // game <id> white, we created the game and wait for an opponent
+    NET_MESSAGE_START,   // start <id> <fen>, text holds the FEN
+    NET_MESSAGE_MOVE,    // move <e2e4>, ours as the server's confirmation or the opponent's
+    NET_MESSAGE_ILLEGAL, // the server refused our move
+    NET_MESSAGE_END,     // text holds the result and the reason
+    NET_MESSAGE_ERROR,
+    NET_MESSAGE_CLOSED   // the connection is gone, nothing follows
+} NetMessageKind;
+
+typedef struct {
+    NetMessageKind kind;
+    int game;
+    char text[NET_TEXT];
+} NetMessage;
+
+// A connection to the game server
+//
+// The server's lines are parsed on the pipe's reader thread, the render loop drains the
+// messages every frame, so a move shows the frame after it arrives.
+typedef struct {
+    NetSocket socket;
+    LinePipe pipe;
+    NetMessage queue[NET_QUEUE_SIZE];
+    char outgoing[NET_OUTGOING]; // consumer side only
+} NetClient;
+
+bool netClientConnect(NetClient* client, const char* host, int port);
+void netClientClose(NetClient* client);
+// Queues a command line like "move e2e4" and sends what it can right away
+void netClientSend(NetClient* client, const char* fmt, ...);
+// Takes the next message off the queue, false if there is none
+bool netClientPoll(NetClient* client, NetMessage* out);
@@ -0,0 +1,270 @@
+#include "pgn.h"
+#include "platform.h"
+
+#include <string.h>
+
+typedef struct {
+    const char* text;
+    int maxPly;
+    PgnGameFn fn;
+    void* user;
+
+    PgnGame game;
+    Position pos;   // after the moves read so far
+    Position startPos;
+    bool inGame;
+    bool inMoves;
+    bool stopped;
+    uint64_t count;
+} PgnParser;
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static GameResult parseResult(const char* s, size_t length) {
+    if(length == 3 && !memcmp(s, "1-0", 3))
+        return RESULT_WHITE_WINS;
+    if(length == 3 && !memcmp(s, "0-1", 3))
+        return RESULT_BLACK_WINS;
+    if(length == 7 && !memcmp(s, "1/2-1/2", 7))
+        return RESULT_DRAW;
+    return RESULT_NONE;
+}
+
+static inline bool isTag(const PgnTag* tag, const char* name, size_t length) {
+    return tag->name.length == length && !memcmp(tag->name.data, name, length);
+}
+
+static void beginGame(PgnParser* p, const char* at) {
+    PgnGame* g = &p->game;
+    g->tagCount = 0;
+    g->start = p->startPos;
+    g->ply = 0;
+    g->result = RESULT_NONE;
+    g->broken = false;
+    g->offset = (size_t)(at - p->text);
+
+    p->pos = p->startPos;
+    p->inGame = true;
+    p->inMoves = false;
+}
+
+static void endGame(PgnParser* p, const char* at, GameResult result) {
+    PgnGame* g = &p->game;
+    PgnString tag;
+    if(result == RESULT_NONE && pgnFindTag(g, "Result", &tag))
+        result = parseResult(tag.data, tag.length);
+    g->result = result;
+    g->length = (size_t)(at - p->text) - g->offset;
+
+    p->inGame = false;
+    p->count++;
+    if(!p->fn(g, p->user))
+        p->stopped = true;
+}
+
+// [Name "value"], the rest of the line is ignored
+static const char* parseTag(PgnParser* p, const char* s, const char* end) {
+    const char* eol = memchr(s, '\n', (size_t)(end - s));
+    if(!eol)
+        eol = end;
+
+    s++;
+    while(s < eol && isSpace(*s))
+        s++;
+    const char* name = s;
+    while(s < eol && !isSpace(*s) && *s != '"' && *s != ']')
+        s++;
+    const char* nameEnd = s;
+    while(s < eol && *s != '"')
+        s++;
+    if(s == eol || nameEnd == name)
+        return eol;
+
+    const char* value = ++s;
+    while(s < eol && *s != '"') {
+        if(*s == '\\' && s + 1 < eol)
+            s++;
+        s++;
+    }
+    if(s == eol)
+        return eol;
+
+    PgnGame* g = &p->game;
+    if(g->tagCount == PGN_MAX_TAGS)
+        return eol;
+    PgnTag* tag = &g->tags[g->tagCount++];
+    tag->name = (PgnString){ name, (uint32_t)(nameEnd - name) };
+    tag->value = (PgnString){ value, (uint32_t)(s - value) };
+
+    if(isTag(tag, "FEN", 3)) {
+        char fen[FEN_MAX_LENGTH + 1];
+        bool ok = tag->value.length <= FEN_MAX_LENGTH;
+        if(ok) {
+            memcpy(fen, value, tag->value.length);
+            fen[tag->value.length] = '\0';
+            ok = positionSetFen(&g->start, fen);
+        }
+        if(!ok) {
+            g->start = p->startPos;
+            g->broken = true;
+        }
+        p->pos = g->start;
+    }
+    return eol;
+}
+
+static void parseMoveToken(PgnParser* p, const char* token, size_t length) {
+    PgnGame* g = &p->game;
+
+    // move numbers, "12." or "12...", possibly glued to the move. "0-0" is castling
+    size_t i = 0;
+    while(i < length && token[i] >= '0' && token[i] <= '9')
+        i++;
+    if(i && i < length && token[i] == '.') {
+        while(i < length && token[i] == '.')
+            i++;
+        token += i;
+        length -= i;
+    }
+    if(!length || *token == '$' || g->broken)
+        return;
+    // the caller's limit skips the rest on purpose, PGN_MAX_PLY cuts the game short
+    if(g->ply >= p->maxPly) {
+        if(g->ply == PGN_MAX_PLY)
+            g->broken = true;
+        return;
+    }
+    Move m = parseSan(&p->pos, token, (int)length);
+    if(m == MOVE_NONE) {
+        g->broken = true;
+        return;
+    }
+    g->moves[g->ply++] = m;
+    positionMakeMove(&p->pos, m);
+}
+
+static const char* skipVariation(const char* s, const char* end) {
+    int depth = 0;
+    while(s < end) {
+        if(*s == '{') {
+            while(s < end && *s != '}')
+                s++;
+        } else if(*s == '(') {
+            depth++;
+        } else if(*s == ')' && --depth == 0) {
+            return s + 1;
+        }
+        s++;
+    }
+    return end;
+}
+
+uint64_t pgnParse(const char* text, size_t length, int maxPly, PgnGameFn fn, void* user) {
+    ASSERT(text != null || !length, "The text shouldn't be null!\n");
+    ASSERT(fn != null, "The callback shouldn't be null!\n");
+
+    PgnParser p;
+    p.text = text;
+    p.maxPly = maxPly < PGN_MAX_PLY ? maxPly : PGN_MAX_PLY;
+    p.fn = fn;
+    p.user = user;
+    p.inGame = false;
+    p.inMoves = false;
+    p.stopped = false;
+    p.count = 0;
+    positionSetStart(&p.startPos);
+
+    const char* s = text;
+    const char* end = text + length;
+    while(s < end && !p.stopped) {
+        char c = *s;
+        if(isSpace(c)) {
+            s++;
+        } else if(c == '[') {
+            // a tag after the moves is a game without a termination marker
+            if(p.inGame && p.inMoves)
+                endGame(&p, s, RESULT_NONE);
+            if(p.stopped)
+                break;
+            if(!p.inGame)
+                beginGame(&p, s);
+            s = parseTag(&p, s, end);
+        } else if(c == '{') {
+            const char* close = memchr(s, '}', (size_t)(end - s));
+            s = close ? close + 1 : end;
+        } else if(c == ';' || c == '%') {
+            const char* eol = memchr(s, '\n', (size_t)(end - s));
+            s = eol ? eol : end;
+        } else if(c == '(') {
+            s = skipVariation(s, end);
+        } else if(c == ')') {
+            s++;
+        } else {
+            const char* token = s;
+            while(s < end && !isSpace(*s) && *s != '{' && *s != '(' && *s != ')' && *s != ';')
+                s++;
+            size_t len = (size_t)(s - token);
+
+            if(!p.inGame)
+                beginGame(&p, token);
+            p.inMoves = true;
+
+            GameResult result = parseResult(token, len);
+            if(result != RESULT_NONE || (len == 1 && *token == '*'))
+                endGame(&p, s, result);
+            else
+                parseMoveToken(&p, token, len);
+        }
+    }
+    if(p.inGame && !p.stopped)
+        endGame(&p, end, RESULT_NONE);
+
+    return p.count;
+}
+
+bool pgnParseFile(const char* path, int maxPly, PgnGameFn fn, void* user, uint64_t* games) {
+    MappedFile file;
+    if(!mapFile(&file, path))
+        return false;
+
+    uint64_t count = pgnParse((const char*)file.data, file.size, maxPly, fn, user);
+    if(games)
+        *games = count;
+
+    unmapFile(&file);
+    return true;
+}
+
+size_t pgnNextGame(const char* text, size_t length, size_t offset) {
+    if(offset == 0)
+        return 0;
+
+    const char* end = text + length;
+    for(const char* s = text + offset - 1; s + 1 < end; s++) {
+        s = memchr(s, '\n', (size_t)(end - s));
+        if(!s || s + 1 >= end)
+            break;
+        if(s[1] != '[')
+            continue;
+        // blank line before it
+        const char* prev = s - 1;
+        if(prev >= text && *prev == '\r')
+            prev--;
+        if(prev >= text && *prev == '\n')
+            return (size_t)(s + 1 - text);
+    }
+    return length;
+}
+
+bool pgnFindTag(const PgnGame* game, const char* name, PgnString* value) {
+    size_t length = strlen(name);
+    for(int i = 0; i < game->tagCount; i++) {
+        if(isTag(&game->tags[i], name, length)) {
+            *value = game->tags[i].value;
+            return true;
+        }
+    }
+    return false;
+}
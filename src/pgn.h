@@ -0,0 +1,59 @@
+#pragma once
+
+#include "position.h"
+
+#include <stddef.h>
+
+#define PGN_MAX_TAGS 32
+#define PGN_MAX_PLY 1024
+
+// A slice of the parsed text, not null terminated and with escapes left in place
+typedef struct {
+    const char* data;
+    uint32_t length;
+} PgnString;
+
+typedef struct {
+    PgnString name;
+    PgnString value;
+} PgnTag;
+
+typedef enum {
+    RESULT_NONE,
+    RESULT_WHITE_WINS,
+    RESULT_BLACK_WINS,
+    RESULT_DRAW
+} GameResult;
+
+typedef struct {
+    PgnTag tags[PGN_MAX_TAGS]; // tags past PGN_MAX_TAGS are dropped
+    int tagCount;
+
+    Position start;            // the FEN tag or the standard start
+    Move moves[PGN_MAX_PLY];
+    int ply;
+    GameResult result;         // the termination marker, the Result tag when it's '*' or missing
+    // a move couldn't be read, isn't legal or is past PGN_MAX_PLY, 'moves' holds the ones before it
+    bool broken;
+
+    // where the game is in the parsed text
+    size_t offset;
+    size_t length;
+} PgnGame;
+
+// Return false to stop parsing, the game and its slices are only valid during the call
+typedef bool (*PgnGameFn)(const PgnGame* game, void* user);
+
+// Calls fn for every game in the text without copying or allocating anything.
+// Moves past 'maxPly', at most PGN_MAX_PLY, are skipped without being resolved so 0
+// only reads the headers.
+// Returns the number of games passed to fn
+uint64_t pgnParse(const char* text, size_t length, int maxPly, PgnGameFn fn, void* user);
+// Maps the file and parses it, false if it can't be read
+bool pgnParseFile(const char* path, int maxPly, PgnGameFn fn, void* user, uint64_t* games);
+
+// Offset of the first game starting at or after 'offset' or 'length' if there's none,
+// a game starts at a tag line after a blank line
+size_t pgnNextGame(const char* text, size_t length, size_t offset);
+
+bool pgnFindTag(const PgnGame* game, const char* name, PgnString* value);
@@ -0,0 +1,580 @@
+#include "platform.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+bool mapFile(MappedFile* map, const char* path) {
+    ASSERT(map != null, "The map ptr provided shouldn't be null!\n");
+    ASSERT(path != null, "The path shouldn't be null!\n");
+
+    memset(map, 0, sizeof(MappedFile));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING,
+                              FILE_FLAG_RANDOM_ACCESS, null);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, null, PAGE_READONLY, 0, 0, null);
+    if(!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    map->data = data;
+    map->size = (size_t)size.QuadPart;
+    map->file = file;
+    map->mapping = mapping;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(null, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file alive
+    close(fd);
+    if(data == MAP_FAILED)
+        return false;
+
+    map->data = data;
+    map->size = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+void unmapFile(MappedFile* map) {
+    ASSERT(map != null, "The map ptr provided shouldn't be null!\n");
+
+    if(!map->data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile((void*)map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap((void*)map->data, map->size);
+#endif
+
+    memset(map, 0, sizeof(MappedFile));
+}
+
+bool mapFileWritable(WritableMapping* map, const char* path, size_t size, bool* wasEmpty) {
+    ASSERT(map != null, "The map ptr provided shouldn't be null!\n");
+    ASSERT(path != null, "The path shouldn't be null!\n");
+
+    memset(map, 0, sizeof(WritableMapping));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, null, OPEN_ALWAYS,
+                              FILE_FLAG_RANDOM_ACCESS, null);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER current;
+    if(!GetFileSizeEx(file, &current)) {
+        CloseHandle(file);
+        return false;
+    }
+    *wasEmpty = current.QuadPart == 0;
+    if((size_t)current.QuadPart != size) {
+        LARGE_INTEGER wanted;
+        wanted.QuadPart = (LONGLONG)size;
+        if(!SetFilePointerEx(file, wanted, null, FILE_BEGIN) || !SetEndOfFile(file)) {
+            CloseHandle(file);
+            return false;
+        }
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, null, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, null);
+    if(!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if(!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    map->file = file;
+    map->mapping = mapping;
+#else
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    *wasEmpty = st.st_size == 0;
+    if((size_t)st.st_size != size && ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(null, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    map->fd = fd;
+#endif
+
+    map->data = data;
+    map->size = size;
+    return true;
+}
+
+void flushMapping(WritableMapping* map) {
+    if(!map->data)
+        return;
+
+#ifdef _WIN32
+    FlushViewOfFile(map->data, 0);
+    FlushFileBuffers(map->file);
+#else
+    msync(map->data, map->size, MS_SYNC);
+#endif
+}
+
+void unmapWritable(WritableMapping* map) {
+    ASSERT(map != null, "The map ptr provided shouldn't be null!\n");
+
+    if(!map->data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap(map->data, map->size);
+    close(map->fd);
+#endif
+
+    memset(map, 0, sizeof(WritableMapping));
+}
+
+int64_t getTimeMs(void) {
+#ifdef _WIN32
+    return (int64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+int64_t getTimeUs(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    if(!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart / frequency.QuadPart * 1000000
+                   + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void sleepMs(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, null);
+#endif
+}
+
+int getCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+bool listDirectory(const char* dir, DirectoryEntryFn fn, void* user) {
+    ASSERT(dir != null, "The dir shouldn't be null!\n");
+    ASSERT(fn != null, "The callback shouldn't be null!\n");
+
+#ifdef _WIN32
+    char pattern[1024];
+    snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if(find == INVALID_HANDLE_VALUE)
+        return false;
+    do {
+        if(!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            fn(dir, data.cFileName, user);
+    } while(FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR* d = opendir(dir);
+    if(!d)
+        return false;
+
+    struct dirent* entry;
+    while((entry = readdir(d))) {
+        char path[1024];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if(stat(path, &st) == 0 && S_ISREG(st.st_mode))
+            fn(dir, entry->d_name, user);
+    }
+    closedir(d);
+#endif
+
+    return true;
+}
+
+bool processStart(ChildProcess* process, const char* command) {
+    ASSERT(process != null, "The process ptr provided shouldn't be null!\n");
+    ASSERT(command != null, "The command shouldn't be null!\n");
+
+    memset(process, 0, sizeof(ChildProcess));
+
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), null, TRUE };
+    HANDLE childIn, ourIn, ourOut, childOut;
+    if(!CreatePipe(&childIn, &ourIn, &inherit, 0))
+        return false;
+    if(!CreatePipe(&ourOut, &childOut, &inherit, 0)) {
+        CloseHandle(childIn);
+        CloseHandle(ourIn);
+        return false;
+    }
+    // the child gets its ends only
+    SetHandleInformation(ourIn, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(ourOut, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startup = { .cb = sizeof(STARTUPINFOA), .dwFlags = STARTF_USESTDHANDLES };
+    startup.hStdInput = childIn;
+    startup.hStdOutput = childOut;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    char line[1024];
+    snprintf(line, sizeof(line), "%s", command);
+    PROCESS_INFORMATION info;
+    BOOL started = CreateProcessA(null, line, null, null, TRUE, CREATE_NO_WINDOW, null, null, &startup, &info);
+    CloseHandle(childIn);
+    CloseHandle(childOut);
+    if(!started) {
+        CloseHandle(ourIn);
+        CloseHandle(ourOut);
+        return false;
+    }
+    CloseHandle(info.hThread);
+
+    DWORD mode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+    SetNamedPipeHandleState(ourIn, &mode, null, null);
+
+    process->process = info.hProcess;
+    process->input = ourIn;
+    process->output = ourOut;
+#else
+    // a child that died must not kill us on the next write
+    signal(SIGPIPE, SIG_IGN);
+
+    int in[2], out[2];
+    if(pipe(in) != 0)
+        return false;
+    if(pipe(out) != 0) {
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+    // children started by other threads mustn't inherit these, dup2 clears it for our child
+    for(int i = 0; i < 2; i++) {
+        fcntl(in[i], F_SETFD, FD_CLOEXEC);
+        fcntl(out[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    pid_t pid = fork();
+    if(pid < 0) {
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        return false;
+    }
+    if(pid == 0) {
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        execl("/bin/sh", "sh", "-c", command, (char*)null);
+        _exit(127);
+    }
+
+    close(in[0]);
+    close(out[1]);
+    fcntl(in[1], F_SETFL, fcntl(in[1], F_GETFL) | O_NONBLOCK);
+
+    process->pid = (int)pid;
+    process->input = in[1];
+    process->output = out[0];
+#endif
+
+    return true;
+}
+
+long processWrite(ChildProcess* process, const void* data, size_t size) {
+#ifdef _WIN32
+    DWORD written = 0;
+    if(!WriteFile(process->input, data, (DWORD)size, &written, null))
+        return GetLastError() == ERROR_NO_DATA ? -1 : 0;
+    return (long)written;
+#else
+    ssize_t written = write(process->input, data, size);
+    if(written < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    return (long)written;
+#endif
+}
+
+long processRead(ChildProcess* process, void* data, size_t size, int timeoutMs) {
+#ifdef _WIN32
+    // anonymous pipes can't be waited on, peek until something arrives
+    int64_t deadline = getTimeMs() + timeoutMs;
+    DWORD available = 0;
+    while(timeoutMs >= 0) {
+        if(!PeekNamedPipe(process->output, null, 0, null, &available, null))
+            return -1;
+        if(available)
+            break;
+        if(getTimeMs() >= deadline)
+            return 0;
+        Sleep(1);
+    }
+
+    DWORD read = 0;
+    if(!ReadFile(process->output, data, (DWORD)size, &read, null) || !read)
+        return -1;
+    return (long)read;
+#else
+    struct pollfd fd = { process->output, POLLIN, 0 };
+    int ready;
+    do {
+        ready = poll(&fd, 1, timeoutMs);
+    } while(ready < 0 && errno == EINTR);
+    if(ready == 0)
+        return 0;
+    if(ready < 0)
+        return -1;
+
+    ssize_t n;
+    do {
+        n = read(process->output, data, size);
+    } while(n < 0 && errno == EINTR);
+    return n > 0 ? (long)n : -1;
+#endif
+}
+
+void processClose(ChildProcess* process, int timeoutMs) {
+#ifdef _WIN32
+    if(!process->process)
+        return;
+    CloseHandle(process->input);
+    if(WaitForSingleObject(process->process, (DWORD)timeoutMs) != WAIT_OBJECT_0)
+        TerminateProcess(process->process, 1);
+    CloseHandle(process->output);
+    CloseHandle(process->process);
+#else
+    if(!process->pid)
+        return;
+    close(process->input);
+
+    int64_t deadline = getTimeMs() + timeoutMs;
+    while(waitpid(process->pid, null, WNOHANG) == 0) {
+        if(getTimeMs() >= deadline) {
+            kill(process->pid, SIGKILL);
+            waitpid(process->pid, null, 0);
+            break;
+        }
+        sleepMs(1);
+    }
+    close(process->output);
+#endif
+
+    memset(process, 0, sizeof(ChildProcess));
+}
+
+bool socketConnect(NetSocket* s, const char* host, int port) {
+    ASSERT(s != null, "The socket ptr provided shouldn't be null!\n");
+    ASSERT(host != null, "The host shouldn't be null!\n");
+
+    memset(s, 0, sizeof(NetSocket));
+
+#ifdef _WIN32
+    static bool started = false;
+    if(!started) {
+        WSADATA data;
+        if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+            return false;
+        started = true;
+    }
+#endif
+
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* addresses;
+    if(getaddrinfo(host, service, &hints, &addresses) != 0)
+        return false;
+
+    bool connected = false;
+    for(struct addrinfo* a = addresses; a && !connected; a = a->ai_next) {
+#ifdef _WIN32
+        SOCKET fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if(fd == INVALID_SOCKET)
+            continue;
+        if(connect(fd, a->ai_addr, (int)a->ai_addrlen) != 0) {
+            closesocket(fd);
+            continue;
+        }
+        u_long nonBlocking = 1;
+        ioctlsocket(fd, FIONBIO, &nonBlocking);
+        s->handle = (uintptr_t)fd;
+#else
+        int fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+        if(fd < 0)
+            continue;
+        if(connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        s->fd = fd;
+#endif
+        // moves are tiny and have to go out at once
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+        connected = true;
+    }
+    freeaddrinfo(addresses);
+
+    s->open = connected;
+    return connected;
+}
+
+long socketSend(NetSocket* s, const void* data, size_t size) {
+#ifdef _WIN32
+    int n = send((SOCKET)s->handle, data, (int)size, 0);
+    if(n < 0)
+        return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+    return (long)n;
+#else
+    ssize_t n = send(s->fd, data, size, MSG_NOSIGNAL);
+    if(n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    return (long)n;
+#endif
+}
+
+long socketReceive(NetSocket* s, void* data, size_t size, int timeoutMs) {
+#ifdef _WIN32
+    SOCKET fd = (SOCKET)s->handle;
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    int ready = select(0, &set, null, null, timeoutMs < 0 ? null : &timeout);
+    if(ready == 0)
+        return 0;
+    if(ready < 0)
+        return -1;
+
+    int n = recv(fd, data, (int)size, 0);
+    if(n < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+        return 0;
+    return n > 0 ? (long)n : -1;
+#else
+    struct pollfd fd = { s->fd, POLLIN, 0 };
+    int ready;
+    do {
+        ready = poll(&fd, 1, timeoutMs);
+    } while(ready < 0 && errno == EINTR);
+    if(ready == 0)
+        return 0;
+    if(ready < 0)
+        return -1;
+
+    ssize_t n;
+    do {
+        n = recv(s->fd, data, size, 0);
+    } while(n < 0 && errno == EINTR);
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    return n > 0 ? (long)n : -1;
+#endif
+}
+
+void socketClose(NetSocket* s) {
+    if(!s->open)
+        return;
+#ifdef _WIN32
+    closesocket((SOCKET)s->handle);
+#else
+    close(s->fd);
+#endif
+    memset(s, 0, sizeof(NetSocket));
+}
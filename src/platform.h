@@ -0,0 +1,90 @@
+#pragma once
+
+#include "defines.h"
+
+#include <stddef.h>
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#endif
+} MappedFile;
+
+// Read-only shared mapping of a whole file, pages are loaded on demand and
+// shared with every other process mapping the same file
+bool mapFile(MappedFile* map, const char* path);
+void unmapFile(MappedFile* map);
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#else
+    int fd;
+#endif
+} WritableMapping;
+
+// Shared read-write mapping of 'size' bytes, the file is created or resized to that. Stores
+// reach the file whenever the OS writes the pages back. 'wasEmpty' tells if the file had no
+// data before, only then is all of it zeros, a resized file keeps what it had
+bool mapFileWritable(WritableMapping* map, const char* path, size_t size, bool* wasEmpty);
+// Writes the changed pages back, returns once they're on disk
+void flushMapping(WritableMapping* map);
+void unmapWritable(WritableMapping* map);
+
+// Milliseconds from an arbitrary fixed point
+int64_t getTimeMs(void);
+// Microseconds from the same kind of point, for clocks that milliseconds would round off
+int64_t getTimeUs(void);
+void sleepMs(int ms);
+int getCpuCount(void);
+
+typedef void (*DirectoryEntryFn)(const char* dir, const char* name, void* user);
+// Calls fn for every regular file in the directory, false if it can't be opened
+bool listDirectory(const char* dir, DirectoryEntryFn fn, void* user);
+
+typedef struct {
+#ifdef _WIN32
+    void* process;
+    void* input;  // our end of the child's stdin
+    void* output; // our end of the child's stdout
+#else
+    int pid;
+    int input;
+    int output;
+#endif
+} ChildProcess;
+
+// Runs the command line with its stdin and stdout connected to pipes, stderr is inherited
+bool processStart(ChildProcess* process, const char* command);
+// Never blocks, writes what fits into the pipe and returns the byte count, -1 once the child is gone
+long processWrite(ChildProcess* process, const void* data, size_t size);
+// Waits up to 'timeoutMs' (forever if negative) for output, returns the bytes read,
+// 0 on a timeout and -1 once the child closed its end
+long processRead(ChildProcess* process, void* data, size_t size, int timeoutMs);
+// Closes the pipes, gives the child 'timeoutMs' to exit and kills it after that
+void processClose(ChildProcess* process, int timeoutMs);
+
+// A TCP connection, reads block up to a timeout and writes never block
+typedef struct {
+#ifdef _WIN32
+    uintptr_t handle;
+#else
+    int fd;
+#endif
+    bool open;
+} NetSocket;
+
+// Connects to host:port, the connect itself blocks
+bool socketConnect(NetSocket* socket, const char* host, int port);
+// Sends what the socket takes and returns the byte count, -1 once the connection is gone
+long socketSend(NetSocket* socket, const void* data, size_t size);
+// Waits up to 'timeoutMs' for data, returns the bytes read, 0 on a timeout and -1 once
+// the connection closed
+long socketReceive(NetSocket* socket, void* data, size_t size, int timeoutMs);
+void socketClose(NetSocket* socket);
@@ -0,0 +1,94 @@
+#include "posindex.h"
+
+#include <string.h>
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t readU64(const uint8_t* p) {
+    return (uint64_t)readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+bool posIndexOpen(PositionIndex* index, const char* path) {
+    ASSERT(index != null, "The index ptr provided shouldn't be null!\n");
+    memset(index, 0, sizeof(PositionIndex));
+
+    if(!mapFile(&index->map, path))
+        return false;
+
+    const uint8_t* data = index->map.data;
+    size_t size = index->map.size;
+    if(size < POSINDEX_HEADER_SIZE || memcmp(data, "CPI1", 4)
+        || readU64(data + 8) > (size - POSINDEX_HEADER_SIZE) / POSINDEX_ENTRY_SIZE) {
+        unmapFile(&index->map);
+        return false;
+    }
+
+    index->count = readU64(data + 8);
+    index->games = readU64(data + 16);
+    index->entries = data + POSINDEX_HEADER_SIZE;
+    return true;
+}
+
+void posIndexClose(PositionIndex* index) {
+    if(index->map.data)
+        unmapFile(&index->map);
+    memset(index, 0, sizeof(PositionIndex));
+}
+
+uint64_t posIndexLookup(const PositionIndex* index, uint64_t key, PositionHit* hits, uint64_t max) {
+    // the keys are uniform so the first guesses interpolate, a few pages are touched
+    // instead of one per halving. Binary search finishes or takes over if it's slow
+    uint64_t lo = 0, hi = index->count;
+    uint64_t loKey = 0, hiKey = UINT64_MAX;
+    for(int step = 0; hi - lo > 64 && step < 8; step++) {
+        uint64_t mid = lo + (uint64_t)((double)(key - loKey) / ((double)(hiKey - loKey) + 1.0) * (double)(hi - lo));
+        if(mid >= hi)
+            mid = hi - 1;
+        uint64_t midKey = readU64(index->entries + mid * POSINDEX_ENTRY_SIZE);
+        if(midKey < key) {
+            lo = mid + 1;
+            loKey = midKey;
+        } else {
+            hi = mid;
+            hiKey = midKey;
+        }
+    }
+    while(lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if(readU64(index->entries + mid * POSINDEX_ENTRY_SIZE) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    uint64_t first = lo;
+
+    // the end of the range, the start position alone has an entry per game
+    hi = index->count;
+    while(lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if(readU64(index->entries + mid * POSINDEX_ENTRY_SIZE) <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    uint64_t count = lo - first;
+
+    for(uint64_t i = 0; i < count && i < max; i++) {
+        const uint8_t* entry = index->entries + (first + i) * POSINDEX_ENTRY_SIZE;
+        hits[i].game = readU32(entry + 8);
+        hits[i].ply = (uint16_t)(entry[12] | entry[13] << 8);
+    }
+    return count;
+}
+
+void posIndexWriteEntry(uint8_t* out, uint64_t key, uint32_t game, uint16_t ply) {
+    for(int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(key >> (8 * i));
+    for(int i = 0; i < 4; i++)
+        out[8 + i] = (uint8_t)(game >> (8 * i));
+    out[12] = (uint8_t)ply;
+    out[13] = (uint8_t)(ply >> 8);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "position.h"
+#include "platform.h"
+
+/*
+ * Position index, little endian:
+ *   0  char[4]  magic "CPI1"
+ *   4  uint32   reserved
+ *   8  uint64   entry count
+ *   16 uint64   game count of the database it was built from
+ * followed by the entries sorted by key, then game:
+ *   0  uint64   position key
+ *   8  uint32   game id
+ *   12 uint16   ply the game first reached the position at
+ */
+#define POSINDEX_HEADER_SIZE 32
+#define POSINDEX_ENTRY_SIZE 14
+
+typedef struct {
+    uint32_t game;
+    uint16_t ply;
+} PositionHit;
+
+typedef struct {
+    MappedFile map;
+    uint64_t count;
+    uint64_t games;
+    const uint8_t* entries;
+} PositionIndex;
+
+bool posIndexOpen(PositionIndex* index, const char* path);
+void posIndexClose(PositionIndex* index);
+// Returns how many games reached the position, the first 'max' go to 'hits' by game id
+uint64_t posIndexLookup(const PositionIndex* index, uint64_t key, PositionHit* hits, uint64_t max);
+void posIndexWriteEntry(uint8_t* out, uint64_t key, uint32_t game, uint16_t ply);
@@ -0,0 +1,240 @@
+#include "position.h"
+
+#include <string.h>
+
+uint64_t ZOBRIST_PIECES[TEAMS][PIECE_TYPES][SQUARES];
+uint64_t ZOBRIST_CASTLING[16];
+uint64_t ZOBRIST_EN_PASSANT[FILES];
+uint64_t ZOBRIST_SIDE;
+uint64_t ZOBRIST_MATERIAL[TEAMS][PIECE_TYPES][16];
+
+// Rights that survive a move touching the square
+static uint8_t CASTLING_MASK[SQUARES];
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64*, fixed seed so the keys are identical across runs and builds
+static uint64_t nextRandom(void) {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1DULL;
+}
+
+void initPosition(void) {
+    initBitboards();
+
+    randomState = 0x9E3779B97F4A7C15ULL;
+    for(int team = 0; team < TEAMS; team++) {
+        for(int type = 0; type < PIECE_TYPES; type++) {
+            for(int sq = 0; sq < SQUARES; sq++)
+                ZOBRIST_PIECES[team][type][sq] = nextRandom();
+            for(int count = 0; count < 16; count++)
+                ZOBRIST_MATERIAL[team][type][count] = nextRandom();
+        }
+    }
+    for(int i = 0; i < 16; i++)
+        ZOBRIST_CASTLING[i] = nextRandom();
+    for(int i = 0; i < FILES; i++)
+        ZOBRIST_EN_PASSANT[i] = nextRandom();
+    ZOBRIST_SIDE = nextRandom();
+
+    for(int sq = 0; sq < SQUARES; sq++)
+        CASTLING_MASK[sq] = CASTLE_ALL;
+    CASTLING_MASK[makeSquare(0, 0)] &= ~CASTLE_WHITE_QUEEN;
+    CASTLING_MASK[makeSquare(7, 0)] &= ~CASTLE_WHITE_KING;
+    CASTLING_MASK[makeSquare(4, 0)] &= ~(CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN);
+    CASTLING_MASK[makeSquare(0, 7)] &= ~CASTLE_BLACK_QUEEN;
+    CASTLING_MASK[makeSquare(7, 7)] &= ~CASTLE_BLACK_KING;
+    CASTLING_MASK[makeSquare(4, 7)] &= ~(CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN);
+}
+
+void positionClear(Position* pos) {
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!\n");
+
+    memset(pos, 0, sizeof(Position));
+    memset(pos->board, PIECE_NONE, sizeof(pos->board));
+    pos->side = TEAM_WHITE;
+    pos->epSquare = SQUARE_NONE;
+    pos->fullmoves = 1;
+}
+
+void positionPutPiece(Position* pos, PieceTeam team, PieceType type, int sq) {
+    Bitboard bb = squareBB(sq);
+
+    pos->pieces[team][type] |= bb;
+    pos->teams[team] |= bb;
+    pos->all |= bb;
+    pos->board[sq] = makePiece(team, type);
+
+    pos->key ^= ZOBRIST_PIECES[team][type][sq];
+    pos->materialKey ^= ZOBRIST_MATERIAL[team][type][pos->counts[team][type] & 15];
+    pos->counts[team][type]++;
+}
+
+void positionRemovePiece(Position* pos, int sq) {
+    uint8_t piece = pos->board[sq];
+    PieceTeam team = pieceTeam(piece);
+    PieceType type = pieceType(piece);
+    Bitboard bb = squareBB(sq);
+
+    pos->pieces[team][type] ^= bb;
+    pos->teams[team] ^= bb;
+    pos->all ^= bb;
+    pos->board[sq] = PIECE_NONE;
+
+    pos->key ^= ZOBRIST_PIECES[team][type][sq];
+    pos->counts[team][type]--;
+    pos->materialKey ^= ZOBRIST_MATERIAL[team][type][pos->counts[team][type] & 15];
+}
+
+static void movePiece(Position* pos, int from, int to) {
+    uint8_t piece = pos->board[from];
+    PieceTeam team = pieceTeam(piece);
+    PieceType type = pieceType(piece);
+    Bitboard bb = squareBB(from) | squareBB(to);
+
+    pos->pieces[team][type] ^= bb;
+    pos->teams[team] ^= bb;
+    pos->all ^= bb;
+    pos->board[from] = PIECE_NONE;
+    pos->board[to] = piece;
+
+    pos->key ^= ZOBRIST_PIECES[team][type][from] ^ ZOBRIST_PIECES[team][type][to];
+}
+
+void positionRefreshKeys(Position* pos) {
+    pos->key = 0;
+    pos->materialKey = 0;
+
+    for(int team = 0; team < TEAMS; team++) {
+        for(int type = 0; type < PIECE_TYPES; type++) {
+            Bitboard b = pos->pieces[team][type];
+            while(b)
+                pos->key ^= ZOBRIST_PIECES[team][type][popLsb(&b)];
+            for(int i = 0; i < pos->counts[team][type]; i++)
+                pos->materialKey ^= ZOBRIST_MATERIAL[team][type][i & 15];
+        }
+    }
+
+    pos->key ^= ZOBRIST_CASTLING[pos->castling];
+    if(pos->epSquare != SQUARE_NONE)
+        pos->key ^= ZOBRIST_EN_PASSANT[squareFile(pos->epSquare)];
+    if(pos->side == TEAM_BLACK)
+        pos->key ^= ZOBRIST_SIDE;
+}
+
+void positionSetStart(Position* pos) {
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!\n");
+
+    static const PieceType backRank[FILES] = {
+        ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK
+    };
+
+    positionClear(pos);
+    for(int file = 0; file < FILES; file++) {
+        positionPutPiece(pos, TEAM_WHITE, backRank[file], makeSquare(file, 0));
+        positionPutPiece(pos, TEAM_WHITE, PAWN, makeSquare(file, 1));
+        positionPutPiece(pos, TEAM_BLACK, PAWN, makeSquare(file, 6));
+        positionPutPiece(pos, TEAM_BLACK, backRank[file], makeSquare(file, 7));
+    }
+    pos->castling = CASTLE_ALL;
+    positionRefreshKeys(pos);
+}
+
+Bitboard attackersTo(const Position* pos, int sq, Bitboard occupied) {
+    Bitboard bishops = pos->pieces[TEAM_WHITE][BISHOP] | pos->pieces[TEAM_BLACK][BISHOP]
+                     | pos->pieces[TEAM_WHITE][QUEEN] | pos->pieces[TEAM_BLACK][QUEEN];
+    Bitboard rooks = pos->pieces[TEAM_WHITE][ROOK] | pos->pieces[TEAM_BLACK][ROOK]
+                   | pos->pieces[TEAM_WHITE][QUEEN] | pos->pieces[TEAM_BLACK][QUEEN];
+
+    return (PAWN_ATTACKS[TEAM_BLACK][sq] & pos->pieces[TEAM_WHITE][PAWN])
+         | (PAWN_ATTACKS[TEAM_WHITE][sq] & pos->pieces[TEAM_BLACK][PAWN])
+         | (KNIGHT_ATTACKS[sq] & (pos->pieces[TEAM_WHITE][KNIGHT] | pos->pieces[TEAM_BLACK][KNIGHT]))
+         | (KING_ATTACKS[sq] & (pos->pieces[TEAM_WHITE][KING] | pos->pieces[TEAM_BLACK][KING]))
+         | (bishopAttacks(sq, occupied) & bishops)
+         | (rookAttacks(sq, occupied) & rooks);
+}
+
+bool isSquareAttacked(const Position* pos, int sq, PieceTeam by) {
+    const Bitboard* p = pos->pieces[by];
+
+    if(PAWN_ATTACKS[!by][sq] & p[PAWN])
+        return true;
+    if(KNIGHT_ATTACKS[sq] & p[KNIGHT])
+        return true;
+    if(KING_ATTACKS[sq] & p[KING])
+        return true;
+    if(bishopAttacks(sq, pos->all) & (p[BISHOP] | p[QUEEN]))
+        return true;
+    return (rookAttacks(sq, pos->all) & (p[ROOK] | p[QUEEN])) != 0;
+}
+
+bool positionInCheck(const Position* pos) {
+    return isSquareAttacked(pos, kingSquare(pos, pos->side), !pos->side);
+}
+
+bool positionMakeMove(Position* pos, Move move) {
+    PieceTeam us = pos->side;
+    PieceTeam them = !us;
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    MoveFlag flag = moveFlag(move);
+
+    if(pos->epSquare != SQUARE_NONE) {
+        pos->key ^= ZOBRIST_EN_PASSANT[squareFile(pos->epSquare)];
+        pos->epSquare = SQUARE_NONE;
+    }
+    pos->key ^= ZOBRIST_CASTLING[pos->castling];
+    pos->halfmoves++;
+
+    if(flag == MOVE_CASTLING) {
+        bool kingSide = to > from;
+        movePiece(pos, from, to);
+        movePiece(pos, kingSide ? from + 3 : from - 4, kingSide ? from + 1 : from - 1);
+    } else {
+        bool isPawn = pieceType(pos->board[from]) == PAWN;
+
+        if(flag == MOVE_EN_PASSANT) {
+            positionRemovePiece(pos, us == TEAM_WHITE ? to - 8 : to + 8);
+        } else if(pos->board[to] != PIECE_NONE) {
+            positionRemovePiece(pos, to);
+            pos->halfmoves = 0;
+        }
+        movePiece(pos, from, to);
+
+        if(isPawn) {
+            pos->halfmoves = 0;
+            if(flag == MOVE_PROMOTION) {
+                positionRemovePiece(pos, to);
+                positionPutPiece(pos, us, movePromotion(move), to);
+            } else if((from ^ to) == 16) {
+                int ep = (from + to) / 2;
+                if(PAWN_ATTACKS[us][ep] & pos->pieces[them][PAWN]) {
+                    pos->epSquare = (uint8_t)ep;
+                    pos->key ^= ZOBRIST_EN_PASSANT[squareFile(ep)];
+                }
+            }
+        }
+    }
+
+    pos->castling &= CASTLING_MASK[from] & CASTLING_MASK[to];
+    pos->key ^= ZOBRIST_CASTLING[pos->castling];
+
+    if(us == TEAM_BLACK)
+        pos->fullmoves++;
+    pos->side = them;
+    pos->key ^= ZOBRIST_SIDE;
+
+    return !isSquareAttacked(pos, kingSquare(pos, us), them);
+}
+
+void positionMakeNullMove(Position* pos) {
+    if(pos->epSquare != SQUARE_NONE) {
+        pos->key ^= ZOBRIST_EN_PASSANT[squareFile(pos->epSquare)];
+        pos->epSquare = SQUARE_NONE;
+    }
+    pos->halfmoves++;
+    pos->side = !pos->side;
+    pos->key ^= ZOBRIST_SIDE;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "defines.h"
+#include "bitboard.h"
+
+#define MAX_MOVES 256
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+// Longest FEN positionGetFen can write, without the terminator: 71 for the placement with 32
+// pieces, then " w", " KQkq", " e3" and two counters of up to FEN_MAX_COUNTER
+#define FEN_MAX_LENGTH 93
+#define FEN_MAX_COUNTER 65535
+
+#define PIECE_NONE 0xFF
+
+// bits 0-5: to, bits 6-11: from, bits 12-13: promotion piece, bits 14-15: flag
+typedef uint16_t Move;
+
+#define MOVE_NONE 0
+#define MOVE_NULL 65
+
+typedef enum {
+    MOVE_NORMAL = 0,
+    MOVE_PROMOTION = 1 << 14,
+    MOVE_EN_PASSANT = 2 << 14,
+    MOVE_CASTLING = 3 << 14
+} MoveFlag;
+
+typedef enum {
+    CASTLE_WHITE_KING = 1,
+    CASTLE_WHITE_QUEEN = 2,
+    CASTLE_BLACK_KING = 4,
+    CASTLE_BLACK_QUEEN = 8,
+    CASTLE_ALL = 15
+} CastlingRights;
+
+typedef struct {
+    Bitboard pieces[TEAMS][PIECE_TYPES];
+    Bitboard teams[TEAMS];
+    Bitboard all;
+
+    uint64_t key;
+    // Zobrist hash of the piece counts only, see material.h
+    uint64_t materialKey;
+
+    uint8_t board[SQUARES]; // PIECE_NONE or makePiece(team, type)
+    uint8_t counts[TEAMS][PIECE_TYPES];
+
+    PieceTeam side;
+    uint8_t castling;
+    uint8_t epSquare; // only set when an enemy pawn could capture en passant
+    uint16_t halfmoves;
+    uint16_t fullmoves;
+} Position;
+
+typedef struct {
+    Move moves[MAX_MOVES];
+    int count;
+} MoveList;
+
+extern uint64_t ZOBRIST_PIECES[TEAMS][PIECE_TYPES][SQUARES];
+extern uint64_t ZOBRIST_CASTLING[16];
+extern uint64_t ZOBRIST_EN_PASSANT[FILES];
+extern uint64_t ZOBRIST_SIDE;
+extern uint64_t ZOBRIST_MATERIAL[TEAMS][PIECE_TYPES][16];
+
+static inline uint8_t makePiece(PieceTeam team, PieceType type) {
+    return (uint8_t)((team << 3) | type);
+}
+
+static inline PieceTeam pieceTeam(uint8_t piece) {
+    return (PieceTeam)(piece >> 3);
+}
+
+static inline PieceType pieceType(uint8_t piece) {
+    return (PieceType)(piece & 7);
+}
+
+static inline Move createMove(int from, int to) {
+    return (Move)((from << 6) | to);
+}
+
+// @note type is one of KNIGHT, BISHOP, ROOK or QUEEN
+static inline Move createPromotion(int from, int to, PieceType type) {
+    int promo = type == KNIGHT ? 0 : type == BISHOP ? 1 : type == ROOK ? 2 : 3;
+    return (Move)(MOVE_PROMOTION | (promo << 12) | (from << 6) | to);
+}
+
+static inline Move createSpecialMove(int from, int to, MoveFlag flag) {
+    return (Move)(flag | (from << 6) | to);
+}
+
+static inline int moveFrom(Move move) {
+    return (move >> 6) & 63;
+}
+
+static inline int moveTo(Move move) {
+    return move & 63;
+}
+
+static inline MoveFlag moveFlag(Move move) {
+    return (MoveFlag)(move & (3 << 14));
+}
+
+static inline PieceType movePromotion(Move move) {
+    static const PieceType types[4] = { KNIGHT, BISHOP, ROOK, QUEEN };
+    return types[(move >> 12) & 3];
+}
+
+static inline int kingSquare(const Position* pos, PieceTeam team) {
+    return lsb(pos->pieces[team][KING]);
+}
+
+static inline bool isCapture(const Position* pos, Move move) {
+    return (pos->board[moveTo(move)] != PIECE_NONE && moveFlag(move) != MOVE_CASTLING)
+        || moveFlag(move) == MOVE_EN_PASSANT;
+}
+
+void initPosition(void);
+
+void positionClear(Position* pos);
+void positionSetStart(Position* pos);
+void positionPutPiece(Position* pos, PieceTeam team, PieceType type, int sq);
+void positionRemovePiece(Position* pos, int sq);
+// Recomputes the hash keys from scratch, call it after setting up a position by hand
+void positionRefreshKeys(Position* pos);
+
+Bitboard attackersTo(const Position* pos, int sq, Bitboard occupied);
+bool isSquareAttacked(const Position* pos, int sq, PieceTeam by);
+bool positionInCheck(const Position* pos);
+
+// Plays a pseudo-legal move in place, returns false if it left the own king in check
+// @note The position is unusable after an illegal move, play on a copy when unsure
+bool positionMakeMove(Position* pos, Move move);
+void positionMakeNullMove(Position* pos);
+
+// Pseudo-legal move generation, see positionMakeMove for the legality check
+void generateMoves(const Position* pos, MoveList* list);
+// Captures and queen promotions only
+void generateCaptures(const Position* pos, MoveList* list);
+void generateLegalMoves(const Position* pos, MoveList* list);
+// Target squares of the pseudo-legal moves of the piece on 'from', castling included,
+// a promotion square stands for all four promotions
+Bitboard pieceMoveTargets(const Position* pos, int from);
+
+// False if the FEN is malformed or the position illegal (king count, pawns on the
+// back ranks, side not to move in check), castling rights the pieces don't allow are dropped
+bool positionSetFen(Position* pos, const char* fen);
+// Parses the FEN at the start of 'text' (the move counters are optional, EPD operations
+// may follow), returns the length parsed or 0 if it's invalid
+size_t positionParseFen(Position* pos, const char* text, size_t length);
+// @note Make sure the 'out' is at least FEN_MAX_LENGTH + 1 chars long, returns the length
+int positionGetFen(const Position* pos, char* out);
+
+// Bulk conversion for dataset tools, one FEN per line, an invalid line gives a cleared
+// position (no kings) so the output stays aligned with the input. With 'consumed' set,
+// an unterminated last line is left for the next call
+size_t positionsFromFen(const char* text, size_t length, Position* out, size_t max, size_t* consumed);
+// Newline separated FENs, returns how many positions fit, 'written' gets the byte count
+size_t positionsToFen(const Position* positions, size_t count, char* out, size_t capacity, size_t* written);
+
+// @note Make sure the 'out' is at least 6 chars long
+void moveToString(Move move, char* out);
+// Standard algebraic notation of a legal move, returns its length
+// @note Make sure the 'out' is at least 8 chars long
+int moveToSan(const Position* pos, Move move, char* out);
+// Parses a move in coordinate notation ("e2e4", "e7e8q"), MOVE_NONE if it's not legal
+Move parseMove(const Position* pos, const char* str);
+// Parses a move in standard algebraic notation ("Nbd7", "exd8=Q+", "O-O"), MOVE_NONE
+// if it's not legal or ambiguous, 'str' doesn't need to be null terminated
+Move parseSan(const Position* pos, const char* str, int length);
@@ -0,0 +1,160 @@
+#include "query.h"
+
+#include <string.h>
+
+static const char* PIECE_LETTERS = "PRNBQK";
+
+static int pieceFromLetter(char c) {
+    const char* letter = c ? strchr(PIECE_LETTERS, c) : null;
+    return letter ? (int)(letter - PIECE_LETTERS) : -1;
+}
+
+// KRPvKR, every piece type not mentioned has to be absent
+static bool parseMaterial(PositionQuery* query, const char* term, int len) {
+    int team = TEAM_WHITE;
+    uint8_t counts[TEAMS][PIECE_TYPES] = {0};
+
+    for(int i = 0; i < len; i++) {
+        if(term[i] == 'v' && team == TEAM_WHITE) {
+            team = TEAM_BLACK;
+            continue;
+        }
+        int type = pieceFromLetter(term[i]);
+        if(type < 0 || (type == KING) != (i == 0 || term[i - 1] == 'v'))
+            return false;
+        if(type != KING)
+            counts[team][type]++;
+    }
+    if(team != TEAM_BLACK || term[len - 1] == 'v')
+        return false;
+
+    for(int t = 0; t < TEAMS; t++) {
+        for(int type = 0; type < KING; type++) {
+            if(counts[t][type] < query->minCount[t][type] || counts[t][type] > query->maxCount[t][type])
+                return false;
+            query->minCount[t][type] = query->maxCount[t][type] = counts[t][type];
+        }
+    }
+    return true;
+}
+
+static bool parseCount(PositionQuery* query, int team, int type, const char* op, int len) {
+    int opLen = len > 1 && op[1] == '=' ? 2 : 1;
+    if(len <= opLen)
+        return false;
+
+    int n = 0;
+    for(int i = opLen; i < len; i++) {
+        if(op[i] < '0' || op[i] > '9')
+            return false;
+        n = n * 10 + op[i] - '0';
+        // the bounds are stored in a byte
+        if(n > 255)
+            return false;
+    }
+
+    int lo = 0, hi = 255;
+    if(op[0] == '=' && opLen == 1)
+        lo = hi = n;
+    else if(op[0] == '<')
+        hi = opLen == 2 ? n : n - 1;
+    else if(op[0] == '>')
+        lo = opLen == 2 ? n : n + 1;
+    else
+        return false;
+    if(hi < 0 || lo > 255)
+        return false;
+
+    if(lo > query->minCount[team][type])
+        query->minCount[team][type] = (uint8_t)lo;
+    if(hi < query->maxCount[team][type])
+        query->maxCount[team][type] = (uint8_t)hi;
+    return query->minCount[team][type] <= query->maxCount[team][type];
+}
+
+static bool parseSquares(const char* s, int len, Bitboard* out) {
+    *out = 0;
+    int i = 0;
+    while(i < len) {
+        int end = i;
+        while(end < len && s[end] != ',')
+            end++;
+        int n = end - i;
+
+        if(n == 2 && s[i] >= 'a' && s[i] <= 'h' && s[i + 1] >= '1' && s[i + 1] <= '8')
+            *out |= squareBB(makeSquare(s[i] - 'a', s[i + 1] - '1'));
+        else if(n == 1 && s[i] >= '1' && s[i] <= '8')
+            *out |= RANK_1_BB << (8 * (s[i] - '1'));
+        else if(n == 1 && s[i] >= 'a' && s[i] <= 'h')
+            *out |= FILE_A_BB << (s[i] - 'a');
+        else if(n == 5 && !strncmp(s + i, "light", 5))
+            *out |= ~DARK_SQUARES_BB;
+        else if(n == 4 && !strncmp(s + i, "dark", 4))
+            *out |= DARK_SQUARES_BB;
+        else
+            return false;
+        i = end + 1;
+    }
+    return *out != 0;
+}
+
+static bool parseTerm(PositionQuery* query, const char* term, int len) {
+    if(len == 3 && !strncmp(term, "ocb", 3)) {
+        query->oppositeBishops = true;
+        return true;
+    }
+    if(len == 1 && (term[0] == 'w' || term[0] == 'b')) {
+        query->side = term[0] == 'w' ? TEAM_WHITE : TEAM_BLACK;
+        return true;
+    }
+    if(term[0] == 'K')
+        return parseMaterial(query, term, len);
+
+    bool negate = term[0] == '!';
+    if(negate) {
+        term++;
+        len--;
+    }
+    if(len < 3 || (term[0] != 'w' && term[0] != 'b'))
+        return false;
+    int team = term[0] == 'w' ? TEAM_WHITE : TEAM_BLACK;
+    int type = pieceFromLetter(term[1]);
+    if(type < 0)
+        return false;
+
+    if(term[2] != '@')
+        return !negate && type != KING && parseCount(query, team, type, term + 2, len - 2);
+
+    if(query->maskCount == QUERY_MAX_MASKS)
+        return false;
+    QueryMask* mask = &query->masks[query->maskCount];
+    mask->team = (uint8_t)team;
+    mask->type = (uint8_t)type;
+    mask->negate = negate;
+    if(!parseSquares(term + 3, len - 3, &mask->squares))
+        return false;
+    query->maskCount++;
+    return true;
+}
+
+bool queryParse(PositionQuery* query, const char* text) {
+    ASSERT(query != null, "The query ptr provided shouldn't be null!\n");
+    ASSERT(text != null, "The query text shouldn't be null!\n");
+
+    memset(query, 0, sizeof(PositionQuery));
+    memset(query->maxCount, 255, sizeof(query->maxCount));
+    query->side = QUERY_ANY_SIDE;
+
+    const char* s = text;
+    while(*s) {
+        while(*s == ' ' || *s == '\t')
+            s++;
+        const char* end = s;
+        while(*end && *end != ' ' && *end != '\t')
+            end++;
+        if(end > s && !parseTerm(query, s, (int)(end - s)))
+            return false;
+        s = end;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "position.h"
+
+#define QUERY_MAX_MASKS 16
+#define QUERY_ANY_SIDE -1
+
+// Pieces of one kind that have to be (or must not be) on a set of squares
+typedef struct {
+    uint8_t team;
+    uint8_t type;
+    bool negate;
+    Bitboard squares;
+} QueryMask;
+
+typedef struct {
+    uint8_t minCount[TEAMS][PIECE_TYPES];
+    uint8_t maxCount[TEAMS][PIECE_TYPES];
+    QueryMask masks[QUERY_MAX_MASKS];
+    int maskCount;
+    bool oppositeBishops;
+    int side; // PieceTeam or QUERY_ANY_SIDE
+} PositionQuery;
+
+/*
+ * A query is a space separated list of terms that all have to hold:
+ *   KRPvKR      exact material, white first
+ *   wQ=0 bP>=3  piece count of a team, with = < <= > >=
+ *   wR@7        a white rook on the 7th rank, squares are comma separated
+ *               squares (e4), ranks (7), files (e), light or dark
+ *   !bP@d,e     no black pawn on the d or e file
+ *   ocb         one bishop each, on squares of different colours
+ *   w, b        side to move
+ */
+bool queryParse(PositionQuery* query, const char* text);
+
+static inline bool queryMatch(const PositionQuery* query, const Position* pos) {
+    if(query->side != QUERY_ANY_SIDE && (int)pos->side != query->side)
+        return false;
+
+    for(int team = 0; team < TEAMS; team++) {
+        for(int type = 0; type < KING; type++) {
+            uint8_t count = pos->counts[team][type];
+            if(count < query->minCount[team][type] || count > query->maxCount[team][type])
+                return false;
+        }
+    }
+
+    for(int i = 0; i < query->maskCount; i++) {
+        const QueryMask* mask = &query->masks[i];
+        if(!(pos->pieces[mask->team][mask->type] & mask->squares) != mask->negate)
+            return false;
+    }
+
+    if(query->oppositeBishops) {
+        Bitboard white = pos->pieces[TEAM_WHITE][BISHOP];
+        Bitboard black = pos->pieces[TEAM_BLACK][BISHOP];
+        if(pos->counts[TEAM_WHITE][BISHOP] != 1 || pos->counts[TEAM_BLACK][BISHOP] != 1
+            || !(white & DARK_SQUARES_BB) == !(black & DARK_SQUARES_BB))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,224 @@
+#include "runs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void runSetInit(RunSet* set, const char* prefix, size_t recordSize, RunCompareFn compare) {
+    ASSERT(set != null, "The run set ptr provided shouldn't be null!\n");
+
+    memset(set, 0, sizeof(RunSet));
+    set->prefix = strdup(prefix);
+    set->recordSize = recordSize;
+    set->compare = compare;
+    ASSERT(set->prefix != null, "Failed to allocate the run prefix!\n");
+    pthread_mutex_init(&set->lock, null);
+}
+
+static void removeRuns(RunSet* set, int first, int count) {
+    for(int i = first; i < first + count; i++) {
+        remove(set->paths[i]);
+        free(set->paths[i]);
+    }
+    memmove(set->paths + first, set->paths + first + count, sizeof(char*) * (set->count - first - count));
+    set->count -= count;
+}
+
+void runSetFree(RunSet* set) {
+    removeRuns(set, 0, set->count);
+    free(set->paths);
+    free(set->prefix);
+    pthread_mutex_destroy(&set->lock);
+}
+
+static void nextRunPath(RunSet* set, char* path, size_t size) {
+    pthread_mutex_lock(&set->lock);
+    snprintf(path, size, "%s.run%d", set->prefix, set->named++);
+    pthread_mutex_unlock(&set->lock);
+}
+
+static void addRun(RunSet* set, const char* path) {
+    pthread_mutex_lock(&set->lock);
+    if(set->count == set->capacity) {
+        set->capacity = set->capacity ? 2 * set->capacity : 64;
+        set->paths = realloc(set->paths, sizeof(char*) * set->capacity);
+        ASSERT(set->paths != null, "Failed to allocate the run list!\n");
+    }
+    set->paths[set->count] = strdup(path);
+    ASSERT(set->paths[set->count] != null, "Failed to allocate a run path!\n");
+    set->count++;
+    pthread_mutex_unlock(&set->lock);
+}
+
+bool runSetWrite(RunSet* set, const void* records, size_t count) {
+    if(!count)
+        return true;
+
+    char path[1024];
+    nextRunPath(set, path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    bool ok = file && fwrite(records, set->recordSize, count, file) == count;
+    if(file)
+        ok = fclose(file) == 0 && ok;
+
+    if(!ok) {
+        ERROR("Failed to write the run %s\n", path);
+        remove(path);
+        return false;
+    }
+    addRun(set, path);
+    return true;
+}
+
+static inline const void* currentRecord(const RunMerge* m, int reader) {
+    const RunReader* r = &m->readers[reader];
+    return r->buffer + r->pos * m->set->recordSize;
+}
+
+// Makes sure the reader has a current record, false once the run is done
+static bool fillReader(RunMerge* m, RunReader* r) {
+    if(r->pos < r->count)
+        return true;
+
+    r->count = fread(r->buffer, m->set->recordSize, RUN_BUFFER_RECORDS, r->file);
+    r->pos = 0;
+    if(!r->count && ferror(r->file))
+        m->failed = true;
+    return r->count > 0;
+}
+
+static void siftDown(RunMerge* m, int i) {
+    while(true) {
+        int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+        if(l < m->heapCount && m->set->compare(currentRecord(m, m->heap[l]), currentRecord(m, m->heap[smallest])) < 0)
+            smallest = l;
+        if(r < m->heapCount && m->set->compare(currentRecord(m, m->heap[r]), currentRecord(m, m->heap[smallest])) < 0)
+            smallest = r;
+        if(smallest == i)
+            return;
+        int tmp = m->heap[i];
+        m->heap[i] = m->heap[smallest];
+        m->heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void closeReaders(RunMerge* m) {
+    for(int i = 0; i < m->readerCount; i++) {
+        if(m->readers[i].file)
+            fclose(m->readers[i].file);
+        free(m->readers[i].buffer);
+    }
+    free(m->readers);
+    free(m->heap);
+    m->readers = null;
+    m->heap = null;
+    m->readerCount = m->heapCount = 0;
+}
+
+// Opens the first 'count' runs of the set
+static bool openReaders(RunMerge* m, const RunSet* set, int count) {
+    memset(m, 0, sizeof(RunMerge));
+    m->set = set;
+    m->readers = calloc(count ? count : 1, sizeof(RunReader));
+    m->heap = malloc(sizeof(int) * (count ? count : 1));
+    ASSERT(m->readers != null && m->heap != null, "Failed to allocate the merge!\n");
+    m->readerCount = count;
+
+    for(int i = 0; i < count; i++) {
+        RunReader* r = &m->readers[i];
+        r->file = fopen(set->paths[i], "rb");
+        r->buffer = malloc(set->recordSize * RUN_BUFFER_RECORDS);
+        ASSERT(r->buffer != null, "Failed to allocate a run buffer!\n");
+        if(!r->file) {
+            ERROR("Can't open the run %s\n", set->paths[i]);
+            closeReaders(m);
+            return false;
+        }
+        if(fillReader(m, r))
+            m->heap[m->heapCount++] = i;
+    }
+    for(int i = m->heapCount / 2 - 1; i >= 0; i--)
+        siftDown(m, i);
+
+    if(m->failed) {
+        ERROR("Can't read the runs of %s\n", set->prefix);
+        closeReaders(m);
+        return false;
+    }
+    return true;
+}
+
+bool runMergeNext(RunMerge* merge, void* out) {
+    if(!merge->heapCount || merge->failed)
+        return false;
+
+    RunReader* r = &merge->readers[merge->heap[0]];
+    memcpy(out, currentRecord(merge, merge->heap[0]), merge->set->recordSize);
+    r->pos++;
+    if(!fillReader(merge, r))
+        merge->heap[0] = merge->heap[--merge->heapCount];
+    siftDown(merge, 0);
+
+    return !merge->failed;
+}
+
+// Merges the first RUN_MERGE_FAN_IN runs into one at the end of the set
+static bool mergePass(RunSet* set) {
+    RunMerge pass;
+    if(!openReaders(&pass, set, RUN_MERGE_FAN_IN))
+        return false;
+
+    char path[1024];
+    nextRunPath(set, path, sizeof(path));
+    FILE* out = fopen(path, "wb");
+    bool ok = out != null;
+
+    uint8_t* block = malloc(set->recordSize * RUN_BUFFER_RECORDS);
+    ASSERT(block != null, "Failed to allocate the merge block!\n");
+    size_t count = 0;
+    while(ok && runMergeNext(&pass, block + count * set->recordSize)) {
+        if(++count == RUN_BUFFER_RECORDS) {
+            ok = fwrite(block, set->recordSize, count, out) == count;
+            count = 0;
+        }
+    }
+    ok = ok && !pass.failed && fwrite(block, set->recordSize, count, out) == count;
+    if(out)
+        ok = fclose(out) == 0 && ok;
+    free(block);
+    closeReaders(&pass);
+
+    if(!ok) {
+        ERROR("Failed to write the run %s\n", path);
+        remove(path);
+        return false;
+    }
+    removeRuns(set, 0, RUN_MERGE_FAN_IN);
+    addRun(set, path);
+    return true;
+}
+
+bool runMergeOpen(RunMerge* merge, RunSet* set) {
+    ASSERT(merge != null && set != null, "The merge and run set ptrs provided shouldn't be null!\n");
+
+    while(set->count > RUN_MERGE_FAN_IN) {
+        if(!mergePass(set)) {
+            memset(merge, 0, sizeof(RunMerge));
+            merge->failed = true;
+            return false;
+        }
+    }
+    if(!openReaders(merge, set, set->count)) {
+        merge->failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool runMergeClose(RunMerge* merge, RunSet* set) {
+    bool ok = !merge->failed;
+
+    closeReaders(merge);
+    removeRuns(set, 0, set->count);
+    return ok;
+}
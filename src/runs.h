@@ -0,0 +1,57 @@
+#pragma once
+
+#include "defines.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+// Runs merged at once, each keeps a file open. More runs are merged in passes first
+#define RUN_MERGE_FAN_IN 256
+// Records read ahead per open run
+#define RUN_BUFFER_RECORDS 4096
+
+typedef int (*RunCompareFn)(const void* a, const void* b);
+
+// Sorted run files of fixed size records, for the builders that spill what doesn't fit in
+// memory and merge it at the end. The files are named '<prefix>.run<n>'
+typedef struct {
+    char* prefix;
+    size_t recordSize;
+    RunCompareFn compare;
+
+    pthread_mutex_t lock;
+    char** paths;
+    int count;
+    int capacity;
+    int named;
+} RunSet;
+
+typedef struct {
+    FILE* file;
+    uint8_t* buffer;
+    size_t count, pos;
+} RunReader;
+
+// Hands out the records of every run in order, equal records come one after another and
+// the caller combines them
+typedef struct {
+    const RunSet* set;
+    RunReader* readers;
+    int readerCount;
+    int* heap; // readers by their current record, smallest first
+    int heapCount;
+    bool failed;
+} RunMerge;
+
+void runSetInit(RunSet* set, const char* prefix, size_t recordSize, RunCompareFn compare);
+// Removes the run files still there
+void runSetFree(RunSet* set);
+// Writes 'count' records sorted by the set's compare as a new run, thread safe
+bool runSetWrite(RunSet* set, const void* records, size_t count);
+
+// False when a run can't be opened or read, a merge never leaves a run out
+bool runMergeOpen(RunMerge* merge, RunSet* set);
+// False at the end, or on a read error which sets 'failed'
+bool runMergeNext(RunMerge* merge, void* out);
+// Closes and removes the runs, false if anything failed since runMergeOpen
+bool runMergeClose(RunMerge* merge, RunSet* set);
@@ -0,0 +1,718 @@
+#include "search.h"
+#include "platform.h"
+
+#include <math.h>
+#include <string.h>
+
+#define VALUE_NONE 32002
+
+static int LMR[64][64];
+
+static inline int minInt(int a, int b) {
+    return a < b ? a : b;
+}
+
+static inline int maxInt(int a, int b) {
+    return a > b ? a : b;
+}
+
+// Mate and tablebase scores are stored relative to the node, not the root
+static inline int scoreToTT(int score, int ply) {
+    if(score >= VALUE_TB_WIN_BOUND)
+        return score + ply;
+    if(score <= -VALUE_TB_WIN_BOUND)
+        return score - ply;
+    return score;
+}
+
+static inline int scoreFromTT(int score, int ply) {
+    if(score >= VALUE_TB_WIN_BOUND)
+        return score - ply;
+    if(score <= -VALUE_TB_WIN_BOUND)
+        return score + ply;
+    return score;
+}
+
+uint64_t engineNodes(const Engine* engine) {
+    uint64_t nodes = 0;
+    for(int i = 0; i < engine->threadCount; i++)
+        nodes += atomic_load_explicit(&engine->threads[i].nodes, memory_order_relaxed);
+    return nodes;
+}
+
+static uint64_t engineTbHits(const Engine* engine) {
+    uint64_t hits = 0;
+    for(int i = 0; i < engine->threadCount; i++)
+        hits += atomic_load_explicit(&engine->threads[i].tbHits, memory_order_relaxed);
+    return hits;
+}
+
+static void checkLimits(Engine* e) {
+    if(atomic_load_explicit(&e->pondering, memory_order_acquire))
+        return;
+    if(e->maximumTime && getTimeMs() - atomic_load_explicit(&e->limitStart, memory_order_relaxed) >= e->maximumTime)
+        atomic_store(&e->stop, true);
+    if(e->limits.nodes && engineNodes(e) >= e->limits.nodes)
+        atomic_store(&e->stop, true);
+}
+
+// Counts the node, returns true when the search has to unwind
+static inline bool countNode(SearchThread* t) {
+    uint64_t nodes = atomic_load_explicit(&t->nodes, memory_order_relaxed) + 1;
+    atomic_store_explicit(&t->nodes, nodes, memory_order_relaxed);
+    if(t->id == 0 && (nodes & 1023) == 0)
+        checkLimits(t->engine);
+    return atomic_load_explicit(&t->engine->stop, memory_order_relaxed);
+}
+
+static bool isDraw(const SearchThread* t, const Position* pos) {
+    if(pos->halfmoves >= 100)
+        return true;
+
+    // Bare kings or a single minor piece
+    if(!(pos->pieces[TEAM_WHITE][PAWN] | pos->pieces[TEAM_BLACK][PAWN]
+        | pos->pieces[TEAM_WHITE][ROOK] | pos->pieces[TEAM_BLACK][ROOK]
+        | pos->pieces[TEAM_WHITE][QUEEN] | pos->pieces[TEAM_BLACK][QUEEN])
+        && popCount(pos->all) <= 3)
+        return true;
+
+    // Any repetition since the last irreversible move
+    int end = maxInt(t->keyCount - pos->halfmoves, 0);
+    for(int i = t->keyCount - 4; i >= end; i -= 2) {
+        if(t->keys[i] == pos->key)
+            return true;
+    }
+
+    return false;
+}
+
+static void scoreMoves(const SearchThread* t, const Position* pos, const MoveList* list, int* scores, Move ttMove, int ply) {
+    for(int i = 0; i < list->count; i++) {
+        Move m = list->moves[i];
+
+        if(m == ttMove) {
+            scores[i] = 1 << 30;
+        } else if(isCapture(pos, m) || moveFlag(m) == MOVE_PROMOTION) {
+            PieceType victim = moveFlag(m) == MOVE_EN_PASSANT || pos->board[moveTo(m)] == PIECE_NONE
+                             ? PAWN : pieceType(pos->board[moveTo(m)]);
+            PieceType attacker = pieceType(pos->board[moveFrom(m)]);
+            scores[i] = (1 << 20) + PIECE_VALUE_MG[victim] * 16 - PIECE_VALUE_MG[attacker] / 16;
+            if(moveFlag(m) == MOVE_PROMOTION)
+                scores[i] += movePromotion(m) == QUEEN ? PIECE_VALUE_MG[QUEEN] * 16 : -(1 << 19);
+        } else if(m == t->killers[ply][0]) {
+            scores[i] = (1 << 19) + 1;
+        } else if(m == t->killers[ply][1]) {
+            scores[i] = 1 << 19;
+        } else {
+            scores[i] = t->history[pos->side][moveFrom(m)][moveTo(m)];
+        }
+    }
+}
+
+// Selection sort step, cheap because most nodes cut off after a few moves
+static inline Move pickMove(MoveList* list, int* scores, int from) {
+    int best = from;
+    for(int i = from + 1; i < list->count; i++) {
+        if(scores[i] > scores[best])
+            best = i;
+    }
+    Move m = list->moves[best];
+    int s = scores[best];
+    list->moves[best] = list->moves[from];
+    scores[best] = scores[from];
+    list->moves[from] = m;
+    scores[from] = s;
+    return m;
+}
+
+static inline bool isExcluded(const SearchThread* t, Move m) {
+    for(int i = 0; i < t->excludedCount; i++) {
+        if(t->excluded[i] == m)
+            return true;
+    }
+    return false;
+}
+
+static inline void updateHistory(int* entry, int bonus) {
+    *entry += bonus - *entry * abs(bonus) / 16384;
+}
+
+static int qsearch(SearchThread* t, const Position* pos, int alpha, int beta, int ply) {
+    Engine* e = t->engine;
+
+    if(countNode(t))
+        return 0;
+    if(ply > t->selDepth)
+        t->selDepth = ply;
+    if(ply >= MAX_PLY - 1)
+        return evaluate(pos, t->material);
+
+    TTData tte;
+    if(ttProbe(e->tt, pos->key, &tte)) {
+        int s = scoreFromTT(tte.score, ply);
+        if(tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && s >= beta) || (tte.bound == BOUND_UPPER && s <= alpha))
+            return s;
+    }
+
+    bool inCheck = positionInCheck(pos);
+    int bestScore = -VALUE_INFINITE;
+    int standPat = 0;
+
+    if(!inCheck) {
+        standPat = evaluate(pos, t->material);
+        if(standPat >= beta)
+            return standPat;
+        if(standPat > alpha)
+            alpha = standPat;
+        bestScore = standPat;
+    }
+
+    MoveList list;
+    int scores[MAX_MOVES];
+    if(inCheck)
+        generateMoves(pos, &list);
+    else
+        generateCaptures(pos, &list);
+    scoreMoves(t, pos, &list, scores, MOVE_NONE, ply);
+
+    int legal = 0;
+    for(int i = 0; i < list.count; i++) {
+        Move m = pickMove(&list, scores, i);
+
+        // Delta pruning, the capture can't bring the score back to alpha
+        if(!inCheck && moveFlag(m) != MOVE_PROMOTION) {
+            PieceType victim = pos->board[moveTo(m)] == PIECE_NONE ? PAWN : pieceType(pos->board[moveTo(m)]);
+            if(standPat + PIECE_VALUE_EG[victim] + 200 <= alpha)
+                continue;
+        }
+
+        Position next = *pos;
+        if(!positionMakeMove(&next, m))
+            continue;
+        legal++;
+
+        int s = -qsearch(t, &next, -beta, -alpha, ply + 1);
+        if(atomic_load_explicit(&e->stop, memory_order_relaxed))
+            return 0;
+
+        if(s > bestScore) {
+            bestScore = s;
+            if(s > alpha) {
+                alpha = s;
+                if(s >= beta)
+                    break;
+            }
+        }
+    }
+
+    if(inCheck && !legal)
+        return -VALUE_MATE + ply;
+
+    return bestScore;
+}
+
+static int search(SearchThread* t, const Position* pos, int alpha, int beta, int depth, int ply, bool nullAllowed) {
+    Engine* e = t->engine;
+    bool pvNode = beta - alpha > 1;
+    bool root = ply == 0;
+
+    t->pvLength[ply] = ply;
+    if(depth <= 0)
+        return qsearch(t, pos, alpha, beta, ply);
+
+    if(!root) {
+        if(isDraw(t, pos))
+            return VALUE_DRAW;
+        if(ply >= MAX_PLY - 1)
+            return evaluate(pos, t->material);
+
+        // Mate distance pruning
+        alpha = maxInt(alpha, -VALUE_MATE + ply);
+        beta = minInt(beta, VALUE_MATE - ply - 1);
+        if(alpha >= beta)
+            return alpha;
+    }
+
+    if(countNode(t))
+        return 0;
+
+    TTData tte;
+    bool ttHit = ttProbe(e->tt, pos->key, &tte);
+    Move ttMove = ttHit ? tte.move : MOVE_NONE;
+    if(ttHit && !pvNode && tte.depth >= depth) {
+        int s = scoreFromTT(tte.score, ply);
+        if(tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && s >= beta) || (tte.bound == BOUND_UPPER && s <= alpha))
+            return s;
+    }
+
+    // Tablebases, exact results are final and wins only bound the score
+    if(!root && tbLargest() && popCount(pos->all) <= tbLargest()) {
+        TBValue wdl;
+        if(tbProbeWDL(pos, &wdl)) {
+            atomic_fetch_add_explicit(&t->tbHits, 1, memory_order_relaxed);
+            int s = wdl == TB_WIN ? VALUE_TB_WIN - ply : wdl == TB_LOSS ? -VALUE_TB_WIN + ply : VALUE_DRAW;
+            Bound bound = wdl == TB_WIN ? BOUND_LOWER : wdl == TB_LOSS ? BOUND_UPPER : BOUND_EXACT;
+            if(bound == BOUND_EXACT || (bound == BOUND_LOWER && s >= beta) || (bound == BOUND_UPPER && s <= alpha)) {
+                ttStore(e->tt, pos->key, MOVE_NONE, scoreToTT(s, ply), VALUE_NONE, minInt(depth + 6, MAX_PLY - 1), bound);
+                return s;
+            }
+        }
+    }
+
+    bool inCheck = positionInCheck(pos);
+    int staticEval = VALUE_NONE;
+    if(!inCheck)
+        staticEval = ttHit && tte.eval != VALUE_NONE ? tte.eval : evaluate(pos, t->material);
+
+    if(!pvNode && !inCheck) {
+        // Reverse futility pruning
+        if(depth <= 6 && staticEval - 90 * depth >= beta && abs(beta) < VALUE_TB_WIN_BOUND)
+            return staticEval;
+
+        // Null move pruning
+        if(nullAllowed && depth >= 3 && staticEval >= beta && nonPawnMaterial(pos, pos->side)) {
+            int reduction = 3 + depth / 4;
+            Position next = *pos;
+            positionMakeNullMove(&next);
+            t->keys[t->keyCount++] = pos->key;
+            int s = -search(t, &next, -beta, -beta + 1, depth - 1 - reduction, ply + 1, false);
+            t->keyCount--;
+            if(atomic_load_explicit(&e->stop, memory_order_relaxed))
+                return 0;
+            if(s >= beta)
+                return s >= VALUE_TB_WIN_BOUND ? beta : s;
+        }
+    }
+
+    MoveList list;
+    int scores[MAX_MOVES];
+    if(root)
+        list = e->rootMoves;
+    else
+        generateMoves(pos, &list);
+    scoreMoves(t, pos, &list, scores, root && t->rootHint ? t->rootHint : ttMove, ply);
+
+    Move quiets[64];
+    int quietCount = 0;
+    int legal = 0;
+    int bestScore = -VALUE_INFINITE;
+    Move bestMove = MOVE_NONE;
+    Bound bound = BOUND_UPPER;
+
+    for(int i = 0; i < list.count; i++) {
+        Move m = pickMove(&list, scores, i);
+        if(root && isExcluded(t, m))
+            continue;
+        bool quiet = !isCapture(pos, m) && moveFlag(m) != MOVE_PROMOTION;
+
+        if(!root && !pvNode && !inCheck && quiet && legal && bestScore > -VALUE_TB_WIN_BOUND) {
+            // Late move pruning
+            if(depth <= 4 && quietCount >= 3 + 2 * depth * depth)
+                continue;
+            // Futility pruning
+            if(depth <= 3 && staticEval + 100 + 100 * depth <= alpha)
+                continue;
+        }
+
+        Position next = *pos;
+        if(!positionMakeMove(&next, m))
+            continue;
+        legal++;
+        if(quiet && quietCount < 64)
+            quiets[quietCount++] = m;
+        ttPrefetch(e->tt, next.key);
+
+        bool givesCheck = positionInCheck(&next);
+        int newDepth = depth - 1 + givesCheck;
+        int s;
+
+        t->keys[t->keyCount++] = pos->key;
+        if(legal == 1) {
+            s = -search(t, &next, -beta, -alpha, newDepth, ply + 1, true);
+        } else {
+            int reduction = 0;
+            if(depth >= 3 && quiet && !inCheck && !givesCheck) {
+                reduction = LMR[minInt(depth, 63)][minInt(legal, 63)];
+                reduction -= pvNode;
+                reduction -= m == t->killers[ply][0] || m == t->killers[ply][1];
+                reduction = maxInt(0, minInt(reduction, newDepth - 1));
+            }
+
+            s = -search(t, &next, -alpha - 1, -alpha, newDepth - reduction, ply + 1, true);
+            if(s > alpha && reduction)
+                s = -search(t, &next, -alpha - 1, -alpha, newDepth, ply + 1, true);
+            if(s > alpha && s < beta)
+                s = -search(t, &next, -beta, -alpha, newDepth, ply + 1, true);
+        }
+        t->keyCount--;
+
+        if(atomic_load_explicit(&e->stop, memory_order_relaxed))
+            return 0;
+
+        if(s > bestScore) {
+            bestScore = s;
+            if(s > alpha) {
+                alpha = s;
+                bestMove = m;
+                bound = BOUND_EXACT;
+
+                t->pv[ply][ply] = m;
+                for(int j = ply + 1; j < t->pvLength[ply + 1]; j++)
+                    t->pv[ply][j] = t->pv[ply + 1][j];
+                t->pvLength[ply] = maxInt(t->pvLength[ply + 1], ply + 1);
+
+                if(s >= beta) {
+                    bound = BOUND_LOWER;
+                    if(quiet) {
+                        if(t->killers[ply][0] != m) {
+                            t->killers[ply][1] = t->killers[ply][0];
+                            t->killers[ply][0] = m;
+                        }
+                        int bonus = minInt(depth * depth, 400);
+                        for(int j = 0; j < quietCount; j++) {
+                            int* h = &t->history[pos->side][moveFrom(quiets[j])][moveTo(quiets[j])];
+                            updateHistory(h, quiets[j] == m ? bonus : -bonus);
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    if(!legal)
+        return inCheck ? -VALUE_MATE + ply : VALUE_DRAW;
+
+    if(!pvNode && bound == BOUND_EXACT)
+        bound = BOUND_LOWER;
+    // without its best moves the root's score isn't the position's
+    if(!(root && t->excludedCount))
+        ttStore(e->tt, pos->key, bestMove, scoreToTT(bestScore, ply), staticEval, depth, bound);
+
+    return bestScore;
+}
+
+static void report(SearchThread* t, int depth, int line) {
+    Engine* e = t->engine;
+    if(!e->onReport)
+        return;
+
+    SearchReport r;
+    r.depth = depth;
+    r.selDepth = t->selDepth;
+    r.multiPv = line + 1;
+    r.score = t->lines[line].score;
+    r.nodes = engineNodes(e);
+    r.time = getTimeMs() - e->startTime;
+    r.nps = r.time > 0 ? r.nodes * 1000 / r.time : r.nodes;
+    r.tbHits = engineTbHits(e);
+    r.hashfull = ttHashfull(e->tt);
+    r.pvLength = t->lines[line].pvLength;
+    memcpy(r.pv, t->lines[line].pv, sizeof(Move) * r.pvLength);
+
+    e->onReport(&r, e->user);
+}
+
+// Aspiration windows around the line's score of the last depth, false once stopped
+static bool searchLine(SearchThread* t, int depth, int previous, SearchLine* out) {
+    Engine* e = t->engine;
+    int delta = 25;
+    int alpha = -VALUE_INFINITE, beta = VALUE_INFINITE;
+    if(depth >= 5) {
+        alpha = maxInt(previous - delta, -VALUE_INFINITE);
+        beta = minInt(previous + delta, VALUE_INFINITE);
+    }
+
+    while(true) {
+        int s = search(t, &t->root, alpha, beta, depth, 0, false);
+        if(atomic_load_explicit(&e->stop, memory_order_relaxed))
+            return false;
+        if(s <= alpha) {
+            beta = (alpha + beta) / 2;
+            alpha = maxInt(s - delta, -VALUE_INFINITE);
+        } else if(s >= beta) {
+            beta = minInt(s + delta, VALUE_INFINITE);
+        } else {
+            out->score = s;
+            out->pvLength = t->pvLength[0];
+            memcpy(out->pv, t->pv[0], sizeof(Move) * out->pvLength);
+            return true;
+        }
+        delta += delta / 2;
+    }
+}
+
+static void iterativeDeepening(SearchThread* t) {
+    Engine* e = t->engine;
+    int maxDepth = e->limits.depth ? minInt(e->limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+    // the lines share the iteration and the table, each one skips the moves of the lines above it
+    int lineCount = t->id == 0 ? maxInt(1, minInt(minInt(e->limits.multiPv, MAX_MULTI_PV), e->rootMoves.count)) : 1;
+    SearchLine lines[MAX_MULTI_PV];
+
+    for(int depth = 1; depth <= maxDepth; depth++) {
+        // Helpers search every other depth ahead of the main thread to spread out
+        if(t->id > 0 && depth > 1 && depth < maxDepth && (depth + t->id) % 2 == 0)
+            continue;
+
+        t->selDepth = 0;
+        t->excludedCount = 0;
+        int line = 0;
+        for(; line < lineCount; line++) {
+            t->rootHint = line < t->lineCount ? t->lines[line].pv[0] : MOVE_NONE;
+            int previous = line < t->lineCount ? t->lines[line].score : 0;
+            if(!searchLine(t, depth, previous, &lines[line]) || !lines[line].pvLength)
+                break;
+            t->excluded[t->excludedCount++] = lines[line].pv[0];
+        }
+        t->excludedCount = 0;
+
+        if(atomic_load_explicit(&e->stop, memory_order_relaxed))
+            break;
+
+        // a later line can come out above an earlier one whose window failed low
+        for(int i = 1; i < line; i++) {
+            SearchLine moved = lines[i];
+            int j = i;
+            for(; j > 0 && lines[j - 1].score < moved.score; j--)
+                lines[j] = lines[j - 1];
+            lines[j] = moved;
+        }
+        memcpy(t->lines, lines, sizeof(SearchLine) * line);
+        t->lineCount = line;
+
+        t->completedDepth = depth;
+        t->bestScore = t->lines[0].score;
+        t->bestMove = t->lines[0].pv[0];
+        t->ponderMove = t->lines[0].pvLength > 1 ? t->lines[0].pv[1] : MOVE_NONE;
+
+        if(t->id == 0) {
+            for(int i = 0; i < t->lineCount; i++)
+                report(t, depth, i);
+            if(atomic_load_explicit(&e->pondering, memory_order_acquire))
+                continue;
+            // the next iteration wouldn't finish in time
+            if(e->optimumTime && getTimeMs() - atomic_load_explicit(&e->limitStart, memory_order_relaxed) >= e->optimumTime * 6 / 10)
+                break;
+            // a single legal move needs no thinking
+            if(e->rootMoves.count == 1 && (e->optimumTime || e->maximumTime) && depth >= 4)
+                break;
+        }
+    }
+}
+
+static void* helperMain(void* arg) {
+    iterativeDeepening((SearchThread*)arg);
+    return null;
+}
+
+static void* searchMain(void* arg) {
+    Engine* e = (Engine*)arg;
+
+    // probes every root move and may map table files, the caller doesn't wait for it
+    e->tbRoot = tbLargest() && tbRootFilter(&e->root, &e->rootMoves, &e->tbRootValue, &e->tbRootDtm);
+
+    if(e->tt == &e->ownTt)
+        ttNewSearch(e->tt);
+    for(int i = 0; i < e->threadCount; i++) {
+        SearchThread* t = &e->threads[i];
+        t->root = e->root;
+        memcpy(t->keys, e->history, sizeof(uint64_t) * e->historyCount);
+        t->keyCount = e->historyCount;
+        atomic_store(&t->nodes, 0);
+        atomic_store(&t->tbHits, 0);
+        t->completedDepth = 0;
+        t->lineCount = 0;
+        t->excludedCount = 0;
+        t->rootHint = MOVE_NONE;
+        t->bestMove = t->ponderMove = MOVE_NONE;
+        t->bestScore = -VALUE_INFINITE;
+        memset(t->killers, 0, sizeof(t->killers));
+        memset(t->pvLength, 0, sizeof(t->pvLength));
+    }
+
+    Move best = MOVE_NONE, ponder = MOVE_NONE;
+    if(e->rootMoves.count) {
+        for(int i = 1; i < e->threadCount; i++)
+            pthread_create(&e->threads[i].handle, null, helperMain, &e->threads[i]);
+
+        iterativeDeepening(&e->threads[0]);
+
+        // UCI wants the best move only once told to stop, or after the ponder hit
+        while((e->limits.infinite || atomic_load(&e->pondering)) && !atomic_load(&e->stop))
+            sleepMs(1);
+        atomic_store(&e->stop, true);
+
+        for(int i = 1; i < e->threadCount; i++)
+            pthread_join(e->threads[i].handle, null);
+
+        best = e->threads[0].bestMove ? e->threads[0].bestMove : e->rootMoves.moves[0];
+        ponder = e->threads[0].bestMove ? e->threads[0].ponderMove : MOVE_NONE;
+    }
+
+    if(e->onDone)
+        e->onDone(best, ponder, e->user);
+
+    return null;
+}
+
+static void allocateThreads(Engine* engine, int threads) {
+    for(int i = 0; i < engine->threadCount; i++)
+        free(engine->threads[i].material);
+    free(engine->threads);
+
+    engine->threadCount = maxInt(1, minInt(threads, MAX_THREADS));
+    engine->threads = calloc(engine->threadCount, sizeof(SearchThread));
+    ASSERT(engine->threads != null, "Failed to allocate the search threads!\n");
+
+    for(int i = 0; i < engine->threadCount; i++) {
+        engine->threads[i].engine = engine;
+        engine->threads[i].id = i;
+        engine->threads[i].material = malloc(sizeof(MaterialTable));
+        ASSERT(engine->threads[i].material != null, "Failed to allocate a material table!\n");
+        initMaterialTable(engine->threads[i].material);
+    }
+}
+
+void initEngine(Engine* engine, size_t hashMb, int threads) {
+    ASSERT(engine != null, "The engine ptr provided shouldn't be null!\n");
+
+    for(int d = 1; d < 64; d++) {
+        for(int m = 1; m < 64; m++)
+            LMR[d][m] = (int)(0.5 + log(d) * log(m) / 2.0);
+    }
+
+    memset(engine, 0, sizeof(Engine));
+    engine->tt = &engine->ownTt;
+    ttInit(engine->tt, hashMb);
+    allocateThreads(engine, threads);
+}
+
+void destroyEngine(Engine* engine) {
+    ASSERT(engine != null, "The engine ptr provided shouldn't be null!\n");
+
+    engineStop(engine);
+    engineWait(engine);
+
+    for(int i = 0; i < engine->threadCount; i++)
+        free(engine->threads[i].material);
+    free(engine->threads);
+    ttFree(&engine->ownTt);
+    memset(engine, 0, sizeof(Engine));
+}
+
+void engineSetHash(Engine* engine, size_t hashMb) {
+    engineWait(engine);
+    ttFree(&engine->ownTt);
+    ttInit(&engine->ownTt, hashMb);
+    engine->tt = &engine->ownTt;
+}
+
+bool engineSetHashFile(Engine* engine, const char* path, size_t hashMb) {
+    engineWait(engine);
+    ttFree(&engine->ownTt);
+    engine->tt = &engine->ownTt;
+    if(ttInitFile(engine->tt, path, hashMb))
+        return true;
+    ttInit(engine->tt, hashMb);
+    return false;
+}
+
+void engineShareTable(Engine* engine, TranspositionTable* tt) {
+    engineWait(engine);
+    ttFree(&engine->ownTt);
+    engine->tt = tt;
+}
+
+void engineSetThreads(Engine* engine, int threads) {
+    engineWait(engine);
+    allocateThreads(engine, threads);
+}
+
+void engineClear(Engine* engine) {
+    engineWait(engine);
+    ttClear(engine->tt);
+    for(int i = 0; i < engine->threadCount; i++) {
+        memset(engine->threads[i].history, 0, sizeof(engine->threads[i].history));
+        initMaterialTable(engine->threads[i].material);
+    }
+}
+
+static void setupTime(Engine* e) {
+    const SearchLimits* l = &e->limits;
+    PieceTeam us = e->root.side;
+
+    e->optimumTime = e->maximumTime = 0;
+    if(l->infinite)
+        return;
+
+    if(l->moveTime) {
+        e->maximumTime = l->moveTime > 10 ? l->moveTime - 10 : 1;
+        return;
+    }
+
+    if(l->time[us]) {
+        int64_t time = l->time[us];
+        int movesToGo = l->movesToGo ? minInt(l->movesToGo, 40) : 30;
+        int64_t reserve = time > 1000 ? 50 : time / 20;
+
+        e->optimumTime = time / movesToGo + l->inc[us] * 3 / 4;
+        e->maximumTime = e->optimumTime * 4;
+        if(e->maximumTime > time / 3 + l->inc[us])
+            e->maximumTime = time / 3 + l->inc[us];
+        if(e->maximumTime > time - reserve)
+            e->maximumTime = time - reserve;
+        if(e->maximumTime < 1)
+            e->maximumTime = 1;
+        if(e->optimumTime > e->maximumTime)
+            e->optimumTime = e->maximumTime;
+    }
+}
+
+void engineStart(Engine* engine, const Position* pos, const uint64_t* history, int historyCount,
+                 const SearchLimits* limits, SearchReportFn onReport, SearchDoneFn onDone, void* user) {
+    ASSERT(engine != null, "The engine ptr provided shouldn't be null!\n");
+    ASSERT(pos != null, "The position ptr provided shouldn't be null!\n");
+
+    engineStop(engine);
+    engineWait(engine);
+
+    engine->startTime = getTimeMs();
+    atomic_store(&engine->limitStart, engine->startTime);
+    atomic_store(&engine->pondering, limits->ponder);
+    engine->root = *pos;
+    if(historyCount > MAX_GAME_PLY) {
+        history += historyCount - MAX_GAME_PLY;
+        historyCount = MAX_GAME_PLY;
+    }
+    if(historyCount)
+        memcpy(engine->history, history, sizeof(uint64_t) * historyCount);
+    engine->historyCount = historyCount;
+    engine->limits = *limits;
+    engine->onReport = onReport;
+    engine->onDone = onDone;
+    engine->user = user;
+    atomic_store(&engine->stop, false);
+
+    generateLegalMoves(pos, &engine->rootMoves);
+
+    setupTime(engine);
+
+    engine->running = true;
+    pthread_create(&engine->mainThread, null, searchMain, engine);
+}
+
+void engineStop(Engine* engine) {
+    atomic_store(&engine->stop, true);
+}
+
+void enginePonderHit(Engine* engine) {
+    atomic_store_explicit(&engine->limitStart, getTimeMs(), memory_order_relaxed);
+    atomic_store_explicit(&engine->pondering, false, memory_order_release);
+}
+
+void engineWait(Engine* engine) {
+    if(!engine->running)
+        return;
+    pthread_join(engine->mainThread, null);
+    engine->running = false;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "position.h"
+#include "eval.h"
+#include "material.h"
+#include "tt.h"
+#include "tb.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MAX_PLY 128
+#define MAX_THREADS 256
+// Longest game the repetition history can hold
+#define MAX_GAME_PLY 2048
+#define MAX_MULTI_PV 16
+
+// Tablebase wins are VALUE_TB_WIN - plies, below any mate score
+#define VALUE_TB_WIN (VALUE_MATE_BOUND - MAX_PLY - 1)
+#define VALUE_TB_WIN_BOUND (VALUE_TB_WIN - MAX_PLY)
+
+typedef struct {
+    int depth;          // 0 means no limit
+    uint64_t nodes;     // 0 means no limit
+    int64_t moveTime;   // ms, 0 means none
+    int64_t time[TEAMS];
+    int64_t inc[TEAMS];
+    int movesToGo;
+    bool infinite;
+    int multiPv;        // lines reported per depth, 0 means 1
+    // searches without stopping until enginePonderHit, the limits count from then on
+    bool ponder;
+} SearchLimits;
+
+typedef struct {
+    int depth;
+    int selDepth;
+    int multiPv;        // 1 for the best line
+    int score;
+    uint64_t nodes;
+    uint64_t nps;
+    int64_t time;
+    uint64_t tbHits;
+    int hashfull;
+    Move pv[MAX_PLY];
+    int pvLength;
+} SearchReport;
+
+// Both are called from a search thread
+typedef void (*SearchReportFn)(const SearchReport* report, void* user);
+typedef void (*SearchDoneFn)(Move best, Move ponder, void* user);
+
+typedef struct Engine Engine;
+
+typedef struct {
+    int score;
+    Move pv[MAX_PLY];
+    int pvLength;
+} SearchLine;
+
+typedef struct {
+    Engine* engine;
+    int id;
+    pthread_t handle;
+
+    Position root;
+    uint64_t keys[MAX_GAME_PLY + MAX_PLY];
+    int keyCount;
+
+    MaterialTable* material;
+    Move killers[MAX_PLY][2];
+    int history[TEAMS][SQUARES][SQUARES];
+    Move pv[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+
+    _Atomic uint64_t nodes;
+    _Atomic uint64_t tbHits;
+    int selDepth;
+    int completedDepth;
+    // best first, only the main thread searches more than one line
+    SearchLine lines[MAX_MULTI_PV];
+    int lineCount;
+    // the root skips the moves of the lines found before this one at the current depth
+    Move excluded[MAX_MULTI_PV];
+    int excludedCount;
+    Move rootHint; // tried first at the root, the line's move of the last depth
+    int bestScore;
+    Move bestMove;
+    Move ponderMove;
+} SearchThread;
+
+struct Engine {
+    TranspositionTable* tt; // ownTt unless it was shared with engineShareTable
+    TranspositionTable ownTt;
+    SearchThread* threads;
+    int threadCount;
+
+    pthread_t mainThread;
+    bool running;
+    atomic_bool stop;
+
+    Position root;
+    uint64_t history[MAX_GAME_PLY];
+    int historyCount;
+    MoveList rootMoves;
+    // set by the search thread before the first report
+    bool tbRoot;
+    TBValue tbRootValue;
+    int tbRootDtm;
+
+    SearchLimits limits;
+    int64_t startTime;
+    _Atomic int64_t limitStart; // the ponder hit when pondering
+    atomic_bool pondering;
+    int64_t optimumTime;
+    int64_t maximumTime;
+
+    SearchReportFn onReport;
+    SearchDoneFn onDone;
+    void* user;
+};
+
+// Also sets up every table the search needs, safe to call more than once
+void initEngine(Engine* engine, size_t hashMb, int threads);
+void destroyEngine(Engine* engine);
+// Goes back to a table of its own
+void engineSetHash(Engine* engine, size_t hashMb);
+// Goes over to a table kept in a file, see ttInitFile, false leaves it with a table in memory
+bool engineSetHashFile(Engine* engine, const char* path, size_t hashMb);
+// Searches with 'tt' instead of its own table, the owner ages it with ttNewSearch
+void engineShareTable(Engine* engine, TranspositionTable* tt);
+void engineSetThreads(Engine* engine, int threads);
+// Forgets everything learned, for a new game
+void engineClear(Engine* engine);
+
+// Starts searching in the background, 'history' holds the keys of the positions
+// before 'pos' in the game for repetition detection
+void engineStart(Engine* engine, const Position* pos, const uint64_t* history, int historyCount,
+                 const SearchLimits* limits, SearchReportFn onReport, SearchDoneFn onDone, void* user);
+void engineStop(Engine* engine);
+// The move pondered on was played, the search goes on under its limits
+void enginePonderHit(Engine* engine);
+// Blocks until the running search finished and onDone was called
+void engineWait(Engine* engine);
+uint64_t engineNodes(const Engine* engine);
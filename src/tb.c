@@ -0,0 +1,532 @@
+#include "tb.h"
+#include "platform.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define TB_HASH_SIZE 16384
+#define TB_MAX_TABLES 8192
+
+typedef struct {
+    TBSignature sig;
+    char path[512];
+    MappedFile map;
+    _Atomic int state; // 0 unmapped, 1 mapped, -1 unusable
+    pthread_mutex_t lock;
+    uint8_t metric;
+    uint32_t blockCount;
+    uint64_t tableOffsets[TB_TABLE_COUNT];
+} TBTable;
+
+typedef struct {
+    uint64_t key;
+    TBTable* table;
+    bool flipped;
+} TBHashEntry;
+
+static TBTable* tables = null;
+static int tableCount = 0;
+static int largest = 0;
+static TBHashEntry hashEntries[TB_HASH_SIZE];
+
+// White king squares of the a1-d1-d4 triangle used for pawnless tables
+static const int TRIANGLE_SQUARES[10] = { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+static const int TRIANGLE_INDEX[SQUARES] = {
+     0,  1,  2,  3, -1, -1, -1, -1,
+    -1,  4,  5,  6, -1, -1, -1, -1,
+    -1, -1,  7,  8, -1, -1, -1, -1,
+    -1, -1, -1,  9, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static const char* PIECE_LETTERS = "PRNBQK";
+// Canonical order of the pieces in a signature name
+static const PieceType NAME_ORDER[5] = { QUEEN, ROOK, BISHOP, KNIGHT, PAWN };
+static const int STRENGTH[PIECE_TYPES] = { 1, 5, 3, 3, 9, 0 };
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t readU64(const uint8_t* p) {
+    return (uint64_t)readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+static int parseSide(const char* s, int len, int counts[PIECE_TYPES]) {
+    memset(counts, 0, sizeof(int) * PIECE_TYPES);
+    if(len < 1 || s[0] != 'K')
+        return -1;
+    for(int i = 1; i < len; i++) {
+        const char* letter = strchr(PIECE_LETTERS, s[i]);
+        if(!letter || s[i] == 'K')
+            return -1;
+        counts[letter - PIECE_LETTERS]++;
+    }
+    return len;
+}
+
+// Orders the sides by material, then piece count, then piece by piece in name order
+static int compareSides(const int a[PIECE_TYPES], const int b[PIECE_TYPES]) {
+    int strengthA = 0, strengthB = 0, piecesA = 0, piecesB = 0;
+    for(int type = 0; type < PIECE_TYPES; type++) {
+        strengthA += a[type] * STRENGTH[type];
+        strengthB += b[type] * STRENGTH[type];
+        piecesA += a[type];
+        piecesB += b[type];
+    }
+    if(strengthA != strengthB)
+        return strengthA - strengthB;
+    if(piecesA != piecesB)
+        return piecesA - piecesB;
+    for(int i = 0; i < 5; i++) {
+        if(a[NAME_ORDER[i]] != b[NAME_ORDER[i]])
+            return a[NAME_ORDER[i]] - b[NAME_ORDER[i]];
+    }
+    return 0;
+}
+
+bool tbParseSignature(const char* name, TBSignature* sig) {
+    ASSERT(name != null, "The name shouldn't be null!\n");
+    ASSERT(sig != null, "The sig ptr provided shouldn't be null!\n");
+
+    const char* v = strchr(name, 'v');
+    if(!v)
+        return false;
+
+    int counts[TEAMS][PIECE_TYPES];
+    if(parseSide(name, (int)(v - name), counts[0]) < 0 || parseSide(v + 1, (int)strlen(v + 1), counts[1]) < 0)
+        return false;
+
+    int strong = compareSides(counts[1], counts[0]) > 0 ? 1 : 0;
+
+    memset(sig, 0, sizeof(TBSignature));
+    sig->pieces[sig->count++] = makePiece(TEAM_WHITE, KING);
+    sig->pieces[sig->count++] = makePiece(TEAM_BLACK, KING);
+    for(int team = 0; team < TEAMS; team++) {
+        const int* c = counts[team == TEAM_WHITE ? strong : !strong];
+        for(int i = 0; i < 5; i++) {
+            for(int n = 0; n < c[NAME_ORDER[i]]; n++) {
+                if(sig->count >= TB_MAX_PIECES)
+                    return false;
+                sig->pieces[sig->count++] = makePiece((PieceTeam)team, NAME_ORDER[i]);
+                if(NAME_ORDER[i] == PAWN)
+                    sig->hasPawns = true;
+            }
+        }
+    }
+
+    sig->positions = sig->hasPawns ? 32 : 10;
+    for(int i = 1; i < sig->count; i++)
+        sig->positions *= 64;
+
+    return true;
+}
+
+void tbSignatureName(const TBSignature* sig, char* out) {
+    int n = 0;
+
+    for(int team = 0; team < TEAMS; team++) {
+        if(team == TEAM_BLACK)
+            out[n++] = 'v';
+        out[n++] = 'K';
+        for(int i = 2; i < sig->count; i++) {
+            if((int)pieceTeam(sig->pieces[i]) == team)
+                out[n++] = PIECE_LETTERS[pieceType(sig->pieces[i])];
+        }
+    }
+    out[n] = '\0';
+}
+
+uint64_t tbSignatureMaterialKey(const TBSignature* sig, bool flipped) {
+    uint8_t counts[TEAMS][PIECE_TYPES] = {0};
+    uint64_t key = 0;
+
+    for(int i = 0; i < sig->count; i++) {
+        PieceTeam team = pieceTeam(sig->pieces[i]);
+        PieceType type = pieceType(sig->pieces[i]);
+        if(flipped)
+            team = !team;
+        key ^= ZOBRIST_MATERIAL[team][type][counts[team][type]++];
+    }
+
+    return key;
+}
+
+static inline int transpose(int sq) {
+    return makeSquare(squareRank(sq), squareFile(sq));
+}
+
+uint64_t tbIndex(const TBSignature* sig, const int* squares) {
+    int sq[TB_MAX_PIECES];
+    memcpy(sq, squares, sizeof(int) * sig->count);
+
+    if(squareFile(sq[0]) > 3) {
+        for(int i = 0; i < sig->count; i++)
+            sq[i] ^= 7;
+    }
+    if(!sig->hasPawns) {
+        if(squareRank(sq[0]) > 3) {
+            for(int i = 0; i < sig->count; i++)
+                sq[i] ^= 56;
+        }
+        if(squareRank(sq[0]) > squareFile(sq[0])) {
+            for(int i = 0; i < sig->count; i++)
+                sq[i] = transpose(sq[i]);
+        }
+    }
+
+    uint64_t index = sig->hasPawns ? (uint64_t)(squareRank(sq[0]) * 4 + squareFile(sq[0])) : (uint64_t)TRIANGLE_INDEX[sq[0]];
+    for(int i = 1; i < sig->count; i++)
+        index = index * 64 + sq[i];
+
+    return index;
+}
+
+void tbDecodeIndex(const TBSignature* sig, uint64_t index, int* squares) {
+    for(int i = sig->count - 1; i >= 1; i--) {
+        squares[i] = (int)(index & 63);
+        index >>= 6;
+    }
+    squares[0] = sig->hasPawns ? makeSquare((int)index & 3, (int)index >> 2) : TRIANGLE_SQUARES[index];
+}
+
+static size_t writeVarint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while(v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline uint64_t readVarint(const uint8_t** p) {
+    uint64_t v = 0;
+    int shift = 0;
+    while(**p & 0x80) {
+        v |= (uint64_t)(*(*p)++ & 0x7F) << shift;
+        shift += 7;
+    }
+    v |= (uint64_t)(*(*p)++) << shift;
+    return v;
+}
+
+// WDL runs: one byte with the value in the low 2 bits and run - 1 in the high 6,
+// run - 1 == 63 is followed by a varint holding run - 64.
+// DTM runs: the value byte followed by a varint holding run - 1.
+size_t tbEncodeBlock(const uint8_t* values, size_t count, bool wdl, uint8_t* out) {
+    size_t n = 0, i = 0;
+
+    while(i < count) {
+        uint8_t value = values[i];
+        size_t run = 1;
+        while(i + run < count && values[i + run] == value)
+            run++;
+        i += run;
+
+        if(wdl) {
+            if(run < 64) {
+                out[n++] = (uint8_t)(value | (run - 1) << 2);
+            } else {
+                out[n++] = (uint8_t)(value | 63 << 2);
+                n += writeVarint(out + n, run - 64);
+            }
+        } else {
+            out[n++] = value;
+            n += writeVarint(out + n, run - 1);
+        }
+    }
+
+    return n;
+}
+
+static int decodeBlock(const uint8_t* p, const uint8_t* end, uint64_t offset, bool wdl) {
+    while(p < end) {
+        int value;
+        uint64_t run;
+        if(wdl) {
+            value = *p & 3;
+            run = (*p >> 2) + 1;
+            p++;
+            if(run == 64)
+                run += readVarint(&p);
+        } else {
+            value = *p++;
+            run = readVarint(&p) + 1;
+        }
+        if(offset < run)
+            return value;
+        offset -= run;
+    }
+    return -1;
+}
+
+static bool validateTable(TBTable* table) {
+    const uint8_t* data = table->map.data;
+    size_t size = table->map.size;
+
+    if(size < TB_HEADER_SIZE || memcmp(data, "CTB1", 4) != 0)
+        return false;
+    if(data[4] != table->sig.count || memcmp(data + 6, table->sig.pieces, table->sig.count) != 0)
+        return false;
+    if(readU32(data + 12) != TB_BLOCK_SIZE || readU64(data + 24) != table->sig.positions)
+        return false;
+
+    table->metric = data[5];
+    table->blockCount = readU32(data + 16);
+    if(table->blockCount != (table->sig.positions + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE)
+        return false;
+
+    for(int i = 0; i < TB_TABLE_COUNT; i++) {
+        table->tableOffsets[i] = readU64(data + 32 + 8 * i);
+        if(table->tableOffsets[i] && table->tableOffsets[i] + 8 * ((uint64_t)table->blockCount + 1) > size)
+            return false;
+    }
+
+    return table->tableOffsets[TB_TABLE_WDL_WHITE] && table->tableOffsets[TB_TABLE_WDL_BLACK];
+}
+
+// Maps the file on first use, racing threads wait on the table's lock
+static bool ensureMapped(TBTable* table) {
+    int state = atomic_load_explicit(&table->state, memory_order_acquire);
+    if(state)
+        return state > 0;
+
+    pthread_mutex_lock(&table->lock);
+    state = atomic_load_explicit(&table->state, memory_order_relaxed);
+    if(!state) {
+        if(mapFile(&table->map, table->path) && validateTable(table)) {
+            state = 1;
+        } else {
+            ERROR("Invalid tablebase file: %s\n", table->path);
+            unmapFile(&table->map);
+            state = -1;
+        }
+        atomic_store_explicit(&table->state, state, memory_order_release);
+    }
+    pthread_mutex_unlock(&table->lock);
+
+    return state > 0;
+}
+
+static const TBHashEntry* findTable(uint64_t key) {
+    size_t i = key & (TB_HASH_SIZE - 1);
+    while(hashEntries[i].table) {
+        if(hashEntries[i].key == key)
+            return &hashEntries[i];
+        i = (i + 1) & (TB_HASH_SIZE - 1);
+    }
+    return null;
+}
+
+static void insertTable(uint64_t key, TBTable* table, bool flipped) {
+    if(findTable(key))
+        return;
+    size_t i = key & (TB_HASH_SIZE - 1);
+    while(hashEntries[i].table)
+        i = (i + 1) & (TB_HASH_SIZE - 1);
+    hashEntries[i].key = key;
+    hashEntries[i].table = table;
+    hashEntries[i].flipped = flipped;
+}
+
+static void addTableFile(const char* dir, const char* name, void* user) {
+    (void)user;
+    size_t len = strlen(name);
+    size_t extLen = strlen(TB_EXTENSION);
+    if(len <= extLen || len - extLen >= 16 || strcmp(name + len - extLen, TB_EXTENSION) != 0)
+        return;
+
+    char code[16];
+    memcpy(code, name, len - extLen);
+    code[len - extLen] = '\0';
+
+    TBSignature sig;
+    if(!tbParseSignature(code, &sig) || sig.count < 3 || tableCount >= TB_MAX_TABLES)
+        return;
+    if(findTable(tbSignatureMaterialKey(&sig, false)))
+        return;
+
+    TBTable* table = &tables[tableCount++];
+    memset(table, 0, sizeof(TBTable));
+    table->sig = sig;
+    snprintf(table->path, sizeof(table->path), "%s/%s", dir, name);
+    pthread_mutex_init(&table->lock, null);
+
+    insertTable(tbSignatureMaterialKey(&sig, false), table, false);
+    insertTable(tbSignatureMaterialKey(&sig, true), table, true);
+    if(sig.count > largest)
+        largest = sig.count;
+}
+
+int tbInit(const char* paths) {
+    tbFree();
+    if(!paths || !paths[0])
+        return 0;
+
+    tables = malloc(sizeof(TBTable) * TB_MAX_TABLES);
+    ASSERT(tables != null, "Failed to allocate the tablebase registry!\n");
+
+    const char* p = paths;
+    while(*p) {
+        const char* end = p;
+        while(*end && *end != ';')
+            end++;
+        char dir[512];
+        size_t len = (size_t)(end - p) < sizeof(dir) - 1 ? (size_t)(end - p) : sizeof(dir) - 1;
+        memcpy(dir, p, len);
+        dir[len] = '\0';
+        if(len && !listDirectory(dir, addTableFile, null))
+            ERROR("Can't open the tablebase directory: %s\n", dir);
+        p = *end ? end + 1 : end;
+    }
+
+    INFO("Found %d tablebase files, up to %d pieces\n", tableCount, largest);
+    return tableCount;
+}
+
+void tbFree(void) {
+    for(int i = 0; i < tableCount; i++) {
+        unmapFile(&tables[i].map);
+        pthread_mutex_destroy(&tables[i].lock);
+    }
+    free(tables);
+    tables = null;
+    tableCount = 0;
+    largest = 0;
+    memset(hashEntries, 0, sizeof(hashEntries));
+}
+
+int tbLargest(void) {
+    return largest;
+}
+
+// Value of the position in the table kind, -1 when it can't be probed
+static int probeTable(const Position* pos, int kind) {
+    if(pos->castling || pos->epSquare != SQUARE_NONE)
+        return -1;
+
+    const TBHashEntry* entry = findTable(pos->materialKey);
+    if(!entry || !ensureMapped(entry->table))
+        return -1;
+
+    const TBTable* table = entry->table;
+    const TBSignature* sig = &table->sig;
+    int squares[TB_MAX_PIECES];
+    Bitboard used[TEAMS][PIECE_TYPES] = {{0}};
+
+    for(int i = 0; i < sig->count; i++) {
+        PieceTeam team = pieceTeam(sig->pieces[i]);
+        PieceType type = pieceType(sig->pieces[i]);
+        PieceTeam real = entry->flipped ? !team : team;
+        Bitboard b = pos->pieces[real][type] & ~used[real][type];
+        int sq = lsb(b);
+        used[real][type] |= squareBB(sq);
+        squares[i] = entry->flipped ? flipSquare(sq) : sq;
+    }
+
+    PieceTeam side = entry->flipped ? !pos->side : pos->side;
+    uint64_t offset = table->tableOffsets[kind + side];
+    if(!offset)
+        return -1;
+
+    uint64_t index = tbIndex(sig, squares);
+    uint64_t block = index / TB_BLOCK_SIZE;
+    const uint8_t* offsets = table->map.data + offset;
+    uint64_t start = readU64(offsets + 8 * block);
+    uint64_t end = readU64(offsets + 8 * (block + 1));
+    if(start > end || end > table->map.size)
+        return -1;
+
+    return decodeBlock(table->map.data + start, table->map.data + end, index % TB_BLOCK_SIZE, kind == TB_TABLE_WDL_WHITE);
+}
+
+bool tbProbeWDL(const Position* pos, TBValue* wdl) {
+    if(pos->all == (pos->pieces[TEAM_WHITE][KING] | pos->pieces[TEAM_BLACK][KING])) {
+        *wdl = TB_DRAW;
+        return true;
+    }
+
+    int value = probeTable(pos, TB_TABLE_WDL_WHITE);
+    if(value < 0 || value == TB_INVALID)
+        return false;
+
+    *wdl = (TBValue)value;
+    return true;
+}
+
+bool tbProbeDTM(const Position* pos, TBValue* wdl, int* dtm) {
+    if(!tbProbeWDL(pos, wdl))
+        return false;
+    if(*wdl == TB_DRAW) {
+        *dtm = 0;
+        return true;
+    }
+
+    int value = probeTable(pos, TB_TABLE_DTM_WHITE);
+    if(value < 0)
+        return false;
+
+    *dtm = value;
+    return true;
+}
+
+bool tbRootFilter(const Position* pos, MoveList* moves, TBValue* wdl, int* dtm) {
+    if(popCount(pos->all) > largest)
+        return false;
+    if(!tbProbeDTM(pos, wdl, dtm)) {
+        *dtm = -1;
+        if(!tbProbeWDL(pos, wdl))
+            return false;
+    }
+
+    int scores[MAX_MOVES];
+    int best = -100000;
+    bool haveDistances = true;
+
+    for(int i = 0; i < moves->count; i++) {
+        Position next = *pos;
+        positionMakeMove(&next, moves->moves[i]);
+
+        MoveList replies;
+        generateLegalMoves(&next, &replies);
+
+        TBValue childWdl;
+        int childDtm = 0;
+        if(replies.count == 0) {
+            childWdl = positionInCheck(&next) ? TB_LOSS : TB_DRAW;
+        } else if(!tbProbeDTM(&next, &childWdl, &childDtm)) {
+            haveDistances = false;
+            if(!tbProbeWDL(&next, &childWdl))
+                return false;
+        }
+
+        // The child's result is from the opponent's point of view. The distances ignore the
+        // 50-move rule, a win only counts as fast once the mate comes before the counter runs out
+        if(childWdl == TB_LOSS && childDtm < TB_DTM_MAX && next.halfmoves + childDtm <= 100)
+            scores[i] = 1000 - childDtm;
+        else if(childWdl == TB_LOSS)
+            scores[i] = 500;
+        else if(childWdl == TB_WIN)
+            scores[i] = -1000 + childDtm;
+        else
+            scores[i] = 0;
+        if(scores[i] > best)
+            best = scores[i];
+    }
+
+    int kept = 0;
+    for(int i = 0; i < moves->count; i++) {
+        bool keep = haveDistances ? scores[i] == best
+                  : (scores[i] > 0) == (best > 0) && (scores[i] < 0) == (best < 0);
+        if(keep)
+            moves->moves[kept++] = moves->moves[i];
+    }
+    moves->count = kept;
+
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "position.h"
+
+// Endgame tables in the project's own .ctb format below, written by tools/tbgen: WDL and DTM
+// for up to 5 pieces. Syzygy (.rtbw/.rtbz) and other formats aren't read, --tb only picks up
+// .ctb files
+
+#define TB_MAX_PIECES 5
+#define TB_EXTENSION ".ctb"
+
+// Positions per compressed block
+#define TB_BLOCK_SIZE 1024
+
+// Values stored in the WDL tables, relative to the side to move
+typedef enum {
+    TB_DRAW = 0,
+    TB_WIN = 1,
+    TB_LOSS = 2,
+    TB_INVALID = 3
+} TBValue;
+
+typedef enum {
+    TB_METRIC_NONE = 0,
+    // plies to mate without the 50-move rule, TB_DTM_MAX stands for that many or more
+    TB_METRIC_DTM = 1
+} TBMetric;
+
+#define TB_DTM_MAX 254
+
+typedef enum {
+    TB_TABLE_WDL_WHITE,
+    TB_TABLE_WDL_BLACK,
+    TB_TABLE_DTM_WHITE,
+    TB_TABLE_DTM_BLACK,
+    TB_TABLE_COUNT
+} TBTableKind;
+
+// A material signature such as KRPvKR, the stronger side is always stored as white
+typedef struct {
+    int count;
+    // makePiece codes, white king, black king, then the other white and black pieces
+    uint8_t pieces[TB_MAX_PIECES];
+    bool hasPawns;
+    // per side to move
+    uint64_t positions;
+} TBSignature;
+
+/*
+ * File layout, little endian:
+ *   0  char[4]  magic "CTB1"
+ *   4  uint8    piece count
+ *   5  uint8    metric
+ *   6  uint8[6] piece codes, the ones past the count are 0
+ *   12 uint32   positions per block
+ *   16 uint32   block count
+ *   20 uint32   reserved
+ *   24 uint64   positions per side to move
+ *   32 uint64[4] table offsets by TBTableKind, 0 if absent
+ * Every table starts with blockCount + 1 absolute uint64 block offsets
+ * followed by the run length encoded blocks, see tbEncodeBlock.
+ */
+#define TB_HEADER_SIZE 64
+
+bool tbParseSignature(const char* name, TBSignature* sig);
+// @note Make sure the 'out' is at least 16 chars long
+void tbSignatureName(const TBSignature* sig, char* out);
+// Material key of positions matching the signature, with colours swapped when flipped
+uint64_t tbSignatureMaterialKey(const TBSignature* sig, bool flipped);
+
+// Index of a placement given in signature order, the symmetry reduction is applied here
+uint64_t tbIndex(const TBSignature* sig, const int* squares);
+void tbDecodeIndex(const TBSignature* sig, uint64_t index, int* squares);
+
+// Run length encodes the values of one block into 'out', returns the byte count
+// @note Make sure 'out' holds at least 3 * count bytes
+size_t tbEncodeBlock(const uint8_t* values, size_t count, bool wdl, uint8_t* out);
+
+// Semicolon separated list of directories, returns the number of tables found
+// @note Not thread safe, no search may be running
+int tbInit(const char* paths);
+void tbFree(void);
+int tbLargest(void);
+
+// Thread safe, the files are mapped lazily on first use
+// Fails (false) with castling rights, en passant or a missing table
+bool tbProbeWDL(const Position* pos, TBValue* wdl);
+bool tbProbeDTM(const Position* pos, TBValue* wdl, int* dtm);
+
+// Keeps only the root moves preserving the tablebase result. With distances a win keeps the
+// fastest mates the 50-move rule can't stop, or every winning move when there is none, a loss
+// keeps the slowest. 'dtm' gets the root's distance, -1 without one
+bool tbRootFilter(const Position* pos, MoveList* moves, TBValue* wdl, int* dtm);
@@ -0,0 +1,190 @@
+#include "tt.h"
+
+#include <string.h>
+
+#define GENERATION_MASK 63
+#define FILE_MAGIC 0x3154544353534843ull // "CHSSCTT1"
+
+// Precedes the clusters in a table file, the size keeps them on cache lines
+typedef struct {
+    uint64_t magic;
+    uint64_t clusterCount;
+    uint8_t generation;
+    uint8_t padding[47];
+} FileHeader;
+
+static inline uint64_t packData(Move move, int score, int eval, int depth, Bound bound, uint8_t generation) {
+    return (uint64_t)move
+         | (uint64_t)(uint16_t)score << 16
+         | (uint64_t)(uint16_t)eval << 32
+         | (uint64_t)(uint8_t)depth << 48
+         | (uint64_t)bound << 56
+         | (uint64_t)(generation & GENERATION_MASK) << 58;
+}
+
+static inline void unpackData(uint64_t data, TTData* out) {
+    out->move = (Move)data;
+    out->score = (int16_t)(data >> 16);
+    out->eval = (int16_t)(data >> 32);
+    out->depth = (int8_t)(data >> 48);
+    out->bound = (Bound)((data >> 56) & 3);
+}
+
+static inline uint8_t dataGeneration(uint64_t data) {
+    return (uint8_t)(data >> 58);
+}
+
+static inline int dataDepth(uint64_t data) {
+    return (int8_t)(data >> 48);
+}
+
+void ttInit(TranspositionTable* tt, size_t megabytes) {
+    ASSERT(tt != null, "The tt ptr provided shouldn't be null!\n");
+
+    memset(tt, 0, sizeof(TranspositionTable));
+    size_t bytes = (megabytes ? megabytes : 1) * 1024 * 1024;
+    size_t clusterBytes = sizeof(TTEntry) * TT_CLUSTER_SIZE;
+
+    tt->clusterCount = bytes / clusterBytes;
+    // one cluster per cache line
+    tt->memory = malloc(tt->clusterCount * clusterBytes + 63);
+    ASSERT(tt->memory != null, "Failed to allocate %zu MB for the transposition table!\n", megabytes);
+    tt->entries = (TTEntry*)(((uintptr_t)tt->memory + 63) & ~(uintptr_t)63);
+    tt->generation = 0;
+
+    ttClear(tt);
+}
+
+// Entries are checked against their keys, one torn by a crash is just never found
+bool ttInitFile(TranspositionTable* tt, const char* path, size_t megabytes) {
+    ASSERT(tt != null, "The tt ptr provided shouldn't be null!\n");
+
+    memset(tt, 0, sizeof(TranspositionTable));
+    size_t clusterBytes = sizeof(TTEntry) * TT_CLUSTER_SIZE;
+    size_t clusterCount = (megabytes ? megabytes : 1) * 1024 * 1024 / clusterBytes;
+
+    bool wasEmpty;
+    if(!mapFileWritable(&tt->file, path, sizeof(FileHeader) + clusterCount * clusterBytes, &wasEmpty))
+        return false;
+
+    FileHeader* header = (FileHeader*)tt->file.data;
+    tt->entries = (TTEntry*)(tt->file.data + sizeof(FileHeader));
+    tt->clusterCount = clusterCount;
+
+    if(wasEmpty || header->magic != FILE_MAGIC || header->clusterCount != clusterCount) {
+        // a new file reads as zeros already, writing them would only dirty every page. One of
+        // another size or format still has its old bytes
+        if(!wasEmpty)
+            ttClear(tt);
+        header->magic = FILE_MAGIC;
+        header->clusterCount = clusterCount;
+        header->generation = 0;
+    }
+    tt->generation = header->generation & GENERATION_MASK;
+    return true;
+}
+
+static void* flusherMain(void* arg) {
+    TranspositionTable* tt = (TranspositionTable*)arg;
+    flushMapping(&tt->file);
+    atomic_store(&tt->flushing, false);
+    return null;
+}
+
+void ttSnapshot(TranspositionTable* tt) {
+    if(!tt->file.data || atomic_exchange(&tt->flushing, true))
+        return;
+    if(tt->flusherStarted)
+        pthread_join(tt->flusher, null);
+
+    ((FileHeader*)tt->file.data)->generation = tt->generation;
+    tt->flusherStarted = pthread_create(&tt->flusher, null, flusherMain, tt) == 0;
+    if(!tt->flusherStarted)
+        atomic_store(&tt->flushing, false);
+}
+
+void ttFree(TranspositionTable* tt) {
+    ASSERT(tt != null, "The tt ptr provided shouldn't be null!\n");
+
+    if(tt->flusherStarted)
+        pthread_join(tt->flusher, null);
+    if(tt->file.data) {
+        ((FileHeader*)tt->file.data)->generation = tt->generation;
+        flushMapping(&tt->file);
+        unmapWritable(&tt->file);
+    }
+    free(tt->memory);
+    memset(tt, 0, sizeof(TranspositionTable));
+}
+
+void ttClear(TranspositionTable* tt) {
+    memset(tt->entries, 0, tt->clusterCount * TT_CLUSTER_SIZE * sizeof(TTEntry));
+    tt->generation = 0;
+}
+
+void ttNewSearch(TranspositionTable* tt) {
+    tt->generation = (tt->generation + 1) & GENERATION_MASK;
+}
+
+bool ttProbe(const TranspositionTable* tt, uint64_t key, TTData* out) {
+    TTEntry* cluster = ttCluster(tt, key);
+
+    for(int i = 0; i < TT_CLUSTER_SIZE; i++) {
+        uint64_t data = atomic_load_explicit(&cluster[i].data, memory_order_relaxed);
+        uint64_t stored = atomic_load_explicit(&cluster[i].key, memory_order_relaxed);
+        if((stored ^ data) == key && data) {
+            unpackData(data, out);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ttStore(TranspositionTable* tt, uint64_t key, Move move, int score, int eval, int depth, Bound bound) {
+    TTEntry* cluster = ttCluster(tt, key);
+    TTEntry* replace = &cluster[0];
+    int replaceWorth = 1 << 30;
+
+    for(int i = 0; i < TT_CLUSTER_SIZE; i++) {
+        uint64_t data = atomic_load_explicit(&cluster[i].data, memory_order_relaxed);
+        uint64_t stored = atomic_load_explicit(&cluster[i].key, memory_order_relaxed);
+
+        if(!data || (stored ^ data) == key) {
+            // keep the deeper result of the same position unless this one is exact
+            if(data && bound != BOUND_EXACT && depth + 3 < dataDepth(data)
+                && dataGeneration(data) == tt->generation)
+                return;
+            if(!move && data)
+                move = (Move)data;
+            replace = &cluster[i];
+            break;
+        }
+
+        int age = (tt->generation - dataGeneration(data)) & GENERATION_MASK;
+        int worth = dataDepth(data) - 8 * age;
+        if(worth < replaceWorth) {
+            replaceWorth = worth;
+            replace = &cluster[i];
+        }
+    }
+
+    uint64_t data = packData(move, score, eval, depth, bound, tt->generation);
+    atomic_store_explicit(&replace->key, key ^ data, memory_order_relaxed);
+    atomic_store_explicit(&replace->data, data, memory_order_relaxed);
+}
+
+int ttHashfull(const TranspositionTable* tt) {
+    int used = 0;
+    size_t clusters = tt->clusterCount < 250 ? tt->clusterCount : 250;
+
+    for(size_t c = 0; c < clusters; c++) {
+        for(int i = 0; i < TT_CLUSTER_SIZE; i++) {
+            uint64_t data = atomic_load_explicit(&tt->entries[c * TT_CLUSTER_SIZE + i].data, memory_order_relaxed);
+            if(data && dataGeneration(data) == tt->generation)
+                used++;
+        }
+    }
+
+    return clusters ? (int)(used * 1000 / (clusters * TT_CLUSTER_SIZE)) : 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "position.h"
+#include "platform.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define TT_CLUSTER_SIZE 4
+
+typedef enum {
+    BOUND_NONE,
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT
+} Bound;
+
+// The key is stored xor'ed with the data so a torn write from another
+// thread fails the key check instead of returning garbage
+typedef struct {
+    _Atomic uint64_t key;
+    _Atomic uint64_t data;
+} TTEntry;
+
+typedef struct {
+    Move move;
+    int16_t score;
+    int16_t eval;
+    int8_t depth;
+    Bound bound;
+} TTData;
+
+// Shared by all search threads without locks
+typedef struct {
+    TTEntry* entries;
+    void* memory;
+    size_t clusterCount;
+    uint8_t generation;
+    WritableMapping file; // holds the entries instead of 'memory' for ttInitFile
+    pthread_t flusher;
+    bool flusherStarted;
+    atomic_bool flushing;
+} TranspositionTable;
+
+void ttInit(TranspositionTable* tt, size_t megabytes);
+// Keeps the table in a mapped file, what an earlier session of the same size stored there is
+// found again. False if the file can't be mapped
+bool ttInitFile(TranspositionTable* tt, const char* path, size_t megabytes);
+// Writes the entries changed since the last snapshot to the file on a thread of its own, the
+// caller and the searches go on meanwhile. Does nothing while the last one is still writing,
+// ttFree writes the rest
+void ttSnapshot(TranspositionTable* tt);
+void ttFree(TranspositionTable* tt);
+void ttClear(TranspositionTable* tt);
+// Ages the entries of the previous searches
+void ttNewSearch(TranspositionTable* tt);
+
+bool ttProbe(const TranspositionTable* tt, uint64_t key, TTData* out);
+void ttStore(TranspositionTable* tt, uint64_t key, Move move, int score, int eval, int depth, Bound bound);
+// Permille of the table used by the current search
+int ttHashfull(const TranspositionTable* tt);
+
+static inline TTEntry* ttCluster(const TranspositionTable* tt, uint64_t key) {
+    return &tt->entries[(size_t)(((__uint128_t)key * tt->clusterCount) >> 64) * TT_CLUSTER_SIZE];
+}
+
+static inline void ttPrefetch(const TranspositionTable* tt, uint64_t key) {
+    __builtin_prefetch(ttCluster(tt, key));
+}
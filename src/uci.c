@@ -0,0 +1,298 @@
+#include "uci.h"
+#include "tb.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+static void sendLine(Uci* uci, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    pthread_mutex_lock(&uci->outLock);
+    vfprintf(uci->out, fmt, args);
+    fputc('\n', uci->out);
+    fflush(uci->out);
+    pthread_mutex_unlock(&uci->outLock);
+    va_end(args);
+}
+
+// Points 'token' at the next space separated word, false at the end of the line
+static bool nextToken(const char** p, const char** token, int* length) {
+    const char* s = *p;
+    while(*s == ' ' || *s == '\t')
+        s++;
+    const char* end = s;
+    while(*end && *end != ' ' && *end != '\t' && *end != '\n' && *end != '\r')
+        end++;
+    *token = s;
+    *length = (int)(end - s);
+    *p = end;
+    return end > s;
+}
+
+static inline bool isToken(const char* token, int length, const char* word) {
+    return (int)strlen(word) == length && !strncmp(token, word, length);
+}
+
+static int64_t parseNumber(const char** p) {
+    const char* token;
+    int length;
+    if(!nextToken(p, &token, &length))
+        return 0;
+    return strtoll(token, null, 10);
+}
+
+// Appends to 'line' holding 'n' chars, a line that is full stays as it is
+static int appendLine(char* line, int n, size_t size, const char* fmt, ...) {
+    if((size_t)n + 1 >= size)
+        return n;
+
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(line + n, size - n, fmt, args);
+    va_end(args);
+    if(written < 0)
+        return n;
+    return (size_t)n + written < size ? n + written : (int)size - 1;
+}
+
+static void onReport(const SearchReport* report, void* user) {
+    // the fields before the pv take up to about 170 chars, a move 6
+    char line[256 + MAX_PLY * 6];
+    int n = appendLine(line, 0, sizeof(line), "info depth %d seldepth %d multipv %d score ", report->depth,
+                       report->selDepth, report->multiPv);
+    if(abs(report->score) >= VALUE_MATE_BOUND)
+        n = appendLine(line, n, sizeof(line), "mate %d",
+                       report->score > 0 ? (VALUE_MATE - report->score + 1) / 2 : -(VALUE_MATE + report->score) / 2);
+    else
+        n = appendLine(line, n, sizeof(line), "cp %d", report->score);
+    n = appendLine(line, n, sizeof(line), " nodes %llu nps %llu hashfull %d tbhits %llu time %lld pv",
+                   (unsigned long long)report->nodes, (unsigned long long)report->nps, report->hashfull,
+                   (unsigned long long)report->tbHits, (long long)report->time);
+    for(int i = 0; i < report->pvLength; i++) {
+        char move[8];
+        moveToString(report->pv[i], move);
+        // a move cut in half would be a different move
+        if((size_t)n + strlen(move) + 2 > sizeof(line))
+            break;
+        n = appendLine(line, n, sizeof(line), " %s", move);
+    }
+    sendLine((Uci*)user, "%s", line);
+}
+
+static void onDone(Move best, Move ponder, void* user) {
+    char bestText[8] = "0000", ponderText[8];
+    if(best != MOVE_NONE)
+        moveToString(best, bestText);
+    if(ponder != MOVE_NONE) {
+        moveToString(ponder, ponderText);
+        sendLine((Uci*)user, "bestmove %s ponder %s", bestText, ponderText);
+    } else {
+        sendLine((Uci*)user, "bestmove %s", bestText);
+    }
+}
+
+void initUci(Uci* uci, FILE* out) {
+    ASSERT(uci != null, "The uci ptr provided shouldn't be null!\n");
+
+    memset(uci, 0, sizeof(Uci));
+    uci->out = out;
+    uci->hashMb = UCI_DEFAULT_HASH_MB;
+    uci->threads = 1;
+    uci->multiPv = 1;
+    pthread_mutex_init(&uci->outLock, null);
+    initEngine(&uci->engine, uci->hashMb, uci->threads);
+    positionSetStart(&uci->position);
+}
+
+void destroyUci(Uci* uci) {
+    destroyEngine(&uci->engine);
+    pthread_mutex_destroy(&uci->outLock);
+}
+
+// position [startpos | fen <fen>] [moves <move> ...]
+static void handlePosition(Uci* uci, const char* p) {
+    const char* token;
+    int length;
+    if(!nextToken(&p, &token, &length))
+        return;
+
+    Position pos;
+    if(isToken(token, length, "startpos")) {
+        positionSetStart(&pos);
+    } else if(isToken(token, length, "fen")) {
+        size_t used = positionParseFen(&pos, p, strlen(p));
+        if(!used) {
+            sendLine(uci, "info string invalid fen");
+            return;
+        }
+        p += used;
+    } else {
+        return;
+    }
+
+    uci->position = pos;
+    uci->keyCount = 0;
+    if(!nextToken(&p, &token, &length) || !isToken(token, length, "moves"))
+        return;
+
+    while(nextToken(&p, &token, &length)) {
+        char text[8] = {0};
+        memcpy(text, token, length < 7 ? (size_t)length : 7);
+        Move move = parseMove(&uci->position, text);
+        if(move == MOVE_NONE) {
+            sendLine(uci, "info string illegal move %s", text);
+            return;
+        }
+
+        // only the positions since the last irreversible move matter for repetitions
+        if(uci->keyCount == MAX_GAME_PLY) {
+            memmove(uci->keys, uci->keys + MAX_GAME_PLY / 2, sizeof(uint64_t) * (MAX_GAME_PLY / 2));
+            uci->keyCount = MAX_GAME_PLY / 2;
+        }
+        uci->keys[uci->keyCount++] = uci->position.key;
+        positionMakeMove(&uci->position, move);
+    }
+}
+
+// go [wtime btime winc binc movestogo depth nodes movetime mate <n>] [infinite] [ponder]
+static void handleGo(Uci* uci, const char* p) {
+    SearchLimits limits = { .multiPv = uci->multiPv };
+    const char* token;
+    int length;
+
+    while(nextToken(&p, &token, &length)) {
+        if(isToken(token, length, "wtime"))
+            limits.time[TEAM_WHITE] = parseNumber(&p);
+        else if(isToken(token, length, "btime"))
+            limits.time[TEAM_BLACK] = parseNumber(&p);
+        else if(isToken(token, length, "winc"))
+            limits.inc[TEAM_WHITE] = parseNumber(&p);
+        else if(isToken(token, length, "binc"))
+            limits.inc[TEAM_BLACK] = parseNumber(&p);
+        else if(isToken(token, length, "movestogo"))
+            limits.movesToGo = (int)parseNumber(&p);
+        else if(isToken(token, length, "depth"))
+            limits.depth = (int)parseNumber(&p);
+        else if(isToken(token, length, "nodes"))
+            limits.nodes = (uint64_t)parseNumber(&p);
+        else if(isToken(token, length, "movetime"))
+            limits.moveTime = parseNumber(&p);
+        else if(isToken(token, length, "mate"))
+            limits.depth = 2 * (int)parseNumber(&p) - 1; // a mate in n is found at depth 2n - 1
+        else if(isToken(token, length, "infinite"))
+            limits.infinite = true;
+        else if(isToken(token, length, "ponder"))
+            limits.ponder = true;
+        else if(isToken(token, length, "searchmoves"))
+            sendLine(uci, "info string searchmoves isn't supported, searching every move");
+    }
+
+    engineStart(&uci->engine, &uci->position, uci->keys, uci->keyCount, &limits, onReport, onDone, uci);
+}
+
+// setoption name <name> [value <value>], the name may have spaces
+static void handleSetOption(Uci* uci, const char* p) {
+    const char* token;
+    int length;
+    if(!nextToken(&p, &token, &length) || !isToken(token, length, "name"))
+        return;
+
+    char name[64] = {0};
+    const char* value = "";
+    while(nextToken(&p, &token, &length)) {
+        if(isToken(token, length, "value")) {
+            while(*p == ' ')
+                p++;
+            value = p;
+            break;
+        }
+        size_t used = strlen(name);
+        if(used + length + 2 < sizeof(name))
+            snprintf(name + used, sizeof(name) - used, "%s%.*s", used ? " " : "", length, token);
+    }
+
+    // none of these can change under a running search
+    engineStop(&uci->engine);
+    engineWait(&uci->engine);
+
+    if(!strcmp(name, "Hash")) {
+        long long mb = strtoll(value, null, 10);
+        uci->hashMb = (size_t)(mb < 1 ? 1 : mb > UCI_MAX_HASH_MB ? UCI_MAX_HASH_MB : mb);
+        engineSetHash(&uci->engine, uci->hashMb);
+    } else if(!strcmp(name, "Threads")) {
+        int threads = atoi(value);
+        uci->threads = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+        engineSetThreads(&uci->engine, uci->threads);
+    } else if(!strcmp(name, "MultiPV")) {
+        int lines = atoi(value);
+        uci->multiPv = lines < 1 ? 1 : lines > MAX_MULTI_PV ? MAX_MULTI_PV : lines;
+    } else if(!strcmp(name, "Clear Hash")) {
+        engineClear(&uci->engine);
+    } else if(!strcmp(name, "TBPath")) {
+        char paths[1024];
+        snprintf(paths, sizeof(paths), "%s", value);
+        paths[strcspn(paths, "\r\n")] = '\0';
+        sendLine(uci, "info string %d tablebases found", tbInit(paths));
+    } else if(strcmp(name, "Ponder") != 0) {
+        sendLine(uci, "info string unknown option %s", name);
+    }
+}
+
+bool uciCommand(Uci* uci, const char* line) {
+    ASSERT(uci != null, "The uci ptr provided shouldn't be null!\n");
+
+    const char* p = line;
+    const char* token;
+    int length;
+    if(!nextToken(&p, &token, &length))
+        return true;
+
+    if(isToken(token, length, "uci")) {
+        sendLine(uci, "id name " UCI_ENGINE_NAME);
+        sendLine(uci, "id author " UCI_ENGINE_AUTHOR);
+        sendLine(uci, "option name Hash type spin default %d min 1 max %d", UCI_DEFAULT_HASH_MB, UCI_MAX_HASH_MB);
+        sendLine(uci, "option name Threads type spin default 1 min 1 max %d", MAX_THREADS);
+        sendLine(uci, "option name MultiPV type spin default 1 min 1 max %d", MAX_MULTI_PV);
+        sendLine(uci, "option name Ponder type check default false");
+        sendLine(uci, "option name Clear Hash type button");
+        sendLine(uci, "option name TBPath type string default <empty>");
+        sendLine(uci, "uciok");
+    } else if(isToken(token, length, "isready")) {
+        sendLine(uci, "readyok");
+    } else if(isToken(token, length, "ucinewgame")) {
+        engineStop(&uci->engine);
+        engineClear(&uci->engine);
+    } else if(isToken(token, length, "position")) {
+        handlePosition(uci, p);
+    } else if(isToken(token, length, "go")) {
+        handleGo(uci, p);
+    } else if(isToken(token, length, "stop")) {
+        engineStop(&uci->engine);
+    } else if(isToken(token, length, "ponderhit")) {
+        enginePonderHit(&uci->engine);
+    } else if(isToken(token, length, "setoption")) {
+        handleSetOption(uci, p);
+    } else if(isToken(token, length, "d")) {
+        char fen[FEN_MAX_LENGTH + 1];
+        positionGetFen(&uci->position, fen);
+        sendLine(uci, "info string fen %s", fen);
+    } else if(isToken(token, length, "quit")) {
+        engineStop(&uci->engine);
+        engineWait(&uci->engine);
+        return false;
+    } else {
+        sendLine(uci, "info string unknown command %.*s", length, token);
+    }
+    return true;
+}
+
+void uciLoop(Uci* uci, FILE* in) {
+    char* line = malloc(UCI_MAX_LINE);
+    ASSERT(line != null, "Failed to allocate the command buffer!\n");
+
+    while(fgets(line, UCI_MAX_LINE, in)) {
+        if(!uciCommand(uci, line))
+            break;
+    }
+    free(line);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "search.h"
+
+#include <stdio.h>
+
+#define UCI_ENGINE_NAME "Chess"
+#define UCI_ENGINE_AUTHOR "CloudCodingSpace"
+#define UCI_DEFAULT_HASH_MB 64
+#define UCI_MAX_HASH_MB 65536
+#define UCI_MAX_LINE 65536
+
+typedef struct {
+    Engine engine;
+    size_t hashMb;
+    int threads;
+    int multiPv;
+
+    Position position;
+    uint64_t keys[MAX_GAME_PLY]; // positions before 'position'
+    int keyCount;
+
+    // the search thread writes info and bestmove lines while commands are answered
+    FILE* out;
+    pthread_mutex_t outLock;
+} Uci;
+
+void initUci(Uci* uci, FILE* out);
+void destroyUci(Uci* uci);
+// Handles one command line, false once it was quit
+bool uciCommand(Uci* uci, const char* line);
+// Reads commands until quit or the end of the input
+void uciLoop(Uci* uci, FILE* in);
@@ -0,0 +1,208 @@
+#include "uciclient.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#define QUIT_TIMEOUT_MS 500
+
+// Points 'token' at the next space separated word, false at the end of the line
+static bool nextToken(const char** p, const char** token, int* length) {
+    const char* s = *p;
+    while(*s == ' ' || *s == '\t')
+        s++;
+    const char* end = s;
+    while(*end && *end != ' ' && *end != '\t')
+        end++;
+    *token = s;
+    *length = (int)(end - s);
+    *p = end;
+    return end > s;
+}
+
+static inline bool isToken(const char* token, int length, const char* word) {
+    return (int)strlen(word) == length && !strncmp(token, word, length);
+}
+
+static int64_t parseNumber(const char** p) {
+    const char* token;
+    int length;
+    if(!nextToken(p, &token, &length))
+        return 0;
+    return strtoll(token, null, 10);
+}
+
+static void copyToken(const char** p, char* out, size_t size) {
+    const char* token;
+    int length;
+    if(nextToken(p, &token, &length))
+        snprintf(out, size, "%.*s", length, token);
+}
+
+// info [depth seldepth multipv score cp|mate [lowerbound|upperbound] nodes nps time ...] [pv ...]
+static void parseInfo(const char* p, UciMessage* m) {
+    m->kind = UCI_MESSAGE_INFO;
+    m->multiPv = 1;
+
+    const char* token;
+    int length;
+    while(nextToken(&p, &token, &length)) {
+        if(isToken(token, length, "depth"))
+            m->depth = (int)parseNumber(&p);
+        else if(isToken(token, length, "seldepth"))
+            m->selDepth = (int)parseNumber(&p);
+        else if(isToken(token, length, "multipv"))
+            m->multiPv = (int)parseNumber(&p);
+        else if(isToken(token, length, "nodes"))
+            m->nodes = (uint64_t)parseNumber(&p);
+        else if(isToken(token, length, "nps"))
+            m->nps = (uint64_t)parseNumber(&p);
+        else if(isToken(token, length, "time"))
+            m->time = parseNumber(&p);
+        else if(isToken(token, length, "cp") || isToken(token, length, "mate")) {
+            m->mate = token[0] == 'm';
+            m->score = (int)parseNumber(&p);
+        } else if(isToken(token, length, "lowerbound"))
+            m->lowerBound = true;
+        else if(isToken(token, length, "upperbound"))
+            m->upperBound = true;
+        else if(isToken(token, length, "pv")) {
+            while(*p == ' ')
+                p++;
+            snprintf(m->text, UCI_CLIENT_TEXT, "%s", p);
+            return;
+        } else if(isToken(token, length, "string")) {
+            return;
+        }
+    }
+}
+
+// Runs on the pipe's reader thread
+static void parseLine(char* line, void* user) {
+    UciClient* client = (UciClient*)user;
+    UciMessage m = {0};
+    if(!line) {
+        m.kind = UCI_MESSAGE_EXITED;
+        linePipePush(&client->pipe, &m, false);
+        return;
+    }
+
+    const char* p = line;
+    const char* token;
+    int length;
+    if(!nextToken(&p, &token, &length))
+        return;
+
+    if(isToken(token, length, "info")) {
+        parseInfo(p, &m);
+    } else if(isToken(token, length, "bestmove")) {
+        m.kind = UCI_MESSAGE_BESTMOVE;
+        copyToken(&p, m.best, sizeof(m.best));
+        if(nextToken(&p, &token, &length) && isToken(token, length, "ponder"))
+            copyToken(&p, m.ponder, sizeof(m.ponder));
+    } else if(isToken(token, length, "readyok")) {
+        m.kind = UCI_MESSAGE_READY;
+    } else if(isToken(token, length, "id")) {
+        if(!nextToken(&p, &token, &length) || !isToken(token, length, "name"))
+            return;
+        while(*p == ' ')
+            p++;
+        m.kind = UCI_MESSAGE_NAME;
+        snprintf(m.text, UCI_CLIENT_NAME, "%s", p);
+    } else {
+        return;
+    }
+    // a slow consumer loses info lines, never a bestmove
+    if(!linePipePush(&client->pipe, &m, m.kind == UCI_MESSAGE_INFO) && m.kind == UCI_MESSAGE_INFO)
+        atomic_fetch_add_explicit(&client->dropped, 1, memory_order_relaxed);
+}
+
+static long readProcess(void* process, void* data, size_t size, int timeoutMs) {
+    return processRead((ChildProcess*)process, data, size, timeoutMs);
+}
+
+static long writeProcess(void* process, const void* data, size_t size) {
+    return processWrite((ChildProcess*)process, data, size);
+}
+
+bool uciClientStart(UciClient* client, const char* command) {
+    ASSERT(client != null, "The client ptr provided shouldn't be null!\n");
+
+    memset(client, 0, sizeof(UciClient));
+    snprintf(client->name, UCI_CLIENT_NAME, "%s", command);
+    if(!processStart(&client->process, command))
+        return false;
+
+    linePipeInit(&client->pipe, client->queue, sizeof(UciMessage), UCI_CLIENT_QUEUE_SIZE, client->outgoing,
+                 UCI_CLIENT_OUTGOING);
+    if(!linePipeStart(&client->pipe, &client->process, readProcess, writeProcess, parseLine, client)) {
+        processClose(&client->process, 0);
+        return false;
+    }
+
+    uciClientSend(client, "uci");
+    uciClientSend(client, "isready");
+    return true;
+}
+
+void uciClientStop(UciClient* client) {
+    if(!atomic_load(&client->pipe.running))
+        return;
+
+    uciClientSend(client, "quit");
+    linePipeStop(&client->pipe);
+    processClose(&client->process, QUIT_TIMEOUT_MS);
+}
+
+void uciClientSend(UciClient* client, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bool queued = linePipeSend(&client->pipe, fmt, args);
+    va_end(args);
+
+    if(!queued)
+        ERROR("%s: command dropped, the engine doesn't read its input\n", client->name);
+}
+
+void uciClientGo(UciClient* client, const char* position, const char* go) {
+    uciClientStopSearch(client);
+    uciClientSend(client, "%s", position);
+    uciClientSend(client, "%s", go);
+    client->searching = true;
+}
+
+void uciClientStopSearch(UciClient* client) {
+    if(!client->searching)
+        return;
+    uciClientSend(client, "stop");
+    client->searching = false;
+    client->staleSearches++;
+}
+
+bool uciClientPoll(UciClient* client, UciMessage* out) {
+    while(linePipePoll(&client->pipe, out)) {
+        switch(out->kind) {
+            case UCI_MESSAGE_NAME:
+                snprintf(client->name, UCI_CLIENT_NAME, "%.*s", UCI_CLIENT_NAME - 1, out->text);
+                break;
+            case UCI_MESSAGE_INFO:
+                // output of a search that was stopped
+                if(client->staleSearches)
+                    continue;
+                break;
+            case UCI_MESSAGE_BESTMOVE:
+                if(client->staleSearches) {
+                    client->staleSearches--;
+                    continue;
+                }
+                client->searching = false;
+                break;
+            case UCI_MESSAGE_EXITED:
+                client->searching = false;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defines.h"
+#include "platform.h"
+#include "linepipe.h"
+
+// Must be a power of 2
+#define UCI_CLIENT_QUEUE_SIZE 1024
+#define UCI_CLIENT_TEXT 512
+#define UCI_CLIENT_NAME 64
+#define UCI_CLIENT_OUTGOING 65536
+
+typedef enum {
+    UCI_MESSAGE_NAME,     // text holds the engine's id name
+    UCI_MESSAGE_READY,    // readyok
+    UCI_MESSAGE_INFO,     // text holds the pv, empty for info lines without one
+    UCI_MESSAGE_BESTMOVE, // best and ponder hold the moves as sent
+    UCI_MESSAGE_EXITED    // the engine closed its output, nothing follows
+} UciMessageKind;
+
+typedef struct {
+    UciMessageKind kind;
+    int depth;
+    int selDepth;
+    int multiPv;
+    int score;
+    bool mate; // 'score' is in moves to mate then
+    bool lowerBound, upperBound;
+    uint64_t nodes;
+    uint64_t nps;
+    int64_t time;
+    char best[8];
+    char ponder[8];
+    char text[UCI_CLIENT_TEXT];
+} UciMessage;
+
+// An external UCI engine running as a child process
+//
+// The engine's output is parsed on the pipe's reader thread, the thread owning the client
+// (the render loop) sends commands and polls the messages, neither ever blocks on the
+// engine. Info lines are dropped when the queue is full.
+typedef struct {
+    ChildProcess process;
+    LinePipe pipe;
+    UciMessage queue[UCI_CLIENT_QUEUE_SIZE];
+    _Atomic uint64_t dropped;
+
+    // consumer side only
+    char name[UCI_CLIENT_NAME];
+    char outgoing[UCI_CLIENT_OUTGOING];
+    bool searching;
+    int staleSearches; // stopped searches whose bestmove is still to come
+} UciClient;
+
+// Starts the engine and sends uci and isready, false if it can't be run
+bool uciClientStart(UciClient* client, const char* command);
+// Sends quit, gives the engine a moment to exit and kills it after that
+void uciClientStop(UciClient* client);
+// Queues a command line, whatever the pipe doesn't take now is sent on the next call or poll
+void uciClientSend(UciClient* client, const char* fmt, ...);
+// Stops the running search if any and starts a new one, the old search's output is dropped
+void uciClientGo(UciClient* client, const char* position, const char* go);
+void uciClientStopSearch(UciClient* client);
+// Takes the next message off the queue, false if there is none
+bool uciClientPoll(UciClient* client, UciMessage* out);
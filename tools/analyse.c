@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "search.h"
+#include "platform.h"
+
+// Batch analysis over JSON lines, one request per line on stdin and one result per line on stdout
+//
+//   {"id": 7, "fen": "<fen>", "depth": 12, "nodes": 100000, "movetime": 50, "multipv": 3}
+//
+// Only fen is required, limits that are left out come from the command line. Results go out
+// as soon as their search finished, so they come back in any order tagged with the request's id:
+//
+//   {"id":7,"bestmove":"e2e4","depth":12,"nodes":98304,"time":41,
+//    "lines":[{"multipv":1,"score":{"cp":31},"pv":["e2e4","e7e5"]}, ...]}
+//   {"id":8,"error":"invalid fen"}
+//
+// Every worker runs an engine with a single search thread, all of them share one transposition
+// table so positions of the same game help each other. The reader blocks once the queue is full,
+// a client writing faster than the workers search is slowed down rather than buffered without end.
+
+#define MAX_LINE 4096
+#define MAX_ID 64
+#define QUEUE_SIZE 1024
+// completed searches between two ages of the shared table
+#define AGE_INTERVAL 256
+
+typedef struct {
+    char id[MAX_ID]; // as it was sent, quotes included for a string
+    Position pos;
+    SearchLimits limits;
+} Request;
+
+typedef struct {
+    Request* queue[QUEUE_SIZE];
+    int head, count;
+    bool closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    TranspositionTable tt;
+    _Atomic uint64_t done;
+    _Atomic uint64_t failed;
+    _Atomic uint64_t nodes;
+
+    pthread_mutex_t outLock;
+} Service;
+
+typedef struct {
+    Service* service;
+    Engine engine;
+    Request* current;
+
+    // the lines of the last depth reported, best first
+    SearchLine lines[MAX_MULTI_PV];
+    int lineCount;
+    int depth;
+    Move best;
+} Worker;
+
+static void writeLine(Service* s, const char* line, size_t length) {
+    pthread_mutex_lock(&s->outLock);
+    fwrite(line, 1, length, stdout);
+    fflush(stdout);
+    pthread_mutex_unlock(&s->outLock);
+}
+
+static void writeError(Service* s, const char* id, const char* error) {
+    char line[MAX_ID + 128];
+    int n = snprintf(line, sizeof(line), "{\"id\":%s,\"error\":\"%s\"}\n", id[0] ? id : "null", error);
+    writeLine(s, line, (size_t)n);
+    atomic_fetch_add(&s->failed, 1);
+}
+
+static const char* skipSpace(const char* p) {
+    while(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+    return p;
+}
+
+// Copies a string without its quotes, escapes other than \uXXXX resolved, null if it's malformed
+static const char* parseString(const char* p, char* out, size_t size) {
+    if(*p != '"')
+        return null;
+    p++;
+    size_t n = 0;
+    while(*p && *p != '"') {
+        char c = *p++;
+        if(c == '\\') {
+            c = *p++;
+            switch(c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case '"': case '\\': case '/': break;
+                default: return null;
+            }
+        }
+        if(n + 1 < size)
+            out[n++] = c;
+    }
+    if(*p != '"')
+        return null;
+    out[n] = '\0';
+    return p + 1;
+}
+
+static const char* parseNumber(const char* p, long long* out) {
+    char* end;
+    *out = strtoll(p, &end, 10);
+    if(end == p)
+        return null;
+    // fractions are cut off
+    if(*end == '.') {
+        end++;
+        while(*end >= '0' && *end <= '9')
+            end++;
+    }
+    return end;
+}
+
+// A flat object, values other than strings and numbers are skipped if they're true, false or null
+static bool parseRequest(const char* line, Request* r, const char** error) {
+    memset(r, 0, sizeof(Request));
+    bool hasFen = false;
+
+    const char* p = skipSpace(line);
+    if(*p != '{') {
+        *error = "not a json object";
+        return false;
+    }
+    p = skipSpace(p + 1);
+
+    while(*p != '}') {
+        char key[32], text[MAX_LINE];
+        long long number = 0;
+        bool isString = false;
+
+        p = parseString(p, key, sizeof(key));
+        if(!p || *(p = skipSpace(p)) != ':') {
+            *error = "malformed json";
+            return false;
+        }
+        p = skipSpace(p + 1);
+
+        const char* value = p;
+        if(*p == '"') {
+            p = parseString(p, text, sizeof(text));
+            isString = true;
+        } else if(!strncmp(p, "true", 4) || !strncmp(p, "null", 4)) {
+            p += 4;
+        } else if(!strncmp(p, "false", 5)) {
+            p += 5;
+        } else {
+            p = parseNumber(p, &number);
+        }
+        if(!p) {
+            *error = "malformed json";
+            return false;
+        }
+
+        if(!strcmp(key, "id")) {
+            if(p - value >= MAX_ID) {
+                *error = "id too long";
+                return false;
+            }
+            memcpy(r->id, value, (size_t)(p - value));
+            r->id[p - value] = '\0';
+        } else if(!strcmp(key, "fen") && isString) {
+            if(!positionSetFen(&r->pos, text)) {
+                *error = "invalid fen";
+                return false;
+            }
+            hasFen = true;
+        } else if(!strcmp(key, "depth")) {
+            r->limits.depth = number < 0 ? 0 : number >= MAX_PLY ? MAX_PLY - 1 : (int)number;
+        } else if(!strcmp(key, "nodes")) {
+            r->limits.nodes = number < 0 ? 0 : (uint64_t)number;
+        } else if(!strcmp(key, "movetime")) {
+            r->limits.moveTime = number < 0 ? 0 : number;
+        } else if(!strcmp(key, "multipv")) {
+            r->limits.multiPv = number < 1 ? 1 : number > MAX_MULTI_PV ? MAX_MULTI_PV : (int)number;
+        }
+
+        p = skipSpace(p);
+        if(*p == ',')
+            p = skipSpace(p + 1);
+        else if(*p != '}') {
+            *error = "malformed json";
+            return false;
+        }
+    }
+
+    if(!hasFen) {
+        *error = "no fen";
+        return false;
+    }
+    return true;
+}
+
+static void onReport(const SearchReport* report, void* user) {
+    Worker* w = (Worker*)user;
+    if(report->multiPv == 1) {
+        w->depth = report->depth;
+        w->lineCount = 0;
+    }
+    SearchLine* line = &w->lines[w->lineCount++];
+    line->score = report->score;
+    line->pvLength = report->pvLength;
+    memcpy(line->pv, report->pv, sizeof(Move) * report->pvLength);
+}
+
+static void onDone(Move best, Move ponder, void* user) {
+    (void)ponder;
+    ((Worker*)user)->best = best;
+}
+
+static void writeResult(Worker* w, int64_t time) {
+    char line[256 + MAX_MULTI_PV * (64 + MAX_PLY * 8)];
+    char move[8] = "0000";
+    uint64_t nodes = engineNodes(&w->engine);
+
+    if(w->best != MOVE_NONE)
+        moveToString(w->best, move);
+    int n = snprintf(line, sizeof(line), "{\"id\":%s,\"bestmove\":\"%s\",\"depth\":%d,\"nodes\":%llu,\"time\":%lld,\"lines\":[",
+                     w->current->id[0] ? w->current->id : "null", move, w->depth, (unsigned long long)nodes, (long long)time);
+
+    for(int i = 0; i < w->lineCount; i++) {
+        const SearchLine* l = &w->lines[i];
+        n += snprintf(line + n, sizeof(line) - n, "%s{\"multipv\":%d,\"score\":", i ? "," : "", i + 1);
+        if(abs(l->score) >= VALUE_MATE_BOUND)
+            n += snprintf(line + n, sizeof(line) - n, "{\"mate\":%d}",
+                          l->score > 0 ? (VALUE_MATE - l->score + 1) / 2 : -(VALUE_MATE + l->score) / 2);
+        else
+            n += snprintf(line + n, sizeof(line) - n, "{\"cp\":%d}", l->score);
+        n += snprintf(line + n, sizeof(line) - n, ",\"pv\":[");
+        for(int j = 0; j < l->pvLength; j++) {
+            moveToString(l->pv[j], move);
+            n += snprintf(line + n, sizeof(line) - n, "%s\"%s\"", j ? "," : "", move);
+        }
+        n += snprintf(line + n, sizeof(line) - n, "]}");
+    }
+    n += snprintf(line + n, sizeof(line) - n, "]}\n");
+
+    writeLine(w->service, line, (size_t)n);
+    atomic_fetch_add(&w->service->nodes, nodes);
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Service* s = w->service;
+
+    while(true) {
+        pthread_mutex_lock(&s->lock);
+        while(!s->count && !s->closed)
+            pthread_cond_wait(&s->notEmpty, &s->lock);
+        if(!s->count) {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        Request* r = s->queue[s->head];
+        s->head = (s->head + 1) % QUEUE_SIZE;
+        s->count--;
+        pthread_cond_signal(&s->notFull);
+        pthread_mutex_unlock(&s->lock);
+
+        w->current = r;
+        w->lineCount = 0;
+        w->depth = 0;
+        w->best = MOVE_NONE;
+
+        // no engineClear between requests, it would wipe the table the others search with
+        int64_t start = getTimeMs();
+        engineStart(&w->engine, &r->pos, null, 0, &r->limits, onReport, onDone, w);
+        engineWait(&w->engine);
+        writeResult(w, getTimeMs() - start);
+        free(r);
+
+        // the generation is only read by the searches, one of them storing an entry
+        // with the old one for a moment makes no difference
+        if((atomic_fetch_add(&s->done, 1) + 1) % AGE_INTERVAL == 0)
+            ttNewSearch(&s->tt);
+    }
+    return null;
+}
+
+static void pushRequest(Service* s, Request* r) {
+    pthread_mutex_lock(&s->lock);
+    while(s->count == QUEUE_SIZE)
+        pthread_cond_wait(&s->notFull, &s->lock);
+    s->queue[(s->head + s->count) % QUEUE_SIZE] = r;
+    s->count++;
+    pthread_cond_signal(&s->notEmpty);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void printUsage(void) {
+    printf("Usage: analyse [-t threads] [-H hash MB] [-s ms] [-d depth] [-n nodes] [-m multipv]\n");
+    printf("  reads JSON requests from stdin, the options are the limits of requests without any\n");
+    printf("  -s 100 unless a depth or node limit is given\n");
+}
+
+int main(int argc, char** argv) {
+    SearchLimits defaults = {0};
+    int threads = getCpuCount();
+    size_t hashMb = 256;
+
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-H") && i + 1 < argc)
+            hashMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            defaults.moveTime = atoll(argv[++i]);
+        else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+            defaults.depth = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            defaults.nodes = strtoull(argv[++i], null, 10);
+        else if(!strcmp(argv[i], "-m") && i + 1 < argc)
+            defaults.multiPv = atoi(argv[++i]);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if(threads < 1)
+        threads = 1;
+    if(!defaults.moveTime && !defaults.depth && !defaults.nodes)
+        defaults.moveTime = 100;
+
+    initPosition();
+    initEval();
+
+    Service s = {0};
+    pthread_mutex_init(&s.lock, null);
+    pthread_mutex_init(&s.outLock, null);
+    pthread_cond_init(&s.notEmpty, null);
+    pthread_cond_init(&s.notFull, null);
+    ttInit(&s.tt, hashMb);
+
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(workers != null && handles != null, "Failed to allocate the workers!\n");
+    for(int t = 0; t < threads; t++) {
+        workers[t].service = &s;
+        initEngine(&workers[t].engine, 1, 1);
+        engineShareTable(&workers[t].engine, &s.tt);
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    }
+    fprintf(stderr, "INFO: %d workers, %zu MB shared hash\n", threads, hashMb);
+
+    int64_t start = getTimeMs();
+    uint64_t received = 0;
+    char* line = malloc(MAX_LINE);
+    ASSERT(line != null, "Failed to allocate the line buffer!\n");
+    while(fgets(line, MAX_LINE, stdin)) {
+        const char* p = skipSpace(line);
+        if(!*p)
+            continue;
+        received++;
+
+        Request* r = malloc(sizeof(Request));
+        ASSERT(r != null, "Failed to allocate a request!\n");
+        const char* error = null;
+        if(!parseRequest(line, r, &error)) {
+            writeError(&s, r->id, error);
+            free(r);
+            continue;
+        }
+        if(!r->limits.depth && !r->limits.nodes && !r->limits.moveTime) {
+            r->limits.depth = defaults.depth;
+            r->limits.nodes = defaults.nodes;
+            r->limits.moveTime = defaults.moveTime;
+        }
+        if(!r->limits.multiPv)
+            r->limits.multiPv = defaults.multiPv;
+        pushRequest(&s, r);
+    }
+    free(line);
+
+    pthread_mutex_lock(&s.lock);
+    s.closed = true;
+    pthread_cond_broadcast(&s.notEmpty);
+    pthread_mutex_unlock(&s.lock);
+    for(int t = 0; t < threads; t++) {
+        pthread_join(handles[t], null);
+        destroyEngine(&workers[t].engine);
+    }
+
+    int64_t time = getTimeMs() - start;
+    fprintf(stderr, "INFO: %llu requests, %llu failed, %llu searched in %.1fs (%.0f/s), %llu nodes\n",
+            (unsigned long long)received, (unsigned long long)atomic_load(&s.failed),
+            (unsigned long long)atomic_load(&s.done), time / 1000.0,
+            time ? atomic_load(&s.done) * 1000.0 / time : 0.0, (unsigned long long)atomic_load(&s.nodes));
+
+    ttFree(&s.tt);
+    free(workers);
+    free(handles);
+    return 0;
+}
@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "book.h"
+#include "runs.h"
+#include "platform.h"
+#include "pgn.h"
+
+// Builds a book from PGN files
+//
+// The files are mapped and cut into chunks at game boundaries, every thread
+// takes chunks off a shared counter and counts wins, draws and losses per
+// (key, move) in its own hash map. A full map is sorted and written to a run
+// file, the runs are merged into the book at the end so memory stays bounded
+// no matter how many games there are.
+
+#define CHUNK_SIZE (8 << 20)
+
+typedef struct {
+    uint64_t key;
+    uint16_t move;
+    uint16_t pad;
+    uint32_t wins, draws, losses; // from the side to move
+} BookStat;
+
+typedef struct {
+    BookStat* slots;
+    size_t capacity;
+    size_t count;
+    size_t limit; // spilled to a run once reached
+} StatMap;
+
+typedef struct {
+    int file;
+    size_t start, end;
+} Chunk;
+
+typedef struct {
+    MappedFile* files;
+    int fileCount;
+    Chunk* chunks;
+    int chunkCount;
+    _Atomic int nextChunk;
+
+    const char* output;
+    int maxPly;
+    size_t mapLimit;
+
+    RunSet runs;
+
+    _Atomic uint64_t games;
+    _Atomic uint64_t skipped;
+    _Atomic uint64_t positions;
+} Builder;
+
+typedef struct {
+    Builder* builder;
+    StatMap map;
+    bool failed;
+} Worker;
+
+static inline size_t hashStat(uint64_t key, uint16_t move, size_t capacity) {
+    return (size_t)((key ^ (uint64_t)move * 0x9E3779B97F4A7C15ULL) * 0xFF51AFD7ED558CCDULL >> 17) & (capacity - 1);
+}
+
+static void initStatMap(StatMap* map, size_t limit) {
+    map->capacity = 1 << 16;
+    map->count = 0;
+    map->limit = limit;
+    map->slots = calloc(map->capacity, sizeof(BookStat));
+    ASSERT(map->slots != null, "Failed to allocate a stat map!\n");
+}
+
+static inline bool isEmpty(const BookStat* s) {
+    return !(s->wins | s->draws | s->losses);
+}
+
+static void growStatMap(StatMap* map) {
+    BookStat* old = map->slots;
+    size_t oldCapacity = map->capacity;
+
+    map->capacity *= 2;
+    map->slots = calloc(map->capacity, sizeof(BookStat));
+    ASSERT(map->slots != null, "Failed to grow a stat map!\n");
+
+    for(size_t i = 0; i < oldCapacity; i++) {
+        if(isEmpty(&old[i]))
+            continue;
+        size_t j = hashStat(old[i].key, old[i].move, map->capacity);
+        while(!isEmpty(&map->slots[j]))
+            j = (j + 1) & (map->capacity - 1);
+        map->slots[j] = old[i];
+    }
+    free(old);
+}
+
+static void addStat(StatMap* map, uint64_t key, uint16_t move, int result) {
+    if(map->count * 2 >= map->capacity)
+        growStatMap(map);
+
+    size_t i = hashStat(key, move, map->capacity);
+    while(!isEmpty(&map->slots[i]) && (map->slots[i].key != key || map->slots[i].move != move))
+        i = (i + 1) & (map->capacity - 1);
+
+    BookStat* s = &map->slots[i];
+    if(isEmpty(s)) {
+        s->key = key;
+        s->move = move;
+        map->count++;
+    }
+    if(result > 0)
+        s->wins++;
+    else if(result < 0)
+        s->losses++;
+    else
+        s->draws++;
+}
+
+static int compareStats(const void* a, const void* b) {
+    const BookStat* x = a;
+    const BookStat* y = b;
+    if(x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return (int)x->move - (int)y->move;
+}
+
+// Sorts the map into a run file and empties it
+static bool spillRun(Worker* w) {
+    Builder* b = w->builder;
+    StatMap* map = &w->map;
+    if(!map->count)
+        return true;
+
+    size_t n = 0;
+    for(size_t i = 0; i < map->capacity; i++) {
+        if(!isEmpty(&map->slots[i]))
+            map->slots[n++] = map->slots[i];
+    }
+    qsort(map->slots, n, sizeof(BookStat), compareStats);
+
+    bool ok = runSetWrite(&b->runs, map->slots, n);
+
+    memset(map->slots, 0, sizeof(BookStat) * map->capacity);
+    map->count = 0;
+    return ok;
+}
+
+static bool onGame(const PgnGame* game, void* user) {
+    Worker* w = (Worker*)user;
+    Builder* b = w->builder;
+    PgnString fen;
+
+    if(game->broken || game->result == RESULT_NONE || !game->ply || pgnFindTag(game, "FEN", &fen)) {
+        atomic_fetch_add_explicit(&b->skipped, 1, memory_order_relaxed);
+        return true;
+    }
+
+    int result = game->result == RESULT_WHITE_WINS ? 1 : game->result == RESULT_BLACK_WINS ? -1 : 0;
+    Position pos = game->start;
+    for(int i = 0; i < game->ply; i++) {
+        addStat(&w->map, bookKey(&pos), bookEncodeMove(game->moves[i]), i & 1 ? -result : result);
+        if(w->map.count >= w->map.limit && !spillRun(w)) {
+            w->failed = true;
+            return false;
+        }
+        positionMakeMove(&pos, game->moves[i]);
+    }
+    atomic_fetch_add_explicit(&b->games, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&b->positions, (uint64_t)game->ply, memory_order_relaxed);
+    return true;
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Builder* b = w->builder;
+
+    int i;
+    while(!w->failed && (i = atomic_fetch_add(&b->nextChunk, 1)) < b->chunkCount) {
+        const Chunk* c = &b->chunks[i];
+        const char* data = (const char*)b->files[c->file].data;
+        pgnParse(data + c->start, c->end - c->start, b->maxPly, onGame, w);
+    }
+    if(!w->failed && !spillRun(w))
+        w->failed = true;
+
+    return null;
+}
+
+// Cuts the file in chunks that start at a tag line right after a game ended
+static void planChunks(Builder* b, int file) {
+    const char* data = (const char*)b->files[file].data;
+    size_t size = b->files[file].size;
+    size_t start = 0;
+
+    while(start < size) {
+        size_t end = start + CHUNK_SIZE < size ? pgnNextGame(data, size, start + CHUNK_SIZE) : size;
+
+        b->chunks = realloc(b->chunks, sizeof(Chunk) * (b->chunkCount + 1));
+        ASSERT(b->chunks != null, "Failed to allocate the chunk list!\n");
+        b->chunks[b->chunkCount++] = (Chunk){ file, start, end };
+        start = end;
+    }
+}
+
+static void addFile(Builder* b, const char* path) {
+    b->files = realloc(b->files, sizeof(MappedFile) * (b->fileCount + 1));
+    ASSERT(b->files != null, "Failed to allocate the file list!\n");
+    if(!mapFile(&b->files[b->fileCount], path)) {
+        ERROR("Can't read %s\n", path);
+        return;
+    }
+    planChunks(b, b->fileCount++);
+}
+
+static void addDirectoryFile(const char* dir, const char* name, void* user) {
+    size_t len = strlen(name);
+    if(len < 4 || strcmp(name + len - 4, ".pgn") != 0)
+        return;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    addFile((Builder*)user, path);
+}
+
+// Weights are 2 * wins + draws like most Polyglot builders, scaled to fit 16 bits
+static uint64_t flushPosition(FILE* out, const BookStat* stats, int count, int minGames) {
+    uint64_t maxWeight = 0;
+    for(int i = 0; i < count; i++) {
+        uint64_t weight = 2 * (uint64_t)stats[i].wins + stats[i].draws;
+        if(weight > maxWeight)
+            maxWeight = weight;
+    }
+
+    uint64_t written = 0;
+    for(int i = 0; i < count; i++) {
+        uint64_t games = (uint64_t)stats[i].wins + stats[i].draws + stats[i].losses;
+        uint64_t weight = 2 * (uint64_t)stats[i].wins + stats[i].draws;
+        if(games < (uint64_t)minGames || !weight)
+            continue;
+        if(maxWeight > 0xFFFF)
+            weight = weight * 0xFFFF / maxWeight;
+
+        uint8_t entry[BOOK_ENTRY_SIZE];
+        bookWriteEntry(entry, stats[i].key, stats[i].move, (uint16_t)(weight ? weight : 1), 0);
+        fwrite(entry, 1, BOOK_ENTRY_SIZE, out);
+        written++;
+    }
+    return written;
+}
+
+static bool mergeRuns(Builder* b, int minGames, uint64_t* entries) {
+    RunMerge merge;
+    if(!runMergeOpen(&merge, &b->runs))
+        return false;
+    FILE* out = fopen(b->output, "wb");
+    if(!out) {
+        ERROR("Can't create %s\n", b->output);
+        runMergeClose(&merge, &b->runs);
+        return false;
+    }
+
+    BookStat s, group[MAX_MOVES];
+    int groupCount = 0;
+    *entries = 0;
+
+    while(runMergeNext(&merge, &s)) {
+        if(groupCount && group[groupCount - 1].key == s.key && group[groupCount - 1].move == s.move) {
+            group[groupCount - 1].wins += s.wins;
+            group[groupCount - 1].draws += s.draws;
+            group[groupCount - 1].losses += s.losses;
+            continue;
+        }
+        if(groupCount && (group[0].key != s.key || groupCount == MAX_MOVES)) {
+            *entries += flushPosition(out, group, groupCount, minGames);
+            groupCount = 0;
+        }
+        group[groupCount++] = s;
+    }
+    if(groupCount)
+        *entries += flushPosition(out, group, groupCount, minGames);
+
+    bool ok = runMergeClose(&merge, &b->runs);
+    ok = fclose(out) == 0 && ok;
+    // a book missing games must not pass for a complete one
+    if(!ok)
+        remove(b->output);
+    return ok;
+}
+
+static void printUsage(void) {
+    printf("Usage: bookgen [-t threads] [-p plies] [-m min games] [-M memory MB] -o book.bin <pgn dir or file ...>\n");
+}
+
+int main(int argc, char** argv) {
+    Builder b = {0};
+    int threads = getCpuCount();
+    int minGames = 2;
+    size_t memoryMb = 1024;
+    b.maxPly = 30;
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-p") && i + 1 < argc)
+            b.maxPly = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-m") && i + 1 < argc)
+            minGames = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-M") && i + 1 < argc)
+            memoryMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            b.output = argv[++i];
+        else
+            break;
+    }
+    if(!b.output || i == argc) {
+        printUsage();
+        return 1;
+    }
+    if(threads < 1)
+        threads = 1;
+    if(b.maxPly < 1 || b.maxPly > PGN_MAX_PLY)
+        b.maxPly = PGN_MAX_PLY;
+
+    initPosition();
+    runSetInit(&b.runs, b.output, sizeof(BookStat), compareStats);
+
+    for(; i < argc; i++) {
+        if(!listDirectory(argv[i], addDirectoryFile, &b))
+            addFile(&b, argv[i]);
+    }
+    INFO("%d files in %d chunks\n", b.fileCount, b.chunkCount);
+
+    // the maps hold at most half their slots, spill well before the budget is reached
+    b.mapLimit = memoryMb * (1 << 20) / sizeof(BookStat) / 4 / threads;
+
+    int64_t start = getTimeMs();
+    Worker* workers = calloc(threads, sizeof(Worker));
+    ASSERT(workers != null, "Failed to allocate the workers!\n");
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    for(int t = 0; t < threads; t++) {
+        workers[t].builder = &b;
+        initStatMap(&workers[t].map, b.mapLimit);
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    }
+
+    bool ok = true;
+    for(int t = 0; t < threads; t++) {
+        pthread_join(handles[t], null);
+        ok = ok && !workers[t].failed;
+        free(workers[t].map.slots);
+    }
+    free(workers);
+    free(handles);
+
+    int64_t parsed = getTimeMs();
+    INFO("%llu games, %llu positions, %llu skipped in %.1fs, %d runs\n",
+         (unsigned long long)b.games, (unsigned long long)b.positions, (unsigned long long)b.skipped,
+         (parsed - start) / 1000.0, b.runs.count);
+
+    uint64_t entries = 0;
+    ok = ok && mergeRuns(&b, minGames, &entries);
+    if(ok)
+        INFO("%llu entries written to %s in %.1fs\n", (unsigned long long)entries, b.output, (getTimeMs() - parsed) / 1000.0);
+    else
+        ERROR("Failed to build %s\n", b.output);
+
+    for(int f = 0; f < b.fileCount; f++)
+        unmapFile(&b.files[f]);
+    free(b.files);
+    free(b.chunks);
+    runSetFree(&b.runs);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "gamedb.h"
+#include "query.h"
+#include "platform.h"
+
+// Finds the positions of a game database matching a material or placement query
+//
+// Every thread takes blocks of games off a shared counter and replays every position
+// of every game against the query. The blocks are taken in order, so once enough games
+// matched no new block is started and the finished ones still hold the first matches.
+
+#define GAME_BLOCK 1024
+
+typedef struct {
+    uint32_t game;
+    uint16_t ply;
+} Match;
+
+typedef struct {
+    GameDb db;
+    PositionQuery query;
+    int minPly;
+    bool allPositions;
+    uint64_t maxGames;
+
+    _Atomic uint64_t nextBlock;
+    _Atomic uint64_t matchedGames;
+    _Atomic uint64_t positions;
+    _Atomic uint64_t broken;
+} Search;
+
+typedef struct {
+    Search* search;
+    Match* matches;
+    size_t count, capacity;
+    uint32_t game;
+    bool matched;
+} Worker;
+
+static void addMatch(Worker* w, uint16_t ply) {
+    if(w->count == w->capacity) {
+        w->capacity = w->capacity ? w->capacity * 2 : 1024;
+        w->matches = realloc(w->matches, sizeof(Match) * w->capacity);
+        ASSERT(w->matches != null, "Failed to grow the match list!\n");
+    }
+    w->matches[w->count++] = (Match){ w->game, ply };
+}
+
+static bool onPosition(const Position* pos, int ply, void* user) {
+    Worker* w = (Worker*)user;
+    const Search* s = w->search;
+    if(ply < s->minPly || !queryMatch(&s->query, pos))
+        return true;
+
+    addMatch(w, (uint16_t)ply);
+    w->matched = true;
+    return s->allPositions;
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Search* s = w->search;
+
+    uint64_t block;
+    while(atomic_load_explicit(&s->matchedGames, memory_order_relaxed) < s->maxGames
+          && (block = atomic_fetch_add(&s->nextBlock, 1)) * GAME_BLOCK < s->db.count) {
+        uint64_t end = (block + 1) * GAME_BLOCK < s->db.count ? (block + 1) * GAME_BLOCK : s->db.count;
+        uint64_t positions = 0, matched = 0;
+        for(uint64_t game = block * GAME_BLOCK; game < end; game++) {
+            Position start;
+            if(!gameDbStart(&s->db, game, &start)) {
+                atomic_fetch_add_explicit(&s->broken, 1, memory_order_relaxed);
+                continue;
+            }
+            size_t size;
+            const uint8_t* data = gameDbMoveData(&s->db, game, &size);
+
+            w->game = (uint32_t)game;
+            w->matched = false;
+            positions += (uint64_t)gameDbReplay(&start, data, size, PGN_MAX_PLY, onPosition, w) + 1;
+            matched += w->matched;
+        }
+        atomic_fetch_add_explicit(&s->positions, positions, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s->matchedGames, matched, memory_order_relaxed);
+    }
+    return null;
+}
+
+static int compareMatches(const void* a, const void* b) {
+    const Match* x = a;
+    const Match* y = b;
+    if(x->game != y->game)
+        return x->game < y->game ? -1 : 1;
+    return (int)x->ply - (int)y->ply;
+}
+
+static void printUsage(void) {
+    printf("Usage: dbsearch [-t threads] [-n max games] [-m min ply] [-a] [-o out.epd] games.cgd \"query\"\n");
+    printf("  -a lists every matching position instead of the first one of each game\n");
+    printf("  query terms, all of them have to hold:\n");
+    printf("    KRPvKR      exact material, white first\n");
+    printf("    wQ=0 bP>=3  piece count of a team, with = < <= > >=\n");
+    printf("    wR@7        a white rook on the 7th rank, squares are comma separated\n");
+    printf("                squares (e4), ranks (7), files (e), light or dark\n");
+    printf("    !bP@d,e     no black pawn on the d or e file\n");
+    printf("    ocb         one bishop each, on squares of different colours\n");
+    printf("    w, b        side to move\n");
+}
+
+int main(int argc, char** argv) {
+    Search s = { .maxGames = UINT64_MAX };
+    int threads = getCpuCount();
+    const char* output = null;
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            s.maxGames = strtoull(argv[++i], null, 10);
+        else if(!strcmp(argv[i], "-m") && i + 1 < argc)
+            s.minPly = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-a"))
+            s.allPositions = true;
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            output = argv[++i];
+        else
+            break;
+    }
+    if(i + 2 != argc) {
+        printUsage();
+        return 1;
+    }
+    if(threads < 1)
+        threads = 1;
+
+    if(!queryParse(&s.query, argv[i + 1])) {
+        ERROR("Invalid query: %s\n", argv[i + 1]);
+        return 1;
+    }
+    initPosition();
+    if(!gameDbOpen(&s.db, argv[i])) {
+        ERROR("Can't read %s\n", argv[i]);
+        return 1;
+    }
+    FILE* out = output ? fopen(output, "w") : stdout;
+    if(!out) {
+        ERROR("Can't create %s\n", output);
+        gameDbClose(&s.db);
+        return 1;
+    }
+
+    int64_t start = getTimeMs();
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(workers != null && handles != null, "Failed to allocate the workers!\n");
+    for(int t = 0; t < threads; t++) {
+        workers[t].search = &s;
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    }
+
+    size_t total = 0;
+    for(int t = 0; t < threads; t++) {
+        pthread_join(handles[t], null);
+        total += workers[t].count;
+    }
+    int64_t time = getTimeMs() - start;
+
+    Match* matches = malloc(sizeof(Match) * (total ? total : 1));
+    ASSERT(matches != null, "Failed to allocate the matches!\n");
+    size_t count = 0;
+    for(int t = 0; t < threads; t++) {
+        if(workers[t].count)
+            memcpy(matches + count, workers[t].matches, sizeof(Match) * workers[t].count);
+        count += workers[t].count;
+        free(workers[t].matches);
+    }
+    free(workers);
+    free(handles);
+    qsort(matches, count, sizeof(Match), compareMatches);
+
+    // the positions are replayed again for the few that get printed
+    Move moves[PGN_MAX_PLY];
+    uint64_t games = 0;
+    for(size_t m = 0; m < count; m++) {
+        if(!m || matches[m].game != matches[m - 1].game) {
+            if(games == s.maxGames)
+                break;
+            games++;
+        }
+
+        Position pos;
+        int ply = gameDbMoves(&s.db, matches[m].game, &pos, moves, matches[m].ply);
+        for(int p = 0; p < ply; p++)
+            positionMakeMove(&pos, moves[p]);
+
+        char fen[FEN_MAX_LENGTH + 1];
+        positionGetFen(&pos, fen);
+        fprintf(out, "%s ; game %u ply %u\n", fen, matches[m].game + 1, matches[m].ply);
+    }
+    if(output)
+        fclose(out);
+
+    uint64_t positions = s.positions;
+    INFO("%llu games matched, %llu positions searched in %.2fs (%.1fM positions/s, %d threads)\n",
+         (unsigned long long)games, (unsigned long long)positions, time / 1000.0,
+         time ? positions / 1000.0 / time : 0.0, threads);
+    if(s.broken)
+        INFO("%llu games with a broken FEN skipped\n", (unsigned long long)s.broken);
+
+    free(matches);
+    gameDbClose(&s.db);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "position.h"
+#include "eval.h"
+#include "tb.h"
+#include "uci.h"
+#include "bench.h"
+
+// Headless UCI engine, the same search as the GUI without any window
+//
+// engine             speaks UCI on stdin and stdout
+// engine bench [d]   fixed search for the node signature and speed, see bench.h
+
+int main(int argc, char** argv) {
+    initPosition();
+    initEval();
+
+    if(argc > 1 && !strcmp(argv[1], "bench")) {
+        BenchResult result;
+        runBench(argc > 2 ? atoi(argv[2]) : 0, true, &result);
+        printBenchResult(&result);
+        return 0;
+    }
+
+    // GUIs read stdout line by line
+    setvbuf(stdout, null, _IOLBF, 4096);
+
+    Uci uci;
+    initUci(&uci, stdout);
+    uciLoop(&uci, stdin);
+    destroyUci(&uci);
+    tbFree();
+    return 0;
+}
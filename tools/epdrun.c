@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "search.h"
+#include "platform.h"
+
+// Runs the engine over an EPD test suite
+//
+// Every worker owns an engine with a single search thread and takes positions off a
+// shared counter, so a suite runs on all cores without the searches sharing anything.
+// A position is solved when the final move is one of its bm moves and none of its am
+// moves, the solve time is when the search settled on it for good.
+
+#define EPD_MAX_MOVES 8
+#define EPD_ID_LENGTH 64
+#define TIME_BUCKETS 9
+
+static const int64_t BUCKET_LIMITS[TIME_BUCKETS - 1] = { 10, 50, 100, 250, 500, 1000, 2500, 5000 };
+
+typedef struct {
+    Position pos;
+    char id[EPD_ID_LENGTH];
+    Move best[EPD_MAX_MOVES];
+    int bestCount;
+    Move avoid[EPD_MAX_MOVES];
+    int avoidCount;
+    int line;
+
+    // results
+    Move played;
+    bool solved;
+    int64_t solveTime; // ms, -1 until a report found the solution
+    int solveDepth;
+    int depth;
+    uint64_t nodes;
+    int64_t time;
+} EpdEntry;
+
+typedef struct {
+    EpdEntry* entries;
+    int count;
+    SearchLimits limits;
+    size_t hashMb;
+    _Atomic int next;
+    _Atomic int done;
+    bool verbose;
+} Suite;
+
+typedef struct {
+    Suite* suite;
+    Engine engine;
+    EpdEntry* current;
+} Worker;
+
+static bool isMoveIn(Move move, const Move* moves, int count) {
+    for(int i = 0; i < count; i++) {
+        if(moves[i] == move)
+            return true;
+    }
+    return false;
+}
+
+static bool isSolution(const EpdEntry* entry, Move move) {
+    if(move == MOVE_NONE || isMoveIn(move, entry->avoid, entry->avoidCount))
+        return false;
+    return !entry->bestCount || isMoveIn(move, entry->best, entry->bestCount);
+}
+
+// Parses the moves of a bm or am operation, SAN like the EPD standard asks for,
+// coordinate notation is accepted too
+static bool parseMoves(const Position* pos, const char* p, const char* end, Move* out, int* count) {
+    while(p < end) {
+        while(p < end && *p == ' ')
+            p++;
+        const char* start = p;
+        while(p < end && *p != ' ')
+            p++;
+        if(p == start)
+            break;
+
+        char coords[8] = {0};
+        memcpy(coords, start, p - start < 7 ? (size_t)(p - start) : 7);
+        Move move = parseSan(pos, start, (int)(p - start));
+        if(move == MOVE_NONE)
+            move = parseMove(pos, coords);
+        if(move == MOVE_NONE || *count == EPD_MAX_MOVES)
+            return false;
+        out[(*count)++] = move;
+    }
+    return true;
+}
+
+static bool parseEpd(const char* line, size_t length, EpdEntry* entry) {
+    memset(entry, 0, sizeof(EpdEntry));
+    size_t used = positionParseFen(&entry->pos, line, length);
+    if(!used)
+        return false;
+
+    const char* p = line + used;
+    const char* end = line + length;
+    while(p < end) {
+        while(p < end && (*p == ' ' || *p == ';'))
+            p++;
+        const char* op = p;
+        while(p < end && *p != ' ' && *p != ';')
+            p++;
+        size_t opLength = (size_t)(p - op);
+
+        // operands run to the semicolon, which may sit inside a string
+        const char* operands = p;
+        bool quoted = false;
+        while(p < end && (quoted || *p != ';')) {
+            if(*p == '"')
+                quoted = !quoted;
+            p++;
+        }
+
+        if(opLength == 2 && !strncmp(op, "bm", 2)) {
+            if(!parseMoves(&entry->pos, operands, p, entry->best, &entry->bestCount))
+                return false;
+        } else if(opLength == 2 && !strncmp(op, "am", 2)) {
+            if(!parseMoves(&entry->pos, operands, p, entry->avoid, &entry->avoidCount))
+                return false;
+        } else if(opLength == 2 && !strncmp(op, "id", 2)) {
+            const char* s = memchr(operands, '"', (size_t)(p - operands));
+            const char* e = s ? memchr(s + 1, '"', (size_t)(p - s - 1)) : null;
+            if(s && e) {
+                size_t n = (size_t)(e - s - 1) < EPD_ID_LENGTH - 1 ? (size_t)(e - s - 1) : EPD_ID_LENGTH - 1;
+                memcpy(entry->id, s + 1, n);
+                entry->id[n] = '\0';
+            }
+        }
+    }
+    return entry->bestCount || entry->avoidCount;
+}
+
+static void onReport(const SearchReport* report, void* user) {
+    Worker* w = (Worker*)user;
+    EpdEntry* entry = w->current;
+    Move move = report->pvLength ? report->pv[0] : MOVE_NONE;
+
+    // the time the solution was found and kept from then on
+    if(!isSolution(entry, move))
+        entry->solveTime = -1;
+    else if(entry->solveTime < 0) {
+        entry->solveTime = report->time;
+        entry->solveDepth = report->depth;
+    }
+    entry->depth = report->depth;
+}
+
+static void onDone(Move best, Move ponder, void* user) {
+    (void)ponder;
+    Worker* w = (Worker*)user;
+    w->current->played = best;
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Suite* s = w->suite;
+
+    int i;
+    while((i = atomic_fetch_add(&s->next, 1)) < s->count) {
+        EpdEntry* entry = &s->entries[i];
+        entry->solveTime = -1;
+        w->current = entry;
+
+        engineClear(&w->engine);
+        int64_t start = getTimeMs();
+        engineStart(&w->engine, &entry->pos, null, 0, &s->limits, onReport, onDone, w);
+        engineWait(&w->engine);
+        entry->time = getTimeMs() - start;
+        entry->nodes = engineNodes(&w->engine);
+
+        entry->solved = isSolution(entry, entry->played);
+        if(!entry->solved)
+            entry->solveTime = -1;
+        else if(entry->solveTime < 0)
+            entry->solveTime = entry->time;
+
+        int done = atomic_fetch_add(&s->done, 1) + 1;
+        if(s->verbose) {
+            char move[8];
+            moveToSan(&entry->pos, entry->played, move);
+            printf("%4d/%d %-12s %-7s %s", done, s->count, entry->id, move, entry->solved ? "solved" : "failed");
+            if(entry->solved)
+                printf(" in %lld ms at depth %d", (long long)entry->solveTime, entry->solveDepth);
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    return null;
+}
+
+static int loadSuite(Suite* s, const char* path) {
+    MappedFile file;
+    if(!mapFile(&file, path))
+        return -1;
+
+    const char* text = (const char*)file.data;
+    size_t offset = 0;
+    int lineNumber = 0, invalid = 0, capacity = 0;
+    while(offset < file.size) {
+        const char* line = text + offset;
+        const char* newline = memchr(line, '\n', file.size - offset);
+        size_t length = newline ? (size_t)(newline - line) : file.size - offset;
+        offset += length + 1;
+        lineNumber++;
+        if(length && line[length - 1] == '\r')
+            length--;
+        if(!length || line[0] == '#')
+            continue;
+
+        if(s->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            s->entries = realloc(s->entries, sizeof(EpdEntry) * capacity);
+            ASSERT(s->entries != null, "Failed to allocate the suite!\n");
+        }
+        EpdEntry* entry = &s->entries[s->count];
+        if(!parseEpd(line, length, entry)) {
+            ERROR("%s:%d: no position with a bm or am move\n", path, lineNumber);
+            invalid++;
+            continue;
+        }
+        entry->line = lineNumber;
+        if(!entry->id[0])
+            snprintf(entry->id, EPD_ID_LENGTH, "line %d", lineNumber);
+        s->count++;
+    }
+    unmapFile(&file);
+    return invalid;
+}
+
+static int compareTimes(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void printSummary(const Suite* s, int threads, int64_t wallTime) {
+    int solved = 0;
+    uint64_t nodes = 0;
+    int64_t searchTime = 0;
+    int buckets[TIME_BUCKETS] = {0};
+    int64_t* times = malloc(sizeof(int64_t) * (s->count ? s->count : 1));
+    ASSERT(times != null, "Failed to allocate the solve times!\n");
+
+    for(int i = 0; i < s->count; i++) {
+        const EpdEntry* entry = &s->entries[i];
+        nodes += entry->nodes;
+        searchTime += entry->time;
+        if(!entry->solved)
+            continue;
+        times[solved++] = entry->solveTime;
+        int b = 0;
+        while(b < TIME_BUCKETS - 1 && entry->solveTime > BUCKET_LIMITS[b])
+            b++;
+        buckets[b]++;
+    }
+    qsort(times, solved, sizeof(int64_t), compareTimes);
+
+    printf("\nfailed:");
+    for(int i = 0; i < s->count; i++) {
+        if(!s->entries[i].solved)
+            printf(" %s", s->entries[i].id);
+    }
+    printf("\n\nsolved %d of %d (%.1f%%)\n", solved, s->count, s->count ? 100.0 * solved / s->count : 0.0);
+    if(solved) {
+        int64_t sum = 0;
+        for(int i = 0; i < solved; i++)
+            sum += times[i];
+        printf("solve time: mean %lld ms, median %lld ms, 90%% %lld ms, max %lld ms\n",
+               (long long)(sum / solved), (long long)times[solved / 2],
+               (long long)times[(solved * 9) / 10 < solved ? (solved * 9) / 10 : solved - 1],
+               (long long)times[solved - 1]);
+    }
+
+    int cumulative = 0;
+    for(int b = 0; b < TIME_BUCKETS; b++) {
+        cumulative += buckets[b];
+        if(b < TIME_BUCKETS - 1)
+            printf("  <= %5lld ms %5d %5d\n", (long long)BUCKET_LIMITS[b], buckets[b], cumulative);
+        else
+            printf("   > %5lld ms %5d %5d\n", (long long)BUCKET_LIMITS[b - 1], buckets[b], cumulative);
+    }
+
+    printf("%llu nodes, %llu nps per engine, %.1fs on %d threads\n", (unsigned long long)nodes,
+           (unsigned long long)(searchTime ? nodes * 1000 / searchTime : 0), wallTime / 1000.0, threads);
+    free(times);
+}
+
+static void printUsage(void) {
+    printf("Usage: epdrun [-t threads] [-s ms per position] [-d depth] [-n nodes] [-H hash MB] [-v] suite.epd\n");
+    printf("  every thread runs an engine of its own, -s 1000 unless a depth or node limit is given\n");
+}
+
+int main(int argc, char** argv) {
+    Suite s = { .hashMb = 16 };
+    int threads = getCpuCount();
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            s.limits.moveTime = atoll(argv[++i]);
+        else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+            s.limits.depth = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            s.limits.nodes = strtoull(argv[++i], null, 10);
+        else if(!strcmp(argv[i], "-H") && i + 1 < argc)
+            s.hashMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-v"))
+            s.verbose = true;
+        else
+            break;
+    }
+    if(i + 1 != argc) {
+        printUsage();
+        return 1;
+    }
+    if(threads < 1)
+        threads = 1;
+    if(!s.limits.moveTime && !s.limits.depth && !s.limits.nodes)
+        s.limits.moveTime = 1000;
+
+    initPosition();
+    initEval();
+    int invalid = loadSuite(&s, argv[i]);
+    if(invalid < 0) {
+        ERROR("Can't read %s\n", argv[i]);
+        return 1;
+    }
+    if(!s.count) {
+        ERROR("No positions in %s\n", argv[i]);
+        return 1;
+    }
+    if(threads > s.count)
+        threads = s.count;
+    INFO("%d positions, %d threads, %lld ms / depth %d / %llu nodes\n", s.count, threads,
+         (long long)s.limits.moveTime, s.limits.depth, (unsigned long long)s.limits.nodes);
+
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(workers != null && handles != null, "Failed to allocate the workers!\n");
+    for(int t = 0; t < threads; t++) {
+        workers[t].suite = &s;
+        initEngine(&workers[t].engine, s.hashMb, 1);
+    }
+
+    int64_t start = getTimeMs();
+    for(int t = 0; t < threads; t++)
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    for(int t = 0; t < threads; t++)
+        pthread_join(handles[t], null);
+    int64_t wallTime = getTimeMs() - start;
+
+    for(int t = 0; t < threads; t++)
+        destroyEngine(&workers[t].engine);
+    free(workers);
+    free(handles);
+
+    printSummary(&s, threads, wallTime);
+    free(s.entries);
+    return 0;
+}
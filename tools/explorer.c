@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "gamedb.h"
+#include "explorer.h"
+#include "runs.h"
+#include "platform.h"
+
+// Builds the opening explorer statistics of a game database
+//
+// Every thread takes blocks of games off a shared counter, replays their first plies
+// and adds results and ratings per (key, move) to its own hash map. A full map is
+// sorted and written to a run file. The runs are merged into the statistics at the
+// end, together with the existing file when there is one: it remembers how many games
+// of the database it counted, so only the games added since are replayed.
+
+#define GAME_BLOCK 4096
+
+typedef struct {
+    ExplorerEntry* slots;
+    size_t capacity;
+    size_t count;
+    size_t limit; // spilled to a run once reached
+} StatMap;
+
+typedef struct {
+    GameDb db;
+    uint64_t firstGame;
+    _Atomic uint64_t nextBlock;
+    const char* output;
+    int plies;
+    size_t mapLimit;
+
+    RunSet runs;
+
+    _Atomic uint64_t games;
+    _Atomic uint64_t positions;
+    _Atomic uint64_t broken;
+} Builder;
+
+typedef struct {
+    Builder* builder;
+    StatMap map;
+    bool failed;
+} Worker;
+
+static inline size_t hashStat(uint64_t key, Move move, size_t capacity) {
+    return (size_t)((key ^ (uint64_t)move * 0x9E3779B97F4A7C15ULL) * 0xFF51AFD7ED558CCDULL >> 17) & (capacity - 1);
+}
+
+static void initStatMap(StatMap* map, size_t limit) {
+    map->capacity = 1 << 16;
+    map->count = 0;
+    map->limit = limit;
+    map->slots = calloc(map->capacity, sizeof(ExplorerEntry));
+    ASSERT(map->slots != null, "Failed to allocate a stat map!\n");
+}
+
+static inline bool isEmpty(const ExplorerEntry* e) {
+    return !(e->white | e->draws | e->black | e->unknown);
+}
+
+static void growStatMap(StatMap* map) {
+    ExplorerEntry* old = map->slots;
+    size_t oldCapacity = map->capacity;
+
+    map->capacity *= 2;
+    map->slots = calloc(map->capacity, sizeof(ExplorerEntry));
+    ASSERT(map->slots != null, "Failed to grow a stat map!\n");
+
+    for(size_t i = 0; i < oldCapacity; i++) {
+        if(isEmpty(&old[i]))
+            continue;
+        size_t j = hashStat(old[i].key, old[i].move, map->capacity);
+        while(!isEmpty(&map->slots[j]))
+            j = (j + 1) & (map->capacity - 1);
+        map->slots[j] = old[i];
+    }
+    free(old);
+}
+
+static void addStat(StatMap* map, uint64_t key, Move move, GameResult result, uint16_t rating) {
+    if(map->count * 2 >= map->capacity)
+        growStatMap(map);
+
+    size_t i = hashStat(key, move, map->capacity);
+    while(!isEmpty(&map->slots[i]) && (map->slots[i].key != key || map->slots[i].move != move))
+        i = (i + 1) & (map->capacity - 1);
+
+    ExplorerEntry* e = &map->slots[i];
+    if(isEmpty(e)) {
+        e->key = key;
+        e->move = move;
+        map->count++;
+    }
+    switch(result) {
+        case RESULT_WHITE_WINS: e->white++; break;
+        case RESULT_BLACK_WINS: e->black++; break;
+        case RESULT_DRAW: e->draws++; break;
+        default: e->unknown++; break;
+    }
+    if(rating) {
+        e->rated++;
+        e->ratingSum += rating;
+    }
+}
+
+static inline int compareEntries(const ExplorerEntry* a, const ExplorerEntry* b) {
+    if(a->key != b->key)
+        return a->key < b->key ? -1 : 1;
+    return (int)a->move - (int)b->move;
+}
+
+static int compareStats(const void* a, const void* b) {
+    return compareEntries(a, b);
+}
+
+// Sorts the map into a run file and empties it
+static bool spillRun(Worker* w) {
+    Builder* b = w->builder;
+    StatMap* map = &w->map;
+    if(!map->count)
+        return true;
+
+    size_t n = 0;
+    for(size_t i = 0; i < map->capacity; i++) {
+        if(!isEmpty(&map->slots[i]))
+            map->slots[n++] = map->slots[i];
+    }
+    qsort(map->slots, n, sizeof(ExplorerEntry), compareStats);
+
+    bool ok = runSetWrite(&b->runs, map->slots, n);
+
+    memset(map->slots, 0, sizeof(ExplorerEntry) * map->capacity);
+    map->count = 0;
+    return ok;
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Builder* b = w->builder;
+    Move moves[PGN_MAX_PLY];
+    uint64_t games = b->db.count - b->firstGame;
+
+    uint64_t block;
+    while(!w->failed && (block = atomic_fetch_add(&b->nextBlock, 1)) * GAME_BLOCK < games) {
+        uint64_t first = b->firstGame + block * GAME_BLOCK;
+        uint64_t end = first + GAME_BLOCK < b->db.count ? first + GAME_BLOCK : b->db.count;
+        for(uint64_t game = first; game < end && !w->failed; game++) {
+            Position pos;
+            int ply = gameDbMoves(&b->db, game, &pos, moves, b->plies);
+            if(ply < 0) {
+                atomic_fetch_add_explicit(&b->broken, 1, memory_order_relaxed);
+                continue;
+            }
+
+            GameInfo info;
+            gameDbInfo(&b->db, game, &info);
+            for(int i = 0; i < ply; i++) {
+                uint16_t rating = pos.side == TEAM_WHITE ? info.whiteElo : info.blackElo;
+                addStat(&w->map, pos.key, moves[i], info.result, rating);
+                if(w->map.count >= w->map.limit && !spillRun(w)) {
+                    w->failed = true;
+                    break;
+                }
+                positionMakeMove(&pos, moves[i]);
+            }
+            atomic_fetch_add_explicit(&b->games, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&b->positions, (uint64_t)ply, memory_order_relaxed);
+        }
+    }
+    if(!w->failed && !spillRun(w))
+        w->failed = true;
+
+    return null;
+}
+
+static bool writeEntry(FILE* out, const ExplorerEntry* e) {
+    uint8_t entry[EXPLORER_ENTRY_SIZE];
+    explorerWriteEntry(entry, e);
+    return fwrite(entry, 1, EXPLORER_ENTRY_SIZE, out) == EXPLORER_ENTRY_SIZE;
+}
+
+// The next entry of the previous statistics, false after the last
+static bool readPrevious(const Explorer* previous, uint64_t* index, ExplorerEntry* out) {
+    if(!previous || *index == previous->count)
+        return false;
+    explorerReadEntry(previous->entries + *index * EXPLORER_ENTRY_SIZE, out);
+    (*index)++;
+    return true;
+}
+
+// Merges the runs and the previous statistics, if any, into 'path'
+static bool mergeRuns(Builder* b, const Explorer* previous, const char* path, uint64_t* written) {
+    RunMerge merge;
+    if(!runMergeOpen(&merge, &b->runs))
+        return false;
+    FILE* out = fopen(path, "wb");
+    if(!out) {
+        ERROR("Can't create %s\n", path);
+        runMergeClose(&merge, &b->runs);
+        return false;
+    }
+
+    uint8_t header[EXPLORER_HEADER_SIZE] = {0};
+    bool ok = fwrite(header, 1, EXPLORER_HEADER_SIZE, out) == EXPLORER_HEADER_SIZE;
+
+    ExplorerEntry run, old, current;
+    uint64_t oldIndex = 0;
+    bool haveRun = runMergeNext(&merge, &run);
+    bool haveOld = readPrevious(previous, &oldIndex, &old);
+    bool pending = false;
+    *written = 0;
+
+    while(ok && (haveRun || haveOld)) {
+        ExplorerEntry e;
+        if(haveRun && (!haveOld || compareEntries(&run, &old) <= 0)) {
+            e = run;
+            haveRun = runMergeNext(&merge, &run);
+        } else {
+            e = old;
+            haveOld = readPrevious(previous, &oldIndex, &old);
+        }
+
+        if(pending && current.key == e.key && current.move == e.move) {
+            current.white += e.white;
+            current.draws += e.draws;
+            current.black += e.black;
+            current.unknown += e.unknown;
+            current.rated += e.rated;
+            current.ratingSum += e.ratingSum;
+            continue;
+        }
+        if(pending) {
+            ok = writeEntry(out, &current);
+            (*written)++;
+        }
+        current = e;
+        pending = true;
+    }
+    if(ok && pending) {
+        ok = writeEntry(out, &current);
+        (*written)++;
+    }
+    ok = runMergeClose(&merge, &b->runs) && ok;
+
+    explorerWriteHeader(header, b->plies, *written, b->db.count);
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(header, 1, EXPLORER_HEADER_SIZE, out) == EXPLORER_HEADER_SIZE;
+    return fclose(out) == 0 && ok;
+}
+
+static void printUsage(void) {
+    printf("Usage: explorer [-t threads] [-p plies] [-M memory MB] [-f] -o games.cex games.cgd\n");
+    printf("  an existing output is updated with the games added to the database since, -f rebuilds it\n");
+}
+
+int main(int argc, char** argv) {
+    Builder b = {0};
+    int threads = getCpuCount();
+    size_t memoryMb = 1024;
+    bool rebuild = false;
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-p") && i + 1 < argc)
+            b.plies = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-M") && i + 1 < argc)
+            memoryMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-f"))
+            rebuild = true;
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            b.output = argv[++i];
+        else
+            break;
+    }
+    if(!b.output || i + 1 != argc) {
+        printUsage();
+        return 1;
+    }
+    if(threads < 1)
+        threads = 1;
+
+    initPosition();
+    if(!gameDbOpen(&b.db, argv[i])) {
+        ERROR("Can't read %s\n", argv[i]);
+        return 1;
+    }
+
+    Explorer previous;
+    bool update = !rebuild && explorerOpen(&previous, b.output);
+    if(update) {
+        if(previous.games > b.db.count || (b.plies && b.plies != previous.plies)) {
+            ERROR("%s doesn't match the database or the plies, rebuild it with -f\n", b.output);
+            explorerClose(&previous);
+            gameDbClose(&b.db);
+            return 1;
+        }
+        b.plies = previous.plies;
+        b.firstGame = previous.games;
+        INFO("Updating %s: %llu entries, %llu new games\n", b.output,
+             (unsigned long long)previous.count, (unsigned long long)(b.db.count - b.firstGame));
+    }
+    if(b.plies < 1 || b.plies > PGN_MAX_PLY)
+        b.plies = b.plies ? PGN_MAX_PLY : 30;
+    runSetInit(&b.runs, b.output, sizeof(ExplorerEntry), compareStats);
+
+    // the maps hold at most half their slots, spill well before the budget is reached
+    b.mapLimit = memoryMb * (1 << 20) / sizeof(ExplorerEntry) / 4 / threads;
+
+    int64_t start = getTimeMs();
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(workers != null && handles != null, "Failed to allocate the workers!\n");
+    for(int t = 0; t < threads; t++) {
+        workers[t].builder = &b;
+        initStatMap(&workers[t].map, b.mapLimit);
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    }
+
+    bool ok = true;
+    for(int t = 0; t < threads; t++) {
+        pthread_join(handles[t], null);
+        ok = ok && !workers[t].failed;
+        free(workers[t].map.slots);
+    }
+    free(workers);
+    free(handles);
+
+    int64_t replayed = getTimeMs();
+    INFO("%llu games, %llu positions in %.1fs, %d runs\n", (unsigned long long)b.games,
+         (unsigned long long)b.positions, (replayed - start) / 1000.0, b.runs.count);
+    if(b.broken)
+        INFO("%llu games with a broken FEN skipped\n", (unsigned long long)b.broken);
+
+    // the previous statistics stay mapped until the merge is done, the new ones replace them after
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", b.output);
+    uint64_t written = 0;
+    ok = ok && mergeRuns(&b, update ? &previous : null, tmp, &written);
+    if(update)
+        explorerClose(&previous);
+    if(ok) {
+        remove(b.output);
+        ok = rename(tmp, b.output) == 0;
+    }
+    if(ok) {
+        INFO("%llu entries written to %s in %.1fs\n", (unsigned long long)written, b.output, (getTimeMs() - replayed) / 1000.0);
+    } else {
+        remove(tmp);
+        ERROR("Failed to build %s\n", b.output);
+    }
+
+    runSetFree(&b.runs);
+    gameDbClose(&b.db);
+    return ok ? 0 : 1;
+}
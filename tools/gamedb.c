@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "position.h"
+#include "gamedb.h"
+#include "ingest.h"
+#include "platform.h"
+
+// Converts between PGN and the game database
+//
+//   gamedb import [-t threads] -o games.cgd <pgn dir or file ...>
+//   gamedb export games.cgd [first [count]] > games.pgn
+//   gamedb info games.cgd
+//
+// The import parses and encodes the games on every core, the games reach the writer
+// in file order so the ids follow the PGN. The string slices of the infos point into
+// the mapped PGN which stays mapped until its last chunk is written.
+
+// The size written for a game that can't be stored
+#define GAME_SKIPPED UINT32_MAX
+
+typedef struct {
+    GameDbWriter writer;
+    uint64_t skipped;
+} Import;
+
+static bool encodeGame(const PgnGame* game, IngestBuffer* out, void* user) {
+    (void)user;
+    // games with an unreadable move or too many keep the part before it
+    GameInfo info;
+    gameInfoFromPgn(game, &info);
+
+    uint8_t moves[PGN_MAX_PLY * GAMEDB_MAX_MOVE_BYTES];
+    size_t encoded;
+    uint32_t size = gameDbEncodeMoves(&game->start, game->moves, game->ply, moves, &encoded) ? (uint32_t)encoded : GAME_SKIPPED;
+    ingestWrite(out, &info, sizeof(GameInfo));
+    ingestWrite(out, &size, sizeof(size));
+    if(size != GAME_SKIPPED)
+        ingestWrite(out, moves, size);
+    return true;
+}
+
+static bool writeChunk(const IngestChunk* chunk, void* user) {
+    Import* import = (Import*)user;
+    const uint8_t* p = chunk->data;
+
+    for(uint64_t i = 0; i < chunk->games; i++) {
+        GameInfo info;
+        uint32_t size;
+        memcpy(&info, p, sizeof(GameInfo));
+        memcpy(&size, p + sizeof(GameInfo), sizeof(size));
+        p += sizeof(GameInfo) + sizeof(size);
+        if(size == GAME_SKIPPED) {
+            import->skipped++;
+            continue;
+        }
+        if(!gameDbAdd(&import->writer, &info, p, size))
+            return false;
+        p += size;
+    }
+    return true;
+}
+
+typedef struct {
+    Import* import;
+    IngestOptions* options;
+    IngestStats* stats;
+    bool failed;
+} ImportFiles;
+
+static void importFile(ImportFiles* f, const char* path) {
+    INFO("Importing %s\n", path);
+    if(!ingestPgnFile(path, f->options, f->stats)) {
+        ERROR("Failed to import %s\n", path);
+        f->failed = true;
+    }
+}
+
+static void importDirectoryFile(const char* dir, const char* name, void* user) {
+    size_t len = strlen(name);
+    if(len < 4 || strcmp(name + len - 4, ".pgn") != 0)
+        return;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    importFile((ImportFiles*)user, path);
+}
+
+static int importCommand(int argc, char** argv) {
+    const char* output = null;
+    IngestOptions options = { .maxPly = PGN_MAX_PLY, .onGame = encodeGame, .onChunk = writeChunk };
+
+    int i = 0;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            output = argv[++i];
+        else
+            break;
+    }
+    if(!output || i == argc) {
+        printf("Usage: gamedb import [-t threads] -o games.cgd <pgn dir or file ...>\n");
+        return 1;
+    }
+
+    Import import = {0};
+    if(!gameDbCreate(&import.writer, output)) {
+        ERROR("Can't create %s\n", output);
+        return 1;
+    }
+    options.user = &import;
+
+    IngestStats stats = {0};
+    ImportFiles files = { &import, &options, &stats, false };
+    for(; i < argc; i++) {
+        if(!listDirectory(argv[i], importDirectoryFile, &files))
+            importFile(&files, argv[i]);
+    }
+
+    uint64_t moveBytes = import.writer.moveBytes;
+    if(!gameDbFinish(&import.writer) || files.failed) {
+        ERROR("Failed to write %s\n", output);
+        return 1;
+    }
+
+    double seconds = stats.time > 0 ? stats.time / 1000.0 : 0.001;
+    INFO("%llu games, %llu plies (%llu with unreadable or too many moves) in %.1fs: %.0f games/s, %.1f MB/s\n",
+         (unsigned long long)stats.games, (unsigned long long)stats.plies, (unsigned long long)stats.broken,
+         seconds, stats.games / seconds, stats.bytes / 1048576.0 / seconds);
+    if(import.skipped)
+        INFO("%llu games skipped, their start has more than 16 pieces a side\n", (unsigned long long)import.skipped);
+    INFO("%.1f MB of PGN, %.1f MB of moves, %.2f bytes per move\n", stats.bytes / 1048576.0,
+         moveBytes / 1048576.0, stats.plies ? (double)moveBytes / stats.plies : 0.0);
+    return 0;
+}
+
+static void printTag(const char* name, PgnString value, const char* unknown) {
+    printf("[%s \"%s\"]\n", name, value.length ? value.data : unknown);
+}
+
+static void exportGame(const GameDb* db, uint64_t id) {
+    static const char* RESULTS[] = { "*", "1-0", "0-1", "1/2-1/2" };
+    GameInfo info;
+    Position pos;
+    Move moves[PGN_MAX_PLY];
+
+    gameDbInfo(db, id, &info);
+    int ply = gameDbMoves(db, id, &pos, moves, PGN_MAX_PLY);
+    if(ply < 0) {
+        ERROR("Game %llu has a broken FEN\n", (unsigned long long)id);
+        return;
+    }
+
+    // unknown parts are stored as 0
+    char year[8] = "????", month[4] = "??", day[4] = "??", date[20];
+    if(info.date / 10000)
+        snprintf(year, sizeof(year), "%04u", info.date / 10000);
+    if(info.date / 100 % 100)
+        snprintf(month, sizeof(month), "%02u", info.date / 100 % 100);
+    if(info.date % 100)
+        snprintf(day, sizeof(day), "%02u", info.date % 100);
+    snprintf(date, sizeof(date), "%s.%s.%s", year, month, day);
+
+    printTag("Event", info.strings[GAMEDB_EVENT], "?");
+    printTag("Site", info.strings[GAMEDB_SITE], "?");
+    printf("[Date \"%s\"]\n", date);
+    printTag("Round", info.strings[GAMEDB_ROUND], "?");
+    printTag("White", info.strings[GAMEDB_WHITE], "?");
+    printTag("Black", info.strings[GAMEDB_BLACK], "?");
+    printf("[Result \"%s\"]\n", RESULTS[info.result]);
+    if(info.whiteElo)
+        printf("[WhiteElo \"%u\"]\n", info.whiteElo);
+    if(info.blackElo)
+        printf("[BlackElo \"%u\"]\n", info.blackElo);
+    if(info.strings[GAMEDB_ECO].length)
+        printTag("ECO", info.strings[GAMEDB_ECO], "");
+    if(info.strings[GAMEDB_FEN].length) {
+        printf("[SetUp \"1\"]\n");
+        printTag("FEN", info.strings[GAMEDB_FEN], "");
+    }
+    printf("\n");
+
+    int column = 0;
+    for(int i = 0; i < ply; i++) {
+        char text[24];
+        int n = 0;
+        if(pos.side == TEAM_WHITE || i == 0)
+            n = sprintf(text, pos.side == TEAM_WHITE ? "%d. " : "%d... ", pos.fullmoves);
+        n += moveToSan(&pos, moves[i], text + n);
+        positionMakeMove(&pos, moves[i]);
+
+        if(column + n + 1 > 80) {
+            printf("\n");
+            column = 0;
+        } else if(column) {
+            printf(" ");
+            column++;
+        }
+        printf("%s", text);
+        column += n;
+    }
+    printf("%s%s\n\n", column ? " " : "", RESULTS[info.result]);
+}
+
+static int exportCommand(int argc, char** argv) {
+    if(argc < 1) {
+        printf("Usage: gamedb export games.cgd [first [count]]\n");
+        return 1;
+    }
+
+    GameDb db;
+    if(!gameDbOpen(&db, argv[0])) {
+        ERROR("Can't read %s\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t first = argc > 1 ? strtoull(argv[1], null, 10) : 0;
+    uint64_t count = argc > 2 ? strtoull(argv[2], null, 10) : db.count;
+    for(uint64_t id = first; id < db.count && id - first < count; id++)
+        exportGame(&db, id);
+
+    gameDbClose(&db);
+    return 0;
+}
+
+static int infoCommand(int argc, char** argv) {
+    if(argc < 1) {
+        printf("Usage: gamedb info games.cgd\n");
+        return 1;
+    }
+
+    GameDb db;
+    if(!gameDbOpen(&db, argv[0])) {
+        ERROR("Can't read %s\n", argv[0]);
+        return 1;
+    }
+
+    // decodes every game to check the file and time the replay
+    int64_t start = getTimeMs();
+    uint64_t plies = 0, results[4] = {0}, broken = 0;
+    Move moves[PGN_MAX_PLY];
+    for(uint64_t id = 0; id < db.count; id++) {
+        GameInfo info;
+        Position pos;
+        gameDbInfo(&db, id, &info);
+        int ply = gameDbMoves(&db, id, &pos, moves, PGN_MAX_PLY);
+        if(ply != info.ply)
+            broken++;
+        plies += ply > 0 ? (uint64_t)ply : 0;
+        results[info.result]++;
+    }
+    int64_t time = getTimeMs() - start;
+
+    printf("%llu games, %llu strings, %.1f MB\n", (unsigned long long)db.count,
+           (unsigned long long)db.stringCount, db.map.size / 1048576.0);
+    printf("1-0 %llu, 0-1 %llu, 1/2-1/2 %llu, unknown %llu\n", (unsigned long long)results[RESULT_WHITE_WINS],
+           (unsigned long long)results[RESULT_BLACK_WINS], (unsigned long long)results[RESULT_DRAW],
+           (unsigned long long)results[RESULT_NONE]);
+    printf("%llu plies replayed in %.2fs, %llu broken games\n", (unsigned long long)plies, time / 1000.0,
+           (unsigned long long)broken);
+
+    gameDbClose(&db);
+    return broken ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        printf("Usage: gamedb <import|export|info> ...\n");
+        return 1;
+    }
+    initPosition();
+
+    if(!strcmp(argv[1], "import"))
+        return importCommand(argc - 2, argv + 2);
+    if(!strcmp(argv[1], "export"))
+        return exportCommand(argc - 2, argv + 2);
+    if(!strcmp(argv[1], "info"))
+        return infoCommand(argc - 2, argv + 2);
+
+    printf("Usage: gamedb <import|export|info> ...\n");
+    return 1;
+}
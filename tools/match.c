@@ -0,0 +1,748 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "pgn.h"
+#include "platform.h"
+
+// Plays two UCI engines against each other on all cores
+//
+// Every worker owns a process of each engine and plays game pairs: one opening of the
+// suite with each engine as white, so an unbalanced opening can't favour either. The
+// clocks are kept in microseconds from the go command going out to the bestmove line
+// coming back. With an SPRT the match stops once the log likelihood ratio of the pair
+// results (pentanomial, pairs aren't independent games) crosses a bound.
+
+#define MATCH_MAX_PLY 1024
+#define MAX_OPENINGS (1 << 20)
+#define LINE_LENGTH 8192
+#define COMMAND_LENGTH (128 + FEN_MAX_LENGTH + MATCH_MAX_PLY * 6)
+#define HANDSHAKE_TIMEOUT_US 10000000LL
+// how long an engine past its time gets to answer the stop before it's restarted
+#define STOP_TIMEOUT_US 1000000LL
+#define PROGRESS_INTERVAL_MS 1000
+
+typedef enum {
+    END_NONE,
+    END_MATE,
+    END_STALEMATE,
+    END_REPETITION,
+    END_FIFTY_MOVES,
+    END_MATERIAL,
+    END_MAX_PLY,
+    END_TIME,
+    END_ILLEGAL_MOVE,
+    END_CRASH
+} GameEnd;
+
+static const char* END_TEXT[] = {
+    "", "checkmate", "stalemate", "threefold repetition", "fifty move rule",
+    "insufficient material", "adjudicated", "time forfeit", "illegal move", "engine crashed"
+};
+
+typedef struct {
+    const char* command;
+    char name[64];
+    ChildProcess process;
+    bool running;
+    // output not yet split into lines
+    char buffer[LINE_LENGTH];
+    size_t start, end;
+} Player;
+
+typedef struct {
+    Position start;
+    Move moves[MATCH_MAX_PLY];
+    int ply;
+    // for the move comments, the last info line before each move
+    int scores[MATCH_MAX_PLY];
+    bool mates[MATCH_MAX_PLY];
+    int depths[MATCH_MAX_PLY];
+    int64_t times[MATCH_MAX_PLY]; // us
+
+    int white; // player index
+    GameResult result;
+    GameEnd end;
+} Game;
+
+typedef struct {
+    const char* commands[2];
+    const char* names[2];
+    size_t hashMb;
+    int64_t baseUs, incUs;
+    const char* timeControl;
+
+    Position* openings;
+    int openingCount;
+    int pairs;
+
+    bool sprt;
+    double elo0, elo1, alpha, beta;
+    double lowerBound, upperBound;
+
+    _Atomic int nextPair;
+    atomic_bool stop;
+    atomic_bool failed; // an engine couldn't be restarted, the match is aborted
+
+    // results of the first engine, guarded by 'lock'
+    pthread_mutex_t lock;
+    int wins, draws, losses;
+    int penta[5]; // pairs by the points scored in them, 0 to 2 in halves
+    int ends[END_CRASH + 1];
+    double llr;
+    int decision; // 1 for H1, -1 for H0
+    int64_t lastProgress;
+    int64_t start;
+    FILE* pgn;
+    char date[16];
+} Match;
+
+typedef struct {
+    Match* match;
+    Player players[2];
+    char command[COMMAND_LENGTH];
+} Worker;
+
+static bool sendLine(Player* player, const char* fmt, ...) {
+    char line[COMMAND_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line) - 1, fmt, args);
+    va_end(args);
+    if(n < 0 || n >= (int)sizeof(line) - 1)
+        return false;
+    line[n++] = '\n';
+
+    // the engine reads its input while it searches, a full pipe clears quickly
+    int written = 0;
+    while(written < n) {
+        long w = processWrite(&player->process, line + written, (size_t)(n - written));
+        if(w < 0)
+            return false;
+        if(w == 0)
+            sleepMs(1);
+        written += (int)w;
+    }
+    return true;
+}
+
+// Reads one output line, 1 with it in 'line', 0 when 'deadline' passed and -1 once the
+// engine is gone. A line longer than the buffer comes in pieces.
+static int readLine(Player* player, char* line, int64_t deadline) {
+    while(true) {
+        char* newline = memchr(player->buffer + player->start, '\n', player->end - player->start);
+        bool full = !newline && player->start == 0 && player->end == sizeof(player->buffer);
+        if(newline || full) {
+            size_t length = newline ? (size_t)(newline - player->buffer) - player->start : player->end;
+            memcpy(line, player->buffer + player->start, length);
+            if(length && line[length - 1] == '\r')
+                length--;
+            line[length] = '\0';
+            player->start = newline ? (size_t)(newline - player->buffer) + 1 : player->end;
+            return 1;
+        }
+
+        memmove(player->buffer, player->buffer + player->start, player->end - player->start);
+        player->end -= player->start;
+        player->start = 0;
+
+        int64_t left = deadline - getTimeUs();
+        if(left <= 0)
+            return 0;
+        long n = processRead(&player->process, player->buffer + player->end, sizeof(player->buffer) - player->end,
+                             (int)((left + 999) / 1000));
+        if(n < 0)
+            return -1;
+        player->end += (size_t)n;
+    }
+}
+
+static inline bool startsWith(const char* line, const char* word) {
+    size_t n = strlen(word);
+    return !strncmp(line, word, n) && (line[n] == ' ' || line[n] == '\0');
+}
+
+// Waits for a line starting with 'word', false on a timeout or when the engine died
+static bool waitFor(Player* player, const char* word, int64_t timeoutUs) {
+    char line[LINE_LENGTH];
+    int64_t deadline = getTimeUs() + timeoutUs;
+    while(readLine(player, line, deadline) > 0) {
+        if(startsWith(line, word))
+            return true;
+    }
+    return false;
+}
+
+static void playerStop(Player* player) {
+    if(!player->running)
+        return;
+    sendLine(player, "quit");
+    processClose(&player->process, 500);
+    player->running = false;
+}
+
+static bool playerStart(Player* player, const char* name, size_t hashMb) {
+    player->start = player->end = 0;
+    if(!processStart(&player->process, player->command))
+        return false;
+    player->running = true;
+
+    char line[LINE_LENGTH];
+    int64_t deadline = getTimeUs() + HANDSHAKE_TIMEOUT_US;
+    int r = sendLine(player, "uci") ? 1 : -1;
+    while(r > 0 && (r = readLine(player, line, deadline)) > 0) {
+        if(startsWith(line, "uciok"))
+            break;
+        if(!name && startsWith(line, "id") && !strncmp(line + 3, "name ", 5))
+            snprintf(player->name, sizeof(player->name), "%.*s", (int)sizeof(player->name) - 1, line + 8);
+    }
+    if(name)
+        snprintf(player->name, sizeof(player->name), "%s", name);
+    if(r <= 0) {
+        playerStop(player);
+        return false;
+    }
+
+    // one core per game, the engines mustn't compete for them
+    sendLine(player, "setoption name Threads value 1");
+    sendLine(player, "setoption name Hash value %llu", (unsigned long long)hashMb);
+    sendLine(player, "isready");
+    if(!waitFor(player, "readyok", HANDSHAKE_TIMEOUT_US)) {
+        playerStop(player);
+        return false;
+    }
+    return true;
+}
+
+static bool playerRestart(Player* player, const char* name, size_t hashMb) {
+    playerStop(player);
+    if(playerStart(player, name, hashMb))
+        return true;
+    ERROR("Can't restart %s\n", player->command);
+    return false;
+}
+
+static bool isInsufficientMaterial(const Position* pos) {
+    for(int team = 0; team < TEAMS; team++) {
+        if(pos->pieces[team][PAWN] | pos->pieces[team][ROOK] | pos->pieces[team][QUEEN])
+            return false;
+    }
+    // bare kings or a single minor piece
+    return popCount(pos->all) <= 3;
+}
+
+// How the game ended at 'pos', END_NONE if it goes on. 'keys' holds the positions before it.
+static GameEnd gameEnd(const Position* pos, const uint64_t* keys, int keyCount) {
+    MoveList list;
+    generateLegalMoves(pos, &list);
+    if(!list.count)
+        return positionInCheck(pos) ? END_MATE : END_STALEMATE;
+    if(pos->halfmoves >= 100)
+        return END_FIFTY_MOVES;
+    if(isInsufficientMaterial(pos))
+        return END_MATERIAL;
+
+    int repetitions = 0;
+    int end = keyCount - pos->halfmoves > 0 ? keyCount - pos->halfmoves : 0;
+    for(int i = keyCount - 4; i >= end; i -= 2) {
+        if(keys[i] == pos->key && ++repetitions == 2)
+            return END_REPETITION;
+    }
+    return END_NONE;
+}
+
+// Parses the score and depth of an info line, the ones without a score are skipped
+static void parseInfo(const char* line, int* score, bool* mate, int* depth) {
+    const char* p = strstr(line, " depth ");
+    if(p)
+        *depth = atoi(p + 7);
+    if((p = strstr(line, " score cp ")))
+        *score = atoi(p + 10), *mate = false;
+    else if((p = strstr(line, " score mate ")))
+        *score = atoi(p + 12), *mate = true;
+}
+
+// Aborts the match, every game after this would only count a dead engine's losses
+static void abortMatch(Match* m) {
+    atomic_store(&m->failed, true);
+    atomic_store(&m->stop, true);
+}
+
+// False when an engine can't be restarted, the match is aborted and the pair isn't counted
+static bool playGame(Worker* w, const Position* opening, int white, Game* game) {
+    Match* m = w->match;
+    memset(game, 0, sizeof(Game));
+    game->start = *opening;
+    game->white = white;
+
+    for(int i = 0; i < 2; i++) {
+        Player* player = &w->players[i];
+        bool ready = player->running && sendLine(player, "ucinewgame") && sendLine(player, "isready")
+            && waitFor(player, "readyok", HANDSHAKE_TIMEOUT_US);
+        if(!ready && !playerRestart(player, m->names[i], m->hashMb)) {
+            abortMatch(m);
+            return false;
+        }
+    }
+
+    char fen[FEN_MAX_LENGTH + 1];
+    positionGetFen(opening, fen);
+    int length = snprintf(w->command, sizeof(w->command), "position fen %s moves", fen);
+
+    Position pos = *opening;
+    uint64_t keys[MATCH_MAX_PLY];
+    int64_t clocks[TEAMS] = { m->baseUs, m->baseUs };
+    char line[LINE_LENGTH];
+
+    while(true) {
+        game->end = game->ply == MATCH_MAX_PLY ? END_MAX_PLY : gameEnd(&pos, keys, game->ply);
+        if(game->end != END_NONE) {
+            game->result = game->end == END_MATE ? (pos.side == TEAM_WHITE ? RESULT_BLACK_WINS : RESULT_WHITE_WINS)
+                                                 : RESULT_DRAW;
+            return true;
+        }
+
+        PieceTeam side = pos.side;
+        int index = side == TEAM_WHITE ? white : !white;
+        Player* player = &w->players[index];
+        GameResult loss = side == TEAM_WHITE ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+
+        bool sent = sendLine(player, "%s", w->command)
+            && sendLine(player, "go wtime %lld btime %lld winc %lld binc %lld",
+                        (long long)(clocks[TEAM_WHITE] / 1000), (long long)(clocks[TEAM_BLACK] / 1000),
+                        (long long)(m->incUs / 1000), (long long)(m->incUs / 1000));
+        int64_t start = getTimeUs();
+        int64_t deadline = start + clocks[side];
+
+        int r = sent ? 1 : -1;
+        int score = 0, depth = 0;
+        bool mate = false;
+        while(r > 0 && (r = readLine(player, line, deadline)) > 0) {
+            if(startsWith(line, "info"))
+                parseInfo(line, &score, &mate, &depth);
+            else if(startsWith(line, "bestmove"))
+                break;
+        }
+        int64_t elapsed = getTimeUs() - start;
+
+        if(r <= 0) {
+            game->end = r == 0 ? END_TIME : END_CRASH;
+            game->result = loss;
+            // an engine that doesn't answer the stop either is hung
+            if(r == 0) {
+                sendLine(player, "stop");
+                if(waitFor(player, "bestmove", STOP_TIMEOUT_US))
+                    return true;
+            }
+            if(!playerRestart(player, m->names[index], m->hashMb)) {
+                abortMatch(m);
+                return false;
+            }
+            return true;
+        }
+
+        clocks[side] -= elapsed;
+        if(clocks[side] < 0) {
+            game->end = END_TIME;
+            game->result = loss;
+            return true;
+        }
+        clocks[side] += m->incUs;
+
+        char text[8] = {0};
+        sscanf(line, "bestmove %7s", text);
+        Move move = parseMove(&pos, text);
+        if(move == MOVE_NONE) {
+            game->end = END_ILLEGAL_MOVE;
+            game->result = loss;
+            return true;
+        }
+
+        game->moves[game->ply] = move;
+        game->scores[game->ply] = score;
+        game->mates[game->ply] = mate;
+        game->depths[game->ply] = depth;
+        game->times[game->ply] = elapsed;
+        keys[game->ply++] = pos.key;
+        positionMakeMove(&pos, move);
+        length += snprintf(w->command + length, sizeof(w->command) - length, " %s", text);
+    }
+}
+
+static void writeGame(Match* m, const Game* game, int round, int index) {
+    static const char* RESULTS[] = { "*", "1-0", "0-1", "1/2-1/2" };
+    FILE* f = m->pgn;
+
+    fprintf(f, "[Event \"match\"]\n[Site \"local\"]\n[Date \"%s\"]\n[Round \"%d.%d\"]\n", m->date, round, index);
+    fprintf(f, "[White \"%s\"]\n[Black \"%s\"]\n[Result \"%s\"]\n", m->names[game->white], m->names[!game->white],
+            RESULTS[game->result]);
+    Position standard;
+    positionSetStart(&standard);
+    if(game->start.key != standard.key) {
+        char fen[FEN_MAX_LENGTH + 1];
+        positionGetFen(&game->start, fen);
+        fprintf(f, "[SetUp \"1\"]\n[FEN \"%s\"]\n", fen);
+    }
+    fprintf(f, "[TimeControl \"%s\"]\n[PlyCount \"%d\"]\n", m->timeControl, game->ply);
+    if(game->end >= END_TIME)
+        fprintf(f, "[Termination \"%s\"]\n", game->end == END_TIME ? "time forfeit" : "rules infraction");
+    fprintf(f, "\n");
+
+    // scores are from the mover's point of view like the engines report them
+    Position pos = game->start;
+    int column = 0;
+    for(int i = 0; i < game->ply; i++) {
+        char text[64];
+        int n = 0;
+        if(pos.side == TEAM_WHITE || i == 0)
+            n = sprintf(text, pos.side == TEAM_WHITE ? "%d. " : "%d... ", pos.fullmoves);
+        n += moveToSan(&pos, game->moves[i], text + n);
+        if(game->mates[i])
+            n += sprintf(text + n, " {%sM%d/%d %.3fs}", game->scores[i] < 0 ? "-" : "+", abs(game->scores[i]),
+                         game->depths[i], game->times[i] / 1e6);
+        else
+            n += sprintf(text + n, " {%+.2f/%d %.3fs}", game->scores[i] / 100.0, game->depths[i], game->times[i] / 1e6);
+        positionMakeMove(&pos, game->moves[i]);
+
+        if(column + n + 1 > 80) {
+            fprintf(f, "\n");
+            column = 0;
+        } else if(column) {
+            fprintf(f, " ");
+            column++;
+        }
+        fprintf(f, "%s", text);
+        column += n;
+    }
+    if(game->end != END_NONE)
+        fprintf(f, "%s{%s}", column ? " " : "", END_TEXT[game->end]);
+    fprintf(f, " %s\n\n", RESULTS[game->result]);
+}
+
+static inline double expectedScore(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static inline double scoreToElo(double score) {
+    if(score <= 0.0)
+        return -INFINITY;
+    if(score >= 1.0)
+        return INFINITY;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Mean and variance of the pair scores (0 to 1) over 'pairs'
+static void pentaStats(const int penta[5], int* pairs, double* mean, double* variance) {
+    *pairs = 0;
+    *mean = *variance = 0.0;
+    for(int i = 0; i < 5; i++)
+        *pairs += penta[i];
+    if(!*pairs)
+        return;
+    for(int i = 0; i < 5; i++)
+        *mean += penta[i] * (i / 4.0);
+    *mean /= *pairs;
+    for(int i = 0; i < 5; i++)
+        *variance += penta[i] * (i / 4.0 - *mean) * (i / 4.0 - *mean);
+    *variance /= *pairs;
+}
+
+// Generalized SPRT, the log likelihood ratio of elo1 over elo0 for the pair scores
+// approximated with a normal distribution of the observed variance
+static double computeLlr(const Match* m) {
+    int pairs;
+    double mean, variance;
+    pentaStats(m->penta, &pairs, &mean, &variance);
+    if(pairs < 2 || variance <= 0.0)
+        return 0.0;
+    double s0 = expectedScore(m->elo0), s1 = expectedScore(m->elo1);
+    return pairs * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * variance);
+}
+
+static void printProgress(const Match* m) {
+    int pairs;
+    double mean, variance;
+    pentaStats(m->penta, &pairs, &mean, &variance);
+    double margin = pairs ? 1.96 * sqrt(variance / pairs) : 0.0;
+    double elo = scoreToElo(mean);
+    double error = (scoreToElo(mean + margin) - scoreToElo(mean - margin)) / 2.0;
+
+    printf("%d games: +%d -%d =%d, %.1f%%, elo %.1f +- %.1f, penta [%d %d %d %d %d]", m->wins + m->losses + m->draws,
+           m->wins, m->losses, m->draws, 100.0 * mean, elo, isfinite(error) ? error : 0.0,
+           m->penta[0], m->penta[1], m->penta[2], m->penta[3], m->penta[4]);
+    if(m->sprt)
+        printf(", llr %.2f [%.2f, %.2f]", m->llr, m->lowerBound, m->upperBound);
+    printf("\n");
+    fflush(stdout);
+}
+
+static double firstScore(const Game* game) {
+    if(game->result == RESULT_DRAW)
+        return 0.5;
+    bool whiteWon = game->result == RESULT_WHITE_WINS;
+    return whiteWon == (game->white == 0) ? 1.0 : 0.0;
+}
+
+static void recordPair(Match* m, int pair, const Game* games) {
+    pthread_mutex_lock(&m->lock);
+
+    double points = 0.0;
+    for(int i = 0; i < 2; i++) {
+        double s = firstScore(&games[i]);
+        points += s;
+        if(s == 1.0)
+            m->wins++;
+        else if(s == 0.0)
+            m->losses++;
+        else
+            m->draws++;
+        m->ends[games[i].end]++;
+        if(m->pgn)
+            writeGame(m, &games[i], pair + 1, i + 1);
+    }
+    m->penta[(int)(points * 2.0 + 0.5)]++;
+    if(m->pgn)
+        fflush(m->pgn);
+
+    // the first crossing decides, pairs already running finish without changing it
+    if(m->sprt && !m->decision) {
+        m->llr = computeLlr(m);
+        if(m->llr >= m->upperBound)
+            m->decision = 1;
+        else if(m->llr <= m->lowerBound)
+            m->decision = -1;
+        if(m->decision)
+            atomic_store(&m->stop, true);
+    }
+
+    int64_t now = getTimeMs();
+    if(now - m->lastProgress >= PROGRESS_INTERVAL_MS) {
+        m->lastProgress = now;
+        printProgress(m);
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Match* m = w->match;
+    Game* games = malloc(sizeof(Game) * 2);
+    ASSERT(games != null, "Failed to allocate the games!\n");
+
+    for(int i = 0; i < 2; i++) {
+        w->players[i].command = m->commands[i];
+        if(!playerStart(&w->players[i], m->names[i], m->hashMb)) {
+            ERROR("Can't start %s\n", m->commands[i]);
+            atomic_store(&m->stop, true);
+        }
+    }
+
+    int pair;
+    while(!atomic_load(&m->stop) && (pair = atomic_fetch_add(&m->nextPair, 1)) < m->pairs) {
+        const Position* opening = &m->openings[pair % m->openingCount];
+        // a pair cut in half would skew the pentanomial counts
+        if(!playGame(w, opening, 0, &games[0]) || atomic_load(&m->stop))
+            break;
+        if(!playGame(w, opening, 1, &games[1]))
+            break;
+        recordPair(m, pair, games);
+    }
+
+    for(int i = 0; i < 2; i++)
+        playerStop(&w->players[i]);
+    free(games);
+    return null;
+}
+
+// One FEN or EPD per line, the operations after the position are ignored
+static bool loadOpenings(Match* m, const char* path) {
+    MappedFile file;
+    if(!mapFile(&file, path))
+        return false;
+
+    const char* text = (const char*)file.data;
+    size_t offset = 0;
+    int capacity = 0, lineNumber = 0;
+    while(offset < file.size && m->openingCount < MAX_OPENINGS) {
+        const char* line = text + offset;
+        const char* newline = memchr(line, '\n', file.size - offset);
+        size_t length = newline ? (size_t)(newline - line) : file.size - offset;
+        offset += length + 1;
+        lineNumber++;
+        if(!length || line[0] == '#' || line[0] == '\r')
+            continue;
+
+        if(m->openingCount == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            m->openings = realloc(m->openings, sizeof(Position) * capacity);
+            ASSERT(m->openings != null, "Failed to allocate the openings!\n");
+        }
+        if(!positionParseFen(&m->openings[m->openingCount], line, length)) {
+            ERROR("%s:%d: invalid position\n", path, lineNumber);
+            continue;
+        }
+        m->openingCount++;
+    }
+    unmapFile(&file);
+    return true;
+}
+
+// "40+0.4" or "40" in seconds
+static bool parseTimeControl(Match* m, const char* text) {
+    char* end;
+    double base = strtod(text, &end);
+    double inc = 0.0;
+    if(*end == '+')
+        inc = strtod(end + 1, &end);
+    if(*end || base <= 0.0 || inc < 0.0)
+        return false;
+    m->baseUs = (int64_t)(base * 1e6);
+    m->incUs = (int64_t)(inc * 1e6);
+    m->timeControl = text;
+    return true;
+}
+
+static void printUsage(void) {
+    printf("Usage: match [-t threads] [-g games] [-tc base+inc] [-H hash MB] [-e openings.epd] [-o games.pgn]\n");
+    printf("             [-sprt elo0 elo1] [-a alpha] [-b beta] [-n1 name] [-n2 name] engine1 engine2\n");
+    printf("  the engines are command lines, one game per thread, -tc in seconds (10+0.1 by default),\n");
+    printf("  every opening is played twice with the colours swapped, -sprt stops at a decision\n");
+}
+
+int main(int argc, char** argv) {
+    Match m = { .hashMb = 16, .alpha = 0.05, .beta = 0.05, .timeControl = "10+0.1" };
+    int threads = getCpuCount();
+    int games = 0;
+    const char* openingsPath = null;
+    const char* pgnPath = null;
+    parseTimeControl(&m, m.timeControl);
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-g") && i + 1 < argc)
+            games = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-tc") && i + 1 < argc) {
+            if(!parseTimeControl(&m, argv[++i])) {
+                ERROR("Invalid time control: %s\n", argv[i]);
+                return 1;
+            }
+        } else if(!strcmp(argv[i], "-H") && i + 1 < argc)
+            m.hashMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-e") && i + 1 < argc)
+            openingsPath = argv[++i];
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            pgnPath = argv[++i];
+        else if(!strcmp(argv[i], "-sprt") && i + 2 < argc) {
+            m.sprt = true;
+            m.elo0 = atof(argv[++i]);
+            m.elo1 = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "-a") && i + 1 < argc)
+            m.alpha = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-b") && i + 1 < argc)
+            m.beta = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-n1") && i + 1 < argc)
+            m.names[0] = argv[++i];
+        else if(!strcmp(argv[i], "-n2") && i + 1 < argc)
+            m.names[1] = argv[++i];
+        else
+            break;
+    }
+    if(i + 2 != argc || (m.sprt && (m.elo1 <= m.elo0 || m.alpha <= 0.0 || m.beta <= 0.0))) {
+        printUsage();
+        return 1;
+    }
+    m.commands[0] = argv[i];
+    m.commands[1] = argv[i + 1];
+    if(threads < 1)
+        threads = 1;
+    // an SPRT runs until it decides, the cap is only there to end it at all
+    if(games <= 0)
+        games = m.sprt ? 200000 : 1000;
+    m.pairs = (games + 1) / 2;
+    m.lowerBound = log(m.beta / (1.0 - m.alpha));
+    m.upperBound = log((1.0 - m.beta) / m.alpha);
+
+    initPosition();
+    if(openingsPath && !loadOpenings(&m, openingsPath)) {
+        ERROR("Can't read %s\n", openingsPath);
+        return 1;
+    }
+    if(!m.openingCount) {
+        if(openingsPath)
+            ERROR("No openings in %s, playing from the start\n", openingsPath);
+        m.openings = malloc(sizeof(Position));
+        ASSERT(m.openings != null, "Failed to allocate the openings!\n");
+        positionSetStart(&m.openings[0]);
+        m.openingCount = 1;
+    }
+    if(pgnPath && !(m.pgn = fopen(pgnPath, "a"))) {
+        ERROR("Can't write %s\n", pgnPath);
+        return 1;
+    }
+    if(threads > m.pairs)
+        threads = m.pairs;
+
+    // engines answering uci set their names, the workers all see the same ones
+    static Player probes[2];
+    char names[2][64];
+    for(int e = 0; e < 2; e++) {
+        probes[e].command = m.commands[e];
+        if(!playerStart(&probes[e], m.names[e], m.hashMb)) {
+            ERROR("Can't start %s\n", m.commands[e]);
+            return 1;
+        }
+        snprintf(names[e], sizeof(names[e]), "%s", probes[e].name[0] ? probes[e].name : m.commands[e]);
+        m.names[e] = names[e];
+        playerStop(&probes[e]);
+    }
+
+    time_t now = time(null);
+    strftime(m.date, sizeof(m.date), "%Y.%m.%d", localtime(&now));
+    pthread_mutex_init(&m.lock, null);
+    INFO("%s vs %s, %d games at %s on %d threads, %d openings\n", m.names[0], m.names[1], m.pairs * 2,
+         m.timeControl, threads, m.openingCount);
+    if(m.sprt)
+        INFO("SPRT elo0 %.1f elo1 %.1f alpha %.3f beta %.3f, bounds [%.2f, %.2f]\n", m.elo0, m.elo1,
+             m.alpha, m.beta, m.lowerBound, m.upperBound);
+
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(workers != null && handles != null, "Failed to allocate the workers!\n");
+
+    m.start = m.lastProgress = getTimeMs();
+    for(int t = 0; t < threads; t++) {
+        workers[t].match = &m;
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    }
+    for(int t = 0; t < threads; t++)
+        pthread_join(handles[t], null);
+
+    printProgress(&m);
+    for(int e = END_MATE; e <= END_CRASH; e++) {
+        if(m.ends[e])
+            printf("  %-22s %d\n", END_TEXT[e], m.ends[e]);
+    }
+    if(m.sprt)
+        printf("%s\n", m.decision > 0 ? "H1 accepted" : m.decision < 0 ? "H0 accepted" : "no decision");
+    printf("%.1fs\n", (getTimeMs() - m.start) / 1000.0);
+    if(m.failed)
+        ERROR("The match was aborted, an engine couldn't be restarted\n");
+
+    if(m.pgn)
+        fclose(m.pgn);
+    pthread_mutex_destroy(&m.lock);
+    free(workers);
+    free(handles);
+    free(m.openings);
+    return m.failed ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "position.h"
+#include "ingest.h"
+#include "platform.h"
+
+// Parses and replays every game of PGN files on all cores and reports the throughput,
+// mostly a check that a dump is readable and a measure of how fast it can be indexed
+
+typedef struct {
+    IngestStats total;
+    uint64_t fileGames;
+    int64_t lastReport;
+    int64_t start;
+    uint64_t startBytes;
+} Scan;
+
+static void printRate(const char* prefix, uint64_t games, uint64_t bytes, int64_t ms) {
+    double seconds = ms > 0 ? ms / 1000.0 : 0.001;
+    printf("%s%llu games, %.1f MB in %.1fs: %.0f games/s, %.1f MB/s\n", prefix, (unsigned long long)games,
+           bytes / 1048576.0, ms / 1000.0, games / seconds, bytes / 1048576.0 / seconds);
+    fflush(stdout);
+}
+
+static bool onChunk(const IngestChunk* chunk, void* user) {
+    Scan* scan = (Scan*)user;
+    scan->fileGames += chunk->games;
+    scan->startBytes += chunk->length;
+
+    int64_t now = getTimeMs();
+    if(now - scan->lastReport >= 1000) {
+        scan->lastReport = now;
+        printRate("  ", scan->fileGames, scan->startBytes, now - scan->start);
+    }
+    return true;
+}
+
+static void scanFile(Scan* scan, const IngestOptions* options, const char* path) {
+    IngestStats stats = {0};
+    scan->fileGames = 0;
+    scan->startBytes = 0;
+    scan->start = scan->lastReport = getTimeMs();
+
+    printf("%s\n", path);
+    if(!ingestPgnFile(path, options, &stats)) {
+        ERROR("Can't read %s\n", path);
+        return;
+    }
+    printRate("  ", stats.games, stats.bytes, stats.time);
+    if(stats.broken)
+        printf("  %llu games with unreadable or too many moves\n", (unsigned long long)stats.broken);
+
+    scan->total.games += stats.games;
+    scan->total.plies += stats.plies;
+    scan->total.broken += stats.broken;
+    scan->total.bytes += stats.bytes;
+    scan->total.time += stats.time;
+}
+
+typedef struct {
+    Scan* scan;
+    const IngestOptions* options;
+} DirectoryScan;
+
+static void scanDirectoryFile(const char* dir, const char* name, void* user) {
+    DirectoryScan* d = (DirectoryScan*)user;
+    size_t len = strlen(name);
+    if(len < 4 || strcmp(name + len - 4, ".pgn") != 0)
+        return;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    scanFile(d->scan, d->options, path);
+}
+
+int main(int argc, char** argv) {
+    IngestOptions options = { .maxPly = PGN_MAX_PLY };
+    Scan scan = {0};
+    options.onChunk = onChunk;
+    options.user = &scan;
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-p") && i + 1 < argc)
+            options.maxPly = atoi(argv[++i]);
+        else
+            break;
+    }
+    if(i == argc) {
+        printf("Usage: pgnscan [-t threads] [-p plies] <pgn dir or file ...>\n");
+        return 1;
+    }
+
+    initPosition();
+
+    DirectoryScan d = { &scan, &options };
+    for(; i < argc; i++) {
+        if(!listDirectory(argv[i], scanDirectoryFile, &d))
+            scanFile(&scan, &options, argv[i]);
+    }
+
+    printRate("total: ", scan.total.games, scan.total.bytes, scan.total.time);
+    printf("%llu plies replayed, %llu games with unreadable or too many moves\n",
+           (unsigned long long)scan.total.plies, (unsigned long long)scan.total.broken);
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "gamedb.h"
+#include "posindex.h"
+#include "runs.h"
+#include "platform.h"
+
+// Builds the position index of a game database
+//
+// Every thread takes blocks of games off a shared counter, replays them and collects
+// (key, game, ply) entries. A full buffer is radix sorted by key and written to a run
+// file, the sort is stable and the blocks are taken in order so a run is sorted by
+// game too. The runs are merged into the index at the end, a game reaching the same
+// position twice keeps its first ply only.
+
+#define GAME_BLOCK 4096
+
+typedef struct {
+    uint64_t key;
+    uint32_t game;
+    uint16_t ply;
+    uint16_t pad;
+} Entry;
+
+typedef struct {
+    GameDb db;
+    _Atomic uint64_t nextBlock;
+    const char* output;
+    size_t bufferEntries;
+
+    RunSet runs;
+
+    _Atomic uint64_t entries;
+    _Atomic uint64_t broken;
+} Builder;
+
+typedef struct {
+    Builder* builder;
+    Entry* buffer;
+    Entry* scratch;
+    size_t count;
+    bool failed;
+} Worker;
+
+// LSD radix sort by key, 16 bits a pass
+static void sortEntries(Entry* entries, Entry* scratch, size_t count) {
+    static _Thread_local size_t counts[1 << 16];
+    Entry* from = entries;
+    Entry* to = scratch;
+
+    for(int shift = 0; shift < 64; shift += 16) {
+        memset(counts, 0, sizeof(counts));
+        for(size_t i = 0; i < count; i++)
+            counts[(from[i].key >> shift) & 0xFFFF]++;
+        size_t sum = 0;
+        for(int i = 0; i < 1 << 16; i++) {
+            size_t c = counts[i];
+            counts[i] = sum;
+            sum += c;
+        }
+        for(size_t i = 0; i < count; i++)
+            to[counts[(from[i].key >> shift) & 0xFFFF]++] = from[i];
+
+        Entry* tmp = from;
+        from = to;
+        to = tmp;
+    }
+    // four passes end up back in 'entries'
+}
+
+static bool spillRun(Worker* w) {
+    sortEntries(w->buffer, w->scratch, w->count);
+    bool ok = runSetWrite(&w->builder->runs, w->buffer, w->count);
+    w->count = 0;
+    return ok;
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    Builder* b = w->builder;
+    Move moves[PGN_MAX_PLY];
+
+    uint64_t block;
+    while(!w->failed && (block = atomic_fetch_add(&b->nextBlock, 1)) * GAME_BLOCK < b->db.count) {
+        uint64_t end = (block + 1) * GAME_BLOCK < b->db.count ? (block + 1) * GAME_BLOCK : b->db.count;
+        for(uint64_t game = block * GAME_BLOCK; game < end && !w->failed; game++) {
+            Position pos;
+            int ply = gameDbMoves(&b->db, game, &pos, moves, PGN_MAX_PLY);
+            if(ply < 0) {
+                atomic_fetch_add_explicit(&b->broken, 1, memory_order_relaxed);
+                continue;
+            }
+            if(w->count + (size_t)ply + 1 > b->bufferEntries && !spillRun(w))
+                w->failed = true;
+
+            for(int i = 0; i <= ply; i++) {
+                w->buffer[w->count++] = (Entry){ pos.key, (uint32_t)game, (uint16_t)i, 0 };
+                if(i < ply)
+                    positionMakeMove(&pos, moves[i]);
+            }
+            atomic_fetch_add_explicit(&b->entries, (uint64_t)ply + 1, memory_order_relaxed);
+        }
+    }
+    if(!w->failed && !spillRun(w))
+        w->failed = true;
+
+    return null;
+}
+
+static int compareEntries(const void* a, const void* b) {
+    const Entry* x = a;
+    const Entry* y = b;
+    if(x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    if(x->game != y->game)
+        return x->game < y->game ? -1 : 1;
+    return (int)x->ply - (int)y->ply;
+}
+
+static bool mergeRuns(Builder* b, uint64_t* written) {
+    RunMerge merge;
+    if(!runMergeOpen(&merge, &b->runs))
+        return false;
+    FILE* out = fopen(b->output, "wb");
+    if(!out) {
+        ERROR("Can't create %s\n", b->output);
+        runMergeClose(&merge, &b->runs);
+        return false;
+    }
+
+    uint8_t header[POSINDEX_HEADER_SIZE] = {0};
+    bool ok = fwrite(header, 1, POSINDEX_HEADER_SIZE, out) == POSINDEX_HEADER_SIZE;
+
+    static uint8_t block[POSINDEX_ENTRY_SIZE * 4096];
+    size_t blockSize = 0;
+    Entry e, last = { .game = UINT32_MAX };
+    *written = 0;
+
+    while(ok && runMergeNext(&merge, &e)) {
+        // repetitions within a game
+        if(e.key == last.key && e.game == last.game)
+            continue;
+        last = e;
+
+        posIndexWriteEntry(block + blockSize, e.key, e.game, e.ply);
+        blockSize += POSINDEX_ENTRY_SIZE;
+        (*written)++;
+        if(blockSize == sizeof(block)) {
+            ok = fwrite(block, 1, blockSize, out) == blockSize;
+            blockSize = 0;
+        }
+    }
+    ok = runMergeClose(&merge, &b->runs) && ok;
+    if(ok && blockSize)
+        ok = fwrite(block, 1, blockSize, out) == blockSize;
+
+    memcpy(header, "CPI1", 4);
+    for(int i = 0; i < 8; i++) {
+        header[8 + i] = (uint8_t)(*written >> (8 * i));
+        header[16 + i] = (uint8_t)(b->db.count >> (8 * i));
+    }
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(header, 1, POSINDEX_HEADER_SIZE, out) == POSINDEX_HEADER_SIZE;
+    ok = fclose(out) == 0 && ok;
+    // a partial index must not pass for a complete one
+    if(!ok)
+        remove(b->output);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    Builder b = {0};
+    int threads = getCpuCount();
+    size_t memoryMb = 1024;
+
+    int i = 1;
+    for(; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-M") && i + 1 < argc)
+            memoryMb = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            b.output = argv[++i];
+        else
+            break;
+    }
+    if(!b.output || i + 1 != argc) {
+        printf("Usage: posindex [-t threads] [-M memory MB] -o games.cpi games.cgd\n");
+        return 1;
+    }
+    if(threads < 1)
+        threads = 1;
+
+    initPosition();
+    if(!gameDbOpen(&b.db, argv[i])) {
+        ERROR("Can't read %s\n", argv[i]);
+        return 1;
+    }
+    runSetInit(&b.runs, b.output, sizeof(Entry), compareEntries);
+
+    // every thread has a buffer and the sort scratch of the same size
+    b.bufferEntries = memoryMb * (1 << 20) / sizeof(Entry) / 2 / threads;
+    if(b.bufferEntries < 2 * PGN_MAX_PLY)
+        b.bufferEntries = 2 * PGN_MAX_PLY;
+
+    int64_t start = getTimeMs();
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+    ASSERT(workers != null && handles != null, "Failed to allocate the workers!\n");
+    for(int t = 0; t < threads; t++) {
+        workers[t].builder = &b;
+        workers[t].buffer = malloc(sizeof(Entry) * b.bufferEntries);
+        workers[t].scratch = malloc(sizeof(Entry) * b.bufferEntries);
+        ASSERT(workers[t].buffer != null && workers[t].scratch != null, "Failed to allocate a sort buffer!\n");
+        pthread_create(&handles[t], null, workerMain, &workers[t]);
+    }
+
+    bool ok = true;
+    for(int t = 0; t < threads; t++) {
+        pthread_join(handles[t], null);
+        ok = ok && !workers[t].failed;
+        free(workers[t].buffer);
+        free(workers[t].scratch);
+    }
+    free(workers);
+    free(handles);
+
+    int64_t sorted = getTimeMs();
+    INFO("%llu games, %llu positions in %.1fs, %d runs\n", (unsigned long long)b.db.count,
+         (unsigned long long)b.entries, (sorted - start) / 1000.0, b.runs.count);
+    if(b.broken)
+        INFO("%llu games with a broken FEN skipped\n", (unsigned long long)b.broken);
+
+    uint64_t written = 0;
+    ok = ok && mergeRuns(&b, &written);
+    if(ok)
+        INFO("%llu entries written to %s in %.1fs\n", (unsigned long long)written, b.output, (getTimeMs() - sorted) / 1000.0);
+    else
+        ERROR("Failed to build %s\n", b.output);
+
+    runSetFree(&b.runs);
+    gameDbClose(&b.db);
+    return ok ? 0 : 1;
+}
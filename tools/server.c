@@ -0,0 +1,848 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "defines.h"
+#include "position.h"
+#include "platform.h"
+
+// Hosts games between TCP clients, every move is checked with the rules code
+//
+// Linux only, the sockets are multiplexed with epoll. The main thread accepts and hands
+// every connection to one of the worker threads, whose epoll owns it from then on, so a
+// connection's input is only ever handled by one thread. A move is written to the
+// opponent's socket right away by the thread that validated it, whatever doesn't fit is
+// buffered and flushed by the owner once the socket drains (edge triggered EPOLLOUT).
+//
+// The protocol is a line per command:
+//   new [fen]     -> game <id> white, the game waits for an opponent
+//   join <id>     -> start <id> <fen> to both players
+//   move <e2e4>   -> move <e2e4> to both players or illegal <e2e4> to the mover
+//   resign
+//   watch <id>    -> the connection spectates, frames instead of lines from then on
+// and end <result> <reason> when a game is over.
+//
+// A spectator frame is a type byte, a zero byte, the payload size (16 bits) and the game
+// id (32 bits), little endian, then the payload:
+//   FRAME_SNAPSHOT  ply (16 bits) and the FEN, the first frame and after a backlog
+//   FRAME_MOVE      the move (16 bits, see position.h) and the ply after it
+//   FRAME_END       result and reason as text, nothing of the game follows
+// Every frame is encoded once and queued by reference on all spectators, a queue is
+// written with one vectored send. A spectator whose queue fills up has its backlog
+// replaced by a snapshot of the position and is dropped if that keeps happening.
+
+#define MAX_GAMES (1 << 16)
+#define MAX_WORKERS 64
+#define EVENTS_PER_WAIT 256
+#define LINE_LENGTH 256
+// a client this far behind is dropped instead of buffering without limit
+#define MAX_PENDING_OUTPUT (1 << 20)
+#define STATS_INTERVAL_MS 10000
+// frames queued per spectator, more are coalesced into a snapshot
+#define SPECTATOR_QUEUE 64
+#define MAX_COALESCED 8
+#define FRAME_HEADER 8
+
+typedef enum {
+    FRAME_SNAPSHOT = 1,
+    FRAME_MOVE = 2,
+    FRAME_END = 3
+} FrameType;
+
+// Immutable once encoded, freed by whoever drops the last reference
+typedef struct {
+    _Atomic int refs;
+    uint32_t size;
+    uint8_t data[];
+} Frame;
+
+typedef enum {
+    GAME_FREE,
+    GAME_WAITING,
+    GAME_PLAYING
+} GameState;
+
+typedef struct Connection {
+    int fd;
+    _Atomic int game; // -1 without one, the game's 'players' are the truth
+    PieceTeam team;
+
+    char in[LINE_LENGTH];
+    int inSize;
+
+    // output other threads may add to
+    pthread_mutex_t lock;
+    char* out;
+    size_t outSize, outCapacity;
+    atomic_bool broken;
+
+    // set by watch, spectators only get frames, guarded by 'lock' like the output
+    bool spectator;
+    _Atomic int watching; // game id or -1, the game's 'spectators' are the truth
+    int spectatorIndex;   // in the game's list, guarded by the game's lock
+    Frame* frames[SPECTATOR_QUEUE];
+    int frameHead, frameCount;
+    uint32_t frameOffset; // bytes of the head frame already sent
+    int coalesced;        // backlogs replaced since the queue last drained
+} Connection;
+
+// Everything the server keeps per game, the repetition history only goes back to the
+// last irreversible move which the fifty move rule caps at 100 plies
+typedef struct {
+    pthread_mutex_t lock;
+    GameState state;
+    Position pos;
+    uint64_t history[100];
+    uint8_t historyCount;
+    uint16_t ply;
+    Connection* players[TEAMS];
+
+    Connection** spectators;
+    int spectatorCount, spectatorCapacity;
+    Frame* snapshot; // of the current position, built when a spectator needs one
+} ServerGame;
+
+typedef struct {
+    int epoll;
+    pthread_t thread;
+} Worker;
+
+typedef struct {
+    ServerGame* games;
+    int freeGames[MAX_GAMES];
+    int freeCount;
+    pthread_mutex_t gamesLock;
+
+    Worker workers[MAX_WORKERS];
+    int workerCount;
+
+    _Atomic uint64_t connections;
+    _Atomic uint64_t activeGames;
+    _Atomic uint64_t finishedGames;
+    _Atomic uint64_t moves;
+    _Atomic uint64_t validationUs; // total over 'moves'
+    _Atomic uint64_t maxValidationUs;
+    _Atomic uint64_t spectators;
+    _Atomic uint64_t frames;    // encoded
+    _Atomic uint64_t coalesced; // backlogs replaced by a snapshot
+} Server;
+
+static Server server;
+
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Sends now what the socket takes and buffers the rest, the owner thread flushes it
+static void sendText(Connection* c, const char* text, size_t length) {
+    pthread_mutex_lock(&c->lock);
+    if(c->broken) {
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+
+    size_t sent = 0;
+    if(!c->outSize) {
+        while(sent < length) {
+            ssize_t n = send(c->fd, text + sent, length - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if(n > 0) {
+                sent += (size_t)n;
+            } else if(n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                    c->broken = true;
+                break;
+            }
+        }
+    }
+
+    size_t left = length - sent;
+    if(left && !c->broken) {
+        if(c->outSize + left > MAX_PENDING_OUTPUT) {
+            c->broken = true;
+        } else {
+            if(c->outSize + left > c->outCapacity) {
+                size_t capacity = c->outCapacity ? c->outCapacity : 1024;
+                while(capacity < c->outSize + left)
+                    capacity *= 2;
+                char* out = realloc(c->out, capacity);
+                ASSERT(out != null, "Failed to allocate an output buffer!\n");
+                c->out = out;
+                c->outCapacity = capacity;
+            }
+            memcpy(c->out + c->outSize, text + sent, left);
+            c->outSize += left;
+        }
+    }
+    // a broken socket is closed by its owner, shutdown wakes it up
+    if(c->broken)
+        shutdown(c->fd, SHUT_RDWR);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void sendLine(Connection* c, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static void sendLine(Connection* c, const char* fmt, ...) {
+    char line[LINE_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line) - 1, fmt, args);
+    va_end(args);
+    if(n < 0)
+        return;
+    if(n > (int)sizeof(line) - 2)
+        n = (int)sizeof(line) - 2;
+    line[n++] = '\n';
+    sendText(c, line, (size_t)n);
+}
+
+static Frame* frameCreate(FrameType type, int game, const void* payload, uint16_t size) {
+    Frame* frame = malloc(sizeof(Frame) + FRAME_HEADER + size);
+    ASSERT(frame != null, "Failed to allocate a frame!\n");
+    atomic_init(&frame->refs, 1);
+    frame->size = FRAME_HEADER + size;
+
+    uint8_t* d = frame->data;
+    d[0] = (uint8_t)type;
+    d[1] = 0;
+    d[2] = (uint8_t)size;
+    d[3] = (uint8_t)(size >> 8);
+    for(int i = 0; i < 4; i++)
+        d[4 + i] = (uint8_t)((uint32_t)game >> (8 * i));
+    memcpy(d + FRAME_HEADER, payload, size);
+    atomic_fetch_add_explicit(&server.frames, 1, memory_order_relaxed);
+    return frame;
+}
+
+static inline Frame* frameRetain(Frame* frame) {
+    atomic_fetch_add_explicit(&frame->refs, 1, memory_order_relaxed);
+    return frame;
+}
+
+static inline void frameRelease(Frame* frame) {
+    if(frame && atomic_fetch_sub_explicit(&frame->refs, 1, memory_order_acq_rel) == 1)
+        free(frame);
+}
+
+// Writes the queued frames with one vectored send per round, called with 'lock' held
+static void sendFrames(Connection* c) {
+    while(c->frameCount && !c->broken) {
+        struct iovec parts[SPECTATOR_QUEUE];
+        for(int i = 0; i < c->frameCount; i++) {
+            Frame* frame = c->frames[(c->frameHead + i) % SPECTATOR_QUEUE];
+            uint32_t skip = i ? 0 : c->frameOffset;
+            parts[i].iov_base = frame->data + skip;
+            parts[i].iov_len = frame->size - skip;
+        }
+        struct msghdr message = { .msg_iov = parts, .msg_iovlen = (size_t)c->frameCount };
+        ssize_t n = sendmsg(c->fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK)
+                c->broken = true;
+            return;
+        }
+
+        size_t sent = (size_t)n;
+        while(c->frameCount) {
+            Frame* frame = c->frames[c->frameHead];
+            size_t left = frame->size - c->frameOffset;
+            if(sent < left) {
+                c->frameOffset += (uint32_t)sent;
+                break;
+            }
+            sent -= left;
+            frameRelease(frame);
+            c->frameHead = (c->frameHead + 1) % SPECTATOR_QUEUE;
+            c->frameCount--;
+            c->frameOffset = 0;
+        }
+        if(!c->frameCount)
+            c->coalesced = 0;
+    }
+}
+
+static void flushOutput(Connection* c) {
+    pthread_mutex_lock(&c->lock);
+    size_t sent = 0;
+    while(sent < c->outSize && !c->broken) {
+        ssize_t n = send(c->fd, c->out + sent, c->outSize - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(n > 0)
+            sent += (size_t)n;
+        else if(n < 0 && errno == EINTR)
+            continue;
+        else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            c->broken = true;
+    }
+    memmove(c->out, c->out + sent, c->outSize - sent);
+    c->outSize -= sent;
+    // the lines sent before watch go first
+    if(!c->outSize)
+        sendFrames(c);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static inline void pushFrame(Connection* c, Frame* frame) {
+    c->frames[(c->frameHead + c->frameCount++) % SPECTATOR_QUEUE] = frameRetain(frame);
+}
+
+// The game's current position as a frame, shared until the next move. The game is locked.
+static Frame* gameSnapshot(ServerGame* game) {
+    if(!game->snapshot) {
+        uint8_t payload[2 + FEN_MAX_LENGTH + 1];
+        payload[0] = (uint8_t)game->ply;
+        payload[1] = (uint8_t)(game->ply >> 8);
+        int length = positionGetFen(&game->pos, (char*)payload + 2);
+        game->snapshot = frameCreate(FRAME_SNAPSHOT, (int)(game - server.games), payload, (uint16_t)(2 + length));
+    }
+    return game->snapshot;
+}
+
+// Queues the frame on a spectator of the locked game, a full queue is replaced by a
+// snapshot, which already has the moves it stood for
+static void queueFrame(Connection* c, ServerGame* game, Frame* frame) {
+    pthread_mutex_lock(&c->lock);
+    if(c->broken) {
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+
+    bool idle = !c->frameCount && !c->outSize;
+    if(c->frameCount < SPECTATOR_QUEUE) {
+        pushFrame(c, frame);
+    } else if(++c->coalesced > MAX_COALESCED) {
+        // not even the snapshots get through
+        c->broken = true;
+    } else {
+        // a frame written in part has to be finished to keep the stream in step
+        int keep = c->frameOffset ? 1 : 0;
+        for(int i = keep; i < c->frameCount; i++)
+            frameRelease(c->frames[(c->frameHead + i) % SPECTATOR_QUEUE]);
+        c->frameCount = keep;
+        pushFrame(c, gameSnapshot(game));
+        if(frame->data[0] != FRAME_MOVE)
+            pushFrame(c, frame);
+        atomic_fetch_add_explicit(&server.coalesced, 1, memory_order_relaxed);
+    }
+    if(idle)
+        sendFrames(c);
+    if(c->broken)
+        shutdown(c->fd, SHUT_RDWR);
+    pthread_mutex_unlock(&c->lock);
+}
+
+// Hands the frame to every spectator of the locked game and drops the caller's reference
+static void broadcast(ServerGame* game, Frame* frame) {
+    for(int i = 0; i < game->spectatorCount; i++)
+        queueFrame(game->spectators[i], game, frame);
+    frameRelease(frame);
+}
+
+static int allocateGame(void) {
+    pthread_mutex_lock(&server.gamesLock);
+    int id = server.freeCount ? server.freeGames[--server.freeCount] : -1;
+    pthread_mutex_unlock(&server.gamesLock);
+    return id;
+}
+
+// Called with the game locked, the slot can be handed out again once it's unlocked
+static void releaseGame(ServerGame* game) {
+    for(int team = 0; team < TEAMS; team++) {
+        if(game->players[team])
+            atomic_store(&game->players[team]->game, -1);
+        game->players[team] = null;
+    }
+    for(int i = 0; i < game->spectatorCount; i++)
+        atomic_store(&game->spectators[i]->watching, -1);
+    atomic_fetch_sub(&server.spectators, (uint64_t)game->spectatorCount);
+    game->spectatorCount = 0;
+    frameRelease(game->snapshot);
+    game->snapshot = null;
+
+    if(game->state == GAME_PLAYING) {
+        atomic_fetch_sub(&server.activeGames, 1);
+        atomic_fetch_add(&server.finishedGames, 1);
+    }
+    game->state = GAME_FREE;
+
+    pthread_mutex_lock(&server.gamesLock);
+    server.freeGames[server.freeCount++] = (int)(game - server.games);
+    pthread_mutex_unlock(&server.gamesLock);
+}
+
+static void endGame(ServerGame* game, const char* result, const char* reason) {
+    for(int team = 0; team < TEAMS; team++) {
+        if(game->players[team])
+            sendLine(game->players[team], "end %s %s", result, reason);
+    }
+    if(game->spectatorCount) {
+        char text[64];
+        int length = snprintf(text, sizeof(text), "%s %s", result, reason);
+        broadcast(game, frameCreate(FRAME_END, (int)(game - server.games), text, (uint16_t)length));
+    }
+    releaseGame(game);
+}
+
+// The connection's game locked, null if it has none. The id is only a hint, the game's
+// players decide since the other player's thread may have ended it meanwhile.
+static ServerGame* lockGame(Connection* c) {
+    int id = atomic_load(&c->game);
+    if(id < 0)
+        return null;
+    ServerGame* game = &server.games[id];
+    pthread_mutex_lock(&game->lock);
+    if(game->state == GAME_FREE || game->players[c->team] != c) {
+        pthread_mutex_unlock(&game->lock);
+        return null;
+    }
+    return game;
+}
+
+static const char* gameEnd(const ServerGame* game, const char** result) {
+    const Position* pos = &game->pos;
+    *result = "1/2-1/2";
+
+    MoveList list;
+    generateLegalMoves(pos, &list);
+    if(!list.count) {
+        if(!positionInCheck(pos))
+            return "stalemate";
+        *result = pos->side == TEAM_WHITE ? "0-1" : "1-0";
+        return "checkmate";
+    }
+    if(pos->halfmoves >= 100)
+        return "fifty-moves";
+    if(!(pos->pieces[TEAM_WHITE][PAWN] | pos->pieces[TEAM_BLACK][PAWN]
+        | pos->pieces[TEAM_WHITE][ROOK] | pos->pieces[TEAM_BLACK][ROOK]
+        | pos->pieces[TEAM_WHITE][QUEEN] | pos->pieces[TEAM_BLACK][QUEEN])
+        && popCount(pos->all) <= 3)
+        return "insufficient-material";
+
+    int repetitions = 0;
+    for(int i = game->historyCount - 4; i >= 0; i -= 2) {
+        if(game->history[i] == pos->key && ++repetitions == 2)
+            return "repetition";
+    }
+    return null;
+}
+
+static void handleNew(Connection* c, const char* args) {
+    if(atomic_load(&c->game) >= 0) {
+        sendLine(c, "error already in a game");
+        return;
+    }
+
+    Position pos;
+    while(*args == ' ')
+        args++;
+    if(!*args) {
+        positionSetStart(&pos);
+    } else if(!positionSetFen(&pos, args)) {
+        sendLine(c, "error invalid fen");
+        return;
+    }
+
+    int id = allocateGame();
+    if(id < 0) {
+        sendLine(c, "error server full");
+        return;
+    }
+    ServerGame* game = &server.games[id];
+    pthread_mutex_lock(&game->lock);
+    game->state = GAME_WAITING;
+    game->pos = pos;
+    game->historyCount = 0;
+    game->ply = 0;
+    game->players[TEAM_WHITE] = c;
+    game->players[TEAM_BLACK] = null;
+    c->team = TEAM_WHITE;
+    atomic_store(&c->game, id);
+    sendLine(c, "game %d white", id);
+    pthread_mutex_unlock(&game->lock);
+}
+
+static void handleJoin(Connection* c, const char* args) {
+    char* end;
+    long id = strtol(args, &end, 10);
+    if(end == args || id < 0 || id >= MAX_GAMES) {
+        sendLine(c, "error no such game");
+        return;
+    }
+    if(atomic_load(&c->game) >= 0) {
+        sendLine(c, "error already in a game");
+        return;
+    }
+
+    ServerGame* game = &server.games[id];
+    pthread_mutex_lock(&game->lock);
+    if(game->state != GAME_WAITING) {
+        pthread_mutex_unlock(&game->lock);
+        sendLine(c, "error no such game");
+        return;
+    }
+    game->state = GAME_PLAYING;
+    game->players[TEAM_BLACK] = c;
+    c->team = TEAM_BLACK;
+    atomic_store(&c->game, (int)id);
+    atomic_fetch_add(&server.activeGames, 1);
+
+    char fen[FEN_MAX_LENGTH + 1];
+    positionGetFen(&game->pos, fen);
+    for(int team = 0; team < TEAMS; team++)
+        sendLine(game->players[team], "start %ld %s", id, fen);
+    pthread_mutex_unlock(&game->lock);
+}
+
+static void handleMove(Connection* c, const char* args) {
+    while(*args == ' ')
+        args++;
+    char text[8] = {0};
+    snprintf(text, sizeof(text), "%.*s", (int)strcspn(args, " "), args);
+
+    ServerGame* game = lockGame(c);
+    if(!game || game->state != GAME_PLAYING || game->pos.side != c->team) {
+        if(game)
+            pthread_mutex_unlock(&game->lock);
+        sendLine(c, "illegal %s", text);
+        return;
+    }
+
+    int64_t start = getTimeUs();
+    Move move = parseMove(&game->pos, text);
+    const char* reason = null;
+    const char* result = null;
+    if(move != MOVE_NONE) {
+        game->history[game->historyCount++] = game->pos.key;
+        positionMakeMove(&game->pos, move);
+        if(!game->pos.halfmoves)
+            game->historyCount = 0;
+        game->ply++;
+        reason = gameEnd(game, &result);
+    }
+    uint64_t time = (uint64_t)(getTimeUs() - start);
+
+    if(move == MOVE_NONE) {
+        pthread_mutex_unlock(&game->lock);
+        sendLine(c, "illegal %s", text);
+        return;
+    }
+
+    atomic_fetch_add_explicit(&server.moves, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&server.validationUs, time, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&server.maxValidationUs, memory_order_relaxed);
+    while(time > max && !atomic_compare_exchange_weak(&server.maxValidationUs, &max, time))
+        ;
+
+    for(int team = 0; team < TEAMS; team++)
+        sendLine(game->players[team], "move %s", text);
+
+    frameRelease(game->snapshot);
+    game->snapshot = null;
+    if(game->spectatorCount) {
+        uint8_t payload[4] = { (uint8_t)move, (uint8_t)(move >> 8), (uint8_t)game->ply, (uint8_t)(game->ply >> 8) };
+        broadcast(game, frameCreate(FRAME_MOVE, (int)(game - server.games), payload, sizeof(payload)));
+    }
+    if(reason)
+        endGame(game, result, reason);
+    pthread_mutex_unlock(&game->lock);
+}
+
+static void leaveGame(Connection* c, const char* reason) {
+    ServerGame* game = lockGame(c);
+    if(!game)
+        return;
+    endGame(game, game->state != GAME_PLAYING ? "*" : c->team == TEAM_WHITE ? "0-1" : "1-0", reason);
+    pthread_mutex_unlock(&game->lock);
+}
+
+// Stops watching, the game may have ended and let go of the spectator meanwhile
+static void unwatch(Connection* c) {
+    int id = atomic_load(&c->watching);
+    if(id < 0)
+        return;
+    ServerGame* game = &server.games[id];
+    pthread_mutex_lock(&game->lock);
+    int i = c->spectatorIndex;
+    if(atomic_load(&c->watching) == id && i < game->spectatorCount && game->spectators[i] == c) {
+        Connection* last = game->spectators[--game->spectatorCount];
+        game->spectators[i] = last;
+        last->spectatorIndex = i;
+        atomic_store(&c->watching, -1);
+        atomic_fetch_sub(&server.spectators, 1);
+    }
+    pthread_mutex_unlock(&game->lock);
+}
+
+static void handleWatch(Connection* c, const char* args) {
+    char* end;
+    long id = strtol(args, &end, 10);
+    if(atomic_load(&c->game) >= 0) {
+        sendLine(c, "error already in a game");
+        return;
+    }
+    unwatch(c);
+
+    ServerGame* game = end != args && id >= 0 && id < MAX_GAMES ? &server.games[id] : null;
+    if(game)
+        pthread_mutex_lock(&game->lock);
+    if(!game || game->state == GAME_FREE) {
+        if(game)
+            pthread_mutex_unlock(&game->lock);
+        // the connection may be reading frames already
+        if(c->spectator) {
+            const char text[] = "* unknown-game";
+            Frame* frame = frameCreate(FRAME_END, (int)id, text, sizeof(text) - 1);
+            pthread_mutex_lock(&c->lock);
+            if(c->frameCount < SPECTATOR_QUEUE)
+                pushFrame(c, frame);
+            sendFrames(c);
+            pthread_mutex_unlock(&c->lock);
+            frameRelease(frame);
+        } else {
+            sendLine(c, "error no such game");
+        }
+        return;
+    }
+
+    if(game->spectatorCount == game->spectatorCapacity) {
+        int capacity = game->spectatorCapacity ? game->spectatorCapacity * 2 : 16;
+        Connection** spectators = realloc(game->spectators, sizeof(Connection*) * capacity);
+        ASSERT(spectators != null, "Failed to allocate the spectators!\n");
+        game->spectators = spectators;
+        game->spectatorCapacity = capacity;
+    }
+    c->spectatorIndex = game->spectatorCount;
+    game->spectators[game->spectatorCount++] = c;
+    atomic_store(&c->watching, (int)id);
+    atomic_fetch_add(&server.spectators, 1);
+
+    pthread_mutex_lock(&c->lock);
+    c->spectator = true;
+    pthread_mutex_unlock(&c->lock);
+    queueFrame(c, game, gameSnapshot(game));
+    pthread_mutex_unlock(&game->lock);
+}
+
+static void handleLine(Connection* c, char* line) {
+    char* args = line;
+    while(*args && *args != ' ')
+        args++;
+    if(*args)
+        *args++ = '\0';
+
+    // a spectator's stream is frames only, it can only switch games
+    if(!strcmp(line, "watch"))
+        handleWatch(c, args);
+    else if(c->spectator)
+        return;
+    else if(!strcmp(line, "move"))
+        handleMove(c, args);
+    else if(!strcmp(line, "new"))
+        handleNew(c, args);
+    else if(!strcmp(line, "join"))
+        handleJoin(c, args);
+    else if(!strcmp(line, "resign"))
+        leaveGame(c, "resignation");
+    else if(*line)
+        sendLine(c, "error unknown command %s", line);
+}
+
+static void closeConnection(Worker* w, Connection* c) {
+    leaveGame(c, "abandoned");
+    unwatch(c);
+    for(int i = 0; i < c->frameCount; i++)
+        frameRelease(c->frames[(c->frameHead + i) % SPECTATOR_QUEUE]);
+    epoll_ctl(w->epoll, EPOLL_CTL_DEL, c->fd, null);
+    close(c->fd);
+    pthread_mutex_destroy(&c->lock);
+    free(c->out);
+    free(c);
+    atomic_fetch_sub(&server.connections, 1);
+}
+
+// Reads until the socket is drained, edge triggered events come only once. False when
+// the connection has to be closed.
+static bool readInput(Connection* c) {
+    while(true) {
+        ssize_t n = recv(c->fd, c->in + c->inSize, sizeof(c->in) - c->inSize, 0);
+        if(n == 0)
+            return false;
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->inSize += (int)n;
+
+        int start = 0;
+        for(int i = 0; i < c->inSize; i++) {
+            if(c->in[i] != '\n')
+                continue;
+            c->in[i] = '\0';
+            if(i > start && c->in[i - 1] == '\r')
+                c->in[i - 1] = '\0';
+            handleLine(c, c->in + start);
+            start = i + 1;
+        }
+        if(start == 0 && c->inSize == (int)sizeof(c->in))
+            return false; // no command is that long
+        memmove(c->in, c->in + start, c->inSize - start);
+        c->inSize -= start;
+    }
+}
+
+static void* workerMain(void* arg) {
+    Worker* w = (Worker*)arg;
+    struct epoll_event events[EVENTS_PER_WAIT];
+
+    while(true) {
+        int count = epoll_wait(w->epoll, events, EVENTS_PER_WAIT, -1);
+        if(count < 0 && errno != EINTR)
+            break;
+        for(int i = 0; i < count; i++) {
+            Connection* c = events[i].data.ptr;
+            bool open = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if(open && (events[i].events & EPOLLOUT))
+                flushOutput(c);
+            if(open && (events[i].events & (EPOLLIN | EPOLLRDHUP)))
+                open = readInput(c);
+            if(!open || c->broken)
+                closeConnection(w, c);
+        }
+    }
+    return null;
+}
+
+static void printStats(void) {
+    uint64_t moves = atomic_load(&server.moves);
+    INFO("%llu connections, %llu games playing, %llu finished, %llu moves, validation avg %.2f us max %llu us\n",
+         (unsigned long long)atomic_load(&server.connections), (unsigned long long)atomic_load(&server.activeGames),
+         (unsigned long long)atomic_load(&server.finishedGames), (unsigned long long)moves,
+         moves ? (double)atomic_load(&server.validationUs) / moves : 0.0,
+         (unsigned long long)atomic_load(&server.maxValidationUs));
+    if(atomic_load(&server.frames))
+        INFO("%llu spectators, %llu frames, %llu backlogs coalesced\n", (unsigned long long)atomic_load(&server.spectators),
+             (unsigned long long)atomic_load(&server.frames), (unsigned long long)atomic_load(&server.coalesced));
+    fflush(stdout);
+}
+
+static void printUsage(void) {
+    printf("Usage: server [-p port] [-t threads] [-a address]\n");
+    printf("  listens on 127.0.0.1:7777 with 4 threads by default\n");
+}
+
+int main(int argc, char** argv) {
+    int port = 7777;
+    int threads = 4;
+    const char* address = "127.0.0.1";
+
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-p") && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-a") && i + 1 < argc)
+            address = argv[++i];
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    threads = threads < 1 ? 1 : threads > MAX_WORKERS ? MAX_WORKERS : threads;
+
+    // two sockets per game
+    struct rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    initPosition();
+    server.games = calloc(MAX_GAMES, sizeof(ServerGame));
+    ASSERT(server.games != null, "Failed to allocate the games!\n");
+    for(int i = 0; i < MAX_GAMES; i++) {
+        pthread_mutex_init(&server.games[i].lock, null);
+        server.freeGames[i] = MAX_GAMES - 1 - i;
+    }
+    server.freeCount = MAX_GAMES;
+    pthread_mutex_init(&server.gamesLock, null);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    if(listener < 0 || inet_pton(AF_INET, address, &addr.sin_addr) != 1
+        || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 4096) != 0) {
+        ERROR("Can't listen on %s:%d\n", address, port);
+        return 1;
+    }
+
+    // accept drains the backlog until it would block
+    setNonBlocking(listener);
+
+    server.workerCount = threads;
+    for(int t = 0; t < threads; t++) {
+        server.workers[t].epoll = epoll_create1(EPOLL_CLOEXEC);
+        ASSERT(server.workers[t].epoll >= 0, "Can't create an epoll instance!\n");
+        pthread_create(&server.workers[t].thread, null, workerMain, &server.workers[t]);
+    }
+    INFO("Listening on %s:%d with %d threads, up to %llu open files\n", address, port, threads,
+         (unsigned long long)limit.rlim_cur);
+    fflush(stdout);
+
+    int64_t lastStats = getTimeMs();
+    uint64_t lastMoves = 0;
+    int next = 0;
+    while(true) {
+        struct pollfd pfd = { listener, POLLIN, 0 };
+        if(poll(&pfd, 1, 1000) > 0) {
+            int fd;
+            while((fd = accept(listener, null, null)) >= 0) {
+                setNonBlocking(fd);
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                Connection* c = calloc(1, sizeof(Connection));
+                ASSERT(c != null, "Failed to allocate a connection!\n");
+                c->fd = fd;
+                atomic_init(&c->game, -1);
+                atomic_init(&c->watching, -1);
+                pthread_mutex_init(&c->lock, null);
+                atomic_fetch_add(&server.connections, 1);
+
+                // the connection stays on this thread's epoll until it closes
+                Worker* w = &server.workers[next];
+                next = (next + 1) % server.workerCount;
+                struct epoll_event event = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = c };
+                epoll_ctl(w->epoll, EPOLL_CTL_ADD, fd, &event);
+            }
+        }
+
+        int64_t now = getTimeMs();
+        if(now - lastStats >= STATS_INTERVAL_MS) {
+            lastStats = now;
+            if(atomic_load(&server.moves) != lastMoves) {
+                lastMoves = atomic_load(&server.moves);
+                printStats();
+            }
+        }
+    }
+    return 0;
+}
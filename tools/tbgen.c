@@ -0,0 +1,690 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "defines.h"
+#include "position.h"
+#include "tb.h"
+#include "platform.h"
+
+// Retrograde generator for the tables probed by tb.c
+//
+// Every position of a signature is classified once by a forward pass, moves
+// leaving the table (captures and promotions) are looked up in the smaller
+// tables, which are generated first. After that each iteration n resolves
+// the positions mated in n plies by walking back from the ones resolved at
+// n - 1, wins on odd and losses on even iterations.
+//
+// Per position the generator keeps 2 bits of state (a TBValue, where draw
+// also means unresolved) and one byte that holds the distance once resolved
+// and the best result through an exit before that. That is 10 bits, about 5
+// times the 2 bits a WDL only generator would need.
+
+#define GEN_MAX_PIECES TB_MAX_PIECES
+#define GEN_CHUNK 16384
+#define DTM_MAX TB_DTM_MAX
+// the pending byte of positions which can't lose, an exit draws
+#define EXIT_BLOCKED 255
+
+typedef struct {
+    TBSignature sig;
+    _Atomic uint8_t* states[TEAMS];
+    _Atomic uint8_t* dtm[TEAMS];
+
+    int threads;
+    int ply;
+    _Atomic uint64_t next;
+    _Atomic uint64_t resolved;
+    _Atomic int maxPending;
+    atomic_bool failed;
+} Generator;
+
+static inline int getState(Generator* g, int side, uint64_t index) {
+    return (atomic_load_explicit(&g->states[side][index >> 2], memory_order_relaxed) >> ((index & 3) * 2)) & 3;
+}
+
+// Sets the state of an unresolved position, false if another thread was first
+static inline bool claimState(Generator* g, int side, uint64_t index, TBValue value) {
+    _Atomic uint8_t* byte = &g->states[side][index >> 2];
+    int shift = (index & 3) * 2;
+    uint8_t old = atomic_load_explicit(byte, memory_order_relaxed);
+    do {
+        if((old >> shift) & 3)
+            return false;
+    } while(!atomic_compare_exchange_weak_explicit(byte, &old, (uint8_t)(old | value << shift),
+                                                   memory_order_relaxed, memory_order_relaxed));
+    return true;
+}
+
+static inline int getDtm(Generator* g, int side, uint64_t index) {
+    return atomic_load_explicit(&g->dtm[side][index], memory_order_relaxed);
+}
+
+static inline void setDtm(Generator* g, int side, uint64_t index, int value) {
+    atomic_store_explicit(&g->dtm[side][index], (uint8_t)value, memory_order_relaxed);
+}
+
+static Bitboard pieceAttacks(uint8_t piece, int sq, Bitboard occupied) {
+    switch(pieceType(piece)) {
+        case PAWN:   return PAWN_ATTACKS[pieceTeam(piece)][sq];
+        case KNIGHT: return KNIGHT_ATTACKS[sq];
+        case BISHOP: return bishopAttacks(sq, occupied);
+        case ROOK:   return rookAttacks(sq, occupied);
+        case QUEEN:  return queenAttacks(sq, occupied);
+        default:     return KING_ATTACKS[sq];
+    }
+}
+
+// Whether 'team' attacks the king of the other team in the placement
+static bool attacksKing(const TBSignature* sig, const int* squares, Bitboard occupied, PieceTeam team) {
+    int king = squares[team == TEAM_WHITE ? 1 : 0];
+    for(int i = 0; i < sig->count; i++) {
+        if(pieceTeam(sig->pieces[i]) == team && (pieceAttacks(sig->pieces[i], squares[i], occupied) & squareBB(king)))
+            return true;
+    }
+    return false;
+}
+
+// Decodes the index and checks that it is a legal placement with 'side' to move
+static bool decodePlacement(const TBSignature* sig, int side, uint64_t index, int* squares, Bitboard* occupied) {
+    tbDecodeIndex(sig, index, squares);
+
+    Bitboard occ = 0;
+    for(int i = 0; i < sig->count; i++) {
+        if(occ & squareBB(squares[i]))
+            return false;
+        if(pieceType(sig->pieces[i]) == PAWN && (squareBB(squares[i]) & (RANK_1_BB | RANK_8_BB)))
+            return false;
+        occ |= squareBB(squares[i]);
+    }
+    *occupied = occ;
+
+    return !attacksKing(sig, squares, occ, (PieceTeam)side);
+}
+
+static void buildPosition(const TBSignature* sig, int side, const int* squares, Position* pos) {
+    positionClear(pos);
+    for(int i = 0; i < sig->count; i++)
+        positionPutPiece(pos, pieceTeam(sig->pieces[i]), pieceType(sig->pieces[i]), squares[i]);
+    // only the material key is needed, for probing the smaller tables
+    pos->side = (PieceTeam)side;
+}
+
+static inline bool isExit(const Position* pos, Move m) {
+    return isCapture(pos, m) || moveFlag(m) == MOVE_PROMOTION;
+}
+
+static void atomicMax(_Atomic int* target, int value) {
+    int old = atomic_load_explicit(target, memory_order_relaxed);
+    while(old < value && !atomic_compare_exchange_weak_explicit(target, &old, value, memory_order_relaxed, memory_order_relaxed));
+}
+
+// Forward pass: invalid positions, mates and the results reachable through exits
+static void classify(Generator* g, int side, uint64_t index) {
+    const TBSignature* sig = &g->sig;
+    int squares[TB_MAX_PIECES];
+    Bitboard occupied;
+
+    if(!decodePlacement(sig, side, index, squares, &occupied)) {
+        claimState(g, side, index, TB_INVALID);
+        return;
+    }
+
+    Position pos;
+    buildPosition(sig, side, squares, &pos);
+
+    MoveList list;
+    generateLegalMoves(&pos, &list);
+    if(!list.count) {
+        if(positionInCheck(&pos))
+            claimState(g, side, index, TB_LOSS);
+        else
+            setDtm(g, side, index, EXIT_BLOCKED);
+        return;
+    }
+
+    int bestWin = 0, worstLoss = 0;
+    bool draw = false;
+    for(int i = 0; i < list.count; i++) {
+        Move m = list.moves[i];
+        if(!isExit(&pos, m))
+            continue;
+
+        Position next = pos;
+        positionMakeMove(&next, m);
+
+        TBValue wdl;
+        int dtm;
+        MoveList replies;
+        generateLegalMoves(&next, &replies);
+        if(!replies.count) {
+            wdl = positionInCheck(&next) ? TB_LOSS : TB_DRAW;
+            dtm = 0;
+        } else if(!tbProbeDTM(&next, &wdl, &dtm)) {
+            atomic_store(&g->failed, true);
+            return;
+        }
+
+        int plies = dtm + 1 < DTM_MAX ? dtm + 1 : DTM_MAX;
+        if(wdl == TB_LOSS && (!bestWin || plies < bestWin))
+            bestWin = plies;
+        else if(wdl == TB_WIN && plies > worstLoss)
+            worstLoss = plies;
+        else if(wdl == TB_DRAW)
+            draw = true;
+    }
+
+    int pending = bestWin ? bestWin : draw ? EXIT_BLOCKED : worstLoss;
+    setDtm(g, side, index, pending);
+    if(pending != EXIT_BLOCKED)
+        atomicMax(&g->maxPending, pending);
+}
+
+// A position is lost once every move reaches a position the opponent already won
+static bool verifyLoss(Generator* g, int side, uint64_t index, int ply) {
+    int pending = getDtm(g, side, index);
+    if(pending == EXIT_BLOCKED || (pending & 1) || pending > ply)
+        return false;
+
+    const TBSignature* sig = &g->sig;
+    int squares[TB_MAX_PIECES];
+    Bitboard occupied;
+    if(!decodePlacement(sig, side, index, squares, &occupied))
+        return false;
+
+    Position pos;
+    buildPosition(sig, side, squares, &pos);
+
+    // pseudo legal moves are enough, the illegal ones lead to invalid placements
+    MoveList list;
+    generateMoves(&pos, &list);
+    for(int i = 0; i < list.count; i++) {
+        Move m = list.moves[i];
+        if(isExit(&pos, m))
+            continue;
+
+        int child[TB_MAX_PIECES];
+        memcpy(child, squares, sizeof(int) * sig->count);
+        for(int j = 0; j < sig->count; j++) {
+            if(child[j] == moveFrom(m))
+                child[j] = moveTo(m);
+        }
+
+        int state = getState(g, !side, tbIndex(sig, child));
+        if(state != TB_WIN && state != TB_INVALID)
+            return false;
+    }
+
+    return true;
+}
+
+static void resolve(Generator* g, int side, uint64_t index, int ply) {
+    if(getState(g, side, index))
+        return;
+
+    if(ply & 1) {
+        if(claimState(g, side, index, TB_WIN)) {
+            setDtm(g, side, index, ply);
+            atomic_fetch_add_explicit(&g->resolved, 1, memory_order_relaxed);
+        }
+    } else if(verifyLoss(g, side, index, ply)) {
+        if(claimState(g, side, index, TB_LOSS)) {
+            setDtm(g, side, index, ply);
+            atomic_fetch_add_explicit(&g->resolved, 1, memory_order_relaxed);
+        }
+    }
+}
+
+// Pawnless placements with the white king on the a1-h8 diagonal are stored twice,
+// mirrored along it, and only one of them is reached by walking back
+static void resolveWithTwin(Generator* g, int side, uint64_t index, int ply) {
+    const TBSignature* sig = &g->sig;
+    resolve(g, side, index, ply);
+    if(sig->hasPawns)
+        return;
+
+    int squares[TB_MAX_PIECES];
+    tbDecodeIndex(sig, index, squares);
+    if(squareFile(squares[0]) != squareRank(squares[0]))
+        return;
+    for(int i = 0; i < sig->count; i++)
+        squares[i] = makeSquare(squareRank(squares[i]), squareFile(squares[i]));
+    resolve(g, side, tbIndex(sig, squares), ply);
+}
+
+// Walks back every quiet move of the side that just moved into the position
+static void resolvePredecessors(Generator* g, int side, uint64_t index, int ply) {
+    const TBSignature* sig = &g->sig;
+    int squares[TB_MAX_PIECES];
+    Bitboard occupied;
+    tbDecodeIndex(sig, index, squares);
+    occupied = 0;
+    for(int i = 0; i < sig->count; i++)
+        occupied |= squareBB(squares[i]);
+
+    PieceTeam mover = (PieceTeam)!side;
+    for(int i = 0; i < sig->count; i++) {
+        uint8_t piece = sig->pieces[i];
+        if(pieceTeam(piece) != mover)
+            continue;
+
+        int sq = squares[i];
+        Bitboard origins;
+        if(pieceType(piece) == PAWN) {
+            int back = mover == TEAM_WHITE ? -8 : 8;
+            origins = 0;
+            if(relativeRank(mover, sq) >= 2 && !(occupied & squareBB(sq + back))) {
+                origins |= squareBB(sq + back);
+                if(relativeRank(mover, sq) == 3 && !(occupied & squareBB(sq + 2 * back)))
+                    origins |= squareBB(sq + 2 * back);
+            }
+        } else {
+            origins = pieceAttacks(piece, sq, occupied) & ~occupied;
+        }
+
+        while(origins) {
+            int from = popLsb(&origins);
+            int prev[TB_MAX_PIECES];
+            memcpy(prev, squares, sizeof(int) * sig->count);
+            prev[i] = from;
+
+            // the side to move in the predecessor can't have left its opponent in check
+            Bitboard occ = occupied ^ squareBB(sq) ^ squareBB(from);
+            if(attacksKing(sig, prev, occ, mover))
+                continue;
+
+            resolveWithTwin(g, mover, tbIndex(sig, prev), ply);
+        }
+    }
+}
+
+static void* classifyWorker(void* arg) {
+    Generator* g = (Generator*)arg;
+    uint64_t total = g->sig.positions * TEAMS;
+
+    uint64_t start;
+    while((start = atomic_fetch_add(&g->next, GEN_CHUNK)) < total && !atomic_load(&g->failed)) {
+        uint64_t end = start + GEN_CHUNK < total ? start + GEN_CHUNK : total;
+        for(uint64_t i = start; i < end; i++)
+            classify(g, (int)(i / g->sig.positions), i % g->sig.positions);
+    }
+
+    return null;
+}
+
+static void* iterationWorker(void* arg) {
+    Generator* g = (Generator*)arg;
+    uint64_t total = g->sig.positions * TEAMS;
+    int ply = g->ply;
+    // positions resolved in the last iteration have the opposite result
+    int previous = ply & 1 ? TB_LOSS : TB_WIN;
+
+    uint64_t start;
+    while((start = atomic_fetch_add(&g->next, GEN_CHUNK)) < total) {
+        uint64_t end = start + GEN_CHUNK < total ? start + GEN_CHUNK : total;
+        for(uint64_t i = start; i < end; i++) {
+            int side = (int)(i / g->sig.positions);
+            uint64_t index = i % g->sig.positions;
+            int state = getState(g, side, index);
+
+            if(state == previous && getDtm(g, side, index) == ply - 1)
+                resolvePredecessors(g, side, index, ply);
+            else if(state == TB_DRAW && getDtm(g, side, index) == ply)
+                resolve(g, side, index, ply);
+        }
+    }
+
+    return null;
+}
+
+static void runWorkers(Generator* g, void* (*fn)(void*)) {
+    pthread_t handles[256];
+    int count = g->threads < 256 ? g->threads : 256;
+
+    atomic_store(&g->next, 0);
+    for(int i = 1; i < count; i++)
+        pthread_create(&handles[i], null, fn, g);
+    fn(g);
+    for(int i = 1; i < count; i++)
+        pthread_join(handles[i], null);
+}
+
+static void writeU32(uint8_t* p, uint32_t v) {
+    for(int i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void writeU64(uint8_t* p, uint64_t v) {
+    for(int i = 0; i < 8; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// Values of one block, positions that are never probed repeat the previous value so the runs get longer
+static void fillBlock(Generator* g, int side, bool wdl, uint64_t start, size_t count, uint8_t* values) {
+    uint8_t last = 0;
+    for(size_t i = 0; i < count; i++) {
+        int state = getState(g, side, start + i);
+        if(wdl)
+            last = state == TB_INVALID ? last : (uint8_t)state;
+        else if(state == TB_WIN || state == TB_LOSS)
+            last = (uint8_t)getDtm(g, side, start + i);
+        values[i] = last;
+    }
+}
+
+static bool writeTable(Generator* g, FILE* file, int kind, uint64_t offset, uint64_t* size) {
+    const TBSignature* sig = &g->sig;
+    uint32_t blockCount = (uint32_t)((sig->positions + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE);
+    bool wdl = kind == TB_TABLE_WDL_WHITE || kind == TB_TABLE_WDL_BLACK;
+    int side = kind == TB_TABLE_WDL_WHITE || kind == TB_TABLE_DTM_WHITE ? TEAM_WHITE : TEAM_BLACK;
+
+    uint8_t values[TB_BLOCK_SIZE];
+    uint8_t* out = malloc(3 * TB_BLOCK_SIZE);
+    uint8_t* offsets = malloc(8 * ((size_t)blockCount + 1));
+    ASSERT(out != null && offsets != null, "Failed to allocate the encoding buffers!\n");
+
+    // the sizes first so the offsets can be written before the blocks
+    uint64_t position = offset + 8 * ((uint64_t)blockCount + 1);
+    for(uint32_t b = 0; b < blockCount; b++) {
+        uint64_t start = (uint64_t)b * TB_BLOCK_SIZE;
+        size_t count = sig->positions - start < TB_BLOCK_SIZE ? (size_t)(sig->positions - start) : TB_BLOCK_SIZE;
+        fillBlock(g, side, wdl, start, count, values);
+        writeU64(offsets + 8 * b, position);
+        position += tbEncodeBlock(values, count, wdl, out);
+    }
+    writeU64(offsets + 8 * blockCount, position);
+
+    bool ok = fwrite(offsets, 8, (size_t)blockCount + 1, file) == (size_t)blockCount + 1;
+    for(uint32_t b = 0; ok && b < blockCount; b++) {
+        uint64_t start = (uint64_t)b * TB_BLOCK_SIZE;
+        size_t count = sig->positions - start < TB_BLOCK_SIZE ? (size_t)(sig->positions - start) : TB_BLOCK_SIZE;
+        fillBlock(g, side, wdl, start, count, values);
+        size_t n = tbEncodeBlock(values, count, wdl, out);
+        ok = fwrite(out, 1, n, file) == n;
+    }
+
+    free(out);
+    free(offsets);
+    *size = position - offset;
+    return ok;
+}
+
+static bool writeFile(Generator* g, const char* path) {
+    const TBSignature* sig = &g->sig;
+    char tmp[1040];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE* file = fopen(tmp, "wb");
+    if(!file) {
+        ERROR("Can't create %s\n", tmp);
+        return false;
+    }
+
+    // the table offsets are only known once the tables before them are written
+    uint8_t header[TB_HEADER_SIZE] = {0};
+    uint64_t offsets[TB_TABLE_COUNT];
+    uint64_t position = TB_HEADER_SIZE;
+    bool ok = fwrite(header, 1, TB_HEADER_SIZE, file) == TB_HEADER_SIZE;
+    for(int kind = 0; ok && kind < TB_TABLE_COUNT; kind++) {
+        uint64_t size;
+        offsets[kind] = position;
+        ok = writeTable(g, file, kind, position, &size);
+        position += size;
+    }
+
+    memcpy(header, "CTB1", 4);
+    header[4] = (uint8_t)sig->count;
+    header[5] = TB_METRIC_DTM;
+    memcpy(header + 6, sig->pieces, sig->count);
+    writeU32(header + 12, TB_BLOCK_SIZE);
+    writeU32(header + 16, (uint32_t)((sig->positions + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE));
+    writeU64(header + 24, sig->positions);
+    for(int kind = 0; kind < TB_TABLE_COUNT; kind++)
+        writeU64(header + 32 + 8 * kind, offsets[kind]);
+
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, TB_HEADER_SIZE, file) == TB_HEADER_SIZE;
+    ok = fclose(file) == 0 && ok;
+
+    if(ok) {
+        remove(path);
+        ok = rename(tmp, path) == 0;
+    }
+    if(!ok) {
+        ERROR("Failed to write %s\n", path);
+        remove(tmp);
+    }
+
+    return ok;
+}
+
+static bool generate(const TBSignature* sig, const char* path, int threads) {
+    char name[16];
+    tbSignatureName(sig, name);
+    INFO("Generating %s, %llu positions per side, %.1f MB\n", name, (unsigned long long)sig->positions,
+         2 * sig->positions * 10 / 8 / 1048576.0);
+
+    int64_t startTime = getTimeMs();
+    Generator* g = calloc(1, sizeof(Generator));
+    ASSERT(g != null, "Failed to allocate the generator!\n");
+    g->sig = *sig;
+    g->threads = threads;
+
+    bool ok = true;
+    for(int side = 0; side < TEAMS; side++) {
+        g->states[side] = calloc((sig->positions + 3) / 4, 1);
+        g->dtm[side] = calloc(sig->positions, 1);
+        if(!g->states[side] || !g->dtm[side])
+            ok = false;
+    }
+
+    if(!ok) {
+        ERROR("Not enough memory for %s\n", name);
+    } else {
+        runWorkers(g, classifyWorker);
+        if(atomic_load(&g->failed)) {
+            ERROR("A table %s depends on is missing or invalid\n", name);
+            ok = false;
+        }
+    }
+
+    int idle = 0;
+    for(int ply = 1; ok && ply <= DTM_MAX; ply++) {
+        g->ply = ply;
+        atomic_store(&g->resolved, 0);
+        runWorkers(g, iterationWorker);
+
+        // a win and a loss iteration without progress end it, unless exits still resolve later
+        idle = atomic_load(&g->resolved) ? 0 : idle + 1;
+        if(idle >= 2 && ply >= atomic_load(&g->maxPending))
+            break;
+    }
+
+    if(ok) {
+        uint64_t counts[4] = {0};
+        int longest = 0;
+        for(int side = 0; side < TEAMS; side++) {
+            for(uint64_t i = 0; i < sig->positions; i++) {
+                int state = getState(g, side, i);
+                counts[state]++;
+                if((state == TB_WIN || state == TB_LOSS) && getDtm(g, side, i) > longest)
+                    longest = getDtm(g, side, i);
+            }
+        }
+        INFO("%s: %llu wins, %llu draws, %llu losses, longest mate %d plies\n", name,
+             (unsigned long long)counts[TB_WIN], (unsigned long long)counts[TB_DRAW],
+             (unsigned long long)counts[TB_LOSS], longest);
+
+        ok = writeFile(g, path);
+    }
+
+    for(int side = 0; side < TEAMS; side++) {
+        free((void*)g->states[side]);
+        free((void*)g->dtm[side]);
+    }
+    free(g);
+
+    if(ok)
+        INFO("%s done in %.1fs\n", name, (getTimeMs() - startTime) / 1000.0);
+    return ok;
+}
+
+static bool fileExists(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if(file)
+        fclose(file);
+    return file != null;
+}
+
+// Canonical signature of a material combination given as counts per team
+static bool signatureFromCounts(const int counts[TEAMS][PIECE_TYPES], TBSignature* sig) {
+    static const char* LETTERS = "PRNBQK";
+    char name[32];
+    int n = 0;
+
+    for(int team = 0; team < TEAMS; team++) {
+        if(team == TEAM_BLACK)
+            name[n++] = 'v';
+        name[n++] = 'K';
+        for(int type = QUEEN; type >= PAWN; type--) {
+            for(int i = 0; i < counts[team][type]; i++)
+                name[n++] = LETTERS[type];
+        }
+    }
+    name[n] = '\0';
+
+    return tbParseSignature(name, sig);
+}
+
+// Generates the table and, first, every table reachable from it by a capture or a promotion
+static bool generateWithDependencies(const TBSignature* sig, const char* dir, int threads) {
+    char name[16], path[1024];
+    tbSignatureName(sig, name);
+    snprintf(path, sizeof(path), "%s/%s%s", dir, name, TB_EXTENSION);
+    if(fileExists(path))
+        return true;
+
+    int counts[TEAMS][PIECE_TYPES] = {{0}};
+    for(int i = 2; i < sig->count; i++)
+        counts[pieceTeam(sig->pieces[i])][pieceType(sig->pieces[i])]++;
+
+    for(int team = 0; team < TEAMS; team++) {
+        for(int type = PAWN; type < KING; type++) {
+            if(!counts[team][type])
+                continue;
+
+            TBSignature child;
+            counts[team][type]--;
+            bool ok = sig->count - 1 < 3 || (signatureFromCounts(counts, &child) && generateWithDependencies(&child, dir, threads));
+            counts[team][type]++;
+            if(!ok)
+                return false;
+
+            if(type != PAWN)
+                continue;
+            for(int promo = ROOK; promo <= QUEEN; promo++) {
+                counts[team][PAWN]--;
+                counts[team][promo]++;
+                ok = signatureFromCounts(counts, &child) && generateWithDependencies(&child, dir, threads);
+                counts[team][promo]--;
+                counts[team][PAWN]++;
+                if(!ok)
+                    return false;
+            }
+        }
+    }
+
+    // the tables just written have to be visible to the probes
+    tbInit(dir);
+    bool ok = generate(sig, path, threads);
+    tbInit(dir);
+    return ok;
+}
+
+// Every combination of up to 'pieces' pieces, smaller ones first
+static bool generateAll(int pieces, const char* dir, int threads) {
+    for(int count = 3; count <= pieces; count++) {
+        int extra = count - 2;
+        // each of the extra pieces picks a team and a type, 10 choices
+        int combinations = 1;
+        for(int i = 0; i < extra; i++)
+            combinations *= 10;
+
+        for(int c = 0; c < combinations; c++) {
+            int counts[TEAMS][PIECE_TYPES] = {{0}};
+            int code = c, last = 0;
+            bool ordered = true;
+            for(int i = 0; i < extra; i++) {
+                int choice = code % 10;
+                code /= 10;
+                // only count every multiset once
+                if(choice < last)
+                    ordered = false;
+                last = choice;
+                counts[choice / 5][choice % 5]++;
+            }
+
+            TBSignature sig;
+            if(ordered && signatureFromCounts(counts, &sig) && !generateWithDependencies(&sig, dir, threads))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static void printUsage(void) {
+    printf("Usage: tbgen [-t threads] [-o dir] <KQvK ...>\n");
+    printf("       tbgen [-t threads] [-o dir] --all <pieces>\n");
+    printf("Tables up to %d pieces, missing smaller ones are generated too.\n", GEN_MAX_PIECES);
+    printf("Memory is 10 bits per position and side to move for the distances, about 5 times\n");
+    printf("a 2 bit WDL table: up to 1.3 GB for the 5 piece tables with pawns.\n");
+}
+
+int main(int argc, char** argv) {
+    const char* dir = ".";
+    int threads = getCpuCount();
+    int all = 0;
+    int first = argc;
+
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "-o") && i + 1 < argc) {
+            dir = argv[++i];
+        } else if(!strcmp(argv[i], "--all") && i + 1 < argc) {
+            all = atoi(argv[++i]);
+        } else {
+            first = i;
+            break;
+        }
+    }
+
+    if(threads < 1)
+        threads = 1;
+    if((!all && first == argc) || all > GEN_MAX_PIECES) {
+        printUsage();
+        return 1;
+    }
+
+    initPosition();
+
+    bool ok = true;
+    if(all)
+        ok = generateAll(all, dir, threads);
+
+    for(int i = first; ok && i < argc; i++) {
+        TBSignature sig;
+        if(!tbParseSignature(argv[i], &sig) || sig.count < 3 || sig.count > GEN_MAX_PIECES) {
+            ERROR("Invalid signature: %s\n", argv[i]);
+            ok = false;
+            break;
+        }
+        ok = generateWithDependencies(&sig, dir, threads);
+    }
+
+    tbFree();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "position.h"
+#include "book.h"
+
+// Checks of what the core reads from and writes for other programs
+//
+// test    runs everything, the exit code is the number of failed checks
+
+static int failures = 0;
+
+#define CHECK(expr) do { if(!(expr)) { ERROR("%s:%d: %s\n", __FILE__, __LINE__, #expr); failures++; } } while(0)
+
+static void testFen(void) {
+    Position pos;
+    char fen[FEN_MAX_LENGTH + 1];
+
+    // as long as a legal position gets: five pieces on the back ranks keep the castling
+    // rights, five on the fifth rank keep the en passant square, the counters are at the maximum
+    const char* longest = "r1b1k1nr/p1p1p1p1/p1n1q1p1/1b1pP1p1/P1P1P1P1/1P1N1Q1P/1P1B4/R1B1K1NR w KQkq d6 65535 65535";
+    CHECK(positionSetFen(&pos, longest));
+    CHECK(positionGetFen(&pos, fen) == (int)strlen(longest));
+    CHECK(!strcmp(fen, longest));
+    CHECK(strlen(longest) <= FEN_MAX_LENGTH);
+
+    CHECK(positionSetFen(&pos, START_FEN));
+    CHECK(positionGetFen(&pos, fen) && !strcmp(fen, START_FEN));
+
+    // more than 16 pieces a side
+    CHECK(!positionSetFen(&pos, "r1n1k1nr/1p1p1p1p/p1p1p1p1/1p1p1P1p/p1p1p1p1/1P1P1P1P/P1P1P1P1/R1N1K1NR b KQkq - 65535 65535"));
+    CHECK(!positionSetFen(&pos, "rnbqkbnr/pppppppp/8/8/8/N7/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+    // more officers than promotions allow
+    CHECK(!positionSetFen(&pos, "QQQQQQQQ/QQk5/8/8/8/8/8/4K3 w - - 0 1"));
+    CHECK(!positionSetFen(&pos, "4k3/8/8/8/8/8/PPPPPPPP/QQ2K3 w - - 0 1"));
+    CHECK(positionSetFen(&pos, "4k3/8/8/8/8/8/PPPPPPP1/QQ2K3 w - - 0 1"));
+    // counters past 16 bits
+    CHECK(!positionSetFen(&pos, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 99999 70000"));
+    CHECK(!positionSetFen(&pos, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 65536"));
+}
+
+static void testBookKey(void) {
+    // the keys listed with Polyglot's book format, each line one move further
+    static const struct {
+        const char* move;
+        uint64_t key;
+    } LINES[] = {
+        { null, 0x463B96181691FC9CULL },
+        { "e2e4", 0x823C9B50FD114196ULL },
+        { "d7d5", 0x0756B94461C50FB0ULL },
+        { "e4e5", 0x662FAFB965DB29D4ULL },
+        { "f7f5", 0x22A48B5A8E47FF78ULL },
+        { "e1e2", 0x652A607CA3F242C1ULL },
+        { "e8f7", 0x00FDD303C946BDD9ULL },
+        { null, 0x463B96181691FC9CULL },
+        { "a2a4", 0 },
+        { "b7b5", 0 },
+        { "h2h4", 0 },
+        { "b5b4", 0 },
+        { "c2c4", 0x3C8123EA7B067637ULL },
+        { "b4c3", 0 },
+        { "a1a3", 0x5C3F9B829B279560ULL },
+    };
+    Position pos;
+
+    for(size_t i = 0; i < sizeof(LINES) / sizeof(LINES[0]); i++) {
+        if(!LINES[i].move) {
+            CHECK(positionSetFen(&pos, START_FEN));
+        } else {
+            Move move = parseMove(&pos, LINES[i].move);
+            CHECK(move != MOVE_NONE);
+            positionMakeMove(&pos, move);
+        }
+        if(LINES[i].key && bookKey(&pos) != LINES[i].key) {
+            ERROR("Book key after %s: %016llx\n", LINES[i].move ? LINES[i].move : "the start",
+                  (unsigned long long)bookKey(&pos));
+            failures++;
+        }
+    }
+}
+
+int main(void) {
+    initPosition();
+
+    testFen();
+    testBookKey();
+
+    if(failures)
+        ERROR("%d checks failed\n", failures);
+    else
+        INFO("All checks passed\n");
+    return failures;
+}